@@ -1,6 +1,7 @@
 #pragma once
+#include <optional>
 #include <string>
-#include <unordered_set>
+#include <vector>
 
 class Proxy_Config
 {
@@ -9,32 +10,88 @@ class Proxy_Config
 
         struct Proxy_Settings // настройки конфига
         {
-            int64_t max_connections = 256; // пока что не используется
-            int64_t timeout_milliseconds = 10000;
+            int64_t max_connections = 256; // максимальное кол-во одновременных сессий
+            int64_t timeout_milliseconds = 10000; // простой туннеля и пересылки тела (без данных в обе стороны)
+            int64_t header_timeout_milliseconds = 10000; // весь заголовок запроса должен прийти за это время (защита от slowloris)
+            int64_t dns_timeout_milliseconds = 5000; // резолвинг хоста назначения
+            int64_t connect_timeout_milliseconds = 10000; // подключение к upstream'у (все попытки Happy Eyeballs)
+            int64_t first_byte_timeout_milliseconds = 30000; // от отправки запроса до заголовка ответа upstream'а
             // int64_t из за того что toml не хочет принимать std::size_t
 
             std::string host = "0.0.0.0"; // пока что не используется
             unsigned short port = 12345;
 
             bool log_on = false;
+            bool access_log_on = false; // бинарный access log (запись на сессию)
+            std::string access_log_file_name = "access.bin";
+            int64_t access_log_file_size_bytes = 1024 * 1024 * 64; // размер одного файла до ротации
             std::string log_file_name = "proxy.log";
             int64_t log_file_size_bytes = 1024 * 1024 * 16; // 16 мб по дефолту
+            int64_t log_buffer_bytes = 1024 * 256; // буфер записей лога на каждый поток, при переполнении записи отбрасываются
 
-            int64_t max_bandwidth_per_sec = 1024 * 1024 * 2; // 2 мб/сек по дефолту
+            int64_t max_bandwidth_per_sec = 1024 * 1024 * 2; // 2 мб/сек по дефолту (на пользователя, в каждом направлении), 0 - без ограничений
+            int64_t max_upload_bandwidth_per_sec = 0; // отдельный лимит пользователя на отправку (клиент -> сервер), 0 - как max_bandwidth_per_sec
+            int64_t global_download_bandwidth_per_sec = 0; // общий лимит прокси на загрузку (сервер -> клиент), 0 - без ограничений
+            int64_t global_upload_bandwidth_per_sec = 0; // общий лимит прокси на отправку, 0 - без ограничений
+            int64_t connection_bandwidth_per_sec = 0; // лимит одного соеденения в каждом направлении, 0 - без ограничений
+            int64_t destination_bandwidth_per_sec = 0; // лимит на один хост назначения в каждом направлении, 0 - без ограничений
+            int64_t bandwidth_burst_percent = 150; // размер ведра каждого лимитера в процентах от секундной скорости
 
             bool blacklist_on = false;
             std::string blacklisted_hosts_file_name = "blacklisted_hosts.toml";
+            std::string blacklisted_addresses_file_name = ""; // CIDR правила для адресов назначения (после DNS), пусто - выключено
+            std::string blacklisted_clients_file_name = ""; // CIDR правила для адресов клиентов (при accept), пусто - выключено
+
+            int64_t worker_threads = 1; // кол-во воркеров (у каждого свой io_context и acceptor), 0 - по кол-ву ядер
+
+            bool reject_when_overloaded = false; // при max_connections сразу отвечать 503 вместо ожидания слота
+            int64_t retry_after_seconds = 5; // значение Retry-After в ответе 503
+
+            int64_t upstream_pool_max_idle = 64; // максимум idle keep-alive соеденений к upstream'ам (на воркер)
+            int64_t upstream_pool_max_per_host = 32; // максимум соеденений к одному host:port (на воркер), 0 - без ограничений
+            int64_t upstream_pool_idle_timeout_milliseconds = 30000; // сколько idle соеденение хранится в пуле
+
+            int64_t dns_cache_max_entries = 4096; // максимум записей в кеше DNS, 0 - кеш выключен
+            int64_t dns_cache_ttl_seconds = 60; // сколько хранится успешный ответ DNS
+            int64_t dns_negative_ttl_seconds = 5; // сколько хранится ошибка резолвинга
+            bool dns_native_resolver = false; // собственный DNS клиент по /etc/resolv.conf вместо getaddrinfo (без search/ndots и nsswitch)
+
+            int64_t connect_attempt_delay_milliseconds = 250; // задержка перед следующей попыткой подключения (Happy Eyeballs)
+
+            bool tunnel_splice = false; // пересылка в туннелях через splice() без копирования в user space (только linux)
+
+            std::string metrics_host = "127.0.0.1"; // адрес admin listener'а метрик Prometheus
+            unsigned short metrics_port = 0; // порт GET /metrics, 0 - выключено
         };
         
         const Proxy_Settings& get_settings() const {return settings;}; // геттер для получение конфига
 
-        std::unordered_set<std::string> get_blacklisted_hosts() const;
+        std::vector<std::string> get_blacklisted_hosts() const; // правила черного списка (разбирает Domain_matcher)
+
+        // правила из toml файла черного списка, nullopt - файл не прочитан (а не пустой список)
+        static std::optional<std::vector<std::string>> read_blacklist(const std::string& filename);
+
+        // строки текстового файла (списки CIDR), nullopt - файл не прочитан
+        static std::optional<std::vector<std::string>> read_lines(const std::string& filename);
+
+        // повторное чтение того же файла: при ошибке или некорректных значениях остаются текущие настройки (false)
+        bool reload();
+
+        const std::string& file_name() const {return filename;}; // файл конфига
+
+        // настройки, которые применяются только при старте (порт, потоки, логи...): в loaded возвращаются значения running,
+        // возвращаются имена отличавшихся
+        static std::vector<std::string> keep_restart_only(const Proxy_Settings& running, Proxy_Settings& loaded);
 
     private:
         Proxy_Settings settings; // текущий конфиг
 
+        std::string filename; // откуда загружен конфиг
+
     private:
         bool validate() const; // проверка корректности конфига
 
         void load_or_create_cfg(const std::string& filename); // загрузка или создание конфига
+
+        void read_settings(); // разбор файла в settings (исключение при ошибке toml)
 };
\ No newline at end of file
@@ -3,18 +3,25 @@
 
 #include "config/proxy_config.hpp"
 #include "logger/logger.hpp"
+#include "logger/access_log.hpp"
+#include "metrics/proxy_metrics.hpp"
+#include "network/dns_cache.hpp"
+#include "network/domain_matcher.hpp"
+#include "network/ip_matcher.hpp"
+#include "utils/snapshot.hpp"
 #include <atomic>
-#include <condition_variable>
-#include <mutex>
 
 namespace __PROXY_GLOBALS__
 {
-    extern Proxy_Config::Proxy_Settings PROXY_CONFIG;
-    extern std::unordered_set<std::string> BLACKLISTED_HOSTS;
+    extern Snapshot<Proxy_Config::Proxy_Settings> PROXY_CONFIG;
+    extern Snapshot<Domain_matcher> BLACKLISTED_HOSTS;
+    extern Snapshot<Ip_matcher> BLACKLISTED_ADDRESSES;
+    extern Snapshot<Ip_matcher> BLACKLISTED_CLIENTS;
     extern bool LOG_ON;
     extern Logger LOGGER;
     extern Logger DEBUG_LOGGER;
-    extern size_t ACTIVE_CONNECTIONS;
-    extern std::mutex ACTIVE_CONNECTIONS_MUTEX;
-    extern std::condition_variable ACTIVE_CONNECTIONS_COND_VAR;
+    extern Access_log ACCESS_LOG;
+    extern std::atomic<size_t> ACTIVE_CONNECTIONS;
+    extern Dns_cache DNS_CACHE;
+    extern Proxy_metrics METRICS;
 }
\ No newline at end of file
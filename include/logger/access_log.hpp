@@ -0,0 +1,135 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include <boost/asio/ip/address.hpp>
+#include "logger/log_queue.hpp"
+
+// причина завершения сессии
+enum class Access_end : std::uint8_t
+{
+    completed, // клиент закрыл keep-alive соеденение, ответ передан или туннель закрыт
+    bad_request, // запрос не разобран (400)
+    blacklisted, // хост в черном списке
+    header_timeout, // заголовок запроса не пришел вовремя (408)
+    resolve_failed, // ошибка резолвинга
+    connect_failed, // не удалось подключиться к upstream'у
+    upstream_timeout, // резолвинг, подключение или первый байт ответа не уложились в срок (504)
+    upstream_error, // ошибка при отправке запроса или чтении заголовка ответа
+    relay_error, // ошибка при пересылке тела или в туннеле
+    exception // исключение в сессии
+};
+
+const char* access_end_name(Access_end end); // имя причины (csv/json декодера, метки метрик)
+
+// одна запись access log'а - одна сессия (для keep-alive - фазы, хост и статус последнего запроса)
+// фиксированный размер, little-endian, без указателей: файл читается как массив записей
+struct Access_record
+{
+    static constexpr std::uint32_t NONE = UINT32_MAX; // фаза не наступила
+
+    std::uint64_t accept_time = 0; // мкс unix time, 0 - конец записанных данных
+    std::uint64_t duration = 0; // мкс от accept до закрытия
+    std::uint32_t headers = NONE; // мкс от accept до разобранного заголовка запроса
+    std::uint32_t resolved = NONE; // до конца резолвинга
+    std::uint32_t connected = NONE; // до подключения к upstream'у
+    std::uint32_t first_byte = NONE; // до заголовка ответа upstream'а
+    std::uint64_t bytes_up = 0; // записано в upstream
+    std::uint64_t bytes_down = 0; // записано клиенту
+    std::array<std::uint8_t, 16> client_address{}; // ipv6 или ipv4 как ::ffff:a.b.c.d
+    std::array<std::uint8_t, 16> upstream_address{};
+    std::uint32_t requests = 0; // запросов в сессии
+    std::uint16_t status = 0; // статус последнего ответа клиенту
+    std::uint16_t port = 0; // порт назначения
+    Access_end end = Access_end::completed;
+    std::uint8_t tunnel = 0; // 1 - CONNECT
+    std::uint8_t host_size = 0;
+    char host[37] = {}; // хост назначения, у длинных имен хранится конец (он важнее для группировки)
+
+    void set_host(std::string_view name); // запись хоста (обрезается с начала)
+
+    std::string_view host_name() const {return std::string_view(host, host_size);}; // геттер хоста
+
+    static std::array<std::uint8_t, 16> pack_address(const boost::asio::ip::address& address); // адрес в 16 байт
+
+    static boost::asio::ip::address unpack_address(const std::array<std::uint8_t, 16>& bytes); // обратно (v4-mapped -> v4)
+};
+static_assert(sizeof(Access_record) == 128);
+static_assert(std::is_trivially_copyable_v<Access_record>);
+
+// бинарный access log: сессия отдает готовую запись в буфер своего потока (без форматирования и системных вызовов),
+// фоновый поток копирует записи в отображенный в память файл заранее заданного размера;
+// заполненный файл переименовывается в <file>.<N> и создается новый
+class Access_log
+{
+    public:
+        struct File_header // заголовок файла
+        {
+            char magic[8] = {'P', 'X', 'A', 'C', 'C', 'L', 'O', 'G'};
+            std::uint32_t version = 1;
+            std::uint32_t record_size = sizeof(Access_record);
+            std::uint8_t reserved[112] = {};
+        };
+        static_assert(sizeof(File_header) == sizeof(Access_record));
+
+        Access_log() = default; // конструктор
+
+        ~Access_log(); // деструктор (дописывает оставшиеся записи и закрывает файл)
+
+        Access_log(const Access_log&) = delete;
+        Access_log& operator=(const Access_log&) = delete;
+
+        // открытие файла и запуск фонового потока, file_size - размер одного файла до ротации
+        void open(const std::string& file_name, std::size_t file_size, std::size_t ring_bytes = 256 * 1024);
+
+        void close(); // остановка и закрытие файла (обрезается до записанных данных)
+
+        bool is_open() const {return queue_.running();}; // пишется ли лог
+
+        void write(const Access_record& record) {queue_.push(0, 0, std::string_view(reinterpret_cast<const char*>(&record), sizeof(record)));}; // из любого потока
+
+        void sync() {queue_.sync();}; // дождаться записи в файл всего, что уже отдано
+
+        std::uint64_t dropped() const {return queue_.dropped();}; // отброшено из за переполнения буфера
+
+        std::uint64_t written() const {return queue_.processed();}; // записано в файлы
+
+        std::size_t rotations() const {return rotations_.load(std::memory_order_relaxed);}; // кол-во ротаций
+
+        // чтение файла (текущего или после ротации), false - не файл access log'а
+        static bool load(const std::string& file_name, std::vector<Access_record>& records);
+
+        static std::string csv_header(); // строка заголовков CSV
+
+        static std::string to_csv(const Access_record& record); // строка CSV
+
+        static std::string to_json(const Access_record& record); // объект JSON в одну строку
+
+    private:
+        void append(std::string_view data); // фоновый поток: копирование записи в файл
+
+        bool map_file(); // создание и отображение нового файла
+
+        void unmap_file(); // закрытие текущего файла с обрезкой до записанных данных
+
+        void rotate(); // текущий файл -> <file>.<N>
+
+    private:
+        std::string file_name_;
+
+        std::size_t file_size_ = 0; // размер файла (кратен размеру записи)
+
+        int fd_ = -1; // дескриптор текущего файла
+
+        char* mapping_ = nullptr; // отображение текущего файла
+
+        std::size_t offset_ = 0; // куда пишется следующая запись
+
+        std::size_t next_index_ = 1; // номер следующего файла после ротации
+
+        std::atomic<std::size_t> rotations_{0};
+
+        Log_queue queue_; // буферы потоков и фоновый поток (уничтожается первым)
+};
@@ -0,0 +1,82 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include "logger/log_ring.hpp"
+
+// очередь записей от многих потоков к одному фоновому: у каждого пишущего потока свой Log_ring,
+// фоновый поток раз в interval (или по sync) обходит все буферы и отдает записи обработчику
+// общая основа текстового логгера и бинарного access log'а
+class Log_queue
+{
+    public:
+        using Record_handler = std::function<void(std::uint8_t level, std::int64_t time, std::string_view data)>; // одна запись
+
+        using Batch_handler = std::function<void()>; // после каждой непустой пачки (flush файла и т.п.)
+
+        Log_queue(); // конструктор
+
+        ~Log_queue(); // деструктор (останавливает фоновый поток, оставшиеся записи обрабатываются)
+
+        Log_queue(const Log_queue&) = delete;
+        Log_queue& operator=(const Log_queue&) = delete;
+
+        // запуск фонового потока, ring_bytes - размер буфера каждого пишущего потока
+        void start(std::size_t ring_bytes, Record_handler on_record, Batch_handler on_batch,
+        std::chrono::milliseconds interval = std::chrono::milliseconds(10));
+
+        void stop(); // остановка фонового потока
+
+        bool running() const {return running_.load(std::memory_order_relaxed);}; // принимаются ли записи
+
+        // запись из любого потока без блокировок: слишком длинная обрезается, не поместившаяся отбрасывается
+        void push(std::uint8_t level, std::int64_t time, std::string_view data);
+
+        void sync(); // дождаться обработки всего, что уже попало в буферы
+
+        std::uint64_t dropped() const; // отброшено из за переполнения буфера
+
+        std::uint64_t truncated() const; // обрезано из за длины
+
+        std::uint64_t processed() const {return processed_.load(std::memory_order_relaxed);}; // отдано обработчику
+
+    private:
+        Log_ring& local(); // буфер текущего потока (создается при первой записи)
+
+        void writer_loop(); // фоновый поток
+
+        void drain(); // перенос записей из всех буферов в обработчик
+
+    private:
+        std::uint64_t id_; // уникальный номер очереди (ключ буфера потока, адрес может быть переиспользован)
+
+        std::size_t ring_bytes_ = 256 * 1024;
+
+        std::chrono::milliseconds interval_{10}; // как часто фоновый поток забирает записи
+
+        Record_handler on_record_;
+        Batch_handler on_batch_;
+
+        std::atomic<bool> running_{false}; // фоновый поток запущен, записи принимаются
+
+        mutable std::mutex rings_mutex_; // только регистрация нового потока, обход списка и чтение счетчиков
+        std::vector<std::shared_ptr<Log_ring>> rings_; // буферы всех пишущих потоков
+        std::uint64_t retired_dropped_ = 0; // счетчики буферов завершившихся потоков
+        std::uint64_t retired_truncated_ = 0;
+
+        std::mutex writer_mutex_; // ожидание фонового потока и sync
+        std::condition_variable writer_wakeup_;
+        std::condition_variable drained_;
+        std::uint64_t sync_requests_ = 0; // сколько раз просили sync
+        std::uint64_t sync_done_ = 0; // сколько из них обслужено
+        std::thread writer_;
+
+        std::atomic<std::uint64_t> processed_{0}; // меняет только фоновый поток
+};
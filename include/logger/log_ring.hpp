@@ -0,0 +1,86 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string_view>
+
+// кольцевой буфер готовых записей лога одного потока (один писатель - поток воркера, один читатель - фоновый поток)
+// lock-free: писатель и читатель синхронизируются только через позиции head_/tail_, память выделяется один раз
+// запись - заголовок (длина, уровень, время) и текст, выровненные на 16 байт; не помещающаяся до конца буфера
+// запись начинается с его начала, а хвост помечается пропуском
+class Log_ring
+{
+    public:
+        explicit Log_ring(std::size_t capacity); // конструктор (емкость округляется вверх до степени двойки)
+
+        // писатель: false - места нет, запись отброшена (поток воркера никогда не ждет)
+        bool try_push(std::uint8_t level, std::int64_t time, std::string_view text);
+
+        // читатель: func(level, time, text) для каждой записи, возвращает кол-во записей
+        // text действителен только внутри вызова, место освобождается после обхода всех записей
+        template<typename Func>
+        std::size_t consume(Func&& func);
+
+        bool empty() const {return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_relaxed);}; // пуст ли буфер
+
+        std::size_t capacity() const {return capacity_;}; // геттер емкости
+
+        std::size_t max_text() const {return capacity_ / 4 - sizeof(Header);}; // самый длинный текст одной записи
+
+        // счетчики писателя: меняет только он (без RMW на общей линии кеша), читать можно из любого потока
+        void count_dropped() {dropped_.store(dropped_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);};
+        void count_truncated() {truncated_.store(truncated_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);};
+        std::uint64_t dropped() const {return dropped_.load(std::memory_order_relaxed);};
+        std::uint64_t truncated() const {return truncated_.load(std::memory_order_relaxed);};
+
+    private:
+        struct Header
+        {
+            std::uint32_t size; // длина текста, SKIP - пропуск до конца буфера
+            std::uint32_t level;
+            std::int64_t time;
+        };
+        static_assert(sizeof(Header) == 16);
+
+        static constexpr std::uint32_t SKIP = UINT32_MAX;
+
+        static std::size_t record_size(std::size_t text_size) {return (sizeof(Header) + text_size + 15) & ~std::size_t(15);}; // с выравниванием
+
+    private:
+        std::size_t capacity_; // размер буфера (степень двойки)
+
+        std::unique_ptr<std::byte[]> buffer_; // записи
+
+        alignas(64) std::atomic<std::uint64_t> head_{0}; // позиция записи (растет монотонно, меняет только писатель)
+        std::atomic<std::uint64_t> dropped_{0}; // не поместилось
+        std::atomic<std::uint64_t> truncated_{0}; // обрезано по max_text
+
+        alignas(64) std::atomic<std::uint64_t> tail_{0}; // позиция чтения (растет монотонно, меняет только читатель)
+};
+
+template<typename Func>
+std::size_t Log_ring::consume(Func&& func)
+{
+    auto tail = tail_.load(std::memory_order_relaxed);
+    auto head = head_.load(std::memory_order_acquire); // текст записей до head уже виден
+    std::size_t count = 0;
+    while(tail != head)
+    {
+        auto offset = tail & (capacity_ - 1);
+        Header header;
+        std::memcpy(&header, buffer_.get() + offset, sizeof(header));
+        if(header.size == SKIP)
+        {
+            tail += capacity_ - offset;
+            continue;
+        }
+        func(static_cast<std::uint8_t>(header.level), header.time,
+        std::string_view(reinterpret_cast<const char*>(buffer_.get() + offset + sizeof(header)), header.size));
+        tail += record_size(header.size);
+        count++;
+    }
+    tail_.store(tail, std::memory_order_release); // место отдается писателю одним сохранением на пачку
+    return count;
+}
@@ -1,24 +1,35 @@
 #pragma once
 
+#include <atomic>
+#include <cstdint>
 #include <string>
+#include <string_view>
 #include <iostream>
 #include <sstream>
 #include <boost/log/trivial.hpp>
 #include <boost/log/utility/setup/file.hpp>
-#include <boost/log/utility/setup/common_attributes.hpp>
 #include <boost/log/core.hpp>
+#include "logger/log_queue.hpp"
 
+// асинхронный логгер: строка форматируется в буфере потока и по std::endl кладется в кольцевой буфер этого потока,
+// фоновый поток пачками отдает записи в boost log (файл с ротацией), так что воркеры не ждут диск и мьютексы
+// если буфер потока переполнен, запись отбрасывается и учитывается в dropped()
 class Logger
 {
     public:
         enum LOG_LEVEL{INFO, DEBUG};
 
-        Logger() = default;
+        Logger(); // конструктор
+
+        ~Logger() = default; // деструктор (очередь дописывает оставшиеся записи и останавливает фоновый поток)
+
+        Logger(const Logger&) = delete;
+        Logger& operator=(const Logger&) = delete;
 
         template<typename T>
         Logger& operator<<(const T& data)
         {
-            stream_ << data;
+            stream() << data;
             return *this;
         }
         Logger& operator<<(std::ostream& (*func)(std::ostream&))
@@ -26,19 +37,36 @@ class Logger
             if(func == static_cast<std::ostream&(*)(std::ostream&)>(std::endl))
                 flush();
             else
-                stream_ << func;
+                stream() << func;
             return *this;
         }
 
         void set_level(LOG_LEVEL log_level);
 
-        void init_logger(const std::string& log_file, std::size_t rotation_size);
-    
-    private:
+        // ring_bytes - размер кольцевого буфера каждого пишущего потока
+        void init_logger(const std::string& log_file, std::size_t rotation_size, std::size_t ring_bytes = 256 * 1024);
+
+        void sync() {queue_.sync();}; // дождаться записи всего, что уже попало в буферы (тесты, завершение)
+
+        std::uint64_t dropped() const {return queue_.dropped();}; // отброшено из за переполнения буфера
+
+        std::uint64_t truncated() const {return queue_.truncated();}; // обрезано из за длины
+
+        std::uint64_t written() const {return queue_.processed();}; // отдано в boost log
 
+    private:
         void flush();
 
+        std::ostringstream& stream(); // буфер текущего потока (воркеры пишут в лог параллельно)
+
+        void write_record(std::uint8_t level, std::int64_t time, std::string_view text); // фоновый поток: запись в boost log
+
     private:
-        std::ostringstream stream_;
-        LOG_LEVEL log_level_;
-};
\ No newline at end of file
+        std::atomic<LOG_LEVEL> log_level_{INFO};
+
+        std::uint64_t id_; // уникальный номер логгера (ключ буфера строки потока, адрес может быть переиспользован)
+
+        boost::shared_ptr<boost::log::core> core_; // core boost log живет, пока фоновый поток дописывает записи
+
+        Log_queue queue_; // буферы потоков и фоновый поток (уничтожается первым и дописывает записи в core_)
+};
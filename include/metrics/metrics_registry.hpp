@@ -0,0 +1,168 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// счетчики, gauge'и и гистограммы для Prometheus
+// у каждого потока своя копия всех ячеек (шард): запись - обычное сложение в своей ячейке без атомарных RMW и общих
+// кеш линий, сумма по шардам считается только при выдаче (scrape); шард завершившегося потока складывается в общий остаток
+// гистограммы логарифмические как HDR: 4 корзины на каждую степень двойки (ошибка не больше 25%), значения до 2^32
+class Metrics_registry
+{
+    public:
+        static constexpr std::size_t MAX_SLOTS = 2048; // ячеек в шарде (счетчик - 1, гистограмма - HISTOGRAM_BUCKETS + 1)
+        static constexpr unsigned SUB_BUCKET_BITS = 2; // 2^SUB_BUCKET_BITS корзин на степень двойки
+        static constexpr std::size_t HISTOGRAM_BUCKETS = 125; // последняя корзина - 2^32 и больше
+
+        class Counter // монотонный счетчик (по умолчанию - пустой, ничего не считает)
+        {
+            public:
+                Counter() = default;
+
+                void add(std::uint64_t value = 1) const {if(registry_) registry_->add(slot_, value);};
+
+            private:
+                friend class Metrics_registry;
+
+                Counter(Metrics_registry* registry, std::uint32_t slot) : registry_(registry), slot_(slot) {};
+
+                Metrics_registry* registry_ = nullptr;
+                std::uint32_t slot_ = 0;
+        };
+
+        class Gauge // значение, которое растет и уменьшается (в шардах лежат приращения)
+        {
+            public:
+                Gauge() = default;
+
+                void add(std::int64_t value = 1) const {if(registry_) registry_->add(slot_, static_cast<std::uint64_t>(value));};
+
+                void sub(std::int64_t value = 1) const {add(-value);};
+
+            private:
+                friend class Metrics_registry;
+
+                Gauge(Metrics_registry* registry, std::uint32_t slot) : registry_(registry), slot_(slot) {};
+
+                Metrics_registry* registry_ = nullptr;
+                std::uint32_t slot_ = 0;
+        };
+
+        class Histogram // распределение целых значений (мкс, байты), в выдаче умножаются на scale
+        {
+            public:
+                Histogram() = default;
+
+                void record(std::uint64_t value) const
+                {
+                    if(!registry_)
+                        return;
+                    registry_->add(slot_ + bucket(value), 1);
+                    registry_->add(slot_ + HISTOGRAM_BUCKETS, value); // сумма
+                };
+
+            private:
+                friend class Metrics_registry;
+
+                Histogram(Metrics_registry* registry, std::uint32_t slot) : registry_(registry), slot_(slot) {};
+
+                Metrics_registry* registry_ = nullptr;
+                std::uint32_t slot_ = 0;
+        };
+
+        using Callback = std::function<double()>;
+
+        Metrics_registry(); // конструктор
+
+        Metrics_registry(const Metrics_registry&) = delete;
+        Metrics_registry& operator=(const Metrics_registry&) = delete;
+
+        // регистрация (labels - "direction=\"upload\"", у одного имени может быть несколько наборов меток)
+        // scale - множитель при выдаче (мкс -> секунды: 1e-6), при переполнении шарда - std::length_error
+        Counter counter(const std::string& name, const std::string& help, const std::string& labels = "", double scale = 1);
+
+        Gauge gauge(const std::string& name, const std::string& help, const std::string& labels = "");
+
+        Histogram histogram(const std::string& name, const std::string& help, double scale = 1, const std::string& labels = "");
+
+        // значение, которое читается при выдаче (счетчики и размеры, которые уже где-то считаются)
+        void counter_callback(const std::string& name, const std::string& help, Callback callback, const std::string& labels = "");
+
+        void gauge_callback(const std::string& name, const std::string& help, Callback callback, const std::string& labels = "");
+
+        std::string scrape() const; // текстовый формат Prometheus (0.0.4)
+
+        std::uint64_t value(const Counter& counter) const; // сумма по потокам
+
+        std::int64_t value(const Gauge& gauge) const;
+
+        std::uint64_t count(const Histogram& histogram, std::uint64_t max_value) const; // кол-во значений до корзины max_value включительно
+
+        static std::size_t bucket(std::uint64_t value); // корзина значения
+
+        static std::uint64_t bucket_upper(std::size_t bucket); // наибольшее значение корзины
+
+    private:
+        struct Shard // ячейки одного потока, пишет только он сам
+        {
+            std::array<std::atomic<std::uint64_t>, MAX_SLOTS> slots{};
+        };
+
+        struct Series
+        {
+            std::string labels;
+            std::uint32_t slot = 0;
+            Callback callback; // пустой - значение из шардов
+        };
+
+        struct Family // все метки одного имени (одни HELP и TYPE)
+        {
+            std::string name;
+            std::string help;
+            std::string type;
+            double scale = 1;
+            std::vector<Series> series;
+        };
+
+        void add(std::uint32_t slot, std::uint64_t value)
+        {
+            auto& cell = local().slots[slot];
+            cell.store(cell.load(std::memory_order_relaxed) + value, std::memory_order_relaxed); // ячейку меняет только этот поток
+        }
+
+        Shard& local() // шард текущего потока (создается при первой записи)
+        {
+            thread_local std::uint64_t last_id = UINT64_MAX; // почти всегда пишут в один и тот же реестр, поиск в map не нужен
+            thread_local Shard* last = nullptr;
+            if(last_id != id_)
+            {
+                last = &register_thread();
+                last_id = id_;
+            }
+            return *last;
+        }
+
+        Shard& register_thread();
+
+        std::uint32_t add_series(const std::string& name, const std::string& help, const std::string& type, double scale,
+        const std::string& labels, std::size_t slots, Callback callback);
+
+        std::uint64_t total(std::uint32_t slot) const; // сумма ячейки по шардам (под мьютексом)
+
+        void retire_finished() const; // шарды завершившихся потоков - в остаток (под мьютексом)
+
+    private:
+        std::uint64_t id_; // уникальный номер реестра (ключ шарда потока, адрес может быть переиспользован)
+
+        mutable std::mutex mutex_; // регистрация метрик и потоков, выдача
+        std::vector<Family> families_;
+        std::size_t used_slots_ = 0;
+        mutable std::vector<std::shared_ptr<Shard>> shards_;
+        mutable std::vector<std::uint64_t> retired_; // сумма шардов завершившихся потоков
+};
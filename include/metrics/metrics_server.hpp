@@ -0,0 +1,41 @@
+#pragma once
+#include "metrics/metrics_registry.hpp"
+#include <boost/asio.hpp>
+#include <string>
+#include <thread>
+
+// admin listener: GET /metrics отдает реестр в текстовом формате Prometheus
+// свой поток и io_context: медленный сборщик метрик не занимает воркеры, а перегруженные воркеры не мешают сбору
+class Metrics_server
+{
+    public:
+        explicit Metrics_server(const Metrics_registry& registry); // конструктор
+
+        ~Metrics_server(); // деструктор (останавливает поток)
+
+        Metrics_server(const Metrics_server&) = delete;
+        Metrics_server& operator=(const Metrics_server&) = delete;
+
+        // bind и запуск потока (port 0 - любой свободный), ошибка bind - исключение
+        void start(const std::string& host, unsigned short port);
+
+        void stop(); // остановка
+
+        unsigned short port() const {return port_;}; // порт, на котором слушает
+
+    private:
+        boost::asio::awaitable<void> accept_connections(); // цикл accept'а
+
+        boost::asio::awaitable<void> serve(boost::asio::ip::tcp::socket socket); // один запрос
+
+    private:
+        const Metrics_registry& registry_;
+
+        boost::asio::io_context context_;
+
+        boost::asio::ip::tcp::acceptor acceptor_;
+
+        unsigned short port_ = 0;
+
+        std::thread thread_;
+};
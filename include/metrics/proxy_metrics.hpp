@@ -0,0 +1,32 @@
+#pragma once
+#include "metrics/metrics_registry.hpp"
+#include "logger/access_log.hpp"
+#include <array>
+
+// метрики прокси: регистрируются в конструкторе, в горячем пути только сложение в шарде потока
+// значения, которые уже считаются в других объектах (активные сессии, кеш DNS, настройки), регистрируются в main как callback'и
+struct Proxy_metrics
+{
+    Proxy_metrics(); // конструктор (регистрация)
+
+    Metrics_registry registry;
+
+    Metrics_registry::Counter connections_accepted; // приняты и получили сессию
+    Metrics_registry::Counter rejected_overloaded; // 503 при max_connections в режиме быстрого отказа
+    Metrics_registry::Counter rejected_client; // клиент в черном списке адресов
+
+    static constexpr std::size_t SESSION_ENDS = static_cast<std::size_t>(Access_end::exception) + 1;
+    std::array<Metrics_registry::Counter, SESSION_ENDS> sessions; // завершенные сессии по причине (как в access log'е)
+
+    Metrics_registry::Counter requests; // разобранные запросы (включая CONNECT и keep-alive)
+
+    Metrics_registry::Counter bytes_upload; // клиент -> сервер
+    Metrics_registry::Counter bytes_download; // сервер -> клиент
+
+    Metrics_registry::Counter throttled_upload; // мкс ожидания лимитеров скорости
+    Metrics_registry::Counter throttled_download;
+
+    Metrics_registry::Histogram session_duration; // мкс от accept до закрытия
+    Metrics_registry::Histogram connect_duration; // мкс от заголовка запроса до подключения к upstream'у (резолвинг и connect)
+    Metrics_registry::Histogram first_byte_duration; // мкс от заголовка запроса до заголовка ответа upstream'а
+};
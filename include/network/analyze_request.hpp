@@ -12,5 +12,5 @@ class HttpHandler
             std::string host; // имя хоста из запроса
             std::string port; // порт из запроса
         };
-    static HandlerResult analyze_request(const boost::beast::http::request<boost::beast::http::string_body>& req); // анализ запроса
+    static HandlerResult analyze_request(const boost::beast::http::request_header<>& req); // анализ запроса (нужен только заголовок)
 };
\ No newline at end of file
@@ -0,0 +1,59 @@
+#pragma once
+#include "utils/async_waiter.hpp"
+#include <boost/asio.hpp>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+
+// асинхронный семафор на кол-во живых сессий (общий для всех воркеров)
+class Connection_gate : public std::enable_shared_from_this<Connection_gate>
+{
+    public:
+        class Slot // слот соеденения, освобождается в деструкторе (вместе с сессией)
+        {
+            public:
+                Slot() = default;
+
+                explicit Slot(std::shared_ptr<Connection_gate> gate); // конструктор
+
+                Slot(Slot&& other) noexcept;
+
+                Slot& operator=(Slot&& other) noexcept;
+
+                Slot(const Slot&) = delete;
+
+                Slot& operator=(const Slot&) = delete;
+
+                ~Slot(); // деструктор (возвращает слот)
+
+                void release(); // вернуть слот раньше времени
+
+                explicit operator bool() const {return gate_ != nullptr;};
+
+            private:
+                std::shared_ptr<Connection_gate> gate_; // семафор, которому принадлежит слот
+        };
+
+        explicit Connection_gate(std::size_t max_connections); // конструктор
+
+        boost::asio::awaitable<Slot> async_acquire(); // ждать свободный слот, не блокируя поток
+
+        std::optional<Slot> try_acquire(); // взять слот если есть свободный (для режима быстрого отказа)
+
+        std::size_t active() const; // кол-во занятых слотов
+
+        std::size_t waiting() const; // кол-во корутин в очереди
+
+    private:
+        void release(); // освобождение слота (отдается первому в очереди если она не пуста)
+
+    private:
+        std::size_t max_connections_; // максимальное кол-во одновременных сессий
+
+        std::size_t active_; // кол-во занятых слотов
+
+        std::deque<std::shared_ptr<Async_waiter>> waiters_; // очередь ожидающих слот корутин
+
+        mutable std::mutex mutex_; // мьютекс для потокобезопасности (acceptor'ы в разных воркерах)
+};
@@ -0,0 +1,114 @@
+#pragma once
+#include "utils/async_waiter.hpp"
+#include "network/dns_resolver.hpp"
+#include <boost/asio.hpp>
+#include <atomic>
+#include <chrono>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// общий для всех воркеров кеш резолвинга host:port
+// хранит успешные и неуспешные ответы с разным TTL, ограничен по размеру (LRU),
+// одновременные запросы одного и того же host:port объединяются в один резолвинг
+class Dns_cache
+{
+    public:
+        using results_type = boost::asio::ip::tcp::resolver::results_type;
+
+        Dns_cache(); // конструктор (с настройками по умолчанию)
+
+        void configure(std::size_t max_entries, std::chrono::milliseconds ttl, std::chrono::milliseconds negative_ttl); // настройка кеша
+
+        void set_resolver(std::shared_ptr<Dns_resolver> resolver); // собственный резолвер вместо getaddrinfo (nullptr - getaddrinfo)
+
+        // срок ожидания getaddrinfo (0 - без срока), у собственного резолвера срок свой
+        void set_system_timeout(std::chrono::milliseconds timeout);
+
+        // резолвинг через кеш (выполняется в executor'е вызывающей корутины)
+        boost::asio::awaitable<results_type> async_resolve(const std::string& host, const std::string& port, boost::system::error_code& ec);
+
+        void clear(); // очистка кеша
+
+        std::size_t size() const; // кол-во записей в кеше
+
+        std::uint64_t hits() const {return hits_.load();}; // ответы из кеша
+
+        std::uint64_t misses() const {return misses_.load();}; // реальные резолвинги
+
+        std::uint64_t coalesced() const {return coalesced_.load();}; // запросы, дождавшиеся чужого резолвинга
+
+        std::uint64_t failures() const {return failures_.load();}; // реальные резолвинги, закончившиеся ошибкой
+
+    private:
+        struct Entry
+        {
+            results_type results; // адреса
+            boost::system::error_code error; // ошибка резолвинга (для негативного кеша)
+            std::chrono::steady_clock::time_point expires; // когда запись устареет
+            std::list<std::string>::iterator lru_position; // позиция в списке LRU
+        };
+
+        struct Pending // резолвинг, который сейчас выполняется
+        {
+            std::vector<std::shared_ptr<Async_waiter>> waiters; // корутины, ждущие результата
+            results_type results; // результат (заполняется перед пробуждением)
+            boost::system::error_code error;
+        };
+
+        // снимает pending на любом выходе из резолвинга (в т.ч. исключение или уничтожение корутины),
+        // пока результат не задан - ожидающие получают operation_aborted
+        struct Completion
+        {
+            Dns_cache& cache;
+            const std::string& key;
+            Pending& pending;
+            results_type results;
+            boost::system::error_code error = boost::asio::error::operation_aborted;
+            std::uint32_t record_ttl = UINT32_MAX; // getaddrinfo не отдает TTL, тогда используется ttl_
+
+            ~Completion() {cache.complete(key, pending, results, error, record_ttl);};
+        };
+
+        // резолвинг через getaddrinfo отдельной корутиной: его нельзя прервать, запросы ждут его со сроком
+        boost::asio::awaitable<void> system_lookup(std::string key, std::string host, std::string port, std::shared_ptr<Pending> pending);
+
+        // результат резолвинга: запись в кеш, снятие pending и пробуждение ожидающих
+        void complete(const std::string& key, Pending& pending, const results_type& results,
+        const boost::system::error_code& ec, std::uint32_t record_ttl);
+
+        bool lookup(const std::string& key, results_type& results, boost::system::error_code& ec); // поиск в кеше (под мьютексом)
+
+        // запись в кеш (под мьютексом), record_ttl - TTL из ответа DNS
+        void store(const std::string& key, const results_type& results, const boost::system::error_code& ec, std::chrono::seconds record_ttl);
+
+    private:
+        std::size_t max_entries_; // максимальное кол-во записей (0 - кеш выключен, остается только объединение запросов)
+
+        std::chrono::milliseconds ttl_; // сколько хранится успешный ответ
+
+        std::chrono::milliseconds negative_ttl_; // сколько хранится ошибка
+
+        std::shared_ptr<Dns_resolver> resolver_; // собственный резолвер (если не задан - tcp::resolver)
+
+        std::chrono::milliseconds system_timeout_; // срок ожидания tcp::resolver (0 - без срока)
+
+        std::unordered_map<std::string, Entry> entries_; // записи по host:port
+
+        std::list<std::string> lru_; // ключи от самых свежих к самым старым
+
+        std::unordered_map<std::string, std::shared_ptr<Pending>> pending_; // выполняющиеся резолвинги
+
+        mutable std::mutex mutex_; // мьютекс для потокобезопасности
+
+        std::atomic<std::uint64_t> hits_;
+
+        std::atomic<std::uint64_t> misses_;
+
+        std::atomic<std::uint64_t> coalesced_;
+
+        std::atomic<std::uint64_t> failures_;
+};
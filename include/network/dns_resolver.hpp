@@ -0,0 +1,69 @@
+#pragma once
+#include <boost/asio.hpp>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// собственный неблокирующий DNS клиент (stub resolver)
+// запросы A и AAAA отправляются параллельно в event loop вызывающей корутины,
+// при усеченном ответе (TC) запрос повторяется по TCP, при таймауте/SERVFAIL - следующий nameserver
+class Dns_resolver
+{
+    public:
+        using results_type = boost::asio::ip::tcp::resolver::results_type;
+
+        struct Settings // настройки из resolv.conf
+        {
+            std::vector<boost::asio::ip::udp::endpoint> nameservers; // не больше 3, как в glibc
+            std::chrono::milliseconds timeout = std::chrono::seconds(5); // ожидание ответа от одного nameserver'а
+            int attempts = 2; // сколько раз обходить список nameserver'ов
+            std::chrono::milliseconds deadline{0}; // общий срок резолвинга (все попытки вместе), 0 - без ограничения
+        };
+
+        static Settings load_resolv_conf(const std::string& filename); // чтение nameserver и options timeout/attempts
+
+        explicit Dns_resolver(Settings settings, const std::string& hosts_file_name = "/etc/hosts"); // конструктор
+
+        // резолвинг host:port, ttl - минимальный TTL из ответа (для кеша)
+        boost::asio::awaitable<results_type> async_resolve(const std::string& host, const std::string& port,
+        std::uint32_t& ttl, boost::system::error_code& ec);
+
+        const Settings& settings() const {return settings_;}; // геттер настроек
+
+    public:
+        static constexpr std::uint16_t TYPE_A = 1;
+        static constexpr std::uint16_t TYPE_CNAME = 5;
+        static constexpr std::uint16_t TYPE_AAAA = 28;
+
+        struct Reply // разобранный ответ на один запрос
+        {
+            int rcode = -1; // код ответа (-1 - ответа нет)
+            bool truncated = false; // флаг TC
+            std::vector<boost::asio::ip::address> addresses;
+            std::uint32_t ttl = UINT32_MAX;
+        };
+
+        static std::vector<std::uint8_t> build_query(std::uint16_t id, const std::string& name, std::uint16_t type); // сборка запроса
+
+        // разбор ответа, false - ответ не на этот запрос или поврежден
+        static bool parse_reply(const std::uint8_t* data, std::size_t size, std::uint16_t id,
+        const std::string& name, std::uint16_t type, Reply& reply);
+
+    private:
+        // отправка запросов по UDP на один nameserver и ожидание ответов до таймаута
+        boost::asio::awaitable<void> exchange_udp(const boost::asio::ip::udp::endpoint& nameserver,
+        const std::string& name, const std::vector<std::uint16_t>& types, std::vector<Reply>& replies, std::chrono::milliseconds timeout);
+
+        // повтор запроса по TCP (после усеченного UDP ответа)
+        boost::asio::awaitable<void> exchange_tcp(const boost::asio::ip::udp::endpoint& nameserver,
+        const std::string& name, std::uint16_t type, Reply& reply, std::chrono::milliseconds timeout);
+
+        void load_hosts(const std::string& filename); // чтение /etc/hosts
+
+    private:
+        Settings settings_; // nameserver'ы, таймаут и кол-во попыток
+
+        std::unordered_map<std::string, std::vector<boost::asio::ip::address>> hosts_; // статические записи из hosts файла
+};
@@ -0,0 +1,143 @@
+#pragma once
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// сопоставление хоста со списком доменных правил (черный список)
+// правила:
+//   example.com    - сам домен и все поддомены
+//   *.example.com  - только поддомены (* - одна любая метка, можно и в середине: ads.*.example.com)
+//   !m.example.com - исключение (@@m.example.com - то же самое)
+// побеждает правило, совпавшее с большим числом меток хоста; при равенстве - исключение
+// хост и правила нормализуются: нижний регистр, без точки в конце
+// хранение - trie по меткам справа налево в плоских массивах: узел знает родителя и свою метку,
+// ребенок ищется по (родитель, метка) в одной хеш таблице с открытой адресацией (у .com могут быть миллионы детей),
+// одинаковые метки хранятся один раз; перед trie стоит блочный фильтр Блума по двум последним меткам правил,
+// который отсекает почти все хосты не из списка чтением одной кеш линии
+// массивы либо строятся из правил в памяти, либо отображаются из файла blacklist_compile (страницы общие для процессов)
+class Domain_matcher
+{
+    public:
+        Domain_matcher() = default; // конструктор (пустой список ничего не блокирует)
+
+        ~Domain_matcher(); // деструктор (снимает отображение файла)
+
+        Domain_matcher(const Domain_matcher&) = delete;
+        Domain_matcher& operator=(const Domain_matcher&) = delete;
+
+        std::size_t build(const std::vector<std::string>& rules); // построение из правил, возвращает кол-во пропущенных некорректных
+
+        // отображение скомпилированного файла, false - не скомпилированный список (тогда молча) или файл поврежден
+        bool load(const std::string& file_name);
+
+        bool save(const std::string& file_name) const; // запись скомпилированного файла
+
+        bool matches(std::string_view host) const; // блокируется ли хост
+
+        bool empty() const {return rules_ == 0;}; // нет ни одного правила
+
+        bool mapped() const {return mapping_ != nullptr;}; // массивы отображены из файла
+
+        std::size_t rules() const {return rules_;}; // кол-во различных правил
+
+        std::size_t nodes() const {return nodes_.size();}; // кол-во узлов trie
+
+        std::size_t memory_bytes() const; // память под trie и фильтр
+
+        static std::string normalize(std::string_view host); // нижний регистр, без точки в конце
+
+    private:
+        static constexpr std::uint8_t BLOCK = 1;
+        static constexpr std::uint8_t ALLOW = 2;
+        static constexpr std::uint8_t WILDCARD = 4; // у узла есть ребенок "*"
+        static constexpr std::size_t MAX_HOST = 253; // длиннее имя хоста быть не может
+        static constexpr std::uint32_t NONE = UINT32_MAX;
+        static constexpr std::uint64_t EMPTY = UINT64_MAX;
+
+        static constexpr std::uint8_t FILTER_ONE_LABEL = 1; // есть правила вида *.ru, проверяется и последняя метка
+        static constexpr std::uint8_t FILTER_OFF = 2; // есть правила без фиксированного конца (*, a.*), фильтр не помогает
+
+        struct Node // 12 байт, в файле в таком же виде
+        {
+            std::uint32_t parent = NONE;
+            std::uint32_t label_offset = 0; // метка в labels_
+            std::uint8_t label_size = 0;
+            std::uint8_t flags = 0; // BLOCK/ALLOW - на этом узле заканчивается правило, WILDCARD
+        };
+        static_assert(sizeof(Node) == 12);
+
+        struct alignas(64) Filter_block // блок фильтра Блума - одна кеш линия, ключ ставит по биту в каждое слово
+        {
+            std::uint64_t words[8] = {};
+        };
+
+        struct File_header // заголовок скомпилированного файла, за ним секции узлов, слотов, меток и фильтра (по 64 байта)
+        {
+            char magic[8] = {'P', 'X', 'B', 'L', 'K', 'L', 'S', 'T'};
+            std::uint32_t version = 1;
+            std::uint32_t byte_order = 0x01020304; // файл переносится только между машинами с тем же порядком байт
+            std::uint64_t rules = 0;
+            std::uint64_t nodes = 0;
+            std::uint64_t slots = 0;
+            std::uint64_t labels = 0;
+            std::uint64_t filter_blocks = 0;
+            std::uint64_t filter_mode = 0;
+        };
+        static_assert(sizeof(File_header) == 64);
+
+        struct Match // лучшее найденное правило
+        {
+            std::size_t depth = 0;
+            std::uint8_t flags = 0;
+        };
+
+        std::string_view label(const Node& node) const {return labels_.substr(node.label_offset, node.label_size);};
+
+        static std::uint64_t hash(std::uint32_t parent, std::string_view label); // хеш ребенка (не зависит от платформы)
+
+        static std::uint64_t filter_hash(std::string_view suffix); // хеш конца хоста для фильтра
+
+        void filter_add(std::uint64_t value);
+
+        bool filter_contains(std::uint64_t value) const;
+
+        bool filter_passes(std::string_view host) const; // false - хост точно не блокируется
+
+        std::uint32_t find_child(std::uint32_t parent, std::string_view label) const; // NONE - нет ребенка
+
+        // обход trie по меткам host справа от end (depth меток уже совпало)
+        void match(std::uint32_t node, std::string_view host, std::size_t end, std::size_t depth, Match& best) const;
+
+        void unmap(); // снятие отображения файла
+
+        void use_owned(); // массивы - собственные векторы
+
+    private:
+        std::span<const Node> nodes_; // nodes_[0] - корень
+
+        // хеш таблица детей (размер - степень двойки): старшие 32 бита хеша и индекс узла, EMPTY - пусто;
+        // по старшим битам отсекается почти любое несовпадение без чтения узла и метки (обычный хост не в списке)
+        std::span<const std::uint64_t> slots_;
+
+        std::string_view labels_; // все различные метки подряд
+
+        std::span<const Filter_block> filter_;
+
+        std::uint8_t filter_mode_ = 0;
+
+        std::size_t rules_ = 0;
+
+        std::vector<Node> own_nodes_; // массивы, построенные в памяти
+
+        std::vector<std::uint64_t> own_slots_;
+
+        std::string own_labels_;
+
+        std::vector<Filter_block> own_filter_;
+
+        void* mapping_ = nullptr; // отображение скомпилированного файла
+
+        std::size_t mapping_size_ = 0;
+};
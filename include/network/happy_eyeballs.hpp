@@ -0,0 +1,13 @@
+#pragma once
+#include <boost/asio.hpp>
+#include <chrono>
+#include <vector>
+
+// порядок попыток подключения (RFC 8305): адреса разных семейств чередуются, начиная с IPv6
+std::vector<boost::asio::ip::tcp::endpoint> happy_eyeballs_order(const boost::asio::ip::tcp::resolver::results_type& results);
+
+// подключение с параллельными попытками (Happy Eyeballs): следующая попытка стартует через attempt_delay
+// или сразу после неудачи предыдущей, первое успешное соеденение переносится в socket, остальные закрываются
+boost::asio::awaitable<void> happy_eyeballs_connect(boost::asio::ip::tcp::socket& socket,
+const boost::asio::ip::tcp::resolver::results_type& results, std::chrono::milliseconds attempt_delay,
+std::chrono::milliseconds timeout, boost::system::error_code& ec);
@@ -0,0 +1,73 @@
+#pragma once
+#include <boost/asio/ip/address.hpp>
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// сопоставление IP адреса со списком CIDR правил (черный список адресов назначения или клиентов)
+// правила:
+//   10.0.0.0/8, 2001:db8::/32 - вся подсеть
+//   192.0.2.1, ::1            - один адрес
+//   !10.1.0.0/16              - исключение (@@10.1.0.0/16 - то же самое)
+// побеждает самый длинный совпавший префикс; при равенстве - исключение
+// ipv4-mapped ipv6 адреса и правила сводятся к ipv4
+// хранение - multibit trie с раскрытием префиксов: корень на 16 бит адреса - прямой массив,
+// дальше по 8 бит на уровень; 256 значений уровня сжаты как в poptrie: битовая карта начал серий
+// одинаковых значений и плотный массив самих значений (индекс - popcount по карте)
+// поиск ipv4 - не больше трех чтений массивов и без ветвлений по длинам префиксов
+class Ip_matcher
+{
+    public:
+        std::size_t build(const std::vector<std::string>& rules); // построение из правил, возвращает кол-во пропущенных некорректных
+
+        bool matches(const boost::asio::ip::address& address) const; // блокируется ли адрес
+
+        bool empty() const {return rules_ == 0;}; // нет ни одного правила
+
+        std::size_t rules() const {return rules_;}; // кол-во различных правил
+
+        std::size_t memory_bytes() const; // память под таблицы
+
+    private:
+        static constexpr std::uint32_t NONE = 0;
+        static constexpr std::uint32_t BLOCK = 1;
+        static constexpr std::uint32_t ALLOW = 2;
+        static constexpr std::uint32_t CHILD = 0x80000000; // значение - номер узла следующего уровня
+        static constexpr std::size_t ROOT_BITS = 16;
+
+        struct alignas(64) Chunk // 256 значений уровня (8 бит адреса) - одна кеш линия карты
+        {
+            std::uint64_t runs[4] = {}; // бит i - значение i отличается от i - 1 (начало серии)
+            std::uint32_t values = 0; // начало серий узла в values_
+            std::uint16_t before[4] = {}; // кол-во серий в предыдущих словах карты
+        };
+
+        struct Tree // таблицы одного семейства адресов
+        {
+            std::vector<std::uint32_t> root; // пустой - нет правил этого семейства
+            std::vector<Chunk> chunks;
+            std::vector<std::uint32_t> values;
+        };
+
+        struct Rule
+        {
+            std::array<std::uint8_t, 16> bytes{}; // адрес с обнуленными битами за префиксом
+            unsigned length = 0;
+            std::uint32_t action = BLOCK;
+            bool v6 = false;
+        };
+
+        static bool parse(const std::string& text, Rule& rule); // разбор правила
+
+        static void build_tree(Tree& tree, const std::vector<Rule>& rules, bool v6); // правила одного семейства по возрастанию длины
+
+        static bool lookup(const Tree& tree, const std::uint8_t* bytes, std::size_t size);
+
+    private:
+        Tree v4_;
+
+        Tree v6_;
+
+        std::size_t rules_ = 0;
+};
@@ -4,25 +4,40 @@
 #include <memory>
 #include <map>
 #include "user_traffic_manager.hpp"
+#include "connection_gate.hpp"
+#include "upstream_pool.hpp"
 
 class Server : public std::enable_shared_from_this<Server>
 {
     public:
-        Server(boost::asio::io_context& context, unsigned short port); // конструктор
+        Server(boost::asio::io_context& context, unsigned short port,
+        std::shared_ptr<User_traffic_manager> manager, std::shared_ptr<Connection_gate> gate,
+        bool reuse_port = false); // конструктор
 
         boost::asio::awaitable<void> run(); // запуск сервера
 
     private:
-        boost::asio::awaitable<void> accept_connections(); // принимает соеденения, создает и запускает сессии
+        boost::asio::awaitable<void> accept_connections(); // принимает соеденения и запускает для них сессии
+
+        void open_acceptor(bool reuse_port); // открытие, bind и listen acceptor'а (с SO_REUSEPORT если нужно)
+
+        // ждет слот (если еще не взят), создает и запускает сессию
+        boost::asio::awaitable<void> start_session(boost::asio::ip::tcp::socket socket, Connection_gate::Slot slot);
+
+        void reject_connection(boost::asio::ip::tcp::socket socket); // быстрый отказ (503) при перегрузке
 
     private:
         unsigned short port_; // порт на котором работает сервер
 
-        boost::asio::io_context& io_context_; // контекст boost asio
+        boost::asio::io_context& io_context_; // контекст boost asio (у каждого воркера свой)
 
         boost::asio::ip::tcp::acceptor acceptor_; // acceptor для приема соеденений
 
-        std::shared_ptr<User_traffic_manager> user_traffic_manager_; // объект для контроля трафика
+        std::shared_ptr<User_traffic_manager> user_traffic_manager_; // объект для контроля трафика (общий для всех воркеров)
+
+        std::shared_ptr<Connection_gate> connection_gate_; // ограничение кол-ва живых сессий (общее для всех воркеров)
+
+        std::shared_ptr<const std::string> overload_response_; // заранее сериализованный ответ 503
 
-        void wait_connection_slot(); // метод для ожидания свободного слота при подключении
-};
\ No newline at end of file
+        std::shared_ptr<Upstream_pool> upstream_pool_; // пул keep-alive соеденений к upstream'ам (свой у каждого воркера)
+};
@@ -1,16 +1,21 @@
 #pragma once
 #include "user_traffic_manager.hpp"
+#include "connection_gate.hpp"
+#include "upstream_pool.hpp"
+#include "tunnel.hpp"
+#include "logger/access_log.hpp"
 #include <boost/asio.hpp>
 #include <boost/beast.hpp>
 #include <memory>
 #include <chrono>
 
-#define TUNNEL_BUFFER_SIZE 16184
+class Timer;
 
 class Session : public std::enable_shared_from_this<Session>
 {
     public:
-        Session(boost::asio::ip::tcp::socket socket, std::shared_ptr<User_traffic_manager> manager); // конструктор
+        Session(boost::asio::ip::tcp::socket socket, std::shared_ptr<User_traffic_manager> manager,
+        Connection_gate::Slot slot, std::shared_ptr<Upstream_pool> upstream_pool); // конструктор
 
         ~Session(); // деструктор
         
@@ -20,16 +25,62 @@ class Session : public std::enable_shared_from_this<Session>
 
         boost::asio::awaitable<void> send_bad_request(const std::string str); // отправка страницы при некорректном запросе
 
-        boost::asio::awaitable<void> http_handler // обработка http соеденения
+        boost::asio::awaitable<void> send_error(boost::beast::http::status status, const std::string str); // ответ с кодом ошибки
+
+        boost::asio::awaitable<void> send_upstream_error(const boost::system::error_code& ec); // 504 при таймауте, иначе 400
+
+        void set_idle_callback(Timer& timer, std::shared_ptr<boost::asio::ip::tcp::socket> upstream_ptr); // простой отменяет операции сокетов
+
+        boost::asio::awaitable<bool> http_handler // обработка http запроса (false - соеденение с клиентом больше не используется)
         (const std::string& host, const std::string& port,
-        const boost::beast::http::request<boost::beast::http::string_body> request);
+        boost::beast::http::request_parser<boost::beast::http::buffer_body>& request_parser);
 
         boost::asio::awaitable<void> https_handler // обработа https соеденения
         (const std::string& host, const std::string& port);
 
+        template<bool isRequest>
+        boost::asio::awaitable<void> relay_message // пересылка сообщения, заголовок которого уже прочитан (тело потоково)
+        (boost::asio::ip::tcp::socket& input, boost::beast::flat_buffer& buffer,
+        boost::beast::http::parser<isRequest, boost::beast::http::buffer_body>& parser,
+        boost::asio::ip::tcp::socket& output, std::shared_ptr<Timer> timer, boost::system::error_code& ec);
+
+        boost::asio::awaitable<void> tunnel // двунаправленное тунелирование между клиентом и upstream'ом
+        (std::shared_ptr<boost::asio::ip::tcp::socket> upstream_ptr, std::shared_ptr<Timer> timer);
+
+        boost::asio::awaitable<void> throttle(Limiter_chain& limiters, std::size_t bytes); // ждать пока лимитеры не разрешат переслать bytes байт
+
+        void select_destination(const std::string& host); // сборка цепочек лимитеров для нового хоста назначения
+
+        std::uint32_t since_accept() const; // мкс от принятия соеденения (для фаз access log'а)
+
+        void set_upstream_address(boost::asio::ip::tcp::socket& upstream); // адрес upstream'а в access log
+
+        // убирает из результатов резолвинга адреса из черного списка, false - не осталось ни одного
+        static bool remove_blacklisted(boost::asio::ip::tcp::resolver::results_type& results);
+
 
     private:
         boost::asio::ip::tcp::socket client_socket_; // сокет клиента
 
-        std::shared_ptr<Traffic_limiter> traffic_limiter_; // лимитер трафика
+        boost::beast::flat_buffer client_buffer_; // буфер чтения от клиента (общий для всех запросов соеденения)
+
+        std::shared_ptr<User_traffic_manager> traffic_manager_; // иерархия лимитеров трафика
+
+        boost::asio::ip::address client_address_; // ip клиента (по нему выбирается лимитер пользователя)
+
+        std::shared_ptr<Traffic_limiter> connection_upload_limiter_; // лимит соеденения на отправку (nullptr - без ограничений)
+
+        std::shared_ptr<Traffic_limiter> connection_download_limiter_; // лимит соеденения на загрузку
+
+        Limiter_chain upload_limiters_; // лимитеры направления клиент -> сервер
+
+        Limiter_chain download_limiters_; // лимитеры направления сервер -> клиент
+
+        Connection_gate::Slot slot_; // слот в лимите соеденений, освобождается вместе с сессией
+
+        std::shared_ptr<Upstream_pool> upstream_pool_; // пул keep-alive соеденений воркера
+
+        std::chrono::steady_clock::time_point accept_clock_; // момент принятия соеденения (отсчет фаз)
+
+        Access_record access_; // запись access log'а, отдается в деструкторе
 };
\ No newline at end of file
@@ -1,26 +1,168 @@
 #pragma once
+#include "utils/async_waiter.hpp"
+#include "metrics/metrics_registry.hpp"
+#include <boost/asio.hpp>
+#include <array>
+#include <atomic>
 #include <chrono>
+#include <cstdint>
+#include <deque>
+#include <memory>
 #include <thread>
+#include <unordered_map>
 
+#define TOKEN_BATCH_SIZE 65536 // сколько байт туннель забирает у лимитера за раз, если они уже накоплены
+
+#define FAIR_SHARE_QUANTUM 65536 // сколько байт добавляется потоку за один круг deficit round robin
+
+// ведро токенов по схеме GCRA: все состояние - одно атомарное виртуальное время (TAT),
+// acquire без блокировок, мьютекс только у очереди ожидающих когда токенов нет
+// ожидающие делятся на потоки (flow, обычно пользователь), между потоками токены раздаются по deficit round robin:
+// каждый активный поток получает равную долю (max-min), поток без ожидающих сразу выпадает из круга
 class Traffic_limiter
 {
         public:
-                Traffic_limiter(uint64_t bytes_per_sec); // конструктор
+                Traffic_limiter(uint64_t bytes_per_sec, uint64_t burst_percent = 150); // конструктор (ведро - burst_percent% от секунды)
 
                 ~Traffic_limiter(); // деструктор
 
                 std::size_t acquire(std::size_t want); // возвращает сколько байт можно переслать и уменьшает счетчик
 
-                void refill(); // обновляет счетчик байт
+                // ждать токены без опроса: первый в очереди спит ровно до момента, когда накопится нужное кол-во,
+                // остальные стоят в FIFO очереди (общей для всех соеденений пользователя) и будятся по порядку
+                // batch - сколько байт можно забрать сверх want, если они уже есть (для Token_batch)
+                // flow - поток для справедливого деления при нехватке токенов (внутри потока - FIFO)
+                boost::asio::awaitable<std::size_t> async_acquire(std::size_t want, std::size_t batch = 0, std::size_t flow = 0);
+
+                std::size_t try_acquire(std::size_t want, std::size_t batch = 0); // то же без ожидания: 0 - пришлось бы ждать
+
+                void give_back(std::size_t tokens); // вернуть неиспользованные токены
+
+                std::size_t waiting() const; // кол-во корутин в очереди за токенами
                 
         private:
-                std::size_t max_tokens_; // максимальное кол-во байт
+                // забрать от at_least до at_most байт на момент now (CAS по TAT), 0 - столько еще нет
+                std::size_t try_consume(std::size_t at_least, std::size_t at_most, std::int64_t now);
+
+                std::chrono::steady_clock::time_point ready_at(std::size_t tokens) const; // когда накопится tokens байт
 
-                std::size_t tokens_; // сколько байт может переслать на данный момент
+                struct Ticket // ожидающая корутина
+                {
+                        std::shared_ptr<Async_waiter> event; // будится, когда получила токены или стала диспетчером
+                        std::size_t size; // сколько байт ей нужно
+                        std::size_t granted = 0; // сколько выдал диспетчер
+                };
+
+                struct Flow // поток ожидающих (пользователь)
+                {
+                        std::deque<std::shared_ptr<Ticket>> tickets; // FIFO внутри потока
+                        std::size_t deficit = 0; // сколько байт поток может получить в текущем круге
+                        bool topped_up = false; // квант за текущий круг уже добавлен
+                };
+
+                std::shared_ptr<Ticket> pick_next(); // кому по DRR достанутся следующие токены (под мьютексом)
+
+                std::shared_ptr<Ticket> any_waiter() const; // любой ожидающий без изменения состояния DRR (новый диспетчер)
+
+                void grant(const std::shared_ptr<Ticket>& ticket, std::size_t flow, std::size_t granted); // выдача и выход из очереди
+
+                void abandon(const std::shared_ptr<Ticket>& ticket, std::size_t flow); // корутина уничтожена, не дождавшись
+
+        private:
+                std::size_t max_tokens_; // максимальное кол-во байт
 
                 double rate_bytes_per_sec_; // текущая скорость с которой клиент может пересылать данные (байты в секунду)
 
-                std::chrono::steady_clock::time_point last_update_; // когда последний раз клиент пересылал данные
+                double ns_per_byte_; // интервал на один байт
+
+                std::int64_t burst_ns_; // виртуальное время на полное ведро (max_tokens_ байт)
+
+                std::atomic<std::int64_t> tat_; // момент (нс steady_clock), когда ведро снова будет полным
+
+                std::unordered_map<std::size_t, Flow> flows_; // потоки с ожидающими
+
+                std::deque<std::size_t> round_; // порядок обхода потоков, текущий - первый
+
+                // диспетчер - один из ожидающих: спит по таймеру до накопления токенов и раздает их по DRR,
+                // решение принимается в момент выдачи, поэтому успевший вернуться в очередь поток не теряет свою долю
+                std::shared_ptr<Ticket> dispatcher_;
+
+                std::atomic<std::size_t> waiting_; // кол-во ожидающих (чтобы быстрый путь не брал мьютекс)
+
+                mutable std::mutex mutex_; // мьютекс очереди
+};
+
+// лимитеры одного направления соеденения, от частного к общему (соеденение, хост назначения, пользователь, весь прокси)
+// байты выдаются только если их разрешили все уровни, лишнее, взятое у верхних уровней, сразу возвращается
+class Limiter_chain
+{
+        public:
+                Limiter_chain() = default; // пустая цепочка - без ограничений
+
+                Limiter_chain(std::initializer_list<std::shared_ptr<Traffic_limiter>> limiters); // конструктор
+
+                void add(std::shared_ptr<Traffic_limiter> limiter); // добавить уровень (nullptr - уровень выключен)
+
+                boost::asio::awaitable<std::size_t> async_acquire(std::size_t want, std::size_t batch = 0); // как у Traffic_limiter
+
+                std::size_t try_acquire(std::size_t want, std::size_t batch = 0); // без ожидания, 0 - какой-то уровень пришлось бы ждать
+
+                void give_back(std::size_t tokens); // вернуть токены всем уровням
+
+                void set_flow(std::size_t flow) {flow_ = flow;}; // поток для справедливого деления (обычно хеш ip пользователя)
+
+                // метрики направления: пересланные байты и мкс ожидания в async_acquire
+                void set_counters(Metrics_registry::Counter transferred, Metrics_registry::Counter throttled)
+                {
+                        transferred_ = transferred;
+                        throttled_ = throttled;
+                };
+
+                void count_transferred(std::size_t bytes) const {transferred_.add(bytes);}; // учесть пересланные байты
+
+                std::size_t size() const {return size_;}; // кол-во включенных уровней
+
+                static constexpr std::size_t MAX_LEVELS = 4; // соеденение, хост, пользователь, весь прокси
+
+        private:
+                std::array<std::shared_ptr<Traffic_limiter>, MAX_LEVELS> limiters_; // уровни в порядке опроса (без кучи)
+
+                std::size_t size_ = 0; // сколько уровней занято
+
+                std::size_t flow_ = 0; // поток на всех уровнях
+
+                Metrics_registry::Counter transferred_; // по умолчанию - ничего не считают
+
+                Metrics_registry::Counter throttled_;
+};
+
+// локальный запас токенов одного направления туннеля: лимитеры трогаются раз на TOKEN_BATCH_SIZE байт,
+// остаток возвращается в деструкторе
+class Token_batch
+{
+        public:
+                Token_batch(Limiter_chain& limiters, std::size_t batch_size = TOKEN_BATCH_SIZE); // конструктор
+
+                ~Token_batch(); // деструктор (возвращает остаток)
+
+                Token_batch(const Token_batch&) = delete;
+
+                Token_batch& operator=(const Token_batch&) = delete;
+
+                boost::asio::awaitable<std::size_t> acquire(std::size_t want); // взять из запаса, пустой запас пополняется у лимитеров
+
+                std::size_t try_acquire(std::size_t want); // без ожидания (и без кадра корутины), 0 - нужен acquire
+
+                void refund(std::size_t tokens); // вернуть в запас неиспользованное (например недочитанное splice'ом)
+
+                void release(); // вернуть весь запас лимитерам
+
+                std::size_t reserved() const {return tokens_;}; // сколько байт в запасе
+
+        private:
+                Limiter_chain& limiters_; // лимитеры направления
+
+                std::size_t batch_size_; // сколько забирать сверх нужного
 
-                std::mutex mutex_; // мьютекс для потокобезопасности
-};
\ No newline at end of file
+                std::size_t tokens_; // запас
+};
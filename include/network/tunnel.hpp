@@ -0,0 +1,21 @@
+#pragma once
+#include "traffic_limiter.hpp"
+#include <boost/asio.hpp>
+#include <atomic>
+#include <cstdint>
+
+#define TUNNEL_BUFFER_SIZE 16384 // размер буфера пересылки (берется из Buffer_pool на время чтения и записи)
+
+#define SPLICE_CHUNK_SIZE 65536 // сколько байт за раз перекладывается через pipe (размер pipe по умолчанию)
+
+class Timer;
+
+// пересылка данных из input в output через буфер в user space, пока одна из сторон не закроется или не выставлен finished
+// к transferred прибавляется каждый записанный в output байт (для access log'а)
+boost::asio::awaitable<void> copy_transfer(boost::asio::ip::tcp::socket& input, boost::asio::ip::tcp::socket& output,
+Limiter_chain& limiters, Timer& timer, const std::atomic_bool& finished, std::uint64_t& transferred, boost::system::error_code& ec);
+
+// то же самое без копирования через user space: socket -> pipe -> socket с помощью splice() (только linux)
+// длина каждого splice ограничена выданными лимитерами токенами, если splice не поддерживается - copy_transfer
+boost::asio::awaitable<void> splice_transfer(boost::asio::ip::tcp::socket& input, boost::asio::ip::tcp::socket& output,
+Limiter_chain& limiters, Timer& timer, const std::atomic_bool& finished, std::uint64_t& transferred, boost::system::error_code& ec);
@@ -0,0 +1,102 @@
+#pragma once
+#include "utils/async_waiter.hpp"
+#include <boost/asio.hpp>
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+// пул keep-alive соеденений к upstream серверам (http), ключ - host:port
+// у каждого воркера свой пул, поэтому синхронизация не нужна
+class Upstream_pool : public std::enable_shared_from_this<Upstream_pool>
+{
+    public:
+        class Connection // соеденение, взятое из пула (возвращается в деструкторе)
+        {
+            public:
+                Connection(std::shared_ptr<Upstream_pool> pool, std::string key,
+                std::shared_ptr<boost::asio::ip::tcp::socket> socket, bool reused); // конструктор
+
+                ~Connection(); // деструктор (возвращает сокет в пул если вызван keep_alive)
+
+                Connection(const Connection&) = delete;
+
+                Connection& operator=(const Connection&) = delete;
+
+                std::shared_ptr<boost::asio::ip::tcp::socket> socket() const {return socket_;}; // сокет upstream'а
+
+                bool is_reused() const {return reused_;}; // взято ли соеденение из пула (не нужно подключаться)
+
+                void keep_alive(); // пометить соеденение как пригодное для повторного использования
+
+                // соеденение уходит из пула навсегда (туннель после 101): место под хост освобождается сразу,
+                // а сокет живет, пока его держит вызывающий
+                void detach();
+
+            private:
+                std::shared_ptr<Upstream_pool> pool_; // пул, которому принадлежит соеденение
+
+                std::string key_; // host:port
+
+                std::shared_ptr<boost::asio::ip::tcp::socket> socket_; // сокет upstream'а
+
+                bool reused_; // взято из пула
+
+                bool keep_alive_; // вернуть в пул при уничтожении
+
+                bool detached_; // уже не считается в пуле
+        };
+
+        Upstream_pool(const boost::asio::any_io_executor& executor, std::size_t max_idle,
+        std::size_t max_per_host, std::chrono::milliseconds idle_timeout); // конструктор
+
+        // взять живое idle соеденение или место под новое (сокет не открыт, подключается вызывающий)
+        // если достигнут лимит соеденений к хосту - ждать пока одно из них не освободится, но не дольше timeout
+        // (nullptr - место так и не освободилось)
+        boost::asio::awaitable<std::shared_ptr<Connection>> acquire(const std::string& host, const std::string& port,
+        std::chrono::milliseconds timeout = std::chrono::milliseconds::max());
+
+        boost::asio::awaitable<void> run_sweeper(); // периодическое закрытие соеденений с истекшим idle timeout
+
+        std::size_t idle_count() const {return idle_total_;}; // кол-во idle соеденений
+
+        std::size_t connections_count(const std::string& host, const std::string& port) const; // кол-во соеденений к хосту
+
+    private:
+        struct Idle_connection
+        {
+            std::shared_ptr<boost::asio::ip::tcp::socket> socket; // сокет
+            std::chrono::steady_clock::time_point since; // когда соеденение вернули в пул
+        };
+
+        struct Host_entry
+        {
+            std::deque<Idle_connection> idle; // idle соеденения (в конце самые свежие)
+            std::size_t total = 0; // все соеденения к хосту (idle + занятые)
+            std::deque<std::shared_ptr<Async_waiter>> waiters; // ожидающие места под соеденение
+        };
+
+        void release(const std::string& key, std::shared_ptr<boost::asio::ip::tcp::socket> socket, bool reusable); // возврат соеденения
+
+        void drop(Host_entry& entry, const std::shared_ptr<boost::asio::ip::tcp::socket>& socket); // закрытие соеденения
+
+        void forget(const std::string& key); // соеденение больше не считается в лимите хоста (сокет не трогается)
+
+        static void wake_one(Host_entry& entry); // разбудить первого ожидающего места
+
+        static bool is_alive(boost::asio::ip::tcp::socket& socket); // не закрыл ли сервер соеденение пока оно лежало в пуле
+
+    private:
+        boost::asio::any_io_executor executor_; // executor воркера
+
+        std::size_t max_idle_; // максимальное кол-во idle соеденений во всем пуле
+
+        std::size_t max_per_host_; // максимальное кол-во соеденений к одному хосту (0 - без ограничений)
+
+        std::chrono::milliseconds idle_timeout_; // сколько соеденение может лежать в пуле
+
+        std::size_t idle_total_; // текущее кол-во idle соеденений
+
+        std::unordered_map<std::string, Host_entry> hosts_; // соеденения по host:port
+};
@@ -1,21 +1,104 @@
 #pragma once
 #include "traffic_limiter.hpp"
+#include <boost/asio.hpp>
+#include <array>
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <unordered_map>
-#include <thread>
+#include <mutex>
 
+// адрес клиента как 128-битное число (ipv4 хранится как ipv4-mapped ipv6), без форматирования строки на каждый accept
+struct Ip_key
+{
+    std::uint64_t high = 0;
+    std::uint64_t low = 0;
+
+    static Ip_key from_address(const boost::asio::ip::address& address); // ::ffff:a.b.c.d и a.b.c.d - один ключ
+
+    bool operator==(const Ip_key&) const = default;
+};
+
+struct Ip_key_hash
+{
+    std::size_t operator()(const Ip_key& key) const noexcept;
+};
+
+// шардированная таблица weak_ptr на лимитеры (по одному на направление), шард выбирается по хешу ключа
+// мертвые записи чистятся амортизированно: шард просматривается целиком, когда вырос вдвое с прошлой чистки
+template<typename Key, typename Hash = std::hash<Key>>
+class Limiter_table
+{
+    public:
+        using Factory = std::shared_ptr<Traffic_limiter> (*)(int64_t bytes_per_sec); // создание лимитера
+
+        // живой лимитер направления direction (0 - upload, 1 - download) или новый
+        std::shared_ptr<Traffic_limiter> get_or_create(const Key& key, std::size_t direction, int64_t bytes_per_sec, Factory factory);
+
+        std::size_t sweep(); // удалить записи без живых лимитеров, возвращает сколько удалено
+
+        std::size_t size() const; // кол-во записей (в т.ч. еще не вычищенных)
+
+    private:
+        static constexpr std::size_t SHARDS = 64; // независимые мьютексы, accept'ы разных воркеров почти не пересекаются
+
+        static constexpr std::size_t MIN_SWEEP_SIZE = 64; // меньше этого шард не чистится
+
+        struct Entry
+        {
+            std::array<std::weak_ptr<Traffic_limiter>, 2> limiters; // upload, download
+        };
+
+        struct alignas(64) Shard // на своей кеш линии, чтобы мьютексы соседних шардов не делили линию
+        {
+            mutable std::mutex mutex;
+            std::unordered_map<Key, Entry, Hash> entries;
+            std::size_t sweep_at = MIN_SWEEP_SIZE; // при каком размере чистить в следующий раз
+        };
+
+        static std::size_t sweep_shard(Shard& shard); // чистка одного шарда (под его мьютексом)
+
+    private:
+        std::array<Shard, SHARDS> shards_;
+};
+
+// иерархия лимитеров скорости: весь прокси, пользователь (ip), хост назначения и отдельное соеденение,
+// у каждого уровня свои ведра на отправку и загрузку, выключенный уровень (скорость 0) в цепочку не попадает
 class User_traffic_manager
 {
     public:
-        User_traffic_manager(); // конструктор
+        enum class Direction {upload, download}; // upload - клиент -> сервер, download - сервер -> клиент
+
+        User_traffic_manager(); // конструктор (общие лимитеры по текущему конфигу)
 
         ~User_traffic_manager(); // деструктор
 
-        std::shared_ptr<Traffic_limiter> get_or_create_user(const std::string& ip);
+        // nullptr - уровень выключен (max_bandwidth_per_sec = 0)
+        std::shared_ptr<Traffic_limiter> get_or_create_user(const boost::asio::ip::address& address, Direction direction = Direction::download);
+
+        // строка с ip адресом разбирается в ключ, другие строки (не ip) хранятся в отдельной таблице
+        std::shared_ptr<Traffic_limiter> get_or_create_user(const std::string& ip, Direction direction = Direction::download);
+
+        std::shared_ptr<Traffic_limiter> get_or_create_destination(const std::string& host, Direction direction); // nullptr - уровень выключен
+
+        std::shared_ptr<Traffic_limiter> global(Direction direction) const; // общий лимитер прокси (nullptr - без ограничений)
+
+        std::shared_ptr<Traffic_limiter> make_connection_limiter() const; // лимитер одного соеденения (nullptr - без ограничений)
+
+        // цепочка одного направления: соеденение, хост назначения, пользователь, весь прокси
+        Limiter_chain make_chain(const boost::asio::ip::address& address, const std::string& host, Direction direction,
+        std::shared_ptr<Traffic_limiter> connection_limiter = nullptr);
+
+        std::size_t sweep(); // удалить записи умерших лимитеров из всех таблиц (возвращает сколько удалено)
+
+        std::size_t users() const; // кол-во записей пользователей (в т.ч. еще не вычищенных)
 
     private:
-        std::unordered_map<std::string, std::weak_ptr<Traffic_limiter>> users_;
+        Limiter_table<Ip_key, Ip_key_hash> users_; // лимитеры пользователей по ip
+
+        Limiter_table<std::string> named_users_; // лимитеры пользователей, заданных не ip адресом
+
+        Limiter_table<std::string> destinations_; // лимитеры хостов назначения
 
-        std::mutex mutex_;
-};
\ No newline at end of file
+        std::array<std::shared_ptr<Traffic_limiter>, 2> global_; // общие лимитеры прокси по направлениям
+};
@@ -0,0 +1,27 @@
+#pragma once
+#include <boost/asio.hpp>
+#include <atomic>
+#include <chrono>
+#include <memory>
+
+// одноразовое событие, которое можно ждать из корутины и взвести из любого потока
+// ожидающая корутина должна работать в однопоточном io_context (как воркеры прокси)
+class Async_waiter : public std::enable_shared_from_this<Async_waiter>
+{
+    public:
+        explicit Async_waiter(const boost::asio::any_io_executor& executor); // конструктор (executor ожидающей корутины)
+
+        boost::asio::awaitable<void> wait(); // ждать пока не вызовут notify (если уже вызвали - вернуться сразу)
+
+        // то же со сроком: false - срок вышел раньше notify (один waiter - один срок, повторно не вызывается)
+        boost::asio::awaitable<bool> wait(std::chrono::steady_clock::duration timeout);
+
+        void notify(); // разбудить ожидающую корутину (потокобезопасно)
+
+        bool is_notified() const; // был ли уже вызван notify
+
+    private:
+        boost::asio::steady_timer timer_; // таймер без срока, отмена которого будит корутину
+
+        std::atomic<bool> notified_; // флаг события
+};
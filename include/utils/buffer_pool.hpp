@@ -0,0 +1,66 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+// пул буферов фиксированного размера, у каждого потока свой (без блокировок)
+// буфер берется только на время пересылки, простаивающее соеденение буферов не держит
+class Buffer_pool : public std::enable_shared_from_this<Buffer_pool>
+{
+    public:
+        class Buffer // буфер из пула, возвращается в пул в деструкторе
+        {
+            public:
+                Buffer(Buffer&& other) noexcept;
+
+                Buffer& operator=(Buffer&& other) noexcept;
+
+                Buffer(const Buffer&) = delete;
+
+                Buffer& operator=(const Buffer&) = delete;
+
+                ~Buffer();
+
+                char* data() const {return data_;};
+
+                std::size_t size() const; // размер буфера
+
+            private:
+                friend class Buffer_pool;
+
+                Buffer(std::shared_ptr<Buffer_pool> pool, char* data);
+
+                void release(); // вернуть буфер в пул
+
+            private:
+                std::shared_ptr<Buffer_pool> pool_; // пул, из которого взят буфер (живет, пока есть буферы)
+
+                char* data_;
+        };
+
+        Buffer_pool(std::size_t buffer_size, std::size_t max_cached); // конструктор
+
+        ~Buffer_pool(); // деструктор
+
+        static const std::shared_ptr<Buffer_pool>& local(); // пул текущего потока (буферы по TUNNEL_BUFFER_SIZE)
+
+        Buffer acquire(); // взять буфер (из свободных или новый)
+
+        std::size_t buffer_size() const {return buffer_size_;};
+
+        std::size_t cached() const {return free_.size();}; // свободные буферы в пуле
+
+        std::size_t outstanding() const {return outstanding_;}; // выданные и еще не возвращенные буферы
+
+    private:
+        void release(char* data); // возврат буфера (лишние сверх max_cached освобождаются)
+
+    private:
+        std::size_t buffer_size_; // размер одного буфера
+
+        std::size_t max_cached_; // сколько свободных буферов держать, остальные отдаются системе
+
+        std::vector<char*> free_; // свободные буферы
+
+        std::size_t outstanding_; // кол-во выданных буферов
+};
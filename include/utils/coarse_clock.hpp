@@ -0,0 +1,15 @@
+#pragma once
+#include <chrono>
+
+// дешевые часы с точностью до тика ядра (1-4 мс), база та же что у steady_clock
+// для горячего пути лимитера, где точность в миллисекунды не важна, а now() вызывается на каждый кусок данных
+struct Coarse_clock
+{
+    using duration = std::chrono::steady_clock::duration;
+    using rep = duration::rep;
+    using period = duration::period;
+    using time_point = std::chrono::steady_clock::time_point;
+    static constexpr bool is_steady = true;
+
+    static time_point now() noexcept; // CLOCK_MONOTONIC_COARSE на linux, иначе steady_clock::now()
+};
@@ -0,0 +1,30 @@
+#pragma once
+#include "utils/timer.hpp"
+#include <boost/asio.hpp>
+#include <chrono>
+
+// срок одной фазы соеденения (заголовок запроса, первый байт ответа) на колесе таймеров, без аллокаций
+// по истечении ожидающие операции сокета отменяются (cancel, а не close): они завершаются с operation_aborted,
+// а сокет остается открытым, например для ответа 408
+// живет на стеке корутины и используется только из потока io_context'а сокета
+class Deadline
+{
+    public:
+        Deadline(boost::asio::ip::tcp::socket& socket, std::chrono::milliseconds timeout); // конструктор (срок сразу идет)
+
+        ~Deadline(); // деструктор (срок снимается)
+
+        Deadline(const Deadline&) = delete;
+        Deadline& operator=(const Deadline&) = delete;
+
+        bool expired() const {return expired_;}; // сработал ли срок
+
+        void check(boost::system::error_code& ec) const; // операция, отмененная сроком, - error::timed_out
+
+    private:
+        boost::asio::any_io_executor executor_; // executor сокета (колесо его io_context'а)
+
+        Timer timer_; // запись в колесе
+
+        bool expired_; // срок вышел
+};
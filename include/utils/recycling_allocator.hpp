@@ -0,0 +1,52 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+// пул освобожденных блоков по классам размеров (степени двойки от 16 до 4096 байт), у каждого потока свой
+// блоки больше 4096 байт и блоки после завершения потока идут напрямую в operator new/delete
+class Recycling_pool
+{
+    public:
+        static void* allocate(std::size_t size); // взять блок (из пула потока или новый)
+
+        static void deallocate(void* pointer, std::size_t size); // вернуть блок в пул текущего потока
+
+        static std::size_t cached(); // кол-во свободных блоков в пуле текущего потока
+
+        static void clear(); // отдать свободные блоки текущего потока системе
+};
+
+// аллокатор для std::allocate_shared поверх Recycling_pool
+// (состояние сессии: сама сессия, таймеры, сокеты upstream'а, флаги туннеля)
+template<typename T>
+class Recycling_allocator
+{
+    public:
+        using value_type = T;
+
+        Recycling_allocator() noexcept = default;
+
+        template<typename U>
+        Recycling_allocator(const Recycling_allocator<U>&) noexcept
+        {}
+
+        T* allocate(std::size_t count)
+        {
+            return static_cast<T*>(Recycling_pool::allocate(count * sizeof(T)));
+        }
+
+        void deallocate(T* pointer, std::size_t count) noexcept
+        {
+            Recycling_pool::deallocate(pointer, count * sizeof(T));
+        }
+
+        template<typename U>
+        bool operator==(const Recycling_allocator<U>&) const noexcept {return true;};
+};
+
+template<typename T, typename... Args>
+std::shared_ptr<T> make_recycled(Args&&... args) // std::make_shared, но объект и счетчик ссылок берутся из пула потока
+{
+    return std::allocate_shared<T>(Recycling_allocator<T>(), std::forward<Args>(args)...);
+}
@@ -0,0 +1,70 @@
+#pragma once
+#include <boost/asio.hpp>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <map>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+// фоновый поток, который вызывает обработчик перезагрузки по SIGHUP или после изменения отслеживаемых файлов (inotify)
+// следится за каталогами файлов: редакторы и скрипты заменяют файл переименованием, а не пишут в него;
+// события в пределах debounce объединяются в одну перезагрузку, обработчик выполняется в этом же фоновом потоке
+class Reload_trigger
+{
+    public:
+        using Handler = std::function<void()>;
+
+        Reload_trigger(); // конструктор
+
+        ~Reload_trigger(); // деструктор (останавливает поток)
+
+        Reload_trigger(const Reload_trigger&) = delete;
+        Reload_trigger& operator=(const Reload_trigger&) = delete;
+
+        // запуск потока, sighup - перезагружать и по сигналу
+        void start(const std::vector<std::string>& files, Handler handler,
+        std::chrono::milliseconds debounce = std::chrono::milliseconds(200), bool sighup = true);
+
+        void stop(); // остановка (до следующего start SIGHUP снова завершает процесс)
+
+        void watch(const std::vector<std::string>& files); // замена списка отслеживаемых файлов (из любого потока)
+
+        std::uint64_t triggers() const {return triggers_.load();}; // кол-во вызовов обработчика
+
+    private:
+        boost::asio::awaitable<void> read_events(); // чтение событий inotify
+
+        boost::asio::awaitable<void> wait_signals(); // ожидание SIGHUP
+
+        boost::asio::awaitable<void> fire_after_debounce(); // вызов обработчика, когда события утихнут
+
+        void schedule(); // событие: перезагрузка через debounce
+
+        void update_watches(const std::vector<std::string>& files); // в потоке триггера
+
+    private:
+        boost::asio::io_context context_;
+
+        boost::asio::signal_set signals_;
+
+        boost::asio::posix::stream_descriptor inotify_;
+
+        boost::asio::steady_timer debounce_timer_;
+
+        std::chrono::milliseconds debounce_;
+
+        Handler handler_;
+
+        std::set<std::string> files_; // абсолютные пути отслеживаемых файлов
+
+        std::map<int, std::string> directories_; // дескриптор inotify -> каталог
+
+        bool pending_ = false; // перезагрузка уже запланирована
+
+        std::atomic<std::uint64_t> triggers_{0};
+
+        std::thread thread_;
+};
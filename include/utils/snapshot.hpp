@@ -0,0 +1,82 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+
+namespace snapshot_detail
+{
+    inline std::atomic<std::uint64_t> next_id{0}; // у каждого снимка свой ключ в кешах потоков
+}
+
+// неизменяемое значение, которое можно заменить на лету (конфиг, черный список)
+// читатель берет копию shared_ptr из кеша своего потока и сверяет только номер версии (атомарное чтение без блокировок),
+// кеш обновляется под мьютексом один раз на поток после каждой публикации;
+// старое значение уничтожается, когда его отпустили все потоки (поток отпускает его при следующем чтении)
+// ссылка из operator*/operator-> живет до следующего чтения в этом потоке - через co_await нужно держать get()
+template<typename T>
+class Snapshot
+{
+    public:
+        Snapshot() : Snapshot(std::make_shared<const T>()) {}; // конструктор (значение по умолчанию)
+
+        explicit Snapshot(std::shared_ptr<const T> value) : id_(snapshot_detail::next_id.fetch_add(1)), current_(std::move(value)) {};
+
+        Snapshot(const Snapshot&) = delete;
+        Snapshot& operator=(const Snapshot&) = delete;
+
+        void publish(std::shared_ptr<const T> value) // замена значения (читатели увидят его при следующем чтении)
+        {
+            std::lock_guard lock(mutex_);
+            current_ = std::move(value);
+            version_.fetch_add(1, std::memory_order_release);
+        }
+
+        void publish(T value) {publish(std::make_shared<const T>(std::move(value)));}; // замена копией значения
+
+        std::shared_ptr<const T> get() const {return local().value;}; // значение, которое можно держать сколько угодно
+
+        const T& operator*() const {return *local().value;};
+
+        const T* operator->() const {return local().value.get();};
+
+        std::uint64_t version() const {return version_.load(std::memory_order_acquire);}; // кол-во публикаций + 1
+
+    private:
+        struct Cached // значение в кеше потока
+        {
+            std::uint64_t version = 0;
+            std::shared_ptr<const T> value;
+        };
+
+        Cached& local() const
+        {
+            thread_local std::unordered_map<std::uint64_t, Cached> cache;
+            thread_local std::uint64_t last_id = UINT64_MAX; // почти всегда читается один и тот же снимок, поиск в map не нужен
+            thread_local Cached* last = nullptr;
+            if(last_id != id_)
+            {
+                last = &cache[id_];
+                last_id = id_;
+            }
+            if(last->version != version_.load(std::memory_order_acquire))
+            {
+                std::shared_ptr<const T> previous; // если поток отпускал старое значение последним, оно уничтожается вне мьютекса
+                std::lock_guard lock(mutex_);
+                previous = std::exchange(last->value, current_);
+                last->version = version_.load(std::memory_order_relaxed);
+            }
+            return *last;
+        }
+
+    private:
+        const std::uint64_t id_;
+
+        std::atomic<std::uint64_t> version_{1};
+
+        std::shared_ptr<const T> current_; // последнее опубликованное значение (под мьютексом)
+
+        mutable std::mutex mutex_;
+};
@@ -1,10 +1,15 @@
+#pragma once
 #include <boost/asio.hpp>
+#include "utils/timing_wheel.hpp"
 
-class Timer : public std::enable_shared_from_this<Timer>
+// таймер бездействия на колесе io_context'а: refresh только запоминает тик активности, без операций с очередью таймеров
+class Timer : public std::enable_shared_from_this<Timer>, private Timing_wheel::Entry
 {
     public:
         Timer(boost::asio::any_io_executor& executor, std::size_t interval); // конструктор
 
+        ~Timer(); // деструктор (снимает запись с колеса)
+
         void start(); // запустить таймер
 
         void refresh(); // обновить таймер
@@ -14,14 +19,17 @@ class Timer : public std::enable_shared_from_this<Timer>
         void set_callback_func(std::function<void()> func); // установить функцию, которая вызовется по истечению таймера
 
     private:
-        void arm(); // запуск таймера (вызывается из всех публичных методов)
+        void expire() override; // срок вышел (из колеса)
+
+        template<typename Function>
+        void run_on_wheel(Function function); // сразу, если мы в потоке io_context'а, иначе через post
 
     private:
-        boost::asio::steady_timer timer_; // таймер
+        boost::asio::io_context::executor_type executor_; // executor io_context'а, которому принадлежит колесо
 
-        std::size_t interval_; // сколько таймер будет длится (В МИЛЛИСЕКУНДАХ!!!)
+        Timing_wheel& wheel_; // колесо таймеров io_context'а
 
         std::function<void()> callback_; // callback функция
 
-        bool is_running_; // запущен ли таймер
-};
\ No newline at end of file
+        std::atomic<bool> is_running_; // запущен ли таймер
+};
@@ -0,0 +1,95 @@
+#pragma once
+#include <boost/asio.hpp>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+// иерархическое колесо таймеров, одно на io_context (у каждого воркера свое)
+// 4 уровня по 64 слота с тиком 10 мс (до ~46 часов), один steady_timer будит колесо только к ближайшему непустому слоту
+// продление таймера - запись времени последней активности, запись переставляется в колесе лениво, когда до нее дошла очередь
+// все кроме Entry::touch вызывается только из потока, в котором крутится io_context
+class Timing_wheel : public boost::asio::execution_context::service
+{
+    public:
+        using key_type = Timing_wheel;
+
+        static boost::asio::execution_context::id id; // идентификатор сервиса asio
+
+        static constexpr std::chrono::milliseconds TICK{10}; // разрешение колеса
+
+        static std::uint64_t now() noexcept; // текущий тик по грубым часам (дешево, можно звать на каждую операцию)
+
+        static std::uint64_t precise_now() noexcept; // текущий тик по steady_clock
+
+        class Entry // запись колеса, встраивается в объект таймера (без аллокаций)
+        {
+            public:
+                void touch(std::uint64_t tick = now()) noexcept {last_activity_.store(tick, std::memory_order_relaxed);} // отметить активность (из любого потока)
+
+                bool is_scheduled() const noexcept {return pprev_ != nullptr;} // стоит ли в колесе
+
+            protected:
+                explicit Entry(std::uint64_t interval_ticks) : interval_(interval_ticks) {} // конструктор (срок в тиках)
+
+                ~Entry() = default;
+
+                virtual void expire() = 0; // срок вышел (вызывается из колеса, запись уже снята)
+
+            private:
+                friend class Timing_wheel;
+
+                Entry* next_ = nullptr; // следующая запись в слоте
+                Entry** pprev_ = nullptr; // указатель на ссылку на эту запись (nullptr - не в колесе)
+                std::uint16_t slot_ = 0; // номер слота (уровень * 64 + слот)
+                std::uint64_t interval_; // срок бездействия в тиках
+                std::atomic<std::uint64_t> last_activity_ = 0; // тик последней активности
+        };
+
+        explicit Timing_wheel(boost::asio::io_context& context); // конструктор (через use_service)
+
+        static Timing_wheel& of(const boost::asio::any_io_executor& executor); // колесо io_context'а executor'а (только io_context)
+
+        void schedule(Entry& entry); // поставить запись (срок считается от последней активности)
+
+        void cancel(Entry& entry); // снять запись (если стоит)
+
+        std::size_t size() const {return size_;}; // кол-во записей в колесе
+
+    private:
+        static constexpr std::size_t LEVELS = 4;
+        static constexpr std::size_t SLOT_BITS = 6;
+        static constexpr std::size_t SLOTS = 1 << SLOT_BITS; // слотов на уровне
+        static constexpr std::uint16_t DETACHED = UINT16_MAX; // запись во временном списке обработки, а не в слоте
+
+        void shutdown() override; // остановка io_context: снять все записи
+
+        void insert(Entry& entry, std::uint64_t expiry); // положить в слот по тику срабатывания
+
+        void unlink(Entry& entry); // вынуть из списка
+
+        void process(std::uint64_t tick); // каскад верхних уровней и срабатывание слота тика
+
+        bool next_due(std::uint64_t& tick) const; // ближайший тик, на котором есть работа (false - колесо пустое)
+
+        void advance(); // обработать все тики до текущего и переставить будильник
+
+        void rearm(); // будильник на ближайший непустой слот
+
+    private:
+        boost::asio::steady_timer timer_; // будильник колеса
+
+        std::array<Entry*, LEVELS * SLOTS> slots_{}; // головы списков слотов
+
+        std::array<std::uint64_t, LEVELS> occupied_{}; // битовые маски непустых слотов по уровням
+
+        std::uint64_t current_ = 0; // последний обработанный тик
+
+        std::uint64_t armed_at_ = 0; // на какой тик заведен будильник
+
+        bool armed_ = false; // есть ли ожидание будильника
+
+        bool advancing_ = false; // идет обработка тиков (callback'и могут ставить записи)
+
+        std::size_t size_ = 0; // кол-во записей
+};
@@ -21,6 +21,26 @@ bool Proxy_Config::validate() const
         std::cerr << "Error in config: timeout_milliseconds must be in range 1-600000" << std::endl;
         error_flag = true;
     }
+    if(settings.header_timeout_milliseconds <= 0 || settings.header_timeout_milliseconds > 600000)
+    {
+        std::cerr << "Error in config: header_timeout_milliseconds must be in range 1-600000" << std::endl;
+        error_flag = true;
+    }
+    if(settings.dns_timeout_milliseconds <= 0 || settings.dns_timeout_milliseconds > 600000)
+    {
+        std::cerr << "Error in config: dns_timeout_milliseconds must be in range 1-600000" << std::endl;
+        error_flag = true;
+    }
+    if(settings.connect_timeout_milliseconds <= 0 || settings.connect_timeout_milliseconds > 600000)
+    {
+        std::cerr << "Error in config: connect_timeout_milliseconds must be in range 1-600000" << std::endl;
+        error_flag = true;
+    }
+    if(settings.first_byte_timeout_milliseconds <= 0 || settings.first_byte_timeout_milliseconds > 600000)
+    {
+        std::cerr << "Error in config: first_byte_timeout_milliseconds must be in range 1-600000" << std::endl;
+        error_flag = true;
+    }
     if(settings.host.empty())
     {
         std::cerr << "Error in config: host cannot be empty" << std::endl;
@@ -31,6 +51,11 @@ bool Proxy_Config::validate() const
         std::cerr << "Error in config: port must be greater than 0" << std::endl;
         error_flag = true;
     }
+    if(settings.metrics_port != 0 && settings.metrics_host.empty())
+    {
+        std::cerr << "Error in config: metrics_host cannot be empty when metrics_port is set" << std::endl;
+        error_flag = true;
+    }
     if(settings.log_file_name.empty())
     {
         std::cerr << "Error in config: log_file_name cannot be empty" << std::endl;
@@ -41,11 +66,83 @@ bool Proxy_Config::validate() const
         std::cerr << "Error in config: log_file_size_bytes must be greater than 0" << std::endl;
         error_flag = true;
     }
+    if(settings.access_log_file_name.empty())
+    {
+        std::cerr << "Error in config: access_log_file_name cannot be empty" << std::endl;
+        error_flag = true;
+    }
+    if(settings.access_log_file_size_bytes < 4096)
+    {
+        std::cerr << "Error in config: access_log_file_size_bytes must be at least 4096" << std::endl;
+        error_flag = true;
+    }
+    if(settings.log_buffer_bytes < 4096)
+    {
+        std::cerr << "Error in config: log_buffer_bytes must be at least 4096" << std::endl;
+        error_flag = true;
+    }
     if(settings.blacklisted_hosts_file_name.empty())
     {
         std::cerr << "Error in config: blacklisted_hosts_file_name cannot be empty" << std::endl;
         error_flag = true;
     }
+    if(settings.worker_threads < 0 || settings.worker_threads > 1024)
+    {
+        std::cerr << "Error in config: worker_threads must be in range 0-1024" << std::endl;
+        error_flag = true;
+    }
+    if(settings.retry_after_seconds < 0)
+    {
+        std::cerr << "Error in config: retry_after_seconds cannot be negative" << std::endl;
+        error_flag = true;
+    }
+    if(settings.upstream_pool_max_idle < 0)
+    {
+        std::cerr << "Error in config: upstream_pool_max_idle cannot be negative" << std::endl;
+        error_flag = true;
+    }
+    if(settings.upstream_pool_max_per_host < 0)
+    {
+        std::cerr << "Error in config: upstream_pool_max_per_host cannot be negative" << std::endl;
+        error_flag = true;
+    }
+    if(settings.upstream_pool_idle_timeout_milliseconds < 1)
+    {
+        std::cerr << "Error in config: upstream_pool_idle_timeout_milliseconds must be greater than 0" << std::endl;
+        error_flag = true;
+    }
+    if(settings.dns_cache_max_entries < 0)
+    {
+        std::cerr << "Error in config: dns_cache_max_entries cannot be negative" << std::endl;
+        error_flag = true;
+    }
+    if(settings.dns_cache_ttl_seconds < 0)
+    {
+        std::cerr << "Error in config: dns_cache_ttl_seconds cannot be negative" << std::endl;
+        error_flag = true;
+    }
+    if(settings.dns_negative_ttl_seconds < 0)
+    {
+        std::cerr << "Error in config: dns_negative_ttl_seconds cannot be negative" << std::endl;
+        error_flag = true;
+    }
+    if(settings.max_bandwidth_per_sec < 0 || settings.max_upload_bandwidth_per_sec < 0
+    || settings.global_download_bandwidth_per_sec < 0 || settings.global_upload_bandwidth_per_sec < 0
+    || settings.connection_bandwidth_per_sec < 0 || settings.destination_bandwidth_per_sec < 0)
+    {
+        std::cerr << "Error in config: bandwidth limits cannot be negative" << std::endl;
+        error_flag = true;
+    }
+    if(settings.bandwidth_burst_percent < 1)
+    {
+        std::cerr << "Error in config: bandwidth_burst_percent must be greater than 0" << std::endl;
+        error_flag = true;
+    }
+    if(settings.connect_attempt_delay_milliseconds < 10 || settings.connect_attempt_delay_milliseconds > 2000)
+    {
+        std::cerr << "Error in config: connect_attempt_delay_milliseconds must be in range 10-2000" << std::endl;
+        error_flag = true;
+    }
     if(error_flag)
         return false;
     else
@@ -54,27 +151,14 @@ bool Proxy_Config::validate() const
 
 void Proxy_Config::load_or_create_cfg(const std::string& filename)
 {
+    this->filename = filename;
     try
     {
         std::ifstream file(filename);
         if(file.good())
         {
             file.close();
-            auto config = toml::parse_file(filename);
-            if(config["proxy"])
-            {
-                auto proxy = config["proxy"];
-                settings.max_connections = proxy["max_connections"].value_or(settings.max_connections);
-                settings.timeout_milliseconds = proxy["timeout_milliseconds"].value_or(settings.timeout_milliseconds);
-                settings.host = proxy["host"].value_or(settings.host);
-                settings.port = static_cast<unsigned short>(proxy["port"].value_or(settings.port));
-                settings.log_on = proxy["log_on"].value_or(settings.log_on);
-                settings.log_file_name = proxy["log_file_name"].value_or(settings.log_file_name);
-                settings.log_file_size_bytes = proxy["log_file_size_bytes"].value_or(settings.log_file_size_bytes);
-                settings.max_bandwidth_per_sec = proxy["max_bandwidth_per_sec"].value_or(settings.max_bandwidth_per_sec);
-                settings.blacklist_on = proxy["blacklist_on"].value_or(settings.blacklist_on);
-                settings.blacklisted_hosts_file_name = proxy["blacklisted_hosts_file_name"].value_or(settings.blacklisted_hosts_file_name);
-            }
+            read_settings();
             if(!validate())
             {
                 std::cerr << "Loaded settings are invalid, using default values" << std::endl;
@@ -94,14 +178,44 @@ void Proxy_Config::load_or_create_cfg(const std::string& filename)
             {
                 {"max_connections", settings.max_connections},
                 {"timeout_milliseconds", settings.timeout_milliseconds},
+                {"header_timeout_milliseconds", settings.header_timeout_milliseconds},
+                {"dns_timeout_milliseconds", settings.dns_timeout_milliseconds},
+                {"connect_timeout_milliseconds", settings.connect_timeout_milliseconds},
+                {"first_byte_timeout_milliseconds", settings.first_byte_timeout_milliseconds},
                 {"host", settings.host},
                 {"port", settings.port},
                 {"log_on", settings.log_on},
+                {"access_log_on", settings.access_log_on},
+                {"access_log_file_name", settings.access_log_file_name},
+                {"access_log_file_size_bytes", settings.access_log_file_size_bytes},
                 {"log_file_name", settings.log_file_name},
                 {"log_file_size_bytes", settings.log_file_size_bytes},
+                {"log_buffer_bytes", settings.log_buffer_bytes},
                 {"max_bandwidth_per_sec", settings.max_bandwidth_per_sec},
+                {"max_upload_bandwidth_per_sec", settings.max_upload_bandwidth_per_sec},
+                {"global_download_bandwidth_per_sec", settings.global_download_bandwidth_per_sec},
+                {"global_upload_bandwidth_per_sec", settings.global_upload_bandwidth_per_sec},
+                {"connection_bandwidth_per_sec", settings.connection_bandwidth_per_sec},
+                {"destination_bandwidth_per_sec", settings.destination_bandwidth_per_sec},
+                {"bandwidth_burst_percent", settings.bandwidth_burst_percent},
                 {"blacklist_on", settings.blacklist_on},
-                {"blacklisted_hosts_file_name", settings.blacklisted_hosts_file_name}
+                {"blacklisted_hosts_file_name", settings.blacklisted_hosts_file_name},
+                {"blacklisted_addresses_file_name", settings.blacklisted_addresses_file_name},
+                {"blacklisted_clients_file_name", settings.blacklisted_clients_file_name},
+                {"worker_threads", settings.worker_threads},
+                {"reject_when_overloaded", settings.reject_when_overloaded},
+                {"retry_after_seconds", settings.retry_after_seconds},
+                {"upstream_pool_max_idle", settings.upstream_pool_max_idle},
+                {"upstream_pool_max_per_host", settings.upstream_pool_max_per_host},
+                {"upstream_pool_idle_timeout_milliseconds", settings.upstream_pool_idle_timeout_milliseconds},
+                {"dns_cache_max_entries", settings.dns_cache_max_entries},
+                {"dns_cache_ttl_seconds", settings.dns_cache_ttl_seconds},
+                {"dns_negative_ttl_seconds", settings.dns_negative_ttl_seconds},
+                {"dns_native_resolver", settings.dns_native_resolver},
+                {"connect_attempt_delay_milliseconds", settings.connect_attempt_delay_milliseconds},
+                {"tunnel_splice", settings.tunnel_splice},
+                {"metrics_host", settings.metrics_host},
+                {"metrics_port", settings.metrics_port}
             });
             std::ofstream out_file(filename);
             out_file << config;
@@ -121,10 +235,14 @@ void Proxy_Config::load_or_create_cfg(const std::string& filename)
     }
 }
 
-std::unordered_set<std::string> Proxy_Config::get_blacklisted_hosts() const
+std::vector<std::string> Proxy_Config::get_blacklisted_hosts() const
+{
+    return read_blacklist(settings.blacklisted_hosts_file_name).value_or(std::vector<std::string>{});
+}
+
+std::optional<std::vector<std::string>> Proxy_Config::read_blacklist(const std::string& filename)
 {
-    std::unordered_set<std::string> blacklisted_hosts;
-    const auto filename = settings.blacklisted_hosts_file_name;
+    std::vector<std::string> blacklisted_hosts;
     try
     {
         auto blacklist = toml::parse_file(filename);
@@ -135,7 +253,7 @@ std::unordered_set<std::string> Proxy_Config::get_blacklisted_hosts() const
             {
                 if(i.is_string())
                 {
-                    blacklisted_hosts.insert(i.value_or(""));
+                    blacklisted_hosts.push_back(i.value_or(""));
                 }
             }
         }
@@ -144,11 +262,146 @@ std::unordered_set<std::string> Proxy_Config::get_blacklisted_hosts() const
     {
         std::cerr << "TOML parsing error: " << err.what() << std::endl;
         std::cerr << "Using default settings" << std::endl;
+        return std::nullopt;
     }
     catch(const std::exception& ex)
     {
         std::cerr << "Error working with configuration: " << ex.what() << std::endl;
         std::cerr << "Using default settings" << std::endl;
+        return std::nullopt;
     }
     return blacklisted_hosts;
-}
\ No newline at end of file
+}
+
+std::optional<std::vector<std::string>> Proxy_Config::read_lines(const std::string& filename)
+{
+    std::ifstream file(filename);
+    if(!file)
+    {
+        std::cerr << "Error working with configuration: cannot open " << filename << std::endl;
+        return std::nullopt;
+    }
+    std::vector<std::string> lines;
+    for(std::string line; std::getline(file, line);)
+        lines.push_back(std::move(line));
+    return lines;
+}
+
+void Proxy_Config::read_settings()
+{
+    auto config = toml::parse_file(filename);
+    if(config["proxy"])
+    {
+        auto proxy = config["proxy"];
+        settings.max_connections = proxy["max_connections"].value_or(settings.max_connections);
+        settings.timeout_milliseconds = proxy["timeout_milliseconds"].value_or(settings.timeout_milliseconds);
+        settings.header_timeout_milliseconds = proxy["header_timeout_milliseconds"].value_or(settings.header_timeout_milliseconds);
+        settings.dns_timeout_milliseconds = proxy["dns_timeout_milliseconds"].value_or(settings.dns_timeout_milliseconds);
+        settings.connect_timeout_milliseconds = proxy["connect_timeout_milliseconds"].value_or(settings.connect_timeout_milliseconds);
+        settings.first_byte_timeout_milliseconds =
+        proxy["first_byte_timeout_milliseconds"].value_or(settings.first_byte_timeout_milliseconds);
+        settings.host = proxy["host"].value_or(settings.host);
+        settings.port = static_cast<unsigned short>(proxy["port"].value_or(settings.port));
+        settings.log_on = proxy["log_on"].value_or(settings.log_on);
+        settings.access_log_on = proxy["access_log_on"].value_or(settings.access_log_on);
+        settings.access_log_file_name = proxy["access_log_file_name"].value_or(settings.access_log_file_name);
+        settings.access_log_file_size_bytes = proxy["access_log_file_size_bytes"].value_or(settings.access_log_file_size_bytes);
+        settings.log_file_name = proxy["log_file_name"].value_or(settings.log_file_name);
+        settings.log_file_size_bytes = proxy["log_file_size_bytes"].value_or(settings.log_file_size_bytes);
+        settings.log_buffer_bytes = proxy["log_buffer_bytes"].value_or(settings.log_buffer_bytes);
+        settings.max_bandwidth_per_sec = proxy["max_bandwidth_per_sec"].value_or(settings.max_bandwidth_per_sec);
+        settings.max_upload_bandwidth_per_sec = proxy["max_upload_bandwidth_per_sec"].value_or(settings.max_upload_bandwidth_per_sec);
+        settings.global_download_bandwidth_per_sec =
+        proxy["global_download_bandwidth_per_sec"].value_or(settings.global_download_bandwidth_per_sec);
+        settings.global_upload_bandwidth_per_sec =
+        proxy["global_upload_bandwidth_per_sec"].value_or(settings.global_upload_bandwidth_per_sec);
+        settings.connection_bandwidth_per_sec = proxy["connection_bandwidth_per_sec"].value_or(settings.connection_bandwidth_per_sec);
+        settings.destination_bandwidth_per_sec = proxy["destination_bandwidth_per_sec"].value_or(settings.destination_bandwidth_per_sec);
+        settings.bandwidth_burst_percent = proxy["bandwidth_burst_percent"].value_or(settings.bandwidth_burst_percent);
+        settings.blacklist_on = proxy["blacklist_on"].value_or(settings.blacklist_on);
+        settings.blacklisted_hosts_file_name = proxy["blacklisted_hosts_file_name"].value_or(settings.blacklisted_hosts_file_name);
+        settings.blacklisted_addresses_file_name =
+        proxy["blacklisted_addresses_file_name"].value_or(settings.blacklisted_addresses_file_name);
+        settings.blacklisted_clients_file_name = proxy["blacklisted_clients_file_name"].value_or(settings.blacklisted_clients_file_name);
+        settings.worker_threads = proxy["worker_threads"].value_or(settings.worker_threads);
+        settings.reject_when_overloaded = proxy["reject_when_overloaded"].value_or(settings.reject_when_overloaded);
+        settings.retry_after_seconds = proxy["retry_after_seconds"].value_or(settings.retry_after_seconds);
+        settings.upstream_pool_max_idle = proxy["upstream_pool_max_idle"].value_or(settings.upstream_pool_max_idle);
+        settings.upstream_pool_max_per_host = proxy["upstream_pool_max_per_host"].value_or(settings.upstream_pool_max_per_host);
+        settings.upstream_pool_idle_timeout_milliseconds =
+        proxy["upstream_pool_idle_timeout_milliseconds"].value_or(settings.upstream_pool_idle_timeout_milliseconds);
+        settings.dns_cache_max_entries = proxy["dns_cache_max_entries"].value_or(settings.dns_cache_max_entries);
+        settings.dns_cache_ttl_seconds = proxy["dns_cache_ttl_seconds"].value_or(settings.dns_cache_ttl_seconds);
+        settings.dns_negative_ttl_seconds = proxy["dns_negative_ttl_seconds"].value_or(settings.dns_negative_ttl_seconds);
+        settings.dns_native_resolver = proxy["dns_native_resolver"].value_or(settings.dns_native_resolver);
+        settings.connect_attempt_delay_milliseconds =
+        proxy["connect_attempt_delay_milliseconds"].value_or(settings.connect_attempt_delay_milliseconds);
+        settings.tunnel_splice = proxy["tunnel_splice"].value_or(settings.tunnel_splice);
+        settings.metrics_host = proxy["metrics_host"].value_or(settings.metrics_host);
+        settings.metrics_port = static_cast<unsigned short>(proxy["metrics_port"].value_or(settings.metrics_port));
+    }
+}
+
+bool Proxy_Config::reload()
+{
+    auto previous = settings;
+    settings = Proxy_Settings{}; // как при старте: чего нет в файле - по умолчанию
+    try
+    {
+        if(!std::ifstream(filename).good())
+            throw std::runtime_error("cannot open " + filename);
+        read_settings();
+    }
+    catch(const std::exception& ex) // toml::parse_error тоже
+    {
+        std::cerr << "Error reloading configuration: " << ex.what() << std::endl;
+        settings = previous;
+        return false;
+    }
+    if(!validate())
+    {
+        std::cerr << "Reloaded settings are invalid, keeping current values" << std::endl;
+        settings = previous;
+        return false;
+    }
+    return true;
+}
+
+std::vector<std::string> Proxy_Config::keep_restart_only(const Proxy_Settings& running, Proxy_Settings& loaded)
+{
+    std::vector<std::string> changed;
+    auto keep = [&](auto Proxy_Settings::* field, const char* name)
+    {
+        if(loaded.*field != running.*field)
+        {
+            changed.push_back(name);
+            loaded.*field = running.*field;
+        }
+    };
+    keep(&Proxy_Settings::max_connections, "max_connections"); // емкость Connection_gate
+    keep(&Proxy_Settings::host, "host");
+    keep(&Proxy_Settings::port, "port"); // acceptor'ы воркеров
+    keep(&Proxy_Settings::worker_threads, "worker_threads");
+    keep(&Proxy_Settings::retry_after_seconds, "retry_after_seconds"); // ответ 503 сериализуется при создании Server
+    keep(&Proxy_Settings::metrics_host, "metrics_host"); // admin listener запущен при старте
+    keep(&Proxy_Settings::metrics_port, "metrics_port");
+    keep(&Proxy_Settings::log_on, "log_on");
+    keep(&Proxy_Settings::log_file_name, "log_file_name");
+    keep(&Proxy_Settings::log_file_size_bytes, "log_file_size_bytes");
+    keep(&Proxy_Settings::log_buffer_bytes, "log_buffer_bytes");
+    keep(&Proxy_Settings::access_log_on, "access_log_on");
+    keep(&Proxy_Settings::access_log_file_name, "access_log_file_name");
+    keep(&Proxy_Settings::access_log_file_size_bytes, "access_log_file_size_bytes");
+    keep(&Proxy_Settings::global_download_bandwidth_per_sec, "global_download_bandwidth_per_sec"); // общие лимитеры созданы при старте
+    keep(&Proxy_Settings::global_upload_bandwidth_per_sec, "global_upload_bandwidth_per_sec");
+    keep(&Proxy_Settings::upstream_pool_max_idle, "upstream_pool_max_idle"); // пулы созданы вместе с воркерами
+    keep(&Proxy_Settings::upstream_pool_max_per_host, "upstream_pool_max_per_host");
+    keep(&Proxy_Settings::upstream_pool_idle_timeout_milliseconds, "upstream_pool_idle_timeout_milliseconds");
+    keep(&Proxy_Settings::dns_cache_max_entries, "dns_cache_max_entries");
+    keep(&Proxy_Settings::dns_cache_ttl_seconds, "dns_cache_ttl_seconds");
+    keep(&Proxy_Settings::dns_negative_ttl_seconds, "dns_negative_ttl_seconds");
+    keep(&Proxy_Settings::dns_native_resolver, "dns_native_resolver");
+    keep(&Proxy_Settings::dns_timeout_milliseconds, "dns_timeout_milliseconds"); // задан резолверу и кешу (getaddrinfo) при старте
+    keep(&Proxy_Settings::tunnel_splice, "tunnel_splice"); // от него зависит обработка SIGPIPE
+    return changed;
+}
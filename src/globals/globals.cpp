@@ -2,21 +2,31 @@
 
 #include "config/proxy_config.hpp"
 #include "logger/logger.hpp"
+#include "logger/access_log.hpp"
+#include "metrics/proxy_metrics.hpp"
+#include "network/dns_cache.hpp"
+#include "network/domain_matcher.hpp"
+#include "network/ip_matcher.hpp"
+#include "utils/snapshot.hpp"
 #include <atomic>
-#include <mutex>
-#include <condition_variable>
 
 namespace __PROXY_GLOBALS__
 {
-    Proxy_Config::Proxy_Settings PROXY_CONFIG;
-    std::unordered_set<std::string> BLACKLISTED_HOSTS; // глобальная хеш таблица, к которой идут обращения из других частей кода
+    Snapshot<Proxy_Config::Proxy_Settings> PROXY_CONFIG; // текущие настройки (заменяются при перезагрузке конфига)
+    Snapshot<Domain_matcher> BLACKLISTED_HOSTS; // правила черного списка, к которым идут обращения из других частей кода
+    Snapshot<Ip_matcher> BLACKLISTED_ADDRESSES; // CIDR правила для адресов назначения
+    Snapshot<Ip_matcher> BLACKLISTED_CLIENTS; // CIDR правила для адресов клиентов
 
     bool LOG_ON;
 
     Logger LOGGER; // объект класса Logger, через который происходит взаимодействие с логами из других частей кода
     Logger DEBUG_LOGGER;
 
-    std::atomic<size_t> ACTIVE_CONNECTIONS; // счетчик активных соеденений
-    std::mutex ACTIVE_CONNECTIONS_MUTEX; // мьютекс для проверки активных соеднений
-    std::condition_variable ACTIVE_CONNECTIONS_COND_VAR; // сcond variable для работы с кол-ом активных соеденений
+    Access_log ACCESS_LOG; // бинарный лог сессий (пишется, только если открыт)
+
+    std::atomic<size_t> ACTIVE_CONNECTIONS; // счетчик живых сессий (обновляется Connection_gate)
+
+    Dns_cache DNS_CACHE; // кеш резолвинга, общий для всех воркеров
+
+    Proxy_metrics METRICS; // метрики для Prometheus (шардированы по потокам)
 }
\ No newline at end of file
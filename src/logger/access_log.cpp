@@ -0,0 +1,235 @@
+#include "logger/access_log.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace
+{
+    std::string address_text(const std::array<std::uint8_t, 16>& bytes)
+    {
+        if(std::all_of(bytes.begin(), bytes.end(), [](std::uint8_t byte){return byte == 0;})) // адреса нет
+            return "";
+        return Access_record::unpack_address(bytes).to_string();
+    }
+
+    std::string phase_text(std::uint32_t value, const char* none)
+    {
+        return value == Access_record::NONE ? none : std::to_string(value);
+    }
+
+    std::string json_string(std::string_view text)
+    {
+        std::string result = "\"";
+        for(char c : text)
+        {
+            if(c == '"' || c == '\\')
+                result += '\\';
+            if(static_cast<unsigned char>(c) < 0x20)
+            {
+                char escaped[8];
+                std::snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned>(c));
+                result += escaped;
+                continue;
+            }
+            result += c;
+        }
+        return result + "\"";
+    }
+}
+
+const char* access_end_name(Access_end end)
+{
+    static const char* names[] = {"completed", "bad_request", "blacklisted", "header_timeout", "resolve_failed",
+    "connect_failed", "upstream_timeout", "upstream_error", "relay_error", "exception"};
+    auto index = static_cast<std::size_t>(end);
+    return index < std::size(names) ? names[index] : "unknown";
+}
+
+void Access_record::set_host(std::string_view name)
+{
+    if(name.size() > sizeof(host))
+        name.remove_prefix(name.size() - sizeof(host));
+    std::memcpy(host, name.data(), name.size());
+    host_size = static_cast<std::uint8_t>(name.size());
+}
+
+std::array<std::uint8_t, 16> Access_record::pack_address(const boost::asio::ip::address& address)
+{
+    if(address.is_v4())
+        return boost::asio::ip::make_address_v6(boost::asio::ip::v4_mapped, address.to_v4()).to_bytes();
+    return address.to_v6().to_bytes();
+}
+
+boost::asio::ip::address Access_record::unpack_address(const std::array<std::uint8_t, 16>& bytes)
+{
+    boost::asio::ip::address_v6 address(bytes);
+    if(address.is_v4_mapped())
+        return boost::asio::ip::make_address_v4(boost::asio::ip::v4_mapped, address);
+    return address;
+}
+
+Access_log::~Access_log()
+{
+    close();
+}
+
+void Access_log::open(const std::string& file_name, std::size_t file_size, std::size_t ring_bytes)
+{
+    close();
+    file_name_ = file_name;
+    file_size_ = std::max<std::size_t>(file_size / sizeof(Access_record), 2) * sizeof(Access_record); // заголовок и хотя бы одна запись
+    next_index_ = 1;
+    while(std::filesystem::exists(file_name_ + "." + std::to_string(next_index_)))
+        next_index_++;
+    if(std::filesystem::exists(file_name_)) // файл прошлого запуска уходит в ротацию, а не дописывается
+    {
+        std::error_code ec;
+        std::filesystem::rename(file_name_, file_name_ + "." + std::to_string(next_index_++), ec);
+    }
+    if(!map_file())
+    {
+        std::cerr << "Error: cannot create access log " << file_name_ << ": " << std::strerror(errno) << std::endl;
+        return;
+    }
+    queue_.start(ring_bytes, [this](std::uint8_t, std::int64_t, std::string_view data){append(data);}, nullptr);
+}
+
+void Access_log::close()
+{
+    queue_.stop();
+    unmap_file();
+}
+
+bool Access_log::map_file()
+{
+    fd_ = ::open(file_name_.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if(fd_ < 0)
+        return false;
+    if(::ftruncate(fd_, file_size_) < 0) // место выделяется сразу, записи не меняют размер файла
+    {
+        ::close(fd_);
+        fd_ = -1;
+        return false;
+    }
+    auto mapping = ::mmap(nullptr, file_size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+    if(mapping == MAP_FAILED)
+    {
+        ::close(fd_);
+        fd_ = -1;
+        return false;
+    }
+    mapping_ = static_cast<char*>(mapping);
+    File_header header;
+    std::memcpy(mapping_, &header, sizeof(header));
+    offset_ = sizeof(header);
+    return true;
+}
+
+void Access_log::unmap_file()
+{
+    if(mapping_)
+    {
+        ::munmap(mapping_, file_size_);
+        mapping_ = nullptr;
+    }
+    if(fd_ >= 0)
+    {
+        if(::ftruncate(fd_, offset_) < 0) // хвост из нулей не нужен (если обрезать не вышло, его пропустит load)
+            std::cerr << "Error: cannot truncate access log " << file_name_ << ": " << std::strerror(errno) << std::endl;
+        ::close(fd_);
+        fd_ = -1;
+    }
+}
+
+void Access_log::rotate()
+{
+    unmap_file();
+    std::error_code ec;
+    std::filesystem::rename(file_name_, file_name_ + "." + std::to_string(next_index_++), ec);
+    rotations_.fetch_add(1, std::memory_order_relaxed);
+    map_file();
+}
+
+void Access_log::append(std::string_view data)
+{
+    if(data.size() != sizeof(Access_record))
+        return;
+    if(mapping_ && offset_ + data.size() > file_size_)
+        rotate();
+    if(!mapping_) // файл не удалось создать, записи теряются
+        return;
+    // после падения процесса в файле остается все до первой нулевой записи: страницы уже в page cache ядра
+    std::memcpy(mapping_ + offset_, data.data(), data.size());
+    offset_ += data.size();
+}
+
+bool Access_log::load(const std::string& file_name, std::vector<Access_record>& records)
+{
+    std::ifstream file(file_name, std::ios::binary);
+    File_header header;
+    if(!file.read(reinterpret_cast<char*>(&header), sizeof(header)))
+        return false;
+    if(std::memcmp(header.magic, File_header{}.magic, sizeof(header.magic)) != 0 || header.version != 1
+    || header.record_size != sizeof(Access_record))
+        return false;
+    Access_record record;
+    while(file.read(reinterpret_cast<char*>(&record), sizeof(record)) && record.accept_time != 0)
+        records.push_back(record);
+    return true;
+}
+
+std::string Access_log::csv_header()
+{
+    return "accept_time_us,duration_us,headers_us,resolved_us,connected_us,first_byte_us,bytes_up,bytes_down,"
+    "client,upstream,requests,status,host,port,tunnel,end";
+}
+
+std::string Access_log::to_csv(const Access_record& record)
+{
+    std::string line;
+    line += std::to_string(record.accept_time) + "," + std::to_string(record.duration) + ",";
+    line += phase_text(record.headers, "") + "," + phase_text(record.resolved, "") + ",";
+    line += phase_text(record.connected, "") + "," + phase_text(record.first_byte, "") + ",";
+    line += std::to_string(record.bytes_up) + "," + std::to_string(record.bytes_down) + ",";
+    line += address_text(record.client_address) + "," + address_text(record.upstream_address) + ",";
+    line += std::to_string(record.requests) + "," + std::to_string(record.status) + ",";
+    std::string host(record.host_name());
+    if(host.find_first_of(",\"") != std::string::npos) // в имени хоста из запроса может быть что угодно
+    {
+        std::string quoted = "\"";
+        for(char c : host)
+            quoted += c == '"' ? std::string("\"\"") : std::string(1, c);
+        host = quoted + "\"";
+    }
+    line += host + "," + std::to_string(record.port) + "," + std::to_string(record.tunnel) + ",";
+    line += access_end_name(record.end);
+    return line;
+}
+
+std::string Access_log::to_json(const Access_record& record)
+{
+    std::string line = "{";
+    line += "\"accept_time_us\":" + std::to_string(record.accept_time);
+    line += ",\"duration_us\":" + std::to_string(record.duration);
+    line += ",\"headers_us\":" + phase_text(record.headers, "null");
+    line += ",\"resolved_us\":" + phase_text(record.resolved, "null");
+    line += ",\"connected_us\":" + phase_text(record.connected, "null");
+    line += ",\"first_byte_us\":" + phase_text(record.first_byte, "null");
+    line += ",\"bytes_up\":" + std::to_string(record.bytes_up);
+    line += ",\"bytes_down\":" + std::to_string(record.bytes_down);
+    line += ",\"client\":" + json_string(address_text(record.client_address));
+    line += ",\"upstream\":" + json_string(address_text(record.upstream_address));
+    line += ",\"requests\":" + std::to_string(record.requests);
+    line += ",\"status\":" + std::to_string(record.status);
+    line += ",\"host\":" + json_string(record.host_name());
+    line += ",\"port\":" + std::to_string(record.port);
+    line += ",\"tunnel\":" + std::string(record.tunnel ? "true" : "false");
+    line += ",\"end\":" + json_string(access_end_name(record.end));
+    return line + "}";
+}
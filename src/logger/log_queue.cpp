@@ -0,0 +1,145 @@
+#include "logger/log_queue.hpp"
+#include <algorithm>
+#include <unordered_map>
+
+namespace
+{
+    std::atomic<std::uint64_t> next_queue_id{0};
+}
+
+Log_queue::Log_queue() : id_(next_queue_id.fetch_add(1, std::memory_order_relaxed))
+{}
+
+Log_queue::~Log_queue()
+{
+    stop();
+}
+
+void Log_queue::start(std::size_t ring_bytes, Record_handler on_record, Batch_handler on_batch, std::chrono::milliseconds interval)
+{
+    stop();
+    ring_bytes_ = ring_bytes;
+    interval_ = interval;
+    on_record_ = std::move(on_record);
+    on_batch_ = std::move(on_batch);
+    running_ = true;
+    writer_ = std::thread([this](){writer_loop();});
+}
+
+void Log_queue::stop()
+{
+    {
+        std::lock_guard lock(writer_mutex_);
+        if(!running_)
+            return;
+        running_ = false;
+    }
+    writer_wakeup_.notify_one();
+    writer_.join();
+    drained_.notify_all();
+}
+
+Log_ring& Log_queue::local()
+{
+    thread_local std::unordered_map<std::uint64_t, std::shared_ptr<Log_ring>> rings;
+    thread_local std::uint64_t last_id = UINT64_MAX; // почти всегда пишут в одну и ту же очередь, поиск в map не нужен
+    thread_local Log_ring* last = nullptr;
+    if(last_id != id_)
+    {
+        auto& ring = rings[id_];
+        if(!ring) // первая запись из этого потока
+        {
+            ring = std::make_shared<Log_ring>(ring_bytes_);
+            std::lock_guard lock(rings_mutex_);
+            rings_.push_back(ring);
+        }
+        last = ring.get();
+        last_id = id_;
+    }
+    return *last;
+}
+
+void Log_queue::push(std::uint8_t level, std::int64_t time, std::string_view data)
+{
+    if(!running_.load(std::memory_order_relaxed))
+        return;
+    auto& ring = local();
+    if(data.size() > ring.max_text())
+    {
+        data = data.substr(0, ring.max_text());
+        ring.count_truncated();
+    }
+    if(!ring.try_push(level, time, data))
+        ring.count_dropped();
+}
+
+std::uint64_t Log_queue::dropped() const
+{
+    std::lock_guard lock(rings_mutex_);
+    auto result = retired_dropped_;
+    for(auto& ring : rings_)
+        result += ring->dropped();
+    return result;
+}
+
+std::uint64_t Log_queue::truncated() const
+{
+    std::lock_guard lock(rings_mutex_);
+    auto result = retired_truncated_;
+    for(auto& ring : rings_)
+        result += ring->truncated();
+    return result;
+}
+
+void Log_queue::sync()
+{
+    std::unique_lock lock(writer_mutex_);
+    if(!running_)
+        return;
+    auto ticket = ++sync_requests_;
+    writer_wakeup_.notify_one();
+    drained_.wait(lock, [&](){return sync_done_ >= ticket || !running_;});
+}
+
+void Log_queue::writer_loop()
+{
+    std::unique_lock lock(writer_mutex_);
+    while(running_)
+    {
+        writer_wakeup_.wait_for(lock, interval_, [&](){return !running_ || sync_requests_ != sync_done_;});
+        auto requested = sync_requests_;
+        lock.unlock();
+        drain();
+        lock.lock();
+        sync_done_ = requested;
+        drained_.notify_all();
+    }
+    lock.unlock();
+    drain(); // то, что успели записать до остановки
+}
+
+void Log_queue::drain()
+{
+    std::vector<std::shared_ptr<Log_ring>> rings;
+    {
+        std::lock_guard lock(rings_mutex_);
+        std::erase_if(rings_, [this](const std::shared_ptr<Log_ring>& ring) // поток завершился и все его записи забраны
+        {
+            if(ring.use_count() != 1 || !ring->empty())
+                return false;
+            retired_dropped_ += ring->dropped();
+            retired_truncated_ += ring->truncated();
+            return true;
+        });
+        rings = rings_;
+    }
+    std::size_t count = 0;
+    for(auto& ring : rings)
+        count += ring->consume(on_record_);
+    if(count)
+    {
+        processed_.fetch_add(count, std::memory_order_relaxed);
+        if(on_batch_)
+            on_batch_();
+    }
+}
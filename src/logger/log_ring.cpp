@@ -0,0 +1,32 @@
+#include "logger/log_ring.hpp"
+#include <algorithm>
+#include <bit>
+
+Log_ring::Log_ring(std::size_t capacity)
+: capacity_(std::bit_ceil(std::max<std::size_t>(capacity, 256))), buffer_(std::make_unique<std::byte[]>(capacity_))
+{}
+
+bool Log_ring::try_push(std::uint8_t level, std::int64_t time, std::string_view text)
+{
+    if(text.size() > max_text())
+        return false;
+    auto head = head_.load(std::memory_order_relaxed);
+    auto tail = tail_.load(std::memory_order_acquire); // читатель закончил с местом до tail
+    auto offset = head & (capacity_ - 1);
+    auto size = record_size(text.size());
+    std::size_t skip = capacity_ - offset < size ? capacity_ - offset : 0; // запись не помещается до конца буфера
+    if(head + skip + size - tail > capacity_)
+        return false;
+    if(skip)
+    {
+        Header header{SKIP, 0, 0};
+        std::memcpy(buffer_.get() + offset, &header, sizeof(header)); // остаток всегда кратен 16, заголовок влезает
+        head += skip;
+        offset = 0;
+    }
+    Header header{static_cast<std::uint32_t>(text.size()), level, time};
+    std::memcpy(buffer_.get() + offset, &header, sizeof(header));
+    std::memcpy(buffer_.get() + offset + sizeof(header), text.data(), text.size());
+    head_.store(head + size, std::memory_order_release); // публикация записи читателю
+    return true;
+}
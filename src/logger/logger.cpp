@@ -1,34 +1,81 @@
 #include "logger/logger.hpp"
+#include <unordered_map>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/date_time/c_local_time_adjustor.hpp>
+#include <boost/log/attributes/attribute_value_impl.hpp>
+#include <boost/log/sources/record_ostream.hpp>
+#include <boost/log/sources/severity_logger.hpp>
+
+namespace
+{
+    std::atomic<std::uint64_t> next_logger_id{0};
+}
+
+Logger::Logger() : id_(next_logger_id.fetch_add(1, std::memory_order_relaxed))
+{}
 
 void Logger::set_level(LOG_LEVEL level)
 {
-    log_level_ = level;
+    log_level_.store(level, std::memory_order_relaxed);
 }
 
-void Logger::init_logger(const std::string& log_file, std::size_t rotation_size)
+void Logger::init_logger(const std::string& log_file, std::size_t rotation_size, std::size_t ring_bytes)
 {
+    queue_.stop();
     log_level_ = LOG_LEVEL::INFO;
+    core_ = boost::log::core::get();
     boost::log::add_file_log
     (
         boost::log::keywords::file_name = log_file,
         boost::log::keywords::rotation_size = rotation_size,
         boost::log::keywords::format = "[%TimeStamp%] [%Severity%] %Message%"
-    );
-    boost::log::add_common_attributes();
+    ); // TimeStamp ставится каждой записи при ее создании в потоке воркера, а не общим атрибутом
+    queue_.start(ring_bytes,
+    [this](std::uint8_t level, std::int64_t time, std::string_view text){write_record(level, time, text);},
+    [this](){core_->flush();}); // один flush на пачку, а не на каждую строку
+}
+
+std::ostringstream& Logger::stream()
+{
+    // у каждого потока свой буфер для каждого логгера, чтобы строки из разных воркеров не перемешивались
+    thread_local std::unordered_map<std::uint64_t, std::ostringstream> streams;
+    thread_local std::uint64_t last_id = UINT64_MAX; // почти всегда пишет один и тот же логгер, поиск в map не нужен
+    thread_local std::ostringstream* last = nullptr;
+    if(last_id != id_)
+    {
+        last = &streams[id_];
+        last_id = id_;
+    }
+    return *last;
 }
 
 void Logger::flush()
 {
-    switch(log_level_)
+    auto& buffer = stream();
+    if(queue_.running())
     {
-        case LOG_LEVEL::INFO:
-            BOOST_LOG_TRIVIAL(info) << stream_.str();
-            break;
-        case LOG_LEVEL::DEBUG:
-            BOOST_LOG_TRIVIAL(debug) << stream_.str();
-            break;
+        auto time = std::chrono::duration_cast<std::chrono::microseconds>
+        (std::chrono::system_clock::now().time_since_epoch()).count();
+        queue_.push(log_level_.load(std::memory_order_relaxed), time, buffer.view());
     }
-    stream_.str(""); // очистка
-    stream_.clear();
-    boost::log::core::get()->flush();
-}
\ No newline at end of file
+    auto text = std::move(buffer).str(); // очистка без потери выделенной памяти
+    text.clear();
+    buffer.str(std::move(text));
+    buffer.clear();
+}
+
+void Logger::write_record(std::uint8_t level, std::int64_t time, std::string_view text)
+{
+    thread_local boost::log::sources::severity_logger<boost::log::trivial::severity_level> source;
+    auto severity = level == LOG_LEVEL::DEBUG ? boost::log::trivial::debug : boost::log::trivial::info;
+    auto record = source.open_record(boost::log::keywords::severity = severity);
+    if(!record)
+        return;
+    auto timestamp = boost::posix_time::from_time_t(time / 1000000) + boost::posix_time::microseconds(time % 1000000);
+    record.attribute_values().insert("TimeStamp", boost::log::attributes::make_attribute_value(
+    boost::date_time::c_local_adjustor<boost::posix_time::ptime>::utc_to_local(timestamp)));
+    boost::log::record_ostream stream(record);
+    stream << text;
+    stream.flush();
+    source.push_record(std::move(record));
+}
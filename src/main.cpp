@@ -3,8 +3,12 @@
 #include "config/proxy_config.hpp"
 #include "logger/logger.hpp"
 #include "globals/globals.hpp"
+#include "utils/reload_trigger.hpp"
+#include "metrics/metrics_server.hpp"
 #include <iostream>
-#include <unordered_set>
+#include <csignal>
+#include <thread>
+#include <vector>
 
 int main(int argc, char** argv)
 {
@@ -12,50 +16,223 @@ int main(int argc, char** argv)
     {
         // Загрузка конфигурации из proxy_config.toml
         Proxy_Config config;
-        __PROXY_GLOBALS__::PROXY_CONFIG = config.get_settings();
-        if(__PROXY_GLOBALS__::PROXY_CONFIG.blacklist_on)
-            __PROXY_GLOBALS__::BLACKLISTED_HOSTS = config.get_blacklisted_hosts();
-        __PROXY_GLOBALS__::LOG_ON = __PROXY_GLOBALS__::PROXY_CONFIG.log_on;
-        __PROXY_GLOBALS__::LOGGER.init_logger(__PROXY_GLOBALS__::PROXY_CONFIG.log_file_name,
-        __PROXY_GLOBALS__::PROXY_CONFIG.log_file_size_bytes);
+        __PROXY_GLOBALS__::PROXY_CONFIG.publish(config.get_settings());
+        std::size_t blacklist_skipped = 0; // некорректные правила черного списка
+        // скомпилированный blacklist_compile файл отображается в память сразу, toml разбирается и строится заново
+        auto load_blacklist = [&blacklist_skipped](const Proxy_Config::Proxy_Settings& settings) -> std::shared_ptr<Domain_matcher>
+        {
+            auto matcher = std::make_shared<Domain_matcher>();
+            blacklist_skipped = 0;
+            if(!settings.blacklist_on || matcher->load(settings.blacklisted_hosts_file_name))
+                return matcher;
+            auto rules = Proxy_Config::read_blacklist(settings.blacklisted_hosts_file_name);
+            if(!rules) // ошибка уже напечатана
+                return nullptr;
+            blacklist_skipped = matcher->build(*rules);
+            return matcher;
+        };
+        if(auto matcher = load_blacklist(*__PROXY_GLOBALS__::PROXY_CONFIG))
+            __PROXY_GLOBALS__::BLACKLISTED_HOSTS.publish(std::move(matcher));
+        // CIDR списки адресов назначения и клиентов (пустое имя файла - список выключен)
+        auto load_addresses = [](const std::string& file_name) -> std::shared_ptr<Ip_matcher>
+        {
+            auto matcher = std::make_shared<Ip_matcher>();
+            if(file_name.empty())
+                return matcher;
+            auto rules = Proxy_Config::read_lines(file_name);
+            if(!rules) // ошибка уже напечатана
+                return nullptr;
+            if(auto skipped = matcher->build(*rules))
+                std::cout << "WARNING: " << skipped << " invalid rules were skipped in " << file_name << std::endl;
+            return matcher;
+        };
+        if(auto matcher = load_addresses(__PROXY_GLOBALS__::PROXY_CONFIG->blacklisted_addresses_file_name))
+            __PROXY_GLOBALS__::BLACKLISTED_ADDRESSES.publish(std::move(matcher));
+        if(auto matcher = load_addresses(__PROXY_GLOBALS__::PROXY_CONFIG->blacklisted_clients_file_name))
+            __PROXY_GLOBALS__::BLACKLISTED_CLIENTS.publish(std::move(matcher));
+        __PROXY_GLOBALS__::LOG_ON = __PROXY_GLOBALS__::PROXY_CONFIG->log_on;
+        __PROXY_GLOBALS__::LOGGER.init_logger(__PROXY_GLOBALS__::PROXY_CONFIG->log_file_name,
+        __PROXY_GLOBALS__::PROXY_CONFIG->log_file_size_bytes, __PROXY_GLOBALS__::PROXY_CONFIG->log_buffer_bytes);
+        if(__PROXY_GLOBALS__::PROXY_CONFIG->access_log_on)
+            __PROXY_GLOBALS__::ACCESS_LOG.open(__PROXY_GLOBALS__::PROXY_CONFIG->access_log_file_name,
+            __PROXY_GLOBALS__::PROXY_CONFIG->access_log_file_size_bytes, __PROXY_GLOBALS__::PROXY_CONFIG->log_buffer_bytes);
 #ifdef DEBUG
         // Если объявлен DEBUG, происходит объекта класса Logger через который происходит взаимодействие с дебаг логами
         DEBUG_LOGGER.init_logger(PROXY_CONFIG.log_file_name, PROXY_CONFIG.log_file_size_bytes);
         DEBUG_LOGGER.set_level(Logger::LOG_LEVEL::DEBUG);
 #endif
         
-        std::cout << "Starting proxy server on " << __PROXY_GLOBALS__::PROXY_CONFIG.host 
-                  << ":" << __PROXY_GLOBALS__::PROXY_CONFIG.port << "...\n";
-        std::cout << "Max connections: " << __PROXY_GLOBALS__::PROXY_CONFIG.max_connections << "\n";
-        std::cout << "Timeout: " << __PROXY_GLOBALS__::PROXY_CONFIG.timeout_milliseconds << " milliseconds\n";
-        std::cout << "Log on: " << __PROXY_GLOBALS__::PROXY_CONFIG.log_on << "\n";
-        std::cout << "Log file name: " << __PROXY_GLOBALS__::PROXY_CONFIG.log_file_name << "\n";
-        std::cout << "Log file size bytes: " << __PROXY_GLOBALS__::PROXY_CONFIG.log_file_size_bytes << "\n";
-        std::cout << "Max_bandwidth_per_sec: " << __PROXY_GLOBALS__::PROXY_CONFIG.max_bandwidth_per_sec << " bytes\n";
-        std::cout << "Blacklist_on: " << __PROXY_GLOBALS__::PROXY_CONFIG.blacklist_on << "\n";
-        std::cout << "Blacklisted_hosts_file_name: " << __PROXY_GLOBALS__::PROXY_CONFIG.blacklisted_hosts_file_name << "\n";
-        if(__PROXY_GLOBALS__::PROXY_CONFIG.blacklist_on)
+        std::cout << "Starting proxy server on " << __PROXY_GLOBALS__::PROXY_CONFIG->host 
+                  << ":" << __PROXY_GLOBALS__::PROXY_CONFIG->port << "...\n";
+        std::cout << "Max connections: " << __PROXY_GLOBALS__::PROXY_CONFIG->max_connections << "\n";
+        std::cout << "Reject when overloaded: " << __PROXY_GLOBALS__::PROXY_CONFIG->reject_when_overloaded << "\n";
+        std::cout << "Timeout: " << __PROXY_GLOBALS__::PROXY_CONFIG->timeout_milliseconds << " milliseconds\n";
+        std::cout << "Header timeout: " << __PROXY_GLOBALS__::PROXY_CONFIG->header_timeout_milliseconds << " milliseconds\n";
+        std::cout << "Log on: " << __PROXY_GLOBALS__::PROXY_CONFIG->log_on << "\n";
+        std::cout << "Log file name: " << __PROXY_GLOBALS__::PROXY_CONFIG->log_file_name << "\n";
+        std::cout << "Log file size bytes: " << __PROXY_GLOBALS__::PROXY_CONFIG->log_file_size_bytes << "\n";
+        std::cout << "Access log: " << (__PROXY_GLOBALS__::ACCESS_LOG.is_open() ?
+        __PROXY_GLOBALS__::PROXY_CONFIG->access_log_file_name : std::string("off")) << "\n";
+        std::cout << "Max_bandwidth_per_sec: " << __PROXY_GLOBALS__::PROXY_CONFIG->max_bandwidth_per_sec << " bytes\n";
+        std::cout << "Blacklist_on: " << __PROXY_GLOBALS__::PROXY_CONFIG->blacklist_on << "\n";
+        std::cout << "Blacklisted_hosts_file_name: " << __PROXY_GLOBALS__::PROXY_CONFIG->blacklisted_hosts_file_name << "\n";
+        std::cout << "DNS cache max entries: " << __PROXY_GLOBALS__::PROXY_CONFIG->dns_cache_max_entries << "\n";
+        std::cout << "DNS cache ttl: " << __PROXY_GLOBALS__::PROXY_CONFIG->dns_cache_ttl_seconds << " seconds\n";
+        __PROXY_GLOBALS__::DNS_CACHE.configure(__PROXY_GLOBALS__::PROXY_CONFIG->dns_cache_max_entries,
+        std::chrono::seconds(__PROXY_GLOBALS__::PROXY_CONFIG->dns_cache_ttl_seconds),
+        std::chrono::seconds(__PROXY_GLOBALS__::PROXY_CONFIG->dns_negative_ttl_seconds));
+        __PROXY_GLOBALS__::DNS_CACHE.set_system_timeout(std::chrono::milliseconds(__PROXY_GLOBALS__::PROXY_CONFIG->dns_timeout_milliseconds));
+        if(__PROXY_GLOBALS__::PROXY_CONFIG->dns_native_resolver)
+        {
+            auto resolver_settings = Dns_resolver::load_resolv_conf("/etc/resolv.conf");
+            resolver_settings.deadline = std::chrono::milliseconds(__PROXY_GLOBALS__::PROXY_CONFIG->dns_timeout_milliseconds);
+            if(!resolver_settings.nameservers.empty())
+                __PROXY_GLOBALS__::DNS_CACHE.set_resolver(std::make_shared<Dns_resolver>(resolver_settings));
+            else
+                std::cout << "WARNING: no nameservers in /etc/resolv.conf, using getaddrinfo" << std::endl;
+        }
+        std::cout << "DNS native resolver: " << __PROXY_GLOBALS__::PROXY_CONFIG->dns_native_resolver << "\n";
+        std::cout << "Tunnel splice: " << __PROXY_GLOBALS__::PROXY_CONFIG->tunnel_splice << "\n";
+        if(__PROXY_GLOBALS__::PROXY_CONFIG->tunnel_splice) // splice() в закрытый сокет шлет SIGPIPE (нельзя передать MSG_NOSIGNAL)
+            std::signal(SIGPIPE, SIG_IGN);
+        std::size_t workers_count = __PROXY_GLOBALS__::PROXY_CONFIG->worker_threads;
+        if(workers_count == 0) // 0 в конфиге - по одному воркеру на ядро
+            workers_count = std::max(1u, std::thread::hardware_concurrency());
+        std::cout << "Worker threads: " << workers_count << "\n";
+        if(__PROXY_GLOBALS__::PROXY_CONFIG->blacklist_on)
+        {
+            if(!__PROXY_GLOBALS__::BLACKLISTED_HOSTS->empty()) // список может быть на миллионы правил, печатается только размер
+                std::cout << "Blacklist rules: " << __PROXY_GLOBALS__::BLACKLISTED_HOSTS->rules() << " ("
+                << __PROXY_GLOBALS__::BLACKLISTED_HOSTS->memory_bytes() / 1024 << " KiB"
+                << (__PROXY_GLOBALS__::BLACKLISTED_HOSTS->mapped() ? ", compiled" : "") << ")\n";
+            else
+                std::cout << "WARNING: Blacklist is enabled but no hosts were loaded!" << std::endl; 
+            if(blacklist_skipped)
+                std::cout << "WARNING: " << blacklist_skipped << " invalid blacklist rules were skipped" << std::endl;
+        }
+        std::cout << "Blacklisted address rules: " << __PROXY_GLOBALS__::BLACKLISTED_ADDRESSES->rules()
+        << ", client rules: " << __PROXY_GLOBALS__::BLACKLISTED_CLIENTS->rules() << "\n";
+        // у каждого воркера свой io_context и свой acceptor на общем порту (SO_REUSEPORT),
+        // сессия живет в том потоке, который ее принял
+        auto user_traffic_manager = std::make_shared<User_traffic_manager>(); // лимиты трафика общие для всех воркеров
+        auto connection_gate = std::make_shared<Connection_gate>(__PROXY_GLOBALS__::PROXY_CONFIG->max_connections);
+        std::vector<std::unique_ptr<boost::asio::io_context>> contexts;
+        std::vector<std::shared_ptr<Server>> servers;
+        for(std::size_t i = 0; i < workers_count; i++)
         {
-            if(!__PROXY_GLOBALS__::BLACKLISTED_HOSTS.empty())
+            auto& context = *contexts.emplace_back(std::make_unique<boost::asio::io_context>(1));
+            auto server = servers.emplace_back(std::make_shared<Server>
+            (context, __PROXY_GLOBALS__::PROXY_CONFIG->port, user_traffic_manager, connection_gate, workers_count > 1));
+
+            boost::asio::co_spawn(context, [server]() -> boost::asio::awaitable<void>
             {
-                std::cout << "Blacklisted hosts:\n";
-                for(const auto& i : __PROXY_GLOBALS__::BLACKLISTED_HOSTS)
-                {
-                    std::cout << "\t\"" << i << "\"" << std::endl;
-                }
+                co_await server->run();
+            }, boost::asio::detached);
+        }
+
+        // SIGHUP или изменение конфига/черного списка - новые снимки настроек и правил без перезапуска,
+        // сессии дорабатывают со старыми; при ошибке остаются текущие
+        Reload_trigger reload_trigger;
+        auto watched_files = [&config]()
+        {
+            const auto& settings = config.get_settings();
+            std::vector<std::string> files{config.file_name(), settings.blacklisted_hosts_file_name};
+            for(const auto& file : {settings.blacklisted_addresses_file_name, settings.blacklisted_clients_file_name})
+            {
+                if(!file.empty())
+                    files.push_back(file);
             }
+            return files;
+        };
+        reload_trigger.start(watched_files(), [&]()
+        {
+            if(!config.reload())
+                return;
+            auto settings = config.get_settings();
+            for(const auto& name : Proxy_Config::keep_restart_only(*__PROXY_GLOBALS__::PROXY_CONFIG, settings))
+                std::cout << "WARNING: " << name << " is applied only after restart" << std::endl;
+            auto matcher = load_blacklist(settings);
+            if(!matcher)
+                std::cout << "WARNING: blacklist was not reloaded, keeping current rules" << std::endl;
+            __PROXY_GLOBALS__::PROXY_CONFIG.publish(settings);
+            if(matcher)
+                __PROXY_GLOBALS__::BLACKLISTED_HOSTS.publish(std::move(matcher));
+            if(blacklist_skipped)
+                std::cout << "WARNING: " << blacklist_skipped << " invalid blacklist rules were skipped" << std::endl;
+            if(auto addresses = load_addresses(settings.blacklisted_addresses_file_name))
+                __PROXY_GLOBALS__::BLACKLISTED_ADDRESSES.publish(std::move(addresses));
             else
-                std::cout << "WARNING: Blacklist is enabled but no hosts were loaded!" << std::endl; 
+                std::cout << "WARNING: address blacklist was not reloaded, keeping current rules" << std::endl;
+            if(auto clients = load_addresses(settings.blacklisted_clients_file_name))
+                __PROXY_GLOBALS__::BLACKLISTED_CLIENTS.publish(std::move(clients));
+            else
+                std::cout << "WARNING: client blacklist was not reloaded, keeping current rules" << std::endl;
+            reload_trigger.watch(watched_files()); // имя черного списка могло поменяться
+            std::cout << "Configuration reloaded (blacklist rules: " << __PROXY_GLOBALS__::BLACKLISTED_HOSTS->rules() << ")" << std::endl;
+        });
+
+        // значения, которые уже считаются в других объектах, читаются при выдаче метрик
+        auto& registry = __PROXY_GLOBALS__::METRICS.registry;
+        registry.gauge_callback("proxy_active_sessions", "Sessions holding a connection slot",
+        []() {return static_cast<double>(__PROXY_GLOBALS__::ACTIVE_CONNECTIONS.load());});
+        registry.gauge_callback("proxy_config_max_connections", "Configured max_connections",
+        []() {return static_cast<double>(__PROXY_GLOBALS__::PROXY_CONFIG->max_connections);});
+        registry.gauge_callback("proxy_config_max_bandwidth_per_sec", "Configured per-user bandwidth limit",
+        []() {return static_cast<double>(__PROXY_GLOBALS__::PROXY_CONFIG->max_bandwidth_per_sec);});
+        registry.counter_callback("proxy_dns_cache_hits_total", "DNS answers served from the cache",
+        []() {return static_cast<double>(__PROXY_GLOBALS__::DNS_CACHE.hits());});
+        registry.counter_callback("proxy_dns_cache_misses_total", "DNS lookups sent to the resolver",
+        []() {return static_cast<double>(__PROXY_GLOBALS__::DNS_CACHE.misses());});
+        registry.counter_callback("proxy_dns_cache_coalesced_total", "DNS lookups that waited for a concurrent lookup",
+        []() {return static_cast<double>(__PROXY_GLOBALS__::DNS_CACHE.coalesced());});
+        registry.counter_callback("proxy_dns_cache_failures_total", "DNS lookups that failed",
+        []() {return static_cast<double>(__PROXY_GLOBALS__::DNS_CACHE.failures());});
+        registry.gauge_callback("proxy_dns_cache_entries", "Entries in the DNS cache",
+        []() {return static_cast<double>(__PROXY_GLOBALS__::DNS_CACHE.size());});
+        registry.gauge_callback("proxy_blacklist_rules", "Loaded blacklist rules",
+        []()
+        {
+            auto rules = __PROXY_GLOBALS__::BLACKLISTED_HOSTS.get(); // пустой, если файл не прочитался при старте
+            return rules ? static_cast<double>(rules->rules()) : 0.0;
+        }, "list=\"hosts\"");
+        registry.gauge_callback("proxy_blacklist_rules", "Loaded blacklist rules",
+        []()
+        {
+            auto rules = __PROXY_GLOBALS__::BLACKLISTED_ADDRESSES.get(); // пустой, если файл не прочитался при старте
+            return rules ? static_cast<double>(rules->rules()) : 0.0;
+        }, "list=\"addresses\"");
+        registry.gauge_callback("proxy_blacklist_rules", "Loaded blacklist rules",
+        []()
+        {
+            auto rules = __PROXY_GLOBALS__::BLACKLISTED_CLIENTS.get(); // пустой, если файл не прочитался при старте
+            return rules ? static_cast<double>(rules->rules()) : 0.0;
+        }, "list=\"clients\"");
+        Metrics_server metrics_server(registry);
+        if(__PROXY_GLOBALS__::PROXY_CONFIG->metrics_port != 0)
+        {
+            metrics_server.start(__PROXY_GLOBALS__::PROXY_CONFIG->metrics_host, __PROXY_GLOBALS__::PROXY_CONFIG->metrics_port);
+            std::cout << "Metrics: http://" << __PROXY_GLOBALS__::PROXY_CONFIG->metrics_host << ":" << metrics_server.port()
+            << "/metrics\n";
         }
-        boost::asio::io_context context;
-        auto server = std::make_shared<Server>(context, __PROXY_GLOBALS__::PROXY_CONFIG.port);
-        
-        boost::asio::co_spawn(context, [server]() -> boost::asio::awaitable<void>
+
+        std::vector<std::thread> workers;
+        for(std::size_t i = 1; i < workers_count; i++)
         {
-            co_await server->run();
-        }, boost::asio::detached);
-        
-        context.run();
+            workers.emplace_back([&context = *contexts[i]]()
+            {
+                try
+                {
+                    context.run();
+                }
+                catch(const std::exception& ex)
+                {
+                    std::cerr << "\n!!!EXCEPTION IN WORKER THREAD: " << ex.what() << "!!!\n";
+                }
+            });
+        }
+        contexts[0]->run(); // первый воркер работает в главном потоке
+        for(auto& worker : workers)
+            worker.join();
     }
     catch(const std::exception& ex)
     {
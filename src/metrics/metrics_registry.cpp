@@ -0,0 +1,227 @@
+#include "metrics/metrics_registry.hpp"
+#include <bit>
+#include <charconv>
+#include <cmath>
+#include <stdexcept>
+
+namespace
+{
+    std::atomic<std::uint64_t> next_registry_id{0};
+
+    void append_number(std::string& out, double value) // кратчайшая точная запись
+    {
+        char buffer[32];
+        auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+        out.append(buffer, result.ptr);
+    }
+
+    double scaled(std::uint64_t value, double scale) // 1e-6 - деление на 1e6: 1023 мкс печатается как 0.001023, без хвоста ошибки
+    {
+        auto inverse = std::round(1 / scale);
+        if(scale < 1 && std::abs(inverse * scale - 1) < 1e-12)
+            return static_cast<double>(value) / inverse;
+        return static_cast<double>(value) * scale;
+    }
+
+    void append_series(std::string& out, const std::string& name, const std::string& labels, const std::string& extra_label = "")
+    {
+        out += name;
+        if(!labels.empty() || !extra_label.empty())
+        {
+            out += '{';
+            out += labels;
+            if(!labels.empty() && !extra_label.empty())
+                out += ',';
+            out += extra_label;
+            out += '}';
+        }
+        out += ' ';
+    }
+}
+
+Metrics_registry::Metrics_registry() : id_(next_registry_id.fetch_add(1, std::memory_order_relaxed)), retired_(MAX_SLOTS, 0)
+{}
+
+Metrics_registry::Shard& Metrics_registry::register_thread()
+{
+    thread_local std::unordered_map<std::uint64_t, std::shared_ptr<Shard>> shards;
+    auto& shard = shards[id_];
+    if(!shard) // первая запись из этого потока
+    {
+        shard = std::make_shared<Shard>();
+        std::lock_guard lock(mutex_);
+        shards_.push_back(shard);
+    }
+    return *shard;
+}
+
+std::uint32_t Metrics_registry::add_series(const std::string& name, const std::string& help, const std::string& type, double scale,
+const std::string& labels, std::size_t slots, Callback callback)
+{
+    std::lock_guard lock(mutex_);
+    if(used_slots_ + slots > MAX_SLOTS)
+        throw std::length_error("metrics registry is full: " + name);
+    Family* family = nullptr;
+    for(auto& i : families_)
+    {
+        if(i.name == name)
+            family = &i;
+    }
+    if(!family)
+    {
+        family = &families_.emplace_back();
+        family->name = name;
+        family->help = help;
+        family->type = type;
+        family->scale = scale;
+    }
+    else if(family->type != type)
+        throw std::invalid_argument("metric " + name + " is already registered as " + family->type);
+    auto slot = static_cast<std::uint32_t>(used_slots_);
+    used_slots_ += slots;
+    family->series.push_back(Series{labels, slot, std::move(callback)});
+    return slot;
+}
+
+Metrics_registry::Counter Metrics_registry::counter(const std::string& name, const std::string& help, const std::string& labels, double scale)
+{
+    return Counter(this, add_series(name, help, "counter", scale, labels, 1, nullptr));
+}
+
+Metrics_registry::Gauge Metrics_registry::gauge(const std::string& name, const std::string& help, const std::string& labels)
+{
+    return Gauge(this, add_series(name, help, "gauge", 1, labels, 1, nullptr));
+}
+
+Metrics_registry::Histogram Metrics_registry::histogram(const std::string& name, const std::string& help, double scale, const std::string& labels)
+{
+    return Histogram(this, add_series(name, help, "histogram", scale, labels, HISTOGRAM_BUCKETS + 1, nullptr));
+}
+
+void Metrics_registry::counter_callback(const std::string& name, const std::string& help, Callback callback, const std::string& labels)
+{
+    add_series(name, help, "counter", 1, labels, 0, std::move(callback));
+}
+
+void Metrics_registry::gauge_callback(const std::string& name, const std::string& help, Callback callback, const std::string& labels)
+{
+    add_series(name, help, "gauge", 1, labels, 0, std::move(callback));
+}
+
+std::size_t Metrics_registry::bucket(std::uint64_t value)
+{
+    constexpr std::uint64_t SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+    if(value < SUB_BUCKETS) // маленькие значения - точно
+        return value;
+    unsigned exponent = std::bit_width(value) - 1;
+    auto mantissa = (value >> (exponent - SUB_BUCKET_BITS)) & (SUB_BUCKETS - 1); // следующие за старшим биты
+    auto index = SUB_BUCKETS + (exponent - SUB_BUCKET_BITS) * SUB_BUCKETS + mantissa;
+    return std::min<std::size_t>(index, HISTOGRAM_BUCKETS - 1);
+}
+
+std::uint64_t Metrics_registry::bucket_upper(std::size_t bucket)
+{
+    constexpr std::uint64_t SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+    if(bucket < SUB_BUCKETS)
+        return bucket;
+    if(bucket >= HISTOGRAM_BUCKETS - 1)
+        return UINT64_MAX;
+    auto exponent = (bucket - SUB_BUCKETS) / SUB_BUCKETS + SUB_BUCKET_BITS;
+    auto mantissa = (bucket - SUB_BUCKETS) % SUB_BUCKETS;
+    auto width = std::uint64_t(1) << (exponent - SUB_BUCKET_BITS);
+    return (SUB_BUCKETS + mantissa) * width + width - 1;
+}
+
+void Metrics_registry::retire_finished() const
+{
+    for(std::size_t i = 0; i < shards_.size();)
+    {
+        if(shards_[i].use_count() > 1) // поток еще держит шард
+        {
+            i++;
+            continue;
+        }
+        for(std::size_t slot = 0; slot < used_slots_; slot++)
+            retired_[slot] += shards_[i]->slots[slot].load(std::memory_order_relaxed);
+        shards_[i] = std::move(shards_.back());
+        shards_.pop_back();
+    }
+}
+
+std::uint64_t Metrics_registry::total(std::uint32_t slot) const
+{
+    auto sum = retired_[slot];
+    for(const auto& shard : shards_)
+        sum += shard->slots[slot].load(std::memory_order_relaxed);
+    return sum;
+}
+
+std::uint64_t Metrics_registry::value(const Counter& counter) const
+{
+    std::lock_guard lock(mutex_);
+    return total(counter.slot_);
+}
+
+std::int64_t Metrics_registry::value(const Gauge& gauge) const
+{
+    std::lock_guard lock(mutex_);
+    return static_cast<std::int64_t>(total(gauge.slot_));
+}
+
+std::uint64_t Metrics_registry::count(const Histogram& histogram, std::uint64_t max_value) const
+{
+    std::lock_guard lock(mutex_);
+    std::uint64_t sum = 0;
+    for(std::size_t i = 0; i <= bucket(max_value); i++)
+        sum += total(histogram.slot_ + i);
+    return sum;
+}
+
+std::string Metrics_registry::scrape() const
+{
+    std::lock_guard lock(mutex_);
+    retire_finished();
+    std::string out;
+    for(const auto& family : families_)
+    {
+        out += "# HELP " + family.name + " " + family.help + "\n";
+        out += "# TYPE " + family.name + " " + family.type + "\n";
+        for(const auto& series : family.series)
+        {
+            if(family.type != "histogram")
+            {
+                append_series(out, family.name, series.labels);
+                if(series.callback)
+                    append_number(out, series.callback());
+                else if(family.type == "gauge")
+                    out += std::to_string(static_cast<std::int64_t>(total(series.slot)));
+                else if(family.scale == 1)
+                    out += std::to_string(total(series.slot));
+                else
+                    append_number(out, scaled(total(series.slot), family.scale));
+                out += '\n';
+                continue;
+            }
+            // границы - только степени двойки (2^k - 1), точные корзины остаются внутри
+            std::uint64_t cumulative = 0;
+            for(std::size_t i = 0; i < HISTOGRAM_BUCKETS; i++)
+            {
+                cumulative += total(series.slot + i);
+                if(i == HISTOGRAM_BUCKETS - 1 || i % (1 << SUB_BUCKET_BITS) != (1 << SUB_BUCKET_BITS) - 1)
+                    continue;
+                std::string le = "le=\"";
+                append_number(le, scaled(bucket_upper(i), family.scale));
+                append_series(out, family.name + "_bucket", series.labels, le + "\"");
+                out += std::to_string(cumulative) + "\n";
+            }
+            append_series(out, family.name + "_bucket", series.labels, "le=\"+Inf\"");
+            out += std::to_string(cumulative) + "\n";
+            append_series(out, family.name + "_sum", series.labels);
+            append_number(out, scaled(total(series.slot + HISTOGRAM_BUCKETS), family.scale));
+            out += "\n";
+            append_series(out, family.name + "_count", series.labels);
+            out += std::to_string(cumulative) + "\n";
+        }
+    }
+    return out;
+}
@@ -0,0 +1,92 @@
+#include "metrics/metrics_server.hpp"
+#include "utils/deadline.hpp"
+#include <boost/beast.hpp>
+#include <iostream>
+
+Metrics_server::Metrics_server(const Metrics_registry& registry) : registry_(registry), acceptor_(context_)
+{}
+
+Metrics_server::~Metrics_server()
+{
+    stop();
+}
+
+void Metrics_server::start(const std::string& host, unsigned short port)
+{
+    stop();
+    context_.restart();
+    boost::asio::ip::tcp::endpoint endpoint(boost::asio::ip::make_address(host), port);
+    acceptor_.open(endpoint.protocol());
+    acceptor_.set_option(boost::asio::socket_base::reuse_address(true));
+    acceptor_.bind(endpoint);
+    acceptor_.listen();
+    port_ = acceptor_.local_endpoint().port();
+    boost::asio::co_spawn(context_, accept_connections(), boost::asio::detached);
+    thread_ = std::thread([this]()
+    {
+        try
+        {
+            context_.run();
+        }
+        catch(const std::exception& ex)
+        {
+            std::cerr << "\n!!!EXCEPTION IN METRICS THREAD: " << ex.what() << "!!!\n";
+        }
+    });
+}
+
+void Metrics_server::stop()
+{
+    if(!thread_.joinable())
+        return;
+    context_.stop();
+    thread_.join();
+    boost::system::error_code ec;
+    acceptor_.close(ec);
+}
+
+boost::asio::awaitable<void> Metrics_server::accept_connections()
+{
+    for(;;)
+    {
+        boost::system::error_code ec;
+        auto socket = co_await acceptor_.async_accept(boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+        if(ec == boost::asio::error::operation_aborted || !acceptor_.is_open())
+            co_return;
+        if(ec)
+            continue;
+        boost::asio::co_spawn(context_, serve(std::move(socket)), boost::asio::detached);
+    }
+}
+
+boost::asio::awaitable<void> Metrics_server::serve(boost::asio::ip::tcp::socket socket)
+{
+    boost::system::error_code ec;
+    boost::beast::flat_buffer buffer;
+    boost::beast::http::request<boost::beast::http::empty_body> request;
+    {
+        Deadline deadline(socket, std::chrono::seconds(5)); // сборщик, не приславший запрос, не держит соеденение
+        co_await boost::beast::http::async_read(socket, buffer, request, boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+    }
+    if(ec)
+        co_return;
+    boost::beast::http::response<boost::beast::http::string_body> response;
+    response.version(request.version());
+    response.set(boost::beast::http::field::server, "Proxy");
+    response.keep_alive(false);
+    if(request.target() != "/metrics")
+        response.result(boost::beast::http::status::not_found);
+    else if(request.method() != boost::beast::http::verb::get && request.method() != boost::beast::http::verb::head)
+        response.result(boost::beast::http::status::method_not_allowed);
+    else
+    {
+        response.result(boost::beast::http::status::ok);
+        response.set(boost::beast::http::field::content_type, "text/plain; version=0.0.4; charset=utf-8");
+        response.body() = registry_.scrape();
+    }
+    response.prepare_payload();
+    if(request.method() == boost::beast::http::verb::head)
+        response.body().clear(); // Content-Length остается как у GET
+    co_await boost::beast::http::async_write(socket, response, boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+    socket.shutdown(boost::asio::ip::tcp::socket::shutdown_both, ec);
+}
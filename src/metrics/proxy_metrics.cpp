@@ -0,0 +1,25 @@
+#include "metrics/proxy_metrics.hpp"
+
+Proxy_metrics::Proxy_metrics()
+{
+    connections_accepted = registry.counter("proxy_connections_accepted_total", "Accepted client connections");
+    rejected_overloaded = registry.counter("proxy_connections_rejected_total", "Client connections closed before a session",
+    "reason=\"overloaded\"");
+    rejected_client = registry.counter("proxy_connections_rejected_total", "Client connections closed before a session",
+    "reason=\"blacklisted_client\"");
+    for(std::size_t i = 0; i < SESSION_ENDS; i++)
+    {
+        sessions[i] = registry.counter("proxy_sessions_total", "Finished sessions by end reason",
+        std::string("end=\"") + access_end_name(static_cast<Access_end>(i)) + "\"");
+    }
+    requests = registry.counter("proxy_requests_total", "Parsed client requests");
+    bytes_upload = registry.counter("proxy_bytes_total", "Bytes relayed", "direction=\"upload\"");
+    bytes_download = registry.counter("proxy_bytes_total", "Bytes relayed", "direction=\"download\"");
+    throttled_upload = registry.counter("proxy_throttled_seconds_total", "Time spent waiting for bandwidth limiters",
+    "direction=\"upload\"", 1e-6);
+    throttled_download = registry.counter("proxy_throttled_seconds_total", "Time spent waiting for bandwidth limiters",
+    "direction=\"download\"", 1e-6);
+    session_duration = registry.histogram("proxy_session_duration_seconds", "Session duration from accept to close", 1e-6);
+    connect_duration = registry.histogram("proxy_upstream_connect_seconds", "Time from request header to connected upstream (resolve and connect)", 1e-6);
+    first_byte_duration = registry.histogram("proxy_first_byte_seconds", "Time from request header to upstream response header", 1e-6);
+}
@@ -1,7 +1,7 @@
 #include "network/analyze_request.hpp"
 #include "globals/globals.hpp"
 
-HttpHandler::HandlerResult HttpHandler::analyze_request(const boost::beast::http::request<boost::beast::http::string_body>& req)
+HttpHandler::HandlerResult HttpHandler::analyze_request(const boost::beast::http::request_header<>& req)
 {
     HttpHandler::HandlerResult result;
     result.is_connect = (req.method() == boost::beast::http::verb::connect);
@@ -23,7 +23,9 @@ HttpHandler::HandlerResult HttpHandler::analyze_request(const boost::beast::http
     else
     {
         auto host_hdr = req.find(boost::beast::http::field::host);
-        std::string_view host_value = host_hdr->value();
+        std::string_view host_value; // без заголовка Host хост остается пустым
+        if(host_hdr != req.end())
+            host_value = host_hdr->value();
         auto pos = host_value.find(':');
         if (pos != std::string_view::npos)
         {
@@ -36,6 +38,6 @@ HttpHandler::HandlerResult HttpHandler::analyze_request(const boost::beast::http
             result.port = "80";
         }
     }
-    result.is_blacklisted = __PROXY_GLOBALS__::BLACKLISTED_HOSTS.count(result.host);
+    result.is_blacklisted = __PROXY_GLOBALS__::BLACKLISTED_HOSTS->matches(result.host);
     return result;
 }
\ No newline at end of file
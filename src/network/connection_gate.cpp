@@ -0,0 +1,95 @@
+#include "network/connection_gate.hpp"
+#include "globals/globals.hpp"
+
+Connection_gate::Slot::Slot(std::shared_ptr<Connection_gate> gate)
+: gate_(std::move(gate))
+{}
+
+Connection_gate::Slot::Slot(Slot&& other) noexcept
+: gate_(std::move(other.gate_))
+{}
+
+Connection_gate::Slot& Connection_gate::Slot::operator=(Slot&& other) noexcept
+{
+    if(this != &other)
+    {
+        release();
+        gate_ = std::move(other.gate_);
+    }
+    return *this;
+}
+
+Connection_gate::Slot::~Slot()
+{
+    release();
+}
+
+void Connection_gate::Slot::release()
+{
+    if(gate_)
+    {
+        gate_->release();
+        gate_.reset();
+    }
+}
+
+Connection_gate::Connection_gate(std::size_t max_connections)
+: max_connections_(max_connections), active_(0)
+{}
+
+boost::asio::awaitable<Connection_gate::Slot> Connection_gate::async_acquire()
+{
+    std::shared_ptr<Async_waiter> waiter;
+    {
+        std::lock_guard lock(mutex_);
+        if(active_ < max_connections_)
+        {
+            active_++;
+            __PROXY_GLOBALS__::ACTIVE_CONNECTIONS = active_;
+            co_return Slot(shared_from_this());
+        }
+        waiter = std::make_shared<Async_waiter>(co_await boost::asio::this_coro::executor);
+        waiters_.push_back(waiter);
+    }
+    co_await waiter->wait(); // слот передается напрямую от освободившей его сессии, active_ не меняется
+    co_return Slot(shared_from_this());
+}
+
+std::optional<Connection_gate::Slot> Connection_gate::try_acquire()
+{
+    std::lock_guard lock(mutex_);
+    if(active_ >= max_connections_ || !waiters_.empty())
+        return std::nullopt;
+    active_++;
+    __PROXY_GLOBALS__::ACTIVE_CONNECTIONS = active_;
+    return Slot(shared_from_this());
+}
+
+void Connection_gate::release()
+{
+    std::shared_ptr<Async_waiter> next;
+    {
+        std::lock_guard lock(mutex_);
+        if(waiters_.empty())
+        {
+            active_--;
+            __PROXY_GLOBALS__::ACTIVE_CONNECTIONS = active_;
+            return;
+        }
+        next = std::move(waiters_.front());
+        waiters_.pop_front();
+    }
+    next->notify();
+}
+
+std::size_t Connection_gate::active() const
+{
+    std::lock_guard lock(mutex_);
+    return active_;
+}
+
+std::size_t Connection_gate::waiting() const
+{
+    std::lock_guard lock(mutex_);
+    return waiters_.size();
+}
@@ -0,0 +1,174 @@
+#include "network/dns_cache.hpp"
+#include <algorithm>
+#include <cctype>
+
+Dns_cache::Dns_cache()
+: max_entries_(4096), ttl_(std::chrono::seconds(60)), negative_ttl_(std::chrono::seconds(5)), system_timeout_(0),
+hits_(0), misses_(0), coalesced_(0), failures_(0)
+{}
+
+void Dns_cache::configure(std::size_t max_entries, std::chrono::milliseconds ttl, std::chrono::milliseconds negative_ttl)
+{
+    std::lock_guard lock(mutex_);
+    max_entries_ = max_entries;
+    ttl_ = ttl;
+    negative_ttl_ = negative_ttl;
+    entries_.clear();
+    lru_.clear();
+}
+
+void Dns_cache::set_resolver(std::shared_ptr<Dns_resolver> resolver)
+{
+    std::lock_guard lock(mutex_);
+    resolver_ = std::move(resolver);
+}
+
+void Dns_cache::set_system_timeout(std::chrono::milliseconds timeout)
+{
+    std::lock_guard lock(mutex_);
+    system_timeout_ = timeout;
+}
+
+boost::asio::awaitable<Dns_cache::results_type> Dns_cache::async_resolve
+(const std::string& host, const std::string& port, boost::system::error_code& ec)
+{
+    auto key = host + ":" + port; // имена хостов регистронезависимы: Example.com и example.com - одна запись
+    std::transform(key.begin(), key.begin() + host.size(), key.begin(), [](unsigned char c){return std::tolower(c);});
+    results_type results;
+    std::shared_ptr<Pending> pending;
+    std::shared_ptr<Async_waiter> waiter;
+    std::shared_ptr<Dns_resolver> resolver;
+    std::chrono::milliseconds timeout(0);
+    bool leader = false;
+    auto executor = co_await boost::asio::this_coro::executor;
+    {
+        std::lock_guard lock(mutex_);
+        if(lookup(key, results, ec))
+        {
+            hits_++;
+            co_return results;
+        }
+        resolver = resolver_;
+        timeout = resolver ? std::chrono::milliseconds(0) : system_timeout_; // собственный резолвер ограничен своим deadline
+        auto it = pending_.find(key);
+        if(it != pending_.end()) // этот host:port уже резолвится, ждем результат
+        {
+            pending = it->second;
+            coalesced_++;
+        }
+        else
+        {
+            pending = std::make_shared<Pending>();
+            pending_.emplace(key, pending);
+            leader = true;
+            misses_++;
+        }
+        if(!leader || !resolver) // getaddrinfo тоже ждется через pending, как чужой резолвинг
+        {
+            waiter = std::make_shared<Async_waiter>(executor);
+            pending->waiters.push_back(waiter);
+        }
+    }
+    if(leader && !resolver)
+        boost::asio::co_spawn(executor, system_lookup(key, host, port, pending), boost::asio::detached);
+    if(waiter)
+    {
+        if(timeout.count() == 0)
+            co_await waiter->wait();
+        else if(!co_await waiter->wait(timeout)) // getaddrinfo завис: запрос уходит, резолвинг доделывается и попадает в кеш
+        {
+            ec = boost::asio::error::timed_out;
+            co_return results_type();
+        }
+        ec = pending->error;
+        co_return pending->results;
+    }
+
+    Completion completion{*this, key, *pending};
+    completion.results = co_await resolver->async_resolve(host, port, completion.record_ttl, ec);
+    completion.error = ec;
+    co_return completion.results;
+}
+
+boost::asio::awaitable<void> Dns_cache::system_lookup(std::string key, std::string host, std::string port, std::shared_ptr<Pending> pending)
+{
+    Completion completion{*this, key, *pending};
+    boost::system::error_code ec;
+    boost::asio::ip::tcp::resolver system_resolver(co_await boost::asio::this_coro::executor);
+    completion.results = co_await system_resolver.async_resolve(host, port, boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+    completion.error = ec;
+}
+
+void Dns_cache::complete(const std::string& key, Pending& pending, const results_type& results,
+const boost::system::error_code& ec, std::uint32_t record_ttl)
+{
+    std::vector<std::shared_ptr<Async_waiter>> waiters;
+    {
+        std::lock_guard lock(mutex_);
+        pending.results = results;
+        pending.error = ec;
+        waiters = std::move(pending.waiters);
+        pending_.erase(key);
+        if(ec && ec != boost::asio::error::operation_aborted)
+            failures_++;
+        if(ec != boost::asio::error::operation_aborted)
+            store(key, results, ec, std::chrono::seconds(record_ttl));
+    }
+    for(auto& i : waiters)
+        i->notify();
+}
+
+bool Dns_cache::lookup(const std::string& key, results_type& results, boost::system::error_code& ec)
+{
+    auto it = entries_.find(key);
+    if(it == entries_.end())
+        return false;
+    if(it->second.expires <= std::chrono::steady_clock::now())
+    {
+        lru_.erase(it->second.lru_position);
+        entries_.erase(it);
+        return false;
+    }
+    lru_.splice(lru_.begin(), lru_, it->second.lru_position); // запись становится самой свежей
+    results = it->second.results;
+    ec = it->second.error;
+    return true;
+}
+
+void Dns_cache::store(const std::string& key, const results_type& results,
+const boost::system::error_code& ec, std::chrono::seconds record_ttl)
+{
+    if(max_entries_ == 0)
+        return;
+    auto ttl = ec ? negative_ttl_ : std::min<std::chrono::milliseconds>(ttl_, record_ttl); // TTL записи, но не больше настроенного
+    auto expires = std::chrono::steady_clock::now() + ttl;
+    auto it = entries_.find(key);
+    if(it != entries_.end())
+    {
+        it->second.results = results;
+        it->second.error = ec;
+        it->second.expires = expires;
+        lru_.splice(lru_.begin(), lru_, it->second.lru_position);
+        return;
+    }
+    while(entries_.size() >= max_entries_) // вытеснение самых старых записей
+    {
+        entries_.erase(lru_.back());
+        lru_.pop_back();
+    }
+    lru_.push_front(key);
+    entries_.emplace(key, Entry{results, ec, expires, lru_.begin()});
+}
+
+void Dns_cache::clear()
+{
+    std::lock_guard lock(mutex_);
+    entries_.clear();
+    lru_.clear();
+}
+
+std::size_t Dns_cache::size() const
+{
+    std::lock_guard lock(mutex_);
+    return entries_.size();
+}
@@ -0,0 +1,464 @@
+#include "network/dns_resolver.hpp"
+#include "utils/timer.hpp"
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <charconv>
+#include <fstream>
+#include <random>
+#include <sstream>
+
+namespace
+{
+    constexpr int RCODE_NOERROR = 0;
+    constexpr int RCODE_NXDOMAIN = 3;
+    constexpr std::size_t MAX_NAMESERVERS = 3; // как MAXNS в glibc
+    constexpr std::size_t HEADER_SIZE = 12;
+
+    std::uint16_t read_u16(const std::uint8_t* data)
+    {
+        return static_cast<std::uint16_t>((data[0] << 8) | data[1]);
+    }
+
+    std::uint32_t read_u32(const std::uint8_t* data)
+    {
+        return (static_cast<std::uint32_t>(data[0]) << 24) | (static_cast<std::uint32_t>(data[1]) << 16) |
+        (static_cast<std::uint32_t>(data[2]) << 8) | static_cast<std::uint32_t>(data[3]);
+    }
+
+    void write_u16(std::vector<std::uint8_t>& out, std::uint16_t value)
+    {
+        out.push_back(static_cast<std::uint8_t>(value >> 8));
+        out.push_back(static_cast<std::uint8_t>(value & 0xFF));
+    }
+
+    std::string to_lower(std::string str)
+    {
+        std::transform(str.begin(), str.end(), str.begin(), [](unsigned char c){return std::tolower(c);});
+        return str;
+    }
+
+    // чтение имени (с поддержкой сжатия), offset сдвигается за имя в исходном месте
+    bool read_name(const std::uint8_t* data, std::size_t size, std::size_t& offset, std::string& name)
+    {
+        name.clear();
+        std::size_t position = offset;
+        bool jumped = false;
+        int jumps = 0;
+        for(;;)
+        {
+            if(position >= size)
+                return false;
+            std::uint8_t length = data[position];
+            if((length & 0xC0) == 0xC0) // указатель на уже встречавшееся имя
+            {
+                if(position + 1 >= size || ++jumps > 16)
+                    return false;
+                if(!jumped)
+                    offset = position + 2;
+                jumped = true;
+                position = ((length & 0x3F) << 8) | data[position + 1];
+                continue;
+            }
+            if(length & 0xC0)
+                return false;
+            if(length == 0)
+            {
+                if(!jumped)
+                    offset = position + 1;
+                return true;
+            }
+            if(position + 1 + length > size)
+                return false;
+            if(!name.empty())
+                name += '.';
+            for(std::size_t i = position + 1; i < position + 1 + length; i++)
+                name += static_cast<char>(std::tolower(data[i]));
+            if(name.size() > 255)
+                return false;
+            position += 1 + length;
+        }
+    }
+
+    bool is_done(const Dns_resolver::Reply& reply) // на запрос получен окончательный ответ
+    {
+        return (reply.rcode == RCODE_NOERROR && !reply.truncated) || reply.rcode == RCODE_NXDOMAIN;
+    }
+
+    std::uint16_t random_id()
+    {
+        thread_local std::mt19937 generator(std::random_device{}());
+        return static_cast<std::uint16_t>(std::uniform_int_distribution<unsigned int>(0, 0xFFFF)(generator));
+    }
+}
+
+Dns_resolver::Settings Dns_resolver::load_resolv_conf(const std::string& filename)
+{
+    Settings settings;
+    std::ifstream file(filename);
+    std::string line;
+    while(std::getline(file, line))
+    {
+        line = line.substr(0, line.find_first_of("#;"));
+        std::istringstream stream(line);
+        std::string keyword;
+        stream >> keyword;
+        if(keyword == "nameserver")
+        {
+            std::string value;
+            stream >> value;
+            boost::system::error_code ec;
+            auto address = boost::asio::ip::make_address(value, ec);
+            if(!ec && settings.nameservers.size() < MAX_NAMESERVERS)
+                settings.nameservers.emplace_back(address, 53);
+        }
+        else if(keyword == "options")
+        {
+            std::string option;
+            while(stream >> option)
+            {
+                int value = 0;
+                auto separator = option.find(':');
+                if(separator == std::string::npos)
+                    continue;
+                auto number = option.substr(separator + 1);
+                if(std::from_chars(number.data(), number.data() + number.size(), value).ec != std::errc{})
+                    continue;
+                if(option.compare(0, separator, "timeout") == 0)
+                    settings.timeout = std::chrono::seconds(std::clamp(value, 1, 30));
+                else if(option.compare(0, separator, "attempts") == 0)
+                    settings.attempts = std::clamp(value, 1, 5);
+            }
+        }
+    }
+    return settings;
+}
+
+Dns_resolver::Dns_resolver(Settings settings, const std::string& hosts_file_name)
+: settings_(std::move(settings))
+{
+    load_hosts(hosts_file_name);
+}
+
+void Dns_resolver::load_hosts(const std::string& filename)
+{
+    std::ifstream file(filename);
+    std::string line;
+    while(std::getline(file, line))
+    {
+        line = line.substr(0, line.find('#'));
+        std::istringstream stream(line);
+        std::string value;
+        if(!(stream >> value))
+            continue;
+        boost::system::error_code ec;
+        auto address = boost::asio::ip::make_address(value, ec);
+        if(ec)
+            continue;
+        std::string name;
+        while(stream >> name)
+            hosts_[to_lower(name)].push_back(address);
+    }
+}
+
+boost::asio::awaitable<Dns_resolver::results_type> Dns_resolver::async_resolve
+(const std::string& host, const std::string& port, std::uint32_t& ttl, boost::system::error_code& ec)
+{
+    ec.clear();
+    ttl = UINT32_MAX;
+    unsigned int port_number = 0;
+    auto [end, error] = std::from_chars(port.data(), port.data() + port.size(), port_number);
+    if(port.empty() || error != std::errc{} || end != port.data() + port.size() || port_number > 65535)
+    {
+        ec = boost::asio::error::service_not_found;
+        co_return results_type{};
+    }
+
+    auto make_results = [&](const std::vector<boost::asio::ip::address>& addresses)
+    {
+        std::vector<boost::asio::ip::tcp::endpoint> endpoints;
+        for(const auto& i : addresses)
+            endpoints.emplace_back(i, static_cast<unsigned short>(port_number));
+        return results_type::create(endpoints.begin(), endpoints.end(), host, port);
+    };
+
+    auto literal = host.size() > 2 && host.front() == '[' && host.back() == ']' ? host.substr(1, host.size() - 2) : host;
+    boost::system::error_code address_ec;
+    auto address = boost::asio::ip::make_address(literal, address_ec);
+    if(!address_ec) // IP адрес резолвить не нужно
+        co_return make_results({address});
+
+    auto name = to_lower(host);
+    if(!name.empty() && name.back() == '.')
+        name.pop_back();
+    if(auto it = hosts_.find(name); it != hosts_.end())
+        co_return make_results(it->second);
+
+    bool valid = !name.empty() && name.size() <= 253;
+    for(std::size_t begin = 0; valid && begin <= name.size();)
+    {
+        auto dot = std::min(name.find('.', begin), name.size());
+        valid = dot - begin > 0 && dot - begin <= 63;
+        begin = dot + 1;
+    }
+    if(!valid || settings_.nameservers.empty())
+    {
+        ec = boost::asio::error::host_not_found;
+        co_return results_type{};
+    }
+
+    std::vector<std::uint16_t> types{TYPE_A, TYPE_AAAA};
+    std::vector<Reply> replies(types.size());
+    auto all_done = [&](){return std::all_of(replies.begin(), replies.end(), is_done);};
+    auto deadline = std::chrono::steady_clock::time_point::max();
+    if(settings_.deadline.count() > 0)
+        deadline = std::chrono::steady_clock::now() + settings_.deadline;
+    bool expired = false;
+    auto remaining = [&]() // ожидание одного nameserver'а, но не дольше общего срока
+    {
+        if(deadline == std::chrono::steady_clock::time_point::max())
+            return settings_.timeout;
+        auto left = std::chrono::ceil<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+        expired = left.count() <= 0;
+        return std::min(settings_.timeout, left);
+    };
+    for(int attempt = 0; attempt < settings_.attempts && !all_done() && !expired; attempt++)
+    {
+        for(const auto& nameserver : settings_.nameservers)
+        {
+            auto timeout = remaining();
+            if(expired)
+                break;
+            co_await exchange_udp(nameserver, name, types, replies, timeout);
+            for(std::size_t i = 0; i < types.size(); i++)
+            {
+                timeout = remaining();
+                if(!expired && replies[i].truncated && replies[i].rcode == RCODE_NOERROR) // ответ не влез в UDP
+                    co_await exchange_tcp(nameserver, name, types[i], replies[i], timeout);
+            }
+            if(all_done())
+                break;
+        }
+    }
+    remaining();
+
+    std::vector<boost::asio::ip::address> addresses;
+    bool nxdomain = false;
+    for(const auto& i : replies)
+    {
+        nxdomain = nxdomain || i.rcode == RCODE_NXDOMAIN;
+        if(i.rcode != RCODE_NOERROR || i.addresses.empty())
+            continue;
+        addresses.insert(addresses.end(), i.addresses.begin(), i.addresses.end());
+        ttl = std::min(ttl, i.ttl);
+    }
+    if(!addresses.empty())
+        co_return make_results(addresses);
+    if(nxdomain)
+        ec = boost::asio::error::host_not_found;
+    else if(expired && !all_done()) // nameserver'ы не ответили за общий срок
+        ec = boost::asio::error::timed_out;
+    else if(all_done()) // имя существует, но адресов нет
+        ec = boost::asio::error::no_data;
+    else
+        ec = boost::asio::error::host_not_found_try_again;
+    co_return results_type{};
+}
+
+boost::asio::awaitable<void> Dns_resolver::exchange_udp(const boost::asio::ip::udp::endpoint& nameserver,
+const std::string& name, const std::vector<std::uint16_t>& types, std::vector<Reply>& replies, std::chrono::milliseconds timeout)
+{
+    auto executor = co_await boost::asio::this_coro::executor;
+    auto socket = std::make_shared<boost::asio::ip::udp::socket>(executor);
+    boost::system::error_code ec;
+    socket->open(nameserver.protocol(), ec);
+    if(!ec)
+        socket->connect(nameserver, ec); // подключенный сокет отбрасывает пакеты от чужих адресов
+    if(ec)
+        co_return;
+
+    std::vector<std::uint16_t> ids(types.size());
+    std::vector<bool> expected(types.size(), false);
+    std::size_t waiting = 0;
+    for(std::size_t i = 0; i < types.size(); i++) // все запросы уходят сразу, ответы ждем параллельно
+    {
+        if(is_done(replies[i]))
+            continue;
+        ids[i] = random_id();
+        auto query = build_query(ids[i], name, types[i]);
+        co_await socket->async_send(boost::asio::buffer(query), boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+        if(ec)
+            co_return;
+        expected[i] = true;
+        waiting++;
+    }
+
+    auto timer = std::make_shared<Timer>(executor, timeout.count());
+    timer->set_callback_func([socket](){boost::system::error_code ec; socket->cancel(ec);}); // ожидание завершится с operation_aborted
+    timer->start();
+    std::array<std::uint8_t, 4096> buffer;
+    while(waiting > 0)
+    {
+        auto size = co_await socket->async_receive(boost::asio::buffer(buffer), boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+        if(ec) // таймаут или ICMP port unreachable
+            break;
+        for(std::size_t i = 0; i < types.size(); i++)
+        {
+            Reply reply;
+            if(expected[i] && parse_reply(buffer.data(), size, ids[i], name, types[i], reply))
+            {
+                replies[i] = std::move(reply);
+                expected[i] = false;
+                waiting--;
+                break;
+            }
+        }
+    }
+    timer->stop();
+}
+
+boost::asio::awaitable<void> Dns_resolver::exchange_tcp(const boost::asio::ip::udp::endpoint& nameserver,
+const std::string& name, std::uint16_t type, Reply& reply, std::chrono::milliseconds timeout)
+{
+    auto executor = co_await boost::asio::this_coro::executor;
+    auto socket = std::make_shared<boost::asio::ip::tcp::socket>(executor);
+    auto timer = std::make_shared<Timer>(executor, timeout.count());
+    timer->set_callback_func([socket](){boost::system::error_code ec; socket->cancel(ec);}); // ожидание завершится с operation_aborted
+    timer->start();
+
+    boost::system::error_code ec;
+    co_await socket->async_connect({nameserver.address(), nameserver.port()}, boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+    auto id = random_id();
+    std::vector<std::uint8_t> message;
+    auto query = build_query(id, name, type);
+    write_u16(message, static_cast<std::uint16_t>(query.size())); // в TCP перед сообщением идет его длина
+    message.insert(message.end(), query.begin(), query.end());
+    if(!ec)
+        co_await boost::asio::async_write(*socket, boost::asio::buffer(message), boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+    std::array<std::uint8_t, 2> length{};
+    if(!ec)
+        co_await boost::asio::async_read(*socket, boost::asio::buffer(length), boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+    std::vector<std::uint8_t> answer;
+    if(!ec) // длина известна только после успешного чтения префикса
+    {
+        answer.resize(read_u16(length.data()));
+        co_await boost::asio::async_read(*socket, boost::asio::buffer(answer), boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+    }
+    timer->stop();
+
+    Reply tcp_reply;
+    if(!ec && parse_reply(answer.data(), answer.size(), id, name, type, tcp_reply))
+        reply = std::move(tcp_reply);
+}
+
+std::vector<std::uint8_t> Dns_resolver::build_query(std::uint16_t id, const std::string& name, std::uint16_t type)
+{
+    std::vector<std::uint8_t> query;
+    query.reserve(HEADER_SIZE + name.size() + 6);
+    write_u16(query, id);
+    write_u16(query, 0x0100); // RD - рекурсивный запрос
+    write_u16(query, 1); // QDCOUNT
+    write_u16(query, 0);
+    write_u16(query, 0);
+    write_u16(query, 0);
+    std::size_t begin = 0;
+    while(begin < name.size())
+    {
+        auto dot = std::min(name.find('.', begin), name.size());
+        query.push_back(static_cast<std::uint8_t>(dot - begin));
+        query.insert(query.end(), name.begin() + begin, name.begin() + dot);
+        begin = dot + 1;
+    }
+    query.push_back(0);
+    write_u16(query, type);
+    write_u16(query, 1); // класс IN
+    return query;
+}
+
+bool Dns_resolver::parse_reply(const std::uint8_t* data, std::size_t size, std::uint16_t id,
+const std::string& name, std::uint16_t type, Reply& reply)
+{
+    if(size < HEADER_SIZE || read_u16(data) != id)
+        return false;
+    auto flags = read_u16(data + 2);
+    if(!(flags & 0x8000) || ((flags >> 11) & 0xF) != 0) // не ответ или не стандартный запрос
+        return false;
+    if(read_u16(data + 4) != 1)
+        return false;
+    std::size_t answers = read_u16(data + 6);
+    std::size_t offset = HEADER_SIZE;
+    std::string owner;
+    if(!read_name(data, size, offset, owner) || owner != name || offset + 4 > size || read_u16(data + offset) != type)
+        return false;
+    offset += 4;
+
+    reply.rcode = flags & 0xF;
+    reply.truncated = flags & 0x0200;
+    reply.addresses.clear();
+    reply.ttl = UINT32_MAX;
+    if(reply.rcode != RCODE_NOERROR)
+        return true;
+
+    struct Record
+    {
+        std::string owner;
+        std::uint16_t type;
+        std::uint32_t ttl;
+        std::string target; // для CNAME
+        boost::asio::ip::address address; // для A/AAAA
+    };
+    std::vector<Record> records;
+    for(std::size_t i = 0; i < answers; i++)
+    {
+        Record record;
+        if(!read_name(data, size, offset, record.owner) || offset + 10 > size)
+            return reply.truncated;
+        record.type = read_u16(data + offset);
+        record.ttl = read_u32(data + offset + 4);
+        std::size_t length = read_u16(data + offset + 8);
+        offset += 10;
+        if(offset + length > size)
+            return reply.truncated; // у усеченного ответа последняя запись может быть обрезана
+        if(record.type == TYPE_CNAME)
+        {
+            std::size_t target_offset = offset;
+            if(!read_name(data, size, target_offset, record.target))
+                return false;
+        }
+        else if(record.type == TYPE_A && length == 4)
+        {
+            boost::asio::ip::address_v4::bytes_type bytes;
+            std::copy(data + offset, data + offset + 4, bytes.begin());
+            record.address = boost::asio::ip::address_v4(bytes);
+        }
+        else if(record.type == TYPE_AAAA && length == 16)
+        {
+            boost::asio::ip::address_v6::bytes_type bytes;
+            std::copy(data + offset, data + offset + 16, bytes.begin());
+            record.address = boost::asio::ip::address_v6(bytes);
+        }
+        else
+            record.type = 0; // неизвестная или некорректная запись пропускается
+        offset += length;
+        records.push_back(std::move(record));
+    }
+
+    std::string current = name; // проход по цепочке CNAME
+    for(int hops = 0; hops < 16; hops++)
+    {
+        auto it = std::find_if(records.begin(), records.end(), [&](const Record& r){return r.type == TYPE_CNAME && r.owner == current;});
+        if(it == records.end())
+            break;
+        current = it->target;
+        reply.ttl = std::min(reply.ttl, it->ttl);
+    }
+    for(const auto& i : records)
+    {
+        if(i.type == type && i.owner == current)
+        {
+            reply.addresses.push_back(i.address);
+            reply.ttl = std::min(reply.ttl, i.ttl);
+        }
+    }
+    return true;
+}
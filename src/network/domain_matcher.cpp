@@ -0,0 +1,464 @@
+#include "network/domain_matcher.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <unordered_map>
+#include <utility>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace
+{
+    constexpr char SEPARATOR = '\x01'; // разделитель меток в ключе построения (меньше любого символа метки)
+
+    char to_lower(char c)
+    {
+        return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+    }
+
+    bool valid_label(std::string_view label)
+    {
+        if(label.empty() || label.size() > 63)
+            return false;
+        if(label == "*")
+            return true;
+        return std::all_of(label.begin(), label.end(), [](char c)
+        {
+            return (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '-' || c == '_';
+        });
+    }
+
+    // правило -> метки справа налево через SEPARATOR ("m.vk.com" -> "com\x01vk\x01m"), пустая строка - правило некорректное
+    std::string reversed_key(std::string_view name)
+    {
+        std::string key;
+        key.reserve(name.size());
+        std::size_t end = name.size();
+        while(true)
+        {
+            auto dot = name.rfind('.', end - 1);
+            auto begin = dot == std::string_view::npos ? 0 : dot + 1;
+            auto label = name.substr(begin, end - begin);
+            if(!valid_label(label))
+                return "";
+            if(!key.empty())
+                key += SEPARATOR;
+            key += label;
+            if(dot == std::string_view::npos)
+                return key;
+            end = dot;
+            if(end == 0) // пустая метка в начале
+                return "";
+        }
+    }
+}
+
+std::string Domain_matcher::normalize(std::string_view host)
+{
+    while(!host.empty() && host.back() == '.')
+        host.remove_suffix(1);
+    std::string result(host);
+    std::transform(result.begin(), result.end(), result.begin(), to_lower);
+    return result;
+}
+
+std::size_t Domain_matcher::build(const std::vector<std::string>& rules)
+{
+    std::vector<std::pair<std::string, std::uint8_t>> keys;
+    keys.reserve(rules.size());
+    std::size_t skipped = 0;
+    for(std::string_view rule : rules)
+    {
+        while(!rule.empty() && (rule.front() == ' ' || rule.front() == '\t'))
+            rule.remove_prefix(1);
+        while(!rule.empty() && (rule.back() == ' ' || rule.back() == '\t' || rule.back() == '\r'))
+            rule.remove_suffix(1);
+        if(rule.empty() || rule.front() == '#') // пустые строки и комментарии в списках
+            continue;
+        std::uint8_t flag = BLOCK;
+        if(rule.starts_with("@@"))
+        {
+            rule.remove_prefix(2);
+            flag = ALLOW;
+        }
+        else if(rule.starts_with('!'))
+        {
+            rule.remove_prefix(1);
+            flag = ALLOW;
+        }
+        if(rule.starts_with('.')) // ".vk.com" в списках означает то же, что и "vk.com"
+            rule.remove_prefix(1);
+        auto name = normalize(rule);
+        auto key = name.size() > MAX_HOST || name.empty() ? std::string() : reversed_key(name);
+        if(key.empty())
+        {
+            skipped++;
+            continue;
+        }
+        keys.emplace_back(std::move(key), flag);
+    }
+    std::sort(keys.begin(), keys.end());
+
+    // слияние одинаковых правил (исключение и блокировка одного домена - побеждает исключение)
+    std::size_t unique = 0;
+    for(std::size_t i = 0; i < keys.size(); i++)
+    {
+        if(unique > 0 && keys[unique - 1].first == keys[i].first)
+            keys[unique - 1].second |= keys[i].second;
+        else if(unique++ != i)
+            keys[unique - 1] = std::move(keys[i]);
+    }
+    keys.resize(unique);
+
+    // trie строится в ширину: у отсортированных ключей с общим префиксом ключи одного ребенка идут подряд
+    unmap();
+    own_nodes_.assign(1, Node{});
+    own_labels_.clear();
+    std::vector<std::pair<std::uint32_t, std::uint32_t>> ranges{{0, static_cast<std::uint32_t>(keys.size())}}; // ключи узла
+    std::vector<std::uint32_t> position(keys.size(), 0); // начало следующей метки в каждом ключе
+    std::unordered_map<std::string_view, std::uint32_t> interned; // метка -> смещение в own_labels_ (string_view в keys)
+    for(std::size_t node = 0; node < own_nodes_.size(); node++)
+    {
+        auto [i, end] = ranges[node];
+        for(; i < end && position[i] == keys[i].first.size(); i++) // ключи, закончившиеся на этом узле, идут первыми
+            own_nodes_[node].flags |= keys[i].second;
+        auto next_label = [&](std::uint32_t k) // следующая метка ключа k
+        {
+            std::string_view key = keys[k].first;
+            auto label_end = std::min(key.find(SEPARATOR, position[k]), key.size());
+            return key.substr(position[k], label_end - position[k]);
+        };
+        while(i < end)
+        {
+            auto label = next_label(i);
+            auto group = i;
+            for(; group < end && next_label(group) == label; group++)
+                position[group] = std::min<std::uint32_t>(position[group] + label.size() + 1, keys[group].first.size());
+            auto [it, inserted] = interned.try_emplace(label, static_cast<std::uint32_t>(own_labels_.size()));
+            if(inserted)
+                own_labels_ += label;
+            if(label == "*")
+                own_nodes_[node].flags |= WILDCARD;
+            Node child;
+            child.parent = static_cast<std::uint32_t>(node);
+            child.label_offset = it->second;
+            child.label_size = static_cast<std::uint8_t>(label.size());
+            own_nodes_.push_back(child);
+            ranges.emplace_back(i, group);
+            i = group;
+        }
+    }
+    own_nodes_.shrink_to_fit();
+    own_labels_.shrink_to_fit();
+
+    // заполнение не больше 2/3, чтобы цепочки линейного пробирования оставались короткими
+    std::size_t size = 1;
+    while(size < own_nodes_.size() + own_nodes_.size() / 2)
+        size *= 2;
+    own_slots_.assign(size, EMPTY);
+    for(std::uint32_t node = 1; node < own_nodes_.size(); node++)
+    {
+        auto value = hash(own_nodes_[node].parent, std::string_view(own_labels_).substr(own_nodes_[node].label_offset, own_nodes_[node].label_size));
+        auto slot = value & (size - 1);
+        while(own_slots_[slot] != EMPTY)
+            slot = (slot + 1) & (size - 1);
+        own_slots_[slot] = (value & 0xffffffff00000000) | node;
+    }
+
+    // фильтр: у каждого блокирующего правила - его конец справа от последней "*", не длиннее двух меток
+    // (любой заблокированный хост оканчивается на такой конец какого-то правила, исключения фильтру не нужны)
+    std::size_t block_rules = std::count_if(keys.begin(), keys.end(), [](const auto& key){return key.second & BLOCK;});
+    own_filter_.assign(std::max<std::size_t>(1, block_rules * 16 / 512), Filter_block{}); // ~16 бит на правило, < 0.5% ложных
+    filter_mode_ = 0;
+    for(const auto& [key, flags] : keys)
+    {
+        if(!(flags & BLOCK))
+            continue;
+        std::string_view rest = key;
+        std::string suffix; // конец в прямом порядке меток, как в хосте
+        for(int labels = 0; labels < 2 && !rest.empty(); labels++)
+        {
+            auto label = rest.substr(0, rest.find(SEPARATOR));
+            if(label == "*")
+                break;
+            suffix = suffix.empty() ? std::string(label) : std::string(label) + "." + suffix;
+            rest.remove_prefix(std::min(rest.size(), label.size() + 1));
+        }
+        if(suffix.empty())
+            filter_mode_ |= FILTER_OFF;
+        else if(suffix.find('.') == std::string::npos)
+            filter_mode_ |= FILTER_ONE_LABEL;
+        filter_add(filter_hash(suffix));
+    }
+    rules_ = keys.size();
+    use_owned();
+    return skipped;
+}
+
+void Domain_matcher::use_owned()
+{
+    nodes_ = own_nodes_;
+    slots_ = own_slots_;
+    labels_ = own_labels_;
+    filter_ = own_filter_;
+}
+
+std::size_t Domain_matcher::memory_bytes() const
+{
+    return nodes_.size_bytes() + slots_.size_bytes() + labels_.size() + filter_.size_bytes();
+}
+
+Domain_matcher::~Domain_matcher()
+{
+    unmap();
+}
+
+void Domain_matcher::unmap()
+{
+    if(mapping_)
+    {
+        ::munmap(mapping_, mapping_size_);
+        mapping_ = nullptr;
+    }
+    nodes_ = {};
+    slots_ = {};
+    labels_ = {};
+    filter_ = {};
+    rules_ = 0;
+}
+
+std::uint64_t Domain_matcher::hash(std::uint32_t parent, std::string_view label)
+{
+    std::uint64_t result = 0xcbf29ce484222325 ^ parent; // FNV-1a, начальное значение зависит от родителя
+    for(char c : label)
+    {
+        result ^= static_cast<unsigned char>(c);
+        result *= 0x100000001b3;
+    }
+    return result ^ (result >> 29); // младшие биты FNV перемешаны слабо, а слот берется по ним
+}
+
+std::uint32_t Domain_matcher::find_child(std::uint32_t parent, std::string_view name) const
+{
+    auto value = hash(parent, name);
+    auto mask = slots_.size() - 1;
+    for(auto slot = value & mask; slots_[slot] != EMPTY; slot = (slot + 1) & mask)
+    {
+        if((slots_[slot] ^ value) >> 32) // другой хеш
+            continue;
+        auto index = static_cast<std::uint32_t>(slots_[slot]);
+        if(nodes_[index].parent == parent && label(nodes_[index]) == name)
+            return index;
+    }
+    return NONE;
+}
+
+void Domain_matcher::match(std::uint32_t node, std::string_view host, std::size_t end, std::size_t depth, Match& best) const
+{
+    auto flags = nodes_[node].flags & (BLOCK | ALLOW);
+    if(flags && (!best.flags || depth > best.depth || (depth == best.depth && (flags & ALLOW))))
+        best = {depth, static_cast<std::uint8_t>((flags & ALLOW) ? ALLOW : BLOCK)};
+    if(end == 0) // метки хоста кончились
+        return;
+    auto dot = host.rfind('.', end - 1);
+    auto begin = dot == std::string_view::npos ? 0 : dot + 1;
+    auto next_end = dot == std::string_view::npos ? 0 : dot;
+    auto name = host.substr(begin, end - begin);
+    auto child = find_child(node, name);
+    if(child != NONE)
+        match(child, host, next_end, depth + 1, best);
+    if((nodes_[node].flags & WILDCARD) && name != "*")
+        match(find_child(node, "*"), host, next_end, depth + 1, best);
+}
+
+std::uint64_t Domain_matcher::filter_hash(std::string_view suffix)
+{
+    std::uint64_t result = 0xcbf29ce484222325; // FNV-1a и перемешивание всех бит (биты фильтра берутся отовсюду)
+    for(char c : suffix)
+    {
+        result ^= static_cast<unsigned char>(to_lower(c)); // хост проверяется фильтром до нормализации
+        result *= 0x100000001b3;
+    }
+    result ^= result >> 33;
+    result *= 0xff51afd7ed558ccd;
+    result ^= result >> 33;
+    result *= 0xc4ceb9fe1a85ec53;
+    return result ^ (result >> 33);
+}
+
+namespace
+{
+    // по одному биту в каждом слове блока (множители из split block Bloom filter parquet)
+    constexpr std::uint32_t FILTER_SALT[8] = {0x47b6137b, 0x44974d91, 0x8824ad5b, 0xa2b7289d,
+    0x705495c7, 0x2df1424b, 0x9efc4947, 0x5c6bfb31};
+}
+
+void Domain_matcher::filter_add(std::uint64_t value)
+{
+    auto& block = own_filter_[((value >> 32) * own_filter_.size()) >> 32];
+    for(int i = 0; i < 8; i++)
+        block.words[i] |= std::uint64_t(1) << ((static_cast<std::uint32_t>(value) * FILTER_SALT[i]) >> 26);
+}
+
+bool Domain_matcher::filter_contains(std::uint64_t value) const
+{
+    const auto& block = filter_[((value >> 32) * filter_.size()) >> 32];
+    for(int i = 0; i < 8; i++)
+    {
+        if(!(block.words[i] & (std::uint64_t(1) << ((static_cast<std::uint32_t>(value) * FILTER_SALT[i]) >> 26))))
+            return false;
+    }
+    return true;
+}
+
+bool Domain_matcher::filter_passes(std::string_view host) const
+{
+    if(filter_mode_ & FILTER_OFF)
+        return true;
+    auto last = host.rfind('.');
+    if(last == std::string_view::npos) // одна метка
+        return (filter_mode_ & FILTER_ONE_LABEL) && filter_contains(filter_hash(host));
+    auto second = host.rfind('.', last - 1);
+    auto two = second == std::string_view::npos ? host : host.substr(second + 1);
+    if(filter_contains(filter_hash(two)))
+        return true;
+    return (filter_mode_ & FILTER_ONE_LABEL) && filter_contains(filter_hash(host.substr(last + 1)));
+}
+
+bool Domain_matcher::matches(std::string_view host) const
+{
+    if(rules_ == 0)
+        return false;
+    while(!host.empty() && host.back() == '.')
+        host.remove_suffix(1);
+    if(host.empty() || host.size() > MAX_HOST)
+        return false;
+    if(!filter_passes(host))
+        return false;
+    char buffer[MAX_HOST]; // нормализация без выделения памяти
+    std::transform(host.begin(), host.end(), buffer, to_lower);
+    std::string_view name(buffer, host.size());
+    Match best;
+    match(0, name, name.size(), 0, best);
+    return best.flags == BLOCK;
+}
+
+namespace
+{
+    std::size_t aligned(std::size_t size) // секции файла выровнены на кеш линию
+    {
+        return (size + 63) / 64 * 64;
+    }
+}
+
+bool Domain_matcher::save(const std::string& file_name) const
+{
+    File_header header;
+    header.rules = rules_;
+    header.nodes = nodes_.size();
+    header.slots = slots_.size();
+    header.labels = labels_.size();
+    header.filter_blocks = filter_.size();
+    header.filter_mode = filter_mode_;
+    // запущенный прокси держит старый файл отображенным: обрезка на месте уронила бы его по SIGBUS,
+    // поэтому новый файл пишется рядом и заменяет старый переименованием
+    auto temporary = file_name + ".tmp";
+    std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+    auto write = [&](const void* data, std::size_t size)
+    {
+        static const char padding[64] = {};
+        file.write(static_cast<const char*>(data), size);
+        file.write(padding, aligned(size) - size);
+    };
+    write(&header, sizeof(header));
+    write(nodes_.data(), nodes_.size_bytes());
+    write(slots_.data(), slots_.size_bytes());
+    write(labels_.data(), labels_.size());
+    write(filter_.data(), filter_.size_bytes());
+    file.close();
+    if(!file || std::rename(temporary.c_str(), file_name.c_str()) != 0)
+    {
+        std::remove(temporary.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool Domain_matcher::load(const std::string& file_name)
+{
+    int fd = ::open(file_name.c_str(), O_RDONLY | O_CLOEXEC);
+    if(fd < 0)
+        return false;
+    File_header header;
+    struct stat info;
+    if(::read(fd, &header, sizeof(header)) != sizeof(header) || std::memcmp(header.magic, File_header{}.magic, sizeof(header.magic)) != 0
+    || ::fstat(fd, &info) < 0)
+    {
+        ::close(fd);
+        return false; // не скомпилированный список (toml)
+    }
+    auto corrupted = [&](const char* reason)
+    {
+        std::cerr << "Error: compiled blacklist " << file_name << " is " << reason << std::endl;
+        ::close(fd);
+        return false;
+    };
+    if(header.version != File_header{}.version || header.byte_order != File_header{}.byte_order)
+        return corrupted("of an incompatible version");
+    if(header.nodes == 0 || header.nodes >= NONE || header.slots < header.nodes || (header.slots & (header.slots - 1))
+    || header.labels > UINT32_MAX || header.filter_blocks == 0 || header.filter_blocks > UINT32_MAX)
+        return corrupted("damaged (header)");
+    auto nodes_offset = aligned(sizeof(File_header));
+    auto slots_offset = nodes_offset + aligned(header.nodes * sizeof(Node));
+    auto labels_offset = slots_offset + aligned(header.slots * sizeof(std::uint64_t));
+    auto filter_offset = labels_offset + aligned(header.labels);
+    auto total = filter_offset + header.filter_blocks * sizeof(Filter_block);
+    if(static_cast<std::size_t>(info.st_size) != total)
+        return corrupted("damaged (size)");
+    auto mapping = ::mmap(nullptr, total, PROT_READ, MAP_SHARED, fd, 0); // страницы общие со всеми процессами, открывшими файл
+    ::close(fd);
+    if(mapping == MAP_FAILED)
+    {
+        std::cerr << "Error: cannot map compiled blacklist " << file_name << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    auto base = static_cast<const char*>(mapping);
+    std::span<const Node> nodes(reinterpret_cast<const Node*>(base + nodes_offset), header.nodes);
+    std::span<const std::uint64_t> slots(reinterpret_cast<const std::uint64_t*>(base + slots_offset), header.slots);
+    // проверка ссылок, чтобы поврежденный файл не читал за пределами отображения (только чтение, страницы остаются общими)
+    bool valid = nodes[0].parent == NONE;
+    for(std::size_t i = 1; valid && i < nodes.size(); i++)
+        valid = nodes[i].parent < i && std::uint64_t(nodes[i].label_offset) + nodes[i].label_size <= header.labels;
+    std::size_t empty = 0; // без пустых слотов поиск отсутствующего ребенка не закончится
+    for(std::size_t i = 0; valid && i < slots.size(); i++)
+    {
+        empty += slots[i] == EMPTY;
+        valid = slots[i] == EMPTY || static_cast<std::uint32_t>(slots[i]) < header.nodes;
+    }
+    valid = valid && empty > 0;
+    if(!valid)
+    {
+        ::munmap(mapping, total);
+        std::cerr << "Error: compiled blacklist " << file_name << " is damaged (links)" << std::endl;
+        return false;
+    }
+    unmap();
+    own_nodes_ = {};
+    own_slots_ = {};
+    own_labels_ = {};
+    own_filter_ = {};
+    mapping_ = mapping;
+    mapping_size_ = total;
+    nodes_ = nodes;
+    slots_ = slots;
+    labels_ = std::string_view(base + labels_offset, header.labels);
+    filter_ = std::span<const Filter_block>(reinterpret_cast<const Filter_block*>(base + filter_offset), header.filter_blocks);
+    filter_mode_ = static_cast<std::uint8_t>(header.filter_mode);
+    rules_ = header.rules;
+    return true;
+}
@@ -0,0 +1,166 @@
+#include "network/happy_eyeballs.hpp"
+#include "utils/async_waiter.hpp"
+#include "utils/deadline.hpp"
+#include <memory>
+
+namespace
+{
+    // состояние одной гонки подключений, все обработчики выполняются в executor'е сессии
+    class Connection_race : public std::enable_shared_from_this<Connection_race>
+    {
+        public:
+            Connection_race(const boost::asio::any_io_executor& executor, std::vector<boost::asio::ip::tcp::endpoint> endpoints,
+            std::chrono::milliseconds attempt_delay)
+            : executor_(executor), endpoints_(std::move(endpoints)), attempt_delay_(attempt_delay),
+            delay_timer_(executor), deadline_(executor), waiter_(std::make_shared<Async_waiter>(executor)), next_(0), in_flight_(0), finished_(false)
+            {}
+
+            void start(std::chrono::milliseconds timeout)
+            {
+                auto self = shared_from_this();
+                deadline_.expires_after(timeout);
+                deadline_.async_wait([self](const boost::system::error_code& ec)
+                {
+                    if(!ec)
+                        self->finish(boost::asio::error::timed_out);
+                });
+                launch();
+            }
+
+            std::shared_ptr<Async_waiter> waiter() const {return waiter_;};
+
+            std::shared_ptr<boost::asio::ip::tcp::socket> winner() const {return winner_;};
+
+            const boost::system::error_code& error() const {return error_;};
+
+        private:
+            void launch() // запуск следующей попытки
+            {
+                if(finished_ || next_ >= endpoints_.size())
+                    return;
+                auto self = shared_from_this();
+                auto socket = attempts_.emplace_back(std::make_shared<boost::asio::ip::tcp::socket>(executor_));
+                in_flight_++;
+                socket->async_connect(endpoints_[next_++], [self, socket](const boost::system::error_code& ec)
+                {
+                    self->on_connect(socket, ec);
+                });
+                if(next_ < endpoints_.size()) // переустановка таймера отменяет предыдущее ожидание
+                {
+                    delay_timer_.expires_after(attempt_delay_);
+                    delay_timer_.async_wait([self](const boost::system::error_code& ec)
+                    {
+                        if(!ec)
+                            self->launch();
+                    });
+                }
+            }
+
+            void on_connect(const std::shared_ptr<boost::asio::ip::tcp::socket>& socket, const boost::system::error_code& ec)
+            {
+                in_flight_--;
+                if(finished_)
+                    return;
+                if(!ec)
+                {
+                    winner_ = socket;
+                    finish({});
+                    return;
+                }
+                error_ = ec;
+                if(next_ < endpoints_.size()) // не ждем таймер, если попытка уже провалилась
+                    launch();
+                else if(in_flight_ == 0)
+                    finish(ec);
+            }
+
+            void finish(const boost::system::error_code& ec)
+            {
+                if(finished_)
+                    return;
+                finished_ = true;
+                error_ = ec;
+                delay_timer_.cancel();
+                deadline_.cancel();
+                for(auto& i : attempts_)
+                {
+                    boost::system::error_code close_ec;
+                    if(i != winner_)
+                        i->close(close_ec);
+                }
+                waiter_->notify();
+            }
+
+        private:
+            boost::asio::any_io_executor executor_;
+
+            std::vector<boost::asio::ip::tcp::endpoint> endpoints_; // адреса в порядке попыток
+
+            std::chrono::milliseconds attempt_delay_; // задержка перед следующей попыткой
+
+            boost::asio::steady_timer delay_timer_; // таймер следующей попытки
+
+            boost::asio::steady_timer deadline_; // общий таймаут подключения
+
+            std::shared_ptr<Async_waiter> waiter_; // пробуждение корутины по окончанию гонки
+
+            std::vector<std::shared_ptr<boost::asio::ip::tcp::socket>> attempts_; // сокеты всех запущенных попыток
+
+            std::shared_ptr<boost::asio::ip::tcp::socket> winner_; // первое успешное соеденение
+
+            boost::system::error_code error_; // ошибка последней попытки
+
+            std::size_t next_; // индекс следующего адреса
+
+            std::size_t in_flight_; // кол-во незавершенных попыток
+
+            bool finished_;
+    };
+}
+
+std::vector<boost::asio::ip::tcp::endpoint> happy_eyeballs_order(const boost::asio::ip::tcp::resolver::results_type& results)
+{
+    std::vector<boost::asio::ip::tcp::endpoint> v6, v4, order;
+    for(const auto& i : results)
+        (i.endpoint().address().is_v6() ? v6 : v4).push_back(i.endpoint());
+    for(std::size_t i = 0; i < std::max(v6.size(), v4.size()); i++)
+    {
+        if(i < v6.size())
+            order.push_back(v6[i]);
+        if(i < v4.size())
+            order.push_back(v4[i]);
+    }
+    return order;
+}
+
+boost::asio::awaitable<void> happy_eyeballs_connect(boost::asio::ip::tcp::socket& socket,
+const boost::asio::ip::tcp::resolver::results_type& results, std::chrono::milliseconds attempt_delay,
+std::chrono::milliseconds timeout, boost::system::error_code& ec)
+{
+    if(results.empty())
+    {
+        ec = boost::asio::error::not_found;
+        co_return;
+    }
+    if(results.size() == 1) // гонка не нужна (и не нужны вектора с порядком адресов), общий срок - тот же
+    {
+        {
+            Deadline deadline(socket, timeout); // без него зависший SYN держит сессию минуты, пока ядро не сдастся
+            co_await socket.async_connect(results.begin()->endpoint(), boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+            deadline.check(ec);
+        }
+        if(ec) // как после гонки: при ошибке сокет закрыт
+        {
+            boost::system::error_code close_ec;
+            socket.close(close_ec);
+        }
+        co_return;
+    }
+    auto endpoints = happy_eyeballs_order(results);
+    auto race = std::make_shared<Connection_race>(socket.get_executor(), std::move(endpoints), attempt_delay);
+    race->start(timeout);
+    co_await race->waiter()->wait();
+    ec = race->error();
+    if(!ec)
+        socket = std::move(*race->winner());
+}
@@ -0,0 +1,184 @@
+#include "network/ip_matcher.hpp"
+#include <algorithm>
+#include <bit>
+#include <charconv>
+#include <string_view>
+#include <tuple>
+
+namespace
+{
+    std::string_view clean(std::string_view line) // без комментария (# или ;) и пробелов по краям
+    {
+        line = line.substr(0, line.find_first_of("#;"));
+        auto begin = line.find_first_not_of(" \t\r\n");
+        if(begin == std::string_view::npos)
+            return {};
+        return line.substr(begin, line.find_last_not_of(" \t\r\n") - begin + 1);
+    }
+}
+
+std::size_t Ip_matcher::build(const std::vector<std::string>& rules)
+{
+    std::vector<Rule> parsed;
+    parsed.reserve(rules.size());
+    std::size_t skipped = 0;
+    for(const auto& line : rules)
+    {
+        auto text = clean(line);
+        if(text.empty())
+            continue;
+        Rule rule;
+        if(parse(std::string(text), rule))
+            parsed.push_back(rule);
+        else
+            skipped++;
+    }
+    // короткие префиксы раскрываются первыми, длинные перезаписывают их диапазоны; при равной длине исключение - последним
+    auto key = [](const Rule& rule) {return std::tie(rule.v6, rule.length, rule.action, rule.bytes);};
+    std::sort(parsed.begin(), parsed.end(), [&](const Rule& a, const Rule& b) {return key(a) < key(b);});
+    parsed.erase(std::unique(parsed.begin(), parsed.end(), [&](const Rule& a, const Rule& b) {return key(a) == key(b);}), parsed.end());
+    rules_ = parsed.size();
+    build_tree(v4_, parsed, false);
+    build_tree(v6_, parsed, true);
+    return skipped;
+}
+
+bool Ip_matcher::parse(const std::string& text, Rule& rule)
+{
+    std::string_view view = text;
+    if(view.starts_with("!"))
+        view.remove_prefix(1);
+    else if(view.starts_with("@@"))
+        view.remove_prefix(2);
+    if(view.size() != text.size())
+        rule.action = ALLOW;
+    auto slash = view.find('/');
+    boost::system::error_code ec;
+    auto address = boost::asio::ip::make_address(std::string(view.substr(0, slash)), ec);
+    if(ec)
+        return false;
+    unsigned bits = address.is_v4() ? 32 : 128;
+    rule.length = bits;
+    if(slash != std::string_view::npos)
+    {
+        auto length = view.substr(slash + 1);
+        auto [end, error] = std::from_chars(length.data(), length.data() + length.size(), rule.length);
+        if(length.empty() || error != std::errc{} || end != length.data() + length.size() || rule.length > bits)
+            return false;
+    }
+    if(address.is_v6() && address.to_v6().is_v4_mapped()) // ::ffff:10.0.0.0/104 - то же, что 10.0.0.0/8
+    {
+        if(rule.length < 96)
+            return false;
+        rule.length -= 96;
+        address = boost::asio::ip::make_address_v4(boost::asio::ip::v4_mapped, address.to_v6());
+    }
+    rule.v6 = address.is_v6();
+    if(rule.v6)
+    {
+        auto bytes = address.to_v6().to_bytes();
+        std::copy(bytes.begin(), bytes.end(), rule.bytes.begin());
+    }
+    else
+    {
+        auto bytes = address.to_v4().to_bytes();
+        std::copy(bytes.begin(), bytes.end(), rule.bytes.begin());
+    }
+    for(unsigned i = rule.length; i < rule.bytes.size() * 8; i++) // 10.1.2.3/8 - то же, что 10.0.0.0/8
+        rule.bytes[i / 8] &= static_cast<std::uint8_t>(~(0x80u >> (i % 8)));
+    return true;
+}
+
+void Ip_matcher::build_tree(Tree& tree, const std::vector<Rule>& rules, bool v6)
+{
+    tree = Tree{};
+    std::vector<std::array<std::uint32_t, 256>> levels; // узлы до сжатия
+    auto entry = [&](std::uint32_t node, std::uint32_t index) -> std::uint32_t& // node == CHILD - корень
+    {
+        return node == CHILD ? tree.root[index] : levels[node][index];
+    };
+    for(const auto& rule : rules)
+    {
+        if(rule.v6 != v6)
+            continue;
+        if(tree.root.empty())
+            tree.root.assign(std::size_t(1) << ROOT_BITS, NONE);
+        std::uint32_t node = CHILD;
+        unsigned consumed = 0;
+        unsigned stride = ROOT_BITS;
+        while(true)
+        {
+            std::uint32_t index = node == CHILD ? (rule.bytes[0] << 8 | rule.bytes[1]) : rule.bytes[consumed / 8];
+            if(rule.length <= consumed + stride) // префикс заканчивается на этом уровне - заполняется его диапазон
+            {
+                auto free = consumed + stride - rule.length;
+                auto first = index >> free << free;
+                for(std::uint32_t i = first; i < first + (1u << free); i++)
+                    entry(node, i) = rule.action; // детей в диапазоне нет: более длинные префиксы еще не вставлены
+                break;
+            }
+            auto value = entry(node, index);
+            if(!(value & CHILD)) // новый уровень наследует значение более короткого префикса
+            {
+                levels.emplace_back().fill(value);
+                value = CHILD | static_cast<std::uint32_t>(levels.size() - 1);
+                entry(node, index) = value;
+            }
+            node = value & ~CHILD;
+            consumed += stride;
+            stride = 8;
+        }
+    }
+    tree.chunks.resize(levels.size());
+    for(std::size_t i = 0; i < levels.size(); i++)
+    {
+        auto& chunk = tree.chunks[i];
+        chunk.values = static_cast<std::uint32_t>(tree.values.size());
+        for(std::size_t j = 0; j < 256; j++)
+        {
+            if(j % 64 == 0)
+                chunk.before[j / 64] = static_cast<std::uint16_t>(tree.values.size() - chunk.values);
+            if(j == 0 || levels[i][j] != levels[i][j - 1])
+            {
+                chunk.runs[j / 64] |= std::uint64_t(1) << (j % 64);
+                tree.values.push_back(levels[i][j]);
+            }
+        }
+    }
+}
+
+bool Ip_matcher::lookup(const Tree& tree, const std::uint8_t* bytes, std::size_t size)
+{
+    if(tree.root.empty())
+        return false;
+    auto value = tree.root[bytes[0] << 8 | bytes[1]];
+    for(std::size_t i = 2; (value & CHILD) && i < size; i++)
+    {
+        const auto& chunk = tree.chunks[value & ~CHILD];
+        auto word = bytes[i] / 64;
+        auto mask = ~std::uint64_t(0) >> (63 - bytes[i] % 64); // биты до текущего включительно
+        value = tree.values[chunk.values + chunk.before[word] + std::popcount(chunk.runs[word] & mask) - 1];
+    }
+    return value == BLOCK;
+}
+
+bool Ip_matcher::matches(const boost::asio::ip::address& address) const
+{
+    if(rules_ == 0)
+        return false;
+    if(address.is_v4())
+        return lookup(v4_, address.to_v4().to_bytes().data(), 4);
+    auto v6 = address.to_v6();
+    if(v6.is_v4_mapped())
+        return lookup(v4_, boost::asio::ip::make_address_v4(boost::asio::ip::v4_mapped, v6).to_bytes().data(), 4);
+    return lookup(v6_, v6.to_bytes().data(), 16);
+}
+
+std::size_t Ip_matcher::memory_bytes() const
+{
+    std::size_t size = 0;
+    for(const auto* tree : {&v4_, &v6_})
+        size += tree->root.capacity() * sizeof(std::uint32_t) + tree->chunks.capacity() * sizeof(Chunk)
+        + tree->values.capacity() * sizeof(std::uint32_t);
+    return size;
+}
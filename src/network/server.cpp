@@ -1,18 +1,59 @@
 #include "network/server.hpp"
 #include "network/session.hpp"
+#include "utils/recycling_allocator.hpp"
 #include "globals/globals.hpp"
 #include <iostream>
+#include <sstream>
 
-Server::Server(boost::asio::io_context& context, unsigned short port)
+Server::Server(boost::asio::io_context& context, unsigned short port,
+std::shared_ptr<User_traffic_manager> manager, std::shared_ptr<Connection_gate> gate, bool reuse_port)
 : io_context_(context), port_(port),
-acceptor_(io_context_, boost::asio::ip::tcp::endpoint(boost::asio::ip::tcp::v4(), port_)),
-user_traffic_manager_(std::make_shared<User_traffic_manager>())
-{}
+acceptor_(io_context_),
+user_traffic_manager_(std::move(manager)),
+connection_gate_(std::move(gate)),
+upstream_pool_(std::make_shared<Upstream_pool>(io_context_.get_executor(),
+__PROXY_GLOBALS__::PROXY_CONFIG->upstream_pool_max_idle,
+__PROXY_GLOBALS__::PROXY_CONFIG->upstream_pool_max_per_host,
+std::chrono::milliseconds(__PROXY_GLOBALS__::PROXY_CONFIG->upstream_pool_idle_timeout_milliseconds)))
+{
+    open_acceptor(reuse_port);
+    // ответ при перегрузке сериализуется один раз, чтобы отказ стоил только один write
+    boost::beast::http::response<boost::beast::http::string_body> res(boost::beast::http::status::service_unavailable, 11);
+    res.set(boost::beast::http::field::server, "Proxy");
+    res.set(boost::beast::http::field::content_type, "text/plain");
+    res.set(boost::beast::http::field::retry_after, std::to_string(__PROXY_GLOBALS__::PROXY_CONFIG->retry_after_seconds));
+    res.set(boost::beast::http::field::connection, "close");
+    res.body() = "SERVICE UNAVAILABLE";
+    res.prepare_payload();
+    std::ostringstream serialized;
+    serialized << res;
+    overload_response_ = std::make_shared<const std::string>(serialized.str());
+}
+
+void Server::open_acceptor(bool reuse_port)
+{
+    boost::asio::ip::tcp::endpoint endpoint(boost::asio::ip::tcp::v4(), port_);
+    acceptor_.open(endpoint.protocol());
+    acceptor_.set_option(boost::asio::ip::tcp::acceptor::reuse_address(true));
+#ifdef SO_REUSEPORT
+    if(reuse_port) // каждый воркер слушает тот же порт, ядро само распределяет соеденения между ними
+    {
+        using reuse_port_option = boost::asio::detail::socket_option::boolean<SOL_SOCKET, SO_REUSEPORT>;
+        acceptor_.set_option(reuse_port_option(true));
+    }
+#else
+    if(reuse_port)
+        throw std::runtime_error("SO_REUSEPORT is not supported on this platform");
+#endif
+    acceptor_.bind(endpoint);
+    acceptor_.listen(boost::asio::socket_base::max_listen_connections);
+}
 
 boost::asio::awaitable<void> Server::run()
 {
     if(__PROXY_GLOBALS__::LOG_ON)
         __PROXY_GLOBALS__::LOGGER << "Starting server" << std::endl;
+    boost::asio::co_spawn(io_context_, upstream_pool_->run_sweeper(), boost::asio::detached);
     co_await accept_connections();
 }
 
@@ -23,15 +64,32 @@ boost::asio::awaitable<void> Server::accept_connections()
     {
         try
         {
-            wait_connection_slot();
             auto socket = co_await acceptor_.async_accept(boost::asio::use_awaitable);
-            if(__PROXY_GLOBALS__::LOG_ON)
-                __PROXY_GLOBALS__::LOGGER << "New connection: " << socket.remote_endpoint().address() << std::endl;
-            auto session = std::make_shared<Session>(std::move(socket), user_traffic_manager_);
-            boost::asio::co_spawn(io_context_, [session]()->boost::asio::awaitable<void>
+            boost::system::error_code remote_ec;
+            auto remote = socket.remote_endpoint(remote_ec);
+            if(remote_ec || __PROXY_GLOBALS__::BLACKLISTED_CLIENTS->matches(remote.address())) // до выделения сессии
+            {
+                if(__PROXY_GLOBALS__::LOG_ON && !remote_ec)
+                    __PROXY_GLOBALS__::LOGGER << "Connection rejected (blacklisted client): " << remote.address() << std::endl;
+                __PROXY_GLOBALS__::METRICS.rejected_client.add();
+                socket.close(remote_ec);
+                continue;
+            }
+            Connection_gate::Slot slot;
+            if(__PROXY_GLOBALS__::PROXY_CONFIG->reject_when_overloaded) // режим быстрого отказа: сразу ответить 503
             {
-                co_await session->start_session();
-            }, boost::asio::detached);
+                auto free_slot = connection_gate_->try_acquire();
+                if(!free_slot)
+                {
+                    reject_connection(std::move(socket));
+                    continue;
+                }
+                slot = std::move(*free_slot);
+            }
+            if(__PROXY_GLOBALS__::LOG_ON)
+                __PROXY_GLOBALS__::LOGGER << "New connection: " << remote.address() << std::endl;
+            __PROXY_GLOBALS__::METRICS.connections_accepted.add();
+            boost::asio::co_spawn(io_context_, start_session(std::move(socket), std::move(slot)), boost::asio::detached);
         }
         catch(const std::exception& ex)
         {
@@ -42,9 +100,28 @@ boost::asio::awaitable<void> Server::accept_connections()
     }
 }
 
-void Server::wait_connection_slot()
+boost::asio::awaitable<void> Server::start_session(boost::asio::ip::tcp::socket socket, Connection_gate::Slot slot)
+{
+    auto self = shared_from_this(); // сервер жив, пока соеденение ждет слот
+    if(!slot) // слот ждет уже принятое соеденение, цикл accept'а не держит слотов
+        slot = co_await connection_gate_->async_acquire();
+    auto session = make_recycled<Session> // сессия и ее счетчик ссылок берутся из пула воркера
+    (std::move(socket), user_traffic_manager_, std::move(slot), upstream_pool_);
+    co_await session->start_session();
+}
+
+void Server::reject_connection(boost::asio::ip::tcp::socket socket)
 {
-    std::unique_lock<std::mutex> lock(__PROXY_GLOBALS__::ACTIVE_CONNECTIONS_MUTEX);
-    __PROXY_GLOBALS__::ACTIVE_CONNECTIONS_COND_VAR.wait(lock,[]
-    {return __PROXY_GLOBALS__::ACTIVE_CONNECTIONS < __PROXY_GLOBALS__::PROXY_CONFIG.max_connections;});
+    if(__PROXY_GLOBALS__::LOG_ON)
+        __PROXY_GLOBALS__::LOGGER << "Connection rejected (overloaded)" << std::endl;
+    __PROXY_GLOBALS__::METRICS.rejected_overloaded.add();
+    auto socket_ptr = std::make_shared<boost::asio::ip::tcp::socket>(std::move(socket));
+    auto response = overload_response_;
+    boost::asio::async_write(*socket_ptr, boost::asio::buffer(*response),
+    [socket_ptr, response](const boost::system::error_code&, std::size_t)
+    {
+        boost::system::error_code ec;
+        socket_ptr->shutdown(boost::asio::ip::tcp::socket::shutdown_both, ec);
+        socket_ptr->close(ec);
+    });
 }
\ No newline at end of file
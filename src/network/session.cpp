@@ -1,20 +1,63 @@
 #include "network/session.hpp"
 #include "network/analyze_request.hpp"
+#include "network/happy_eyeballs.hpp"
+#include "network/tunnel.hpp"
 #include "globals/globals.hpp"
 #include <boost/asio/experimental/awaitable_operators.hpp>
 #include "utils/timer.hpp"
+#include "utils/deadline.hpp"
+#include "utils/buffer_pool.hpp"
+#include "utils/recycling_allocator.hpp"
 #include <iostream>
 #include <atomic>
 #include <array>
+#include <charconv>
+#include <limits>
+#include <optional>
 #include <sstream>
+#include <vector>
 
 
-Session::Session(boost::asio::ip::tcp::socket socket, std::shared_ptr<User_traffic_manager> manager)
-: client_socket_(std::move(socket))
+namespace
+{
+    // заголовок ответа upstream'а, промежуточные ответы 1xx (кроме 101) пропускаются
+    boost::asio::awaitable<void> read_response_header(boost::asio::ip::tcp::socket& upstream, boost::beast::flat_buffer& buffer,
+    std::optional<boost::beast::http::response_parser<boost::beast::http::buffer_body>>& parser, bool is_head,
+    boost::system::error_code& ec)
+    {
+        do
+        {
+            parser.emplace();
+            parser->body_limit((std::numeric_limits<std::uint64_t>::max)()); // тело не буферизуется, ограничение не нужно
+            if(is_head)
+                parser->skip(true); // у ответа на HEAD нет тела
+            co_await boost::beast::http::async_read_header(upstream, buffer, *parser,
+            boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+        }
+        while(!ec && parser->get().result_int() / 100 == 1
+        && parser->get().result() != boost::beast::http::status::switching_protocols);
+    }
+}
+
+Session::Session(boost::asio::ip::tcp::socket socket, std::shared_ptr<User_traffic_manager> manager,
+Connection_gate::Slot slot, std::shared_ptr<Upstream_pool> upstream_pool)
+: client_socket_(std::move(socket)), traffic_manager_(std::move(manager)), slot_(std::move(slot)), upstream_pool_(std::move(upstream_pool))
 {
     auto ep = client_socket_.remote_endpoint(); // получение endpoint'а
-    auto client_ip = ep.address().to_string(); // строка с ip адресом
-    traffic_limiter_ = manager->get_or_create_user(client_ip);  // получение или создание пользователя с помощью Traffic Manager'а
+    client_address_ = ep.address(); // ip адрес (ключ лимитера пользователя)
+    accept_clock_ = std::chrono::steady_clock::now();
+    access_.accept_time = std::chrono::duration_cast<std::chrono::microseconds>
+    (std::chrono::system_clock::now().time_since_epoch()).count();
+    access_.client_address = Access_record::pack_address(client_address_);
+    connection_upload_limiter_ = traffic_manager_->make_connection_limiter();
+    connection_download_limiter_ = traffic_manager_->make_connection_limiter();
+}
+
+void Session::select_destination(const std::string& host)
+{
+    using Direction = User_traffic_manager::Direction;
+    upload_limiters_ = traffic_manager_->make_chain(client_address_, host, Direction::upload, connection_upload_limiter_);
+    download_limiters_ = traffic_manager_->make_chain(client_address_, host, Direction::download, connection_download_limiter_);
 }
 
 boost::asio::awaitable<void> Session::start_session() // старт сессии
@@ -23,41 +66,116 @@ boost::asio::awaitable<void> Session::start_session() // старт сессии
 }
 
 Session::~Session()
-{}
+{
+    access_.duration = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - accept_clock_).count();
+    auto& metrics = __PROXY_GLOBALS__::METRICS;
+    metrics.sessions[static_cast<std::size_t>(access_.end)].add();
+    metrics.session_duration.record(access_.duration);
+    if(__PROXY_GLOBALS__::ACCESS_LOG.is_open())
+        __PROXY_GLOBALS__::ACCESS_LOG.write(access_);
+}
+
+std::uint32_t Session::since_accept() const
+{
+    auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - accept_clock_).count();
+    return static_cast<std::uint32_t>(std::min<std::int64_t>(elapsed, Access_record::NONE - 1)); // ~71 минута максимум
+}
+
+void Session::set_upstream_address(boost::asio::ip::tcp::socket& upstream)
+{
+    boost::system::error_code ec;
+    auto endpoint = upstream.remote_endpoint(ec);
+    if(!ec)
+        access_.upstream_address = Access_record::pack_address(endpoint.address());
+}
+
+bool Session::remove_blacklisted(boost::asio::ip::tcp::resolver::results_type& results)
+{
+    const auto& blacklist = *__PROXY_GLOBALS__::BLACKLISTED_ADDRESSES;
+    if(blacklist.empty() || results.empty())
+        return true;
+    std::vector<boost::asio::ip::tcp::endpoint> allowed;
+    for(const auto& i : results)
+    {
+        if(!blacklist.matches(i.endpoint().address()))
+            allowed.push_back(i.endpoint());
+    }
+    if(!allowed.empty() && allowed.size() != results.size())
+        results = boost::asio::ip::tcp::resolver::results_type::create(allowed.begin(), allowed.end(),
+        results.begin()->host_name(), results.begin()->service_name());
+    return !allowed.empty();
+}
 
 boost::asio::awaitable<void> Session::handle_request()
 {
     try
     {
-        boost::beast::flat_buffer read_buffer;
-        boost::beast::http::request<boost::beast::http::string_body> req;
-        boost::system::error_code ec;
-        co_await boost::beast::http::async_read(client_socket_, read_buffer, req, 
-        boost::asio::redirect_error(boost::asio::use_awaitable, ec));
-        if(!ec) // если нет ошибки
+        bool first_request = true;
+        for(;;) // каждый запрос keep-alive соеденения разбирается отдельно
         {
-            auto result = HttpHandler::analyze_request(req); // анализ запроса
+            boost::beast::http::request_parser<boost::beast::http::buffer_body> parser;
+            parser.body_limit((std::numeric_limits<std::uint64_t>::max)()); // тело не буферизуется, ограничение не нужно
+            boost::system::error_code ec;
+            {
+                // срок на весь заголовок, а не на паузу между байтами: клиент, шлющий по байту, слот тоже не удержит
+                Deadline deadline(client_socket_, std::chrono::milliseconds(__PROXY_GLOBALS__::PROXY_CONFIG->header_timeout_milliseconds));
+                co_await boost::beast::http::async_read_header(client_socket_, client_buffer_, parser,
+                boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+                deadline.check(ec);
+            }
+            if(ec == boost::asio::error::timed_out)
+            {
+                if(first_request || parser.got_some()) // молчащий keep-alive клиент закрывается без ответа
+                {
+                    access_.end = Access_end::header_timeout;
+                    co_await send_error(boost::beast::http::status::request_timeout, "REQUEST TIMEOUT");
+                }
+                co_return;
+            }
+            if(ec)
+            {
+                if(first_request) // если ошибка в первом запросе, то послать BAD REQUEST
+                {
+                    access_.end = Access_end::bad_request;
+                    co_await send_bad_request("BAD REQUEST");
+                }
+                co_return; // иначе клиент просто закрыл keep-alive соеденение
+            }
+            first_request = false;
+            access_.headers = since_accept();
+            access_.requests++;
+            __PROXY_GLOBALS__::METRICS.requests.add();
+            auto result = HttpHandler::analyze_request(parser.get()); // анализ запроса
+            access_.set_host(result.host);
+            std::from_chars(result.port.data(), result.port.data() + result.port.size(), access_.port);
             if(__PROXY_GLOBALS__::LOG_ON)
                 __PROXY_GLOBALS__::LOGGER << "Request from " << client_socket_.remote_endpoint().address() << ":\n" 
-                << req << std::endl;
+                << parser.get().base() << std::endl;
             if(result.is_blacklisted)
             {
+                access_.end = Access_end::blacklisted;
                 co_await send_bad_request("BLACKLISTED HOST");
                 co_return;
             }
+            if(result.host.empty())
+            {
+                access_.end = Access_end::bad_request;
+                co_await send_bad_request("BAD REQUEST");
+                co_return;
+            }
             if(result.is_connect) // если CONNECT, то вызвать https_handler
             {
                 co_await https_handler(result.host, result.port);
                 co_return;
             }
-            else // иначе вызвать http_hanlder
-                co_await http_handler(result.host, result.port, req);
+            // иначе вызвать http_hanlder, он вернет false если соеденение с клиентом больше не используется
+            if(!co_await http_handler(result.host, result.port, parser))
+                co_return;
         }
-        else // если ошибка, то послать BAD REQUEST
-            co_await send_bad_request("BAD REQUEST");
     }
     catch(const std::exception& ex)
     {
+        access_.end = Access_end::exception;
 #ifdef DEBUG
         __PROXY_GLOBALS__::DEBUG_LOGGER << "Exception in handle request: " << ex.what();
 #endif
@@ -66,61 +184,120 @@ boost::asio::awaitable<void> Session::handle_request()
 
 boost::asio::awaitable<void> Session::send_bad_request(const std::string str)
 {
-    boost::beast::http::response<boost::beast::http::string_body> res(boost::beast::http::status::bad_request, 11);
+    co_await send_error(boost::beast::http::status::bad_request, str);
+}
+
+boost::asio::awaitable<void> Session::send_error(boost::beast::http::status status, const std::string str)
+{
+    boost::beast::http::response<boost::beast::http::string_body> res(status, 11);
     res.set(boost::beast::http::field::server, "Proxy");
     res.set(boost::beast::http::field::content_type, "text/plain");
     res.body() = str;
     res.prepare_payload();
-    co_await boost::beast::http::async_write(client_socket_, res, boost::asio::use_awaitable);
+    access_.status = res.result_int();
+    access_.bytes_down += co_await boost::beast::http::async_write(client_socket_, res, boost::asio::use_awaitable);
     if(__PROXY_GLOBALS__::LOG_ON)
-        __PROXY_GLOBALS__::LOGGER << "Send bad request to " << client_socket_.remote_endpoint().address() << ":\n" 
+        __PROXY_GLOBALS__::LOGGER << "Send error to " << client_socket_.remote_endpoint().address() << ":\n" 
         << res << std::endl;
     co_return;
 }
 
-boost::asio::awaitable<void> Session::http_handler
-(const std::string& host, const std::string& port, const boost::beast::http::request<boost::beast::http::string_body> request)
+boost::asio::awaitable<void> Session::send_upstream_error(const boost::system::error_code& ec)
 {
-    auto executor = client_socket_.get_executor();
-    boost::asio::ip::tcp::resolver resolver(executor);
-    boost::system::error_code ec;
-    auto upstream_ptr = std::make_shared<boost::asio::ip::tcp::socket>(executor);
-    auto finished = std::make_shared<std::atomic_bool>(false);
-    auto self_weak = weak_from_this();
-    auto timer = std::make_shared<Timer>(executor, __PROXY_GLOBALS__::PROXY_CONFIG.timeout_milliseconds);
-    
-    auto close_both = [self_weak, upstream_ptr, timer]()
+    if(ec == boost::asio::error::timed_out) // резолвинг, подключение или ответ не уложились в свой срок
+    {
+        access_.end = Access_end::upstream_timeout; // важнее причины, выставленной вызывающим
+        co_await send_error(boost::beast::http::status::gateway_timeout, "GATEWAY TIMEOUT");
+    }
+    else
+        co_await send_bad_request(ec.what());
+}
+
+void Session::set_idle_callback(Timer& timer, std::shared_ptr<boost::asio::ip::tcp::socket> upstream_ptr)
+{
+    // отмена, а не закрытие: ожидающие операции завершаются с operation_aborted и корутины сами закрывают соеденение
+    timer.set_callback_func([self_weak = weak_from_this(), upstream_ptr]()
     {
         if(auto self = self_weak.lock())
         {
-            timer->stop();
             boost::system::error_code ec;
-            self->client_socket_.shutdown(boost::asio::ip::tcp::socket::shutdown_both, ec);
-            upstream_ptr->shutdown(boost::asio::ip::tcp::socket::shutdown_both, ec);
-            self->client_socket_.close(ec);
-            upstream_ptr->close(ec);
+            self->client_socket_.cancel(ec);
+            upstream_ptr->cancel(ec);
         }
-        else
-            return;
-    };
+    });
+}
 
-    timer->set_callback_func([upstream_ptr](){upstream_ptr->close();});
-    timer->start();
-    auto results = co_await resolver.async_resolve(host, port, boost::asio::redirect_error(boost::asio::use_awaitable, ec));
-    timer->refresh();
-    co_await boost::asio::async_connect(*upstream_ptr, results, boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+boost::asio::awaitable<void> Session::throttle(Limiter_chain& limiters, std::size_t bytes)
+{
+    while(bytes > 0)
+        bytes -= co_await limiters.async_acquire(bytes);
+}
+
+template<bool isRequest>
+boost::asio::awaitable<void> Session::relay_message(boost::asio::ip::tcp::socket& input, boost::beast::flat_buffer& buffer,
+boost::beast::http::parser<isRequest, boost::beast::http::buffer_body>& parser, boost::asio::ip::tcp::socket& output,
+std::shared_ptr<Timer> timer, boost::system::error_code& ec)
+{
+    // заголовок уже прочитан, тело пересылается кусками по мере чтения
+    boost::beast::http::serializer<isRequest, boost::beast::http::buffer_body> serializer(parser.get());
+    auto& written = isRequest ? access_.bytes_up : access_.bytes_down; // счетчик access log'а
+    auto& limiters = isRequest ? upload_limiters_ : download_limiters_;
+    auto sent = co_await boost::beast::http::async_write_header(output, serializer, boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+    written += sent;
+    limiters.count_transferred(sent);
     timer->refresh();
     if(ec)
-    {
-        timer->stop();
-#ifdef DEBUG
-        __PROXY_GLOBALS__::DEBUG_LOGGER << "Error in connect to upstream: " << ec.what() << std::endl;
-#endif
-        co_await send_bad_request(ec.what());
         co_return;
+    auto body_buffer = Buffer_pool::local()->acquire(); // буфер для тела на время пересылки сообщения
+    do
+    {
+        if(!parser.is_done())
+        {
+            parser.get().body().data = body_buffer.data();
+            parser.get().body().size = body_buffer.size();
+            co_await boost::beast::http::async_read(input, buffer, parser, boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+            timer->refresh();
+            if(ec == boost::beast::http::error::need_buffer)
+                ec = {};
+            if(ec)
+                co_return;
+            parser.get().body().size = body_buffer.size() - parser.get().body().size;
+            parser.get().body().data = body_buffer.data();
+            parser.get().body().more = !parser.is_done();
+            auto granted = limiters.try_acquire(parser.get().body().size); // обычно токены есть и ждать не нужно
+            if(granted < parser.get().body().size)
+                co_await throttle(limiters, parser.get().body().size - granted);
+        }
+        else
+        {
+            parser.get().body().data = nullptr;
+            parser.get().body().size = 0;
+            parser.get().body().more = false;
+        }
+        sent = co_await boost::beast::http::async_write(output, serializer, boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+        written += sent;
+        limiters.count_transferred(sent);
+        timer->refresh();
+        if(ec == boost::beast::http::error::need_buffer)
+            ec = {};
+        if(ec)
+            co_return;
     }
+    while(!parser.is_done() && !serializer.is_done());
+}
+
+boost::asio::awaitable<bool> Session::http_handler
+(const std::string& host, const std::string& port, boost::beast::http::request_parser<boost::beast::http::buffer_body>& request_parser)
+{
+    auto executor = client_socket_.get_executor();
+    const auto config_snapshot = __PROXY_GLOBALS__::PROXY_CONFIG.get(); // настройки не меняются до конца обработки
+    const auto& config = *config_snapshot;
+    boost::system::error_code ec;
+    auto timer = make_recycled<Timer>(executor, config.timeout_milliseconds); // простой при пересылке запроса и ответа
+    auto& request = request_parser.get();
+    select_destination(host);
+    access_.resolved = access_.connected = access_.first_byte = Access_record::NONE; // фазы описывают последний запрос
 
-    auto modified_req = request; // модификация запроса для upstream сервера
     std::string target = std::string(request.target()); // конвертация url
     auto scheme_pos = target.find("://");
     if(scheme_pos != std::string::npos)
@@ -131,135 +308,227 @@ boost::asio::awaitable<void> Session::http_handler
         else
             target = "/";
     }
-    modified_req.target(target);
-    modified_req.erase(boost::beast::http::field::proxy_connection); // удаление proxy-connection заголовка
-
-    // отправка модифицированного запроса на upstream сервер
-    co_await boost::beast::http::async_write(*upstream_ptr, modified_req, boost::asio::redirect_error(boost::asio::use_awaitable, ec));
-    timer->refresh();
-    if(ec)
+    // модификация запроса для upstream сервера
+    bool client_keep_alive = request.keep_alive();
+    bool is_head = request.method() == boost::beast::http::verb::head;
+    bool is_upgrade = request.find(boost::beast::http::field::upgrade) != request.end(); // например websocket
+    request.target(target);
+    request.erase(boost::beast::http::field::proxy_connection); // удаление proxy-connection заголовка
+    if(!is_upgrade)
+        request.keep_alive(true); // с upstream'ом соеденение держится всегда, чтобы вернуть его в пул
+    if(request[boost::beast::http::field::expect] == "100-continue" && !request_parser.is_done())
     {
-        timer->stop();
-#ifdef DEBUG
-        __PROXY_GLOBALS__::DEBUG_LOGGER << "Error writing to upstream: " << ec.what() << std::endl;
-#endif
-        co_await send_bad_request(ec.what());
-        co_return;
+        // клиент ждет 100 Continue перед отправкой тела, прокси отвечает сам и читает тело сразу
+        static const std::string continue_response = "HTTP/1.1 100 Continue\r\n\r\n";
+        request.erase(boost::beast::http::field::expect);
+        access_.bytes_down += co_await boost::asio::async_write(client_socket_, boost::asio::buffer(continue_response),
+        boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+        if(ec)
+            co_return false;
     }
-    timer->set_callback_func([finished](){finished->store(true);});
+    bool has_body = !request_parser.is_done(); // запрос с телом нельзя повторить на другом соеденении
 
-    // корутина для чтения от сервера и отправки клиенту
-    auto server_to_client = [self_weak, upstream_ptr, finished, close_both, timer]() -> boost::asio::awaitable<void>
+    std::shared_ptr<Upstream_pool::Connection> connection; // соеденение из пула
+    std::shared_ptr<boost::asio::ip::tcp::socket> upstream_ptr;
+    boost::beast::flat_buffer upstream_buffer;
+    std::optional<boost::beast::http::response_parser<boost::beast::http::buffer_body>> parser;
+    for(int attempt = 0;; attempt++)
     {
-        if(auto self = self_weak.lock())
+        // ожидание места под хост входит в срок подключения
+        connection = co_await upstream_pool_->acquire(host, port, std::chrono::milliseconds(config.connect_timeout_milliseconds));
+        if(!connection)
         {
-            std::array<char, TUNNEL_BUFFER_SIZE> read_buffer_from_server;
-            boost::system::error_code ec;
-            for(;;)
+            co_await send_upstream_error(boost::asio::error::timed_out);
+            co_return false;
+        }
+        upstream_ptr = connection->socket();
+        set_idle_callback(*timer, upstream_ptr);
+        if(!connection->is_reused()) // в пуле нет соеденения, подключение как обычно
+        {
+            auto results = co_await __PROXY_GLOBALS__::DNS_CACHE.async_resolve(host, port, ec); // срок - у резолвера (getaddrinfo ждет кеш)
+            access_.end = Access_end::resolve_failed;
+            if(!ec)
             {
-                if(finished->load())
-                    break;
-                auto bytes_transferred = co_await upstream_ptr->async_read_some
-                (boost::asio::buffer(read_buffer_from_server), boost::asio::redirect_error(boost::asio::use_awaitable, ec));
-                timer->refresh();
-                if(bytes_transferred == 0 || ec)
-                    break;
-                std::size_t offset = 0;
-                while(offset < bytes_transferred)
+                access_.resolved = since_accept();
+                if(!remove_blacklisted(results))
                 {
-                    auto allowed = self->traffic_limiter_->acquire(bytes_transferred - offset);
-                    if(allowed == 0)
-                    {
-                        boost::asio::steady_timer wait_timer(self->client_socket_.get_executor());
-                        wait_timer.expires_after(std::chrono::milliseconds(10));
-                        co_await wait_timer.async_wait(boost::asio::use_awaitable);
-                        continue;
-                    }
-                    
-                    auto sent = co_await boost::asio::async_write
-                    (self->client_socket_,
-                    boost::asio::buffer(read_buffer_from_server.data() + offset, allowed),
-                    boost::asio::redirect_error(boost::asio::use_awaitable, ec));
-                    timer->refresh();
-                    
-                    if(ec)
-                        break;
-                    offset += sent;
+                    access_.end = Access_end::blacklisted;
+                    co_await send_bad_request("BLACKLISTED ADDRESS");
+                    co_return false;
                 }
+                access_.end = Access_end::connect_failed;
+                co_await happy_eyeballs_connect(*upstream_ptr, results,
+                std::chrono::milliseconds(config.connect_attempt_delay_milliseconds),
+                std::chrono::milliseconds(config.connect_timeout_milliseconds), ec);
             }
-            
-#ifdef DEBUG
             if(ec)
-                __PROXY_GLOBALS__::DEBUG_LOGGER << "Error in server_to_client (HTTP): " << ec.what() << std::endl;
+            {
+#ifdef DEBUG
+                __PROXY_GLOBALS__::DEBUG_LOGGER << "Error in connect to upstream: " << ec.what() << std::endl;
 #endif
-            if(!finished->exchange(true))
-                close_both();
+                co_await send_upstream_error(ec);
+                co_return false;
+            }
+            access_.connected = since_accept();
+            access_.end = Access_end::completed;
+            __PROXY_GLOBALS__::METRICS.connect_duration.record(access_.connected - access_.headers);
         }
-        else
-            co_return;
-    };
+        set_upstream_address(*upstream_ptr);
 
-    // корутина для чтения от клиента и отправки серверу
-    auto client_to_server = [self_weak, upstream_ptr, finished, close_both, timer]() -> boost::asio::awaitable<void>
-    {
-        if(auto self = self_weak.lock())
+        // отправка модифицированного запроса (заголовок и тело) на upstream сервер
+        timer->start();
+        co_await relay_message(client_socket_, client_buffer_, request_parser, *upstream_ptr, timer, ec);
+        timer->stop(); // пока сервер готовит ответ, действует срок на первый байт, а не простой
+        if(!ec)
+        {
+            Deadline deadline(*upstream_ptr, std::chrono::milliseconds(config.first_byte_timeout_milliseconds));
+            co_await read_response_header(*upstream_ptr, upstream_buffer, parser, is_head, ec);
+            deadline.check(ec);
+        }
+        if(!ec)
+        {
+            access_.first_byte = since_accept();
+            __PROXY_GLOBALS__::METRICS.first_byte_duration.record(access_.first_byte - access_.headers);
+            access_.status = parser->get().result_int();
+            break;
+        }
+        // повтор не поможет, если запрос с телом или сервер просто не успел ответить
+        if(!connection->is_reused() || has_body || attempt > 0 || ec == boost::asio::error::timed_out)
         {
-            std::array<char, TUNNEL_BUFFER_SIZE> read_buffer_from_client;
-            boost::system::error_code ec;
-            for(;;)
-            {
-                if(finished->load())
-                    break;
-                auto bytes_transferred = co_await self->client_socket_.async_read_some
-                (boost::asio::buffer(read_buffer_from_client), boost::asio::redirect_error(boost::asio::use_awaitable, ec));
-                timer->refresh();
-                if(bytes_transferred == 0 || ec)
-                    break;
-                std::size_t offset = 0;
-                while(offset < bytes_transferred)
-                {
-                    auto allowed = self->traffic_limiter_->acquire(bytes_transferred - offset);
-                    if(allowed == 0)
-                    {
-                        boost::asio::steady_timer wait_timer(self->client_socket_.get_executor());
-                        wait_timer.expires_after(std::chrono::milliseconds(10));
-                        co_await wait_timer.async_wait(boost::asio::use_awaitable);
-                        continue;
-                    }
-                    auto sent = co_await boost::asio::async_write
-                    (*upstream_ptr,
-                    boost::asio::buffer(read_buffer_from_client.data() + offset, allowed),
-                    boost::asio::redirect_error(boost::asio::use_awaitable, ec));
-                    timer->refresh();
-                    if(ec)
-                        break;
-                    offset += sent;
-                }
-            }
 #ifdef DEBUG
-            if(ec)
-                __PROXY_GLOBALS__::DEBUG_LOGGER << "Error in client_to_server (HTTP): " << ec.what() << std::endl;
+            __PROXY_GLOBALS__::DEBUG_LOGGER << "Error writing to upstream: " << ec.what() << std::endl;
 #endif
-            if(!finished->exchange(true))
-                close_both();
+            access_.end = Access_end::upstream_error;
+            co_await send_upstream_error(ec);
+            co_return false;
         }
-        else
-            co_return;
-    };
-    // запуск обеих корутин для двунаправленной передачи
-    co_await (boost::asio::experimental::awaitable_operators::operator&&(client_to_server(), server_to_client()));
-    co_return;
+        // сервер закрыл соеденение пока оно лежало в пуле, повтор с новым соеденением
+        upstream_buffer.clear();
+        connection.reset();
+    }
+
+    if(parser->get().result() == boost::beast::http::status::switching_protocols)
+    {
+        // смена протокола (websocket и т.п.): ответ пересылается клиенту, дальше тунелирование
+        connection->detach(); // туннель может жить долго, место под хост отдается ожидающим сразу
+        boost::beast::http::serializer<false, boost::beast::http::buffer_body> serializer(parser->get());
+        auto sent = co_await boost::beast::http::async_write_header(client_socket_, serializer,
+        boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+        if(!ec && upstream_buffer.size() > 0) // данные сервера, прочитанные вместе с заголовком
+            sent += co_await boost::asio::async_write(client_socket_, upstream_buffer.data(),
+            boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+        access_.bytes_down += sent;
+        download_limiters_.count_transferred(sent);
+        if(!ec && client_buffer_.size() > 0)
+        {
+            sent = co_await boost::asio::async_write(*upstream_ptr, client_buffer_.data(),
+            boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+            access_.bytes_up += sent;
+            upload_limiters_.count_transferred(sent);
+        }
+        client_buffer_.consume(client_buffer_.size());
+        if(ec)
+        {
+            access_.end = Access_end::relay_error;
+            co_return false;
+        }
+        co_await tunnel(upstream_ptr, timer);
+        co_return false;
+    }
+
+    bool upstream_reusable = !parser->get().need_eof(); // ответ ограничен по длине и сервер не просил закрыть соеденение
+    if(!upstream_reusable)
+        client_keep_alive = false; // конец тела без длины клиент узнает только по закрытию соеденения
+    parser->get().keep_alive(client_keep_alive);
+    timer->start();
+    co_await relay_message(*upstream_ptr, upstream_buffer, *parser, client_socket_, timer, ec);
+    timer->stop();
+    if(ec)
+    {
+#ifdef DEBUG
+        __PROXY_GLOBALS__::DEBUG_LOGGER << "Error in relay response: " << ec.what() << std::endl;
+#endif
+        access_.end = Access_end::relay_error;
+        co_return false;
+    }
+    if(upstream_reusable)
+        connection->keep_alive(); // ответ передан полностью, соеденение вернется в пул
+    if(!client_keep_alive)
+    {
+        boost::system::error_code close_ec;
+        client_socket_.shutdown(boost::asio::ip::tcp::socket::shutdown_both, close_ec);
+        client_socket_.close(close_ec);
+    }
+    co_return client_keep_alive;
 }
 
 boost::asio::awaitable<void> Session::https_handler (const std::string& host, const std::string& port)
 {
     auto executor = client_socket_.get_executor();
-    boost::asio::ip::tcp::resolver resolver(executor);
     boost::system::error_code ec;
-    auto upstream_ptr = std::make_shared<boost::asio::ip::tcp::socket>(executor); // сокет для соеденения с сервером
-    auto finished = std::make_shared<std::atomic_bool>(false); // флаг завершения
+    select_destination(host);
+    const auto config_snapshot = __PROXY_GLOBALS__::PROXY_CONFIG.get(); // настройки не меняются до конца обработки
+    const auto& config = *config_snapshot;
+    auto upstream_ptr = make_recycled<boost::asio::ip::tcp::socket>(executor); // сокет для соеденения с сервером
+    access_.tunnel = 1;
+
+    auto results = co_await __PROXY_GLOBALS__::DNS_CACHE.async_resolve(host, port, ec); // срок - у резолвера (getaddrinfo ждет кеш)
+    access_.end = Access_end::resolve_failed;
+    // подключение к серверу
+    if(!ec)
+    {
+        access_.resolved = since_accept();
+        if(!remove_blacklisted(results)) // CONNECT на голый IP или имя, которое резолвится в запрещенную подсеть
+        {
+            access_.end = Access_end::blacklisted;
+            co_await send_bad_request("BLACKLISTED ADDRESS");
+            co_return;
+        }
+        access_.end = Access_end::connect_failed;
+        co_await happy_eyeballs_connect(*upstream_ptr, results,
+        std::chrono::milliseconds(config.connect_attempt_delay_milliseconds),
+        std::chrono::milliseconds(config.connect_timeout_milliseconds), ec);
+    }
+    if(ec)
+    {
+#ifdef DEBUG
+        DEBUG_LOGGER << "Error in connect to upstream: " << ec.what() << std::endl;
+#endif
+        co_await send_upstream_error(ec);
+        co_return;
+    }
+    access_.connected = since_accept();
+    access_.end = Access_end::completed;
+    __PROXY_GLOBALS__::METRICS.connect_duration.record(access_.connected - access_.headers);
+    set_upstream_address(*upstream_ptr);
+    boost::beast::http::response<boost::beast::http::empty_body> res(boost::beast::http::status::ok, 11);
+    res.reason("Connection Established");
+    res.prepare_payload();
+    access_.status = res.result_int();
+    // отправка подтеврждения, что тунель установлен
+    access_.bytes_down += co_await boost::beast::http::async_write(client_socket_, res, boost::asio::use_awaitable);
+    auto timer = make_recycled<Timer>(executor, config.timeout_milliseconds); // простой туннеля
+    if(client_buffer_.size() > 0) // данные, которые клиент отправил сразу после CONNECT
+    {
+        auto sent = co_await boost::asio::async_write(*upstream_ptr, client_buffer_.data(),
+        boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+        access_.bytes_up += sent;
+        upload_limiters_.count_transferred(sent);
+        client_buffer_.consume(client_buffer_.size());
+        if(ec)
+        {
+            access_.end = Access_end::relay_error;
+            co_return;
+        }
+    }
+    co_await tunnel(upstream_ptr, timer);
+    co_return;
+}
+
+boost::asio::awaitable<void> Session::tunnel(std::shared_ptr<boost::asio::ip::tcp::socket> upstream_ptr, std::shared_ptr<Timer> timer)
+{
+    auto finished = make_recycled<std::atomic_bool>(false); // флаг завершения
     auto self_weak = weak_from_this(); // shared_ptr, чтобы объект не уничтожился раньше чем надо
-    auto timer = std::make_shared<Timer>(executor, __PROXY_GLOBALS__::PROXY_CONFIG.timeout_milliseconds);
 
     auto close_both = [self_weak, upstream_ptr, timer]() // закрытие обоих сокетов
     {
@@ -276,46 +545,19 @@ boost::asio::awaitable<void> Session::https_handler (const std::string& host, co
             return;
     };
 
+    // splice перекладывает данные между сокетами внутри ядра, без копирования в user space
+    auto transfer = __PROXY_GLOBALS__::PROXY_CONFIG->tunnel_splice ? splice_transfer : copy_transfer;
+
     // корутина для отправки данных от клиента к серверу
-    auto client_to_server = [self_weak, upstream_ptr, finished, close_both, timer] -> boost::asio::awaitable<void>
+    auto client_to_server = [self_weak, upstream_ptr, finished, close_both, timer, transfer]() -> boost::asio::awaitable<void>
     {
         if(auto self = self_weak.lock())
         {
-            std::array<char, TUNNEL_BUFFER_SIZE> read_buffer_from_client; // буфер для чтения
             boost::system::error_code ec;
-            for(;;)
-            {
-                if(finished->load())
-                    break;
-                auto bytes_transferred = co_await self->client_socket_.async_read_some
-                (boost::asio::buffer(read_buffer_from_client), boost::asio::redirect_error(boost::asio::use_awaitable, ec));
-                timer->refresh(); // обновление таймера
-                if(bytes_transferred == 0 || ec)
-                    break;
-                std::size_t offset = 0; // смещение в буфере
-                while(offset < bytes_transferred)
-                {
-                    auto allowed = self->traffic_limiter_->acquire(bytes_transferred - offset);
-                    if(allowed == 0) // ждать 10 мс пока токены не обновятся
-                    {
-                        boost::asio::steady_timer timer(self->client_socket_.get_executor());
-                        timer.expires_after(std::chrono::milliseconds(10));
-                        co_await timer.async_wait(boost::asio::use_awaitable);
-                        continue;
-                    }
-                    auto sent = co_await boost::asio::async_write
-                    (*upstream_ptr,
-                    boost::asio::buffer(read_buffer_from_client.data() + offset, allowed),
-                    boost::asio::redirect_error(boost::asio::use_awaitable, ec));
-                    timer->refresh();
-                    if(ec)
-                        break;
-                    offset += sent;
-                }
-            }
+            co_await transfer(self->client_socket_, *upstream_ptr, self->upload_limiters_, *timer, *finished, self->access_.bytes_up, ec);
 #ifdef DEBUG
         if(ec)
-            DEBUG_LOGGER << "Error in client_to_server: " << ec.what() << std::endl;
+            __PROXY_GLOBALS__::DEBUG_LOGGER << "Error in client_to_server: " << ec.what() << std::endl;
 #endif
             if(!finished->exchange(true)) // если данная корутина завершилась первой, то закрыть сокеты
                 close_both();
@@ -325,45 +567,15 @@ boost::asio::awaitable<void> Session::https_handler (const std::string& host, co
     };
 
     // корутина для отправки данных от сервера к клиенту
-    auto server_to_client = [self_weak, upstream_ptr, finished, close_both, timer]() -> boost::asio::awaitable<void>
+    auto server_to_client = [self_weak, upstream_ptr, finished, close_both, timer, transfer]() -> boost::asio::awaitable<void>
     {
         if(auto self = self_weak.lock())
         {
-            std::array<char, TUNNEL_BUFFER_SIZE> read_buffer_from_server; // буфер для чтения
             boost::system::error_code ec;
-            for(;;)
-            {
-                if(finished->load())
-                    break;
-                auto bytes_transferred = co_await upstream_ptr->async_read_some
-                (boost::asio::buffer(read_buffer_from_server), boost::asio::redirect_error(boost::asio::use_awaitable, ec));
-                timer->refresh();
-                if(bytes_transferred == 0 || ec)
-                    break;
-                std::size_t offset = 0; // смещение в буфере
-                while(offset < bytes_transferred)
-                {
-                    auto allowed = self->traffic_limiter_->acquire(bytes_transferred - offset);
-                    if(allowed == 0) // ждать 10 мс пока токены не обновятся
-                    {
-                        boost::asio::steady_timer timer(self->client_socket_.get_executor());
-                        timer.expires_after(std::chrono::milliseconds(10));
-                        co_await timer.async_wait(boost::asio::use_awaitable);
-                        continue;
-                    }
-                    auto sent = co_await boost::asio::async_write
-                    (self->client_socket_,
-                    boost::asio::buffer(read_buffer_from_server.data() + offset, allowed),
-                    boost::asio::redirect_error(boost::asio::use_awaitable, ec));
-                    timer->refresh();
-                    if(ec)
-                        break;
-                    offset += sent;
-                }
-            }
+            co_await transfer(*upstream_ptr, self->client_socket_, self->download_limiters_, *timer, *finished, self->access_.bytes_down, ec);
 #ifdef DEBUG
         if(ec)
-            DEBUG_LOGGER << "Error in server_to_client: " << ec.what() << std::endl;
+            __PROXY_GLOBALS__::DEBUG_LOGGER << "Error in server_to_client: " << ec.what() << std::endl;
 #endif
             if(!finished->exchange(true)) // если данная корутина завершилась первой, то закрыть сокеты
                 close_both();
@@ -371,30 +583,9 @@ boost::asio::awaitable<void> Session::https_handler (const std::string& host, co
         else
             co_return;
     };
-    timer->set_callback_func([upstream_ptr](){upstream_ptr->close();}); // колбэк для подключения и резолвинга
-    timer->start(); // запуск таймера
-    auto results = co_await resolver.async_resolve(host, port, boost::asio::redirect_error(boost::asio::use_awaitable, ec));
-    timer->refresh(); // обновление таймера
-    // подключение к серверу
-    co_await boost::asio::async_connect(*upstream_ptr, results, boost::asio::redirect_error(boost::asio::use_awaitable, ec));
-    timer->refresh();
-    if(ec)
-    {
-        timer->stop();
-#ifdef DEBUG
-        DEBUG_LOGGER << "Error in connect to upstream: " << ec.what() << std::endl;
-#endif
-        co_await send_bad_request(ec.what());
-        co_return;
-    }
-    boost::beast::http::response<boost::beast::http::empty_body> res(boost::beast::http::status::ok, 11);
-    res.reason("Connection Established");
-    res.prepare_payload();
-    // отправка подтеврждения, что тунель установлен
-    co_await boost::beast::http::async_write(client_socket_, res, boost::asio::use_awaitable);
-    timer->refresh();
-    timer->set_callback_func([finished](){finished->store(true);}); // колбэк для корутин
+    set_idle_callback(*timer, upstream_ptr); // простой отменяет ожидание обеих корутин, первая завершившаяся закроет сокеты
+    timer->start();
     // запуск корутин
     co_await (boost::asio::experimental::awaitable_operators::operator&&(client_to_server(), server_to_client()));
     co_return;
-}
\ No newline at end of file
+}
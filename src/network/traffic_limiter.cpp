@@ -1,33 +1,352 @@
 #include "network/traffic_limiter.hpp"
 #include "globals/globals.hpp"
+#include "utils/coarse_clock.hpp"
+#include <algorithm>
+#include <cmath>
+#include <optional>
+#include <stdexcept>
 
-Traffic_limiter::Traffic_limiter(uint64_t bytes_per_sec)
+namespace
 {
-    __PROXY_GLOBALS__::ACTIVE_CONNECTIONS++;
-    max_tokens_ = bytes_per_sec * 1.5; // 2 мб по дефолту
-    tokens_ = max_tokens_;
-    rate_bytes_per_sec_ = bytes_per_sec; // 1.5 мб/сек по дефолту
-    last_update_ = std::chrono::steady_clock::now();
+    template<typename F>
+    struct Scope_exit // вызов f при выходе из области видимости (в т.ч. при уничтожении кадра корутины)
+    {
+        F f;
+        ~Scope_exit() {f();}
+    };
+
+    template<typename Clock>
+    std::int64_t now_ns()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count();
+    }
 }
 
-void Traffic_limiter::refill()
+Traffic_limiter::Traffic_limiter(uint64_t bytes_per_sec, uint64_t burst_percent)
+: waiting_(0)
 {
-    auto now = std::chrono::steady_clock::now();
-    auto elapsed = std::chrono::duration<double>(now - last_update_).count(); // сколько секунд прошло с последнего обновления
-    tokens_ = std::min(max_tokens_, tokens_ + static_cast<std::size_t>(elapsed * rate_bytes_per_sec_)); // сколько байт надо добавить
-    last_update_ = now;
+    max_tokens_ = bytes_per_sec * burst_percent / 100; // 3 мб по дефолту
+    rate_bytes_per_sec_ = bytes_per_sec; // 2 мб/сек по дефолту
+    ns_per_byte_ = bytes_per_sec > 0 ? 1e9 / rate_bytes_per_sec_ : 0;
+    burst_ns_ = static_cast<std::int64_t>(max_tokens_ * ns_per_byte_);
+    tat_ = now_ns<Coarse_clock>(); // ведро полное (по грубым часам, чтобы быстрый путь сразу видел все ведро)
+}
+
+std::size_t Traffic_limiter::try_consume(std::size_t at_least, std::size_t at_most, std::int64_t now)
+{
+    if(rate_bytes_per_sec_ <= 0)
+        return 0;
+    auto tat = tat_.load(std::memory_order_relaxed);
+    for(;;)
+    {
+        auto base = std::max(tat, now); // TAT в прошлом - ведро полное
+        auto credit = now + burst_ns_ - base; // отрицательный, если грубые часы отстали от TAT, выставленного по точным
+        if(credit <= 0)
+            return 0;
+        auto available = static_cast<std::size_t>(credit / ns_per_byte_);
+        if(available < at_least)
+            return 0;
+        auto granted = std::min(available, at_most);
+        auto next = base + static_cast<std::int64_t>(std::ceil(granted * ns_per_byte_));
+        if(tat_.compare_exchange_weak(tat, next, std::memory_order_acq_rel, std::memory_order_relaxed))
+            return granted;
+    }
 }
 
 std::size_t Traffic_limiter::acquire(std::size_t want)
+{
+    if(want == 0)
+        return 0;
+    return try_consume(1, want, now_ns<Coarse_clock>());
+}
+
+void Traffic_limiter::give_back(std::size_t tokens)
+{
+    if(tokens > 0 && rate_bytes_per_sec_ > 0)
+        tat_.fetch_sub(static_cast<std::int64_t>(tokens * ns_per_byte_), std::memory_order_acq_rel);
+}
+
+boost::asio::awaitable<std::size_t> Traffic_limiter::async_acquire(std::size_t want, std::size_t batch, std::size_t flow)
+{
+    if(want == 0)
+        co_return 0;
+    if(auto granted = try_acquire(want, batch))
+        co_return granted;
+    // при нехватке выдается ровно target: так DRR честно считает байты каждого потока
+    auto target = std::min(want, std::max<std::size_t>(max_tokens_, 1)); // ждем сразу весь кусок, а не по паре байт
+    auto executor = co_await boost::asio::this_coro::executor;
+    auto ticket = std::make_shared<Ticket>();
+    ticket->size = target;
+    bool queued = false;
+    Scope_exit guard{[&] {if(queued) abandon(ticket, flow);}};
+    {
+        std::lock_guard lock(mutex_);
+        if(dispatcher_ == nullptr) // очередь пуста, пока шла подготовка токены могли появиться
+        {
+            auto granted = try_consume(target, std::max(target, std::min(batch, max_tokens_)), now_ns<std::chrono::steady_clock>());
+            if(granted > 0)
+                co_return granted;
+        }
+        ticket->event = std::make_shared<Async_waiter>(executor);
+        auto [it, inserted] = flows_.try_emplace(flow);
+        if(inserted)
+            round_.push_back(flow);
+        it->second.tickets.push_back(ticket);
+        waiting_.fetch_add(1, std::memory_order_acq_rel);
+        queued = true;
+        if(dispatcher_ == nullptr)
+            dispatcher_ = ticket;
+    }
+    std::optional<boost::asio::steady_timer> wait_timer;
+    for(;;)
+    {
+        bool dispatching;
+        std::chrono::steady_clock::time_point wake_at;
+        {
+            std::lock_guard lock(mutex_);
+            dispatching = dispatcher_ == ticket;
+            while(dispatching && ticket->granted == 0)
+            {
+                auto chosen = pick_next(); // не пусто: в очереди как минимум сам диспетчер
+                auto granted = try_consume(chosen->size, chosen->size, now_ns<std::chrono::steady_clock>());
+                if(granted == 0)
+                {
+                    wake_at = ready_at(chosen->size);
+                    break;
+                }
+                grant(chosen, round_.front(), granted);
+                if(chosen == ticket)
+                    break;
+                chosen->event->notify();
+                // следующий выбор - только когда накопятся токены: к этому моменту обслуженный поток
+                // успеет снова встать в очередь и не будет сочтен простаивающим
+                wake_at = ready_at(chosen->size);
+                break;
+            }
+            if(ticket->granted > 0)
+            {
+                queued = false;
+                if(dispatcher_ == ticket) // роль диспетчера переходит любому ожидающему, DRR решит при выдаче
+                {
+                    dispatcher_ = any_waiter();
+                    if(dispatcher_)
+                        dispatcher_->event->notify();
+                }
+                co_return ticket->granted;
+            }
+        }
+        if(dispatching)
+        {
+            if(!wait_timer)
+                wait_timer.emplace(executor);
+            wait_timer->expires_at(wake_at);
+            co_await wait_timer->async_wait(boost::asio::use_awaitable);
+        }
+        else
+            co_await ticket->event->wait(); // будит диспетчер: токены выданы или теперь диспетчер - эта корутина
+    }
+}
+
+std::shared_ptr<Traffic_limiter::Ticket> Traffic_limiter::pick_next()
+{
+    while(!round_.empty())
+    {
+        auto it = flows_.find(round_.front());
+        auto& current = it->second;
+        if(current.tickets.empty()) // поток больше не ждет - его доля сразу делится между остальными
+        {
+            flows_.erase(it);
+            round_.pop_front();
+            continue;
+        }
+        if(!current.topped_up)
+        {
+            current.deficit += FAIR_SHARE_QUANTUM;
+            current.topped_up = true;
+        }
+        if(current.deficit >= current.tickets.front()->size)
+            return current.tickets.front();
+        // квант потока за этот круг исчерпан, очередь следующего
+        current.topped_up = false;
+        round_.push_back(round_.front());
+        round_.pop_front();
+    }
+    return nullptr;
+}
+
+std::shared_ptr<Traffic_limiter::Ticket> Traffic_limiter::any_waiter() const
+{
+    for(auto flow : round_)
+    {
+        const auto& tickets = flows_.at(flow).tickets;
+        if(!tickets.empty())
+            return tickets.front();
+    }
+    return nullptr;
+}
+
+void Traffic_limiter::grant(const std::shared_ptr<Ticket>& ticket, std::size_t flow, std::size_t granted)
+{
+    auto& current = flows_[flow];
+    current.deficit -= std::min(current.deficit, granted);
+    current.tickets.erase(std::find(current.tickets.begin(), current.tickets.end(), ticket));
+    waiting_.fetch_sub(1, std::memory_order_acq_rel);
+    ticket->granted = granted;
+}
+
+std::size_t Traffic_limiter::try_acquire(std::size_t want, std::size_t batch)
+{
+    if(want == 0 || waiting_.load(std::memory_order_acquire) > 0) // очередь не обгоняется
+        return 0;
+    auto target = std::min(want, std::max<std::size_t>(max_tokens_, 1));
+    auto at_most = std::max(target, std::min(batch, max_tokens_));
+    if(auto granted = try_consume(target, at_most, now_ns<Coarse_clock>())) // грубых часов обычно достаточно
+        return granted;
+    return try_consume(target, at_most, now_ns<std::chrono::steady_clock>());
+}
+
+std::chrono::steady_clock::time_point Traffic_limiter::ready_at(std::size_t tokens) const
+{
+    auto now = std::chrono::steady_clock::now();
+    if(rate_bytes_per_sec_ <= 0)
+        return now + std::chrono::seconds(1);
+    // available = (now + burst - TAT) / ns_per_byte >= tokens
+    auto ready = tat_.load(std::memory_order_acquire) + static_cast<std::int64_t>(std::ceil(tokens * ns_per_byte_)) - burst_ns_;
+    return std::max(now, std::chrono::steady_clock::time_point(std::chrono::nanoseconds(ready)));
+}
+
+void Traffic_limiter::abandon(const std::shared_ptr<Ticket>& ticket, std::size_t flow)
 {
     std::lock_guard lock(mutex_);
-    refill();
-    std::size_t allowed = std::min(tokens_, want);
-    tokens_ -= allowed;
-    return allowed;
+    if(ticket->granted > 0) // токены выданы, но забрать их уже некому
+    {
+        give_back(ticket->granted);
+        return;
+    }
+    auto it = flows_.find(flow);
+    if(it != flows_.end())
+    {
+        auto& tickets = it->second.tickets;
+        auto position = std::find(tickets.begin(), tickets.end(), ticket);
+        if(position != tickets.end())
+        {
+            tickets.erase(position);
+            waiting_.fetch_sub(1, std::memory_order_acq_rel);
+        }
+    }
+    if(dispatcher_ == ticket)
+    {
+        dispatcher_ = any_waiter();
+        if(dispatcher_)
+            dispatcher_->event->notify();
+    }
+}
+
+std::size_t Traffic_limiter::waiting() const
+{
+    return waiting_.load(std::memory_order_acquire);
 }
 
 Traffic_limiter::~Traffic_limiter()
+{}
+
+Limiter_chain::Limiter_chain(std::initializer_list<std::shared_ptr<Traffic_limiter>> limiters)
+{
+    for(const auto& limiter : limiters)
+        add(limiter);
+}
+
+void Limiter_chain::add(std::shared_ptr<Traffic_limiter> limiter)
+{
+    if(!limiter)
+        return;
+    if(size_ == MAX_LEVELS)
+        throw std::length_error("Limiter_chain: too many levels");
+    limiters_[size_++] = std::move(limiter);
+}
+
+boost::asio::awaitable<std::size_t> Limiter_chain::async_acquire(std::size_t want, std::size_t batch)
 {
-    __PROXY_GLOBALS__::ACTIVE_CONNECTIONS--;
-}
\ No newline at end of file
+    if(size_ == 0)
+        co_return std::max(want, batch);
+    // каждый следующий уровень просят не больше, чем выдал предыдущий, поэтому выданное только уменьшается,
+    // разница сразу возвращается всем уже опрошенным уровням
+    auto started = std::chrono::steady_clock::now(); // сюда попадают после неудачного try_acquire, время ожидания - в метрики
+    auto granted = std::max(want, batch);
+    for(std::size_t i = 0; i < size_; i++)
+    {
+        auto next = co_await limiters_[i]->async_acquire(std::min(want, granted), granted, flow_);
+        if(i > 0 && next < granted)
+        {
+            for(std::size_t j = 0; j < i; j++)
+                limiters_[j]->give_back(granted - next);
+        }
+        granted = next;
+    }
+    throttled_.add(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - started).count());
+    co_return granted;
+}
+
+std::size_t Limiter_chain::try_acquire(std::size_t want, std::size_t batch)
+{
+    if(size_ == 0)
+        return std::max(want, batch);
+    auto granted = std::max(want, batch);
+    for(std::size_t i = 0; i < size_; i++)
+    {
+        auto next = limiters_[i]->try_acquire(std::min(want, granted), granted);
+        if(i > 0 && next < granted)
+        {
+            for(std::size_t j = 0; j < i; j++)
+                limiters_[j]->give_back(granted - next);
+        }
+        granted = next;
+        if(granted == 0)
+            break;
+    }
+    return granted;
+}
+
+void Limiter_chain::give_back(std::size_t tokens)
+{
+    for(std::size_t i = 0; i < size_; i++)
+        limiters_[i]->give_back(tokens);
+}
+
+Token_batch::Token_batch(Limiter_chain& limiters, std::size_t batch_size)
+: limiters_(limiters), batch_size_(batch_size), tokens_(0)
+{}
+
+Token_batch::~Token_batch()
+{
+    release();
+}
+
+boost::asio::awaitable<std::size_t> Token_batch::acquire(std::size_t want)
+{
+    if(tokens_ == 0)
+        tokens_ = co_await limiters_.async_acquire(want, batch_size_);
+    auto granted = std::min(tokens_, want);
+    tokens_ -= granted;
+    co_return granted;
+}
+
+std::size_t Token_batch::try_acquire(std::size_t want)
+{
+    if(tokens_ == 0)
+        tokens_ = limiters_.try_acquire(want, batch_size_);
+    auto granted = std::min(tokens_, want);
+    tokens_ -= granted;
+    return granted;
+}
+
+void Token_batch::refund(std::size_t tokens)
+{
+    tokens_ += tokens;
+}
+
+void Token_batch::release()
+{
+    limiters_.give_back(tokens_);
+    tokens_ = 0;
+}
@@ -0,0 +1,173 @@
+#include "network/tunnel.hpp"
+#include "utils/timer.hpp"
+#include "utils/buffer_pool.hpp"
+#include <array>
+#ifdef __linux__
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+namespace
+{
+#ifdef __linux__
+    class Splice_pipe // pipe, через который данные идут между сокетами внутри ядра
+    {
+        public:
+            Splice_pipe()
+            {
+                if(::pipe2(fds_, O_NONBLOCK | O_CLOEXEC) < 0)
+                    fds_[0] = fds_[1] = -1;
+            }
+
+            ~Splice_pipe()
+            {
+                if(fds_[0] >= 0)
+                    ::close(fds_[0]);
+                if(fds_[1] >= 0)
+                    ::close(fds_[1]);
+            }
+
+            Splice_pipe(const Splice_pipe&) = delete;
+            Splice_pipe& operator=(const Splice_pipe&) = delete;
+
+            bool is_open() const {return fds_[0] >= 0;};
+
+            int read_fd() const {return fds_[0];};
+
+            int write_fd() const {return fds_[1];};
+
+        private:
+            int fds_[2];
+    };
+
+    boost::system::error_code last_error()
+    {
+        return boost::system::error_code(errno, boost::system::system_category());
+    }
+#endif
+}
+
+boost::asio::awaitable<void> copy_transfer(boost::asio::ip::tcp::socket& input, boost::asio::ip::tcp::socket& output,
+Limiter_chain& limiters, Timer& timer, const std::atomic_bool& finished, std::uint64_t& transferred, boost::system::error_code& ec)
+{
+    Token_batch tokens(limiters); // лимитеры общие для многих соеденений, поэтому трогаются пачками
+    for(;;)
+    {
+        if(finished.load())
+            break;
+        // пока данных нет, буфер не нужен: простаивающий туннель память под буферы не держит
+        co_await input.async_wait(boost::asio::ip::tcp::socket::wait_read, boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+        if(ec)
+            break;
+        auto buffer = Buffer_pool::local()->acquire(); // возвращается в пул в конце итерации
+        auto bytes_transferred = co_await input.async_read_some
+        (boost::asio::buffer(buffer.data(), buffer.size()), boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+        timer.refresh(); // обновление таймера
+        if(bytes_transferred == 0 || ec)
+            break;
+        std::size_t offset = 0; // смещение в буфере
+        while(offset < bytes_transferred)
+        {
+            auto allowed = tokens.try_acquire(bytes_transferred - offset);
+            if(allowed == 0)
+                allowed = co_await tokens.acquire(bytes_transferred - offset);
+            auto sent = co_await boost::asio::async_write
+            (output, boost::asio::buffer(buffer.data() + offset, allowed), boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+            timer.refresh();
+            transferred += sent;
+            limiters.count_transferred(sent);
+            if(ec)
+                co_return;
+            offset += sent;
+        }
+    }
+}
+
+boost::asio::awaitable<void> splice_transfer(boost::asio::ip::tcp::socket& input, boost::asio::ip::tcp::socket& output,
+Limiter_chain& limiters, Timer& timer, const std::atomic_bool& finished, std::uint64_t& transferred, boost::system::error_code& ec)
+{
+#ifdef __linux__
+    Splice_pipe pipe;
+    if(pipe.is_open())
+    {
+        input.native_non_blocking(true, ec);
+        if(!ec)
+            output.native_non_blocking(true, ec);
+    }
+    if(!pipe.is_open() || ec) // нет свободных дескрипторов - обычное копирование
+    {
+        ec.clear();
+        co_await copy_transfer(input, output, limiters, timer, finished, transferred, ec);
+        co_return;
+    }
+    bool spliced = false; // был ли хоть один успешный splice
+    Token_batch tokens(limiters);
+    for(;;)
+    {
+        if(finished.load())
+            break;
+        co_await input.async_wait(boost::asio::ip::tcp::socket::wait_read, boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+        timer.refresh();
+        if(ec)
+            break;
+        int available = 0; // сколько байт уже лежит в сокете, столько и запрашивается у лимитера
+        if(::ioctl(input.native_handle(), FIONREAD, &available) < 0)
+        {
+            ec = last_error();
+            break;
+        }
+        std::size_t granted = 1; // 0 байт в сокете - конец потока или ошибка, их покажет splice
+        if(available > 0)
+        {
+            auto want = std::min<std::size_t>(available, SPLICE_CHUNK_SIZE);
+            granted = tokens.try_acquire(want);
+            if(granted == 0)
+                granted = co_await tokens.acquire(want);
+        }
+        auto moved = ::splice(input.native_handle(), nullptr, pipe.write_fd(), nullptr, granted, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+        if(moved == 0) // клиент или сервер закрыл соеденение
+            break;
+        if(available > 0)
+            tokens.refund(granted - std::max<ssize_t>(moved, 0)); // не перемещенное в pipe остается в запасе
+        if(moved < 0)
+        {
+            if(errno == EAGAIN)
+                continue;
+            if(!spliced && (errno == EINVAL || errno == ENOSYS)) // ядро не умеет splice для этих сокетов
+            {
+                tokens.release();
+                co_await copy_transfer(input, output, limiters, timer, finished, transferred, ec);
+                co_return;
+            }
+            ec = last_error();
+            break;
+        }
+        spliced = true;
+        std::size_t in_pipe = moved;
+        while(in_pipe > 0) // все, что попало в pipe, отправляется до следующего чтения
+        {
+            auto sent = ::splice(pipe.read_fd(), nullptr, output.native_handle(), nullptr, in_pipe, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+            if(sent < 0 && errno == EAGAIN)
+            {
+                co_await output.async_wait(boost::asio::ip::tcp::socket::wait_write, boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+                if(ec)
+                    co_return;
+                continue;
+            }
+            if(sent <= 0)
+            {
+                ec = sent < 0 ? last_error() : boost::asio::error::eof;
+                co_return;
+            }
+            in_pipe -= sent;
+            transferred += sent;
+            limiters.count_transferred(sent);
+            timer.refresh();
+        }
+    }
+#else
+    co_await copy_transfer(input, output, limiters, timer, finished, transferred, ec);
+#endif
+}
@@ -0,0 +1,162 @@
+#include "network/upstream_pool.hpp"
+#include "utils/recycling_allocator.hpp"
+#include <algorithm>
+#include <sys/socket.h>
+#include <cerrno>
+
+Upstream_pool::Connection::Connection(std::shared_ptr<Upstream_pool> pool, std::string key,
+std::shared_ptr<boost::asio::ip::tcp::socket> socket, bool reused)
+: pool_(std::move(pool)), key_(std::move(key)), socket_(std::move(socket)), reused_(reused), keep_alive_(false), detached_(false)
+{}
+
+Upstream_pool::Connection::~Connection()
+{
+    if(!detached_)
+        pool_->release(key_, std::move(socket_), keep_alive_);
+}
+
+void Upstream_pool::Connection::keep_alive()
+{
+    keep_alive_ = true;
+}
+
+void Upstream_pool::Connection::detach()
+{
+    if(detached_)
+        return;
+    detached_ = true;
+    pool_->forget(key_);
+}
+
+Upstream_pool::Upstream_pool(const boost::asio::any_io_executor& executor, std::size_t max_idle,
+std::size_t max_per_host, std::chrono::milliseconds idle_timeout)
+: executor_(executor), max_idle_(max_idle), max_per_host_(max_per_host), idle_timeout_(idle_timeout), idle_total_(0)
+{}
+
+boost::asio::awaitable<std::shared_ptr<Upstream_pool::Connection>> Upstream_pool::acquire
+(const std::string& host, const std::string& port, std::chrono::milliseconds timeout)
+{
+    auto key = host + ":" + port;
+    auto deadline = timeout == std::chrono::milliseconds::max() ? std::chrono::steady_clock::time_point::max()
+    : std::chrono::steady_clock::now() + timeout; // общий срок на все ожидания
+    for(;;)
+    {
+        auto& entry = hosts_[key]; // ссылка берется заново после каждого ожидания
+        auto now = std::chrono::steady_clock::now();
+        while(!entry.idle.empty())
+        {
+            auto idle = std::move(entry.idle.back()); // самое свежее соеденение
+            entry.idle.pop_back();
+            idle_total_--;
+            if(now - idle.since < idle_timeout_ && is_alive(*idle.socket))
+                co_return make_recycled<Connection>(shared_from_this(), key, std::move(idle.socket), true);
+            drop(entry, idle.socket);
+        }
+        if(max_per_host_ == 0 || entry.total < max_per_host_)
+        {
+            entry.total++;
+            co_return make_recycled<Connection>(shared_from_this(), key,
+            make_recycled<boost::asio::ip::tcp::socket>(executor_), false);
+        }
+        auto waiter = std::make_shared<Async_waiter>(executor_);
+        entry.waiters.push_back(waiter);
+        if(deadline == std::chrono::steady_clock::time_point::max())
+            co_await waiter->wait();
+        else if(!co_await waiter->wait(deadline - std::chrono::steady_clock::now()))
+        {
+            auto& waiters = hosts_[key].waiters; // notify убирает из очереди сам, по сроку - убираемся сами
+            waiters.erase(std::remove(waiters.begin(), waiters.end(), waiter), waiters.end());
+            co_return nullptr;
+        }
+    }
+}
+
+void Upstream_pool::release(const std::string& key, std::shared_ptr<boost::asio::ip::tcp::socket> socket, bool reusable)
+{
+    auto it = hosts_.find(key);
+    if(it == hosts_.end())
+        return;
+    auto& entry = it->second;
+    if(reusable && socket->is_open() && idle_total_ < max_idle_)
+    {
+        entry.idle.push_back({std::move(socket), std::chrono::steady_clock::now()});
+        idle_total_++;
+    }
+    else
+        drop(entry, socket);
+    wake_one(entry); // освободилось место или появилось idle соеденение
+}
+
+void Upstream_pool::forget(const std::string& key)
+{
+    auto it = hosts_.find(key);
+    if(it == hosts_.end())
+        return;
+    it->second.total--;
+    wake_one(it->second);
+}
+
+void Upstream_pool::wake_one(Host_entry& entry)
+{
+    if(entry.waiters.empty())
+        return;
+    entry.waiters.front()->notify();
+    entry.waiters.pop_front();
+}
+
+void Upstream_pool::drop(Host_entry& entry, const std::shared_ptr<boost::asio::ip::tcp::socket>& socket)
+{
+    boost::system::error_code ec;
+    socket->shutdown(boost::asio::ip::tcp::socket::shutdown_both, ec);
+    socket->close(ec);
+    entry.total--;
+}
+
+boost::asio::awaitable<void> Upstream_pool::run_sweeper()
+{
+    auto self = shared_from_this();
+    boost::asio::steady_timer timer(executor_);
+    for(;;)
+    {
+        timer.expires_after(std::max(idle_timeout_ / 2, std::chrono::milliseconds(100)));
+        boost::system::error_code ec;
+        co_await timer.async_wait(boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+        if(ec)
+            co_return;
+        auto now = std::chrono::steady_clock::now();
+        for(auto it = hosts_.begin(); it != hosts_.end();)
+        {
+            auto& entry = it->second;
+            while(!entry.idle.empty() && now - entry.idle.front().since >= idle_timeout_) // в начале самые старые
+            {
+                drop(entry, entry.idle.front().socket);
+                entry.idle.pop_front();
+                idle_total_--;
+                wake_one(entry);
+            }
+            if(entry.total == 0 && entry.waiters.empty())
+                it = hosts_.erase(it);
+            else
+                ++it;
+        }
+    }
+}
+
+std::size_t Upstream_pool::connections_count(const std::string& host, const std::string& port) const
+{
+    auto it = hosts_.find(host + ":" + port);
+    return it == hosts_.end() ? 0 : it->second.total;
+}
+
+bool Upstream_pool::is_alive(boost::asio::ip::tcp::socket& socket)
+{
+    if(!socket.is_open())
+        return false;
+    char byte;
+    auto received = ::recv(socket.native_handle(), &byte, 1, MSG_PEEK | MSG_DONTWAIT);
+    if(received == 0) // сервер закрыл соеденение
+        return false;
+    if(received > 0) // неожиданные данные от сервера - соеденение в неизвестном состоянии
+        return false;
+    return errno == EAGAIN || errno == EWOULDBLOCK;
+}
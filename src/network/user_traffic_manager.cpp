@@ -1,24 +1,202 @@
 #include "network/user_traffic_manager.hpp"
 #include "globals/globals.hpp"
 
-std::shared_ptr<Traffic_limiter> User_traffic_manager::get_or_create_user(const std::string& ip)
+namespace
 {
-    std::lock_guard lock(mutex_);
-    auto it = users_.find(ip);
-    if(it != users_.end())
+    std::size_t index(User_traffic_manager::Direction direction)
     {
-        if(auto limiter = it->second.lock())
-            return limiter;
-        else
-            users_.erase(it);
+        return direction == User_traffic_manager::Direction::upload ? 0 : 1;
+    }
+
+    std::shared_ptr<Traffic_limiter> create_limiter(int64_t bytes_per_sec)
+    {
+        return std::make_shared<Traffic_limiter>(bytes_per_sec, __PROXY_GLOBALS__::PROXY_CONFIG->bandwidth_burst_percent);
+    }
+
+    std::shared_ptr<Traffic_limiter> make_limiter(int64_t bytes_per_sec) // nullptr для выключенного уровня
+    {
+        if(bytes_per_sec <= 0)
+            return nullptr;
+        return create_limiter(bytes_per_sec);
+    }
+
+    int64_t user_rate(User_traffic_manager::Direction direction)
+    {
+        const auto& config = *__PROXY_GLOBALS__::PROXY_CONFIG;
+        if(direction == User_traffic_manager::Direction::upload && config.max_upload_bandwidth_per_sec > 0)
+            return config.max_upload_bandwidth_per_sec;
+        return config.max_bandwidth_per_sec;
+    }
+
+    std::uint64_t mix(std::uint64_t value) // splitmix64: младшие биты хеша зависят от всех бит адреса
+    {
+        value += 0x9e3779b97f4a7c15ull;
+        value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ull;
+        value = (value ^ (value >> 27)) * 0x94d049bb133111ebull;
+        return value ^ (value >> 31);
+    }
+}
+
+Ip_key Ip_key::from_address(const boost::asio::ip::address& address)
+{
+    Ip_key key;
+    if(address.is_v4())
+    {
+        key.low = 0x0000ffff00000000ull | address.to_v4().to_uint();
+        return key;
+    }
+    auto bytes = address.to_v6().to_bytes();
+    for(std::size_t i = 0; i < 8; i++)
+    {
+        key.high = (key.high << 8) | bytes[i];
+        key.low = (key.low << 8) | bytes[i + 8];
+    }
+    return key;
+}
+
+std::size_t Ip_key_hash::operator()(const Ip_key& key) const noexcept
+{
+    return mix(key.high ^ mix(key.low));
+}
+
+template<typename Key, typename Hash>
+std::shared_ptr<Traffic_limiter> Limiter_table<Key, Hash>::get_or_create(const Key& key, std::size_t direction,
+int64_t bytes_per_sec, Factory factory)
+{
+    auto hash = Hash{}(key);
+    auto& shard = shards_[mix(hash) % SHARDS]; // mix - чтобы шард не совпадал с бакетом внутри шарда
+    std::lock_guard lock(shard.mutex);
+    auto& entry = shard.entries[key];
+    if(auto limiter = entry.limiters[direction].lock())
+        return limiter;
+    auto limiter = factory(bytes_per_sec);
+    entry.limiters[direction] = limiter;
+    if(shard.entries.size() >= shard.sweep_at) // одноразовые клиенты не копятся: шард чистится, когда вырос вдвое
+    {
+        sweep_shard(shard);
+        shard.sweep_at = std::max(MIN_SWEEP_SIZE, shard.entries.size() * 2);
     }
-    auto limiter = std::make_shared<Traffic_limiter>(__PROXY_GLOBALS__::PROXY_CONFIG.max_bandwidth_per_sec);
-    users_.emplace(ip, limiter);
     return limiter;
 }
 
+template<typename Key, typename Hash>
+std::size_t Limiter_table<Key, Hash>::sweep_shard(Shard& shard)
+{
+    std::size_t removed = 0;
+    for(auto it = shard.entries.begin(); it != shard.entries.end();)
+    {
+        bool alive = false;
+        for(const auto& limiter : it->second.limiters)
+            alive = alive || !limiter.expired();
+        if(alive)
+            ++it;
+        else
+        {
+            it = shard.entries.erase(it);
+            removed++;
+        }
+    }
+    return removed;
+}
+
+template<typename Key, typename Hash>
+std::size_t Limiter_table<Key, Hash>::sweep()
+{
+    std::size_t removed = 0;
+    for(auto& shard : shards_)
+    {
+        std::lock_guard lock(shard.mutex);
+        removed += sweep_shard(shard);
+        shard.sweep_at = std::max(MIN_SWEEP_SIZE, shard.entries.size() * 2);
+    }
+    return removed;
+}
+
+template<typename Key, typename Hash>
+std::size_t Limiter_table<Key, Hash>::size() const
+{
+    std::size_t total = 0;
+    for(const auto& shard : shards_)
+    {
+        std::lock_guard lock(shard.mutex);
+        total += shard.entries.size();
+    }
+    return total;
+}
+
+template class Limiter_table<Ip_key, Ip_key_hash>;
+template class Limiter_table<std::string>;
+
+std::shared_ptr<Traffic_limiter> User_traffic_manager::get_or_create_user(const boost::asio::ip::address& address, Direction direction)
+{
+    if(user_rate(direction) <= 0) // уровень пользователя выключен (лимитер со скоростью 0 остановил бы весь трафик)
+        return nullptr;
+    return users_.get_or_create(Ip_key::from_address(address), index(direction), user_rate(direction), create_limiter);
+}
+
+std::shared_ptr<Traffic_limiter> User_traffic_manager::get_or_create_user(const std::string& ip, Direction direction)
+{
+    boost::system::error_code ec;
+    auto address = boost::asio::ip::make_address(ip, ec);
+    if(!ec)
+        return get_or_create_user(address, direction);
+    if(user_rate(direction) <= 0)
+        return nullptr;
+    return named_users_.get_or_create(ip, index(direction), user_rate(direction), create_limiter);
+}
+
+std::shared_ptr<Traffic_limiter> User_traffic_manager::get_or_create_destination(const std::string& host, Direction direction)
+{
+    auto bytes_per_sec = __PROXY_GLOBALS__::PROXY_CONFIG->destination_bandwidth_per_sec;
+    if(bytes_per_sec <= 0)
+        return nullptr;
+    return destinations_.get_or_create(host, index(direction), bytes_per_sec, create_limiter);
+}
+
+std::shared_ptr<Traffic_limiter> User_traffic_manager::global(Direction direction) const
+{
+    return global_[index(direction)];
+}
+
+std::shared_ptr<Traffic_limiter> User_traffic_manager::make_connection_limiter() const
+{
+    return make_limiter(__PROXY_GLOBALS__::PROXY_CONFIG->connection_bandwidth_per_sec);
+}
+
+Limiter_chain User_traffic_manager::make_chain(const boost::asio::ip::address& address, const std::string& host, Direction direction,
+std::shared_ptr<Traffic_limiter> connection_limiter)
+{
+    // от частного к общему: пока соеденение ждет свой лимит, токены общих уровней не заняты
+    Limiter_chain chain;
+    chain.set_flow(Ip_key_hash{}(Ip_key::from_address(address))); // при нехватке общие уровни делятся поровну между пользователями
+    chain.add(std::move(connection_limiter));
+    if(!host.empty())
+        chain.add(get_or_create_destination(host, direction));
+    chain.add(get_or_create_user(address, direction));
+    chain.add(global(direction));
+    const auto& metrics = __PROXY_GLOBALS__::METRICS;
+    if(direction == Direction::upload)
+        chain.set_counters(metrics.bytes_upload, metrics.throttled_upload);
+    else
+        chain.set_counters(metrics.bytes_download, metrics.throttled_download);
+    return chain;
+}
+
+std::size_t User_traffic_manager::sweep()
+{
+    return users_.sweep() + named_users_.sweep() + destinations_.sweep();
+}
+
+std::size_t User_traffic_manager::users() const
+{
+    return users_.size() + named_users_.size();
+}
+
 User_traffic_manager::User_traffic_manager()
-{}
+{
+    global_[index(Direction::upload)] = make_limiter(__PROXY_GLOBALS__::PROXY_CONFIG->global_upload_bandwidth_per_sec);
+    global_[index(Direction::download)] = make_limiter(__PROXY_GLOBALS__::PROXY_CONFIG->global_download_bandwidth_per_sec);
+}
 
 User_traffic_manager::~User_traffic_manager()
-{}
\ No newline at end of file
+{}
@@ -0,0 +1,44 @@
+#include "utils/async_waiter.hpp"
+
+Async_waiter::Async_waiter(const boost::asio::any_io_executor& executor)
+: timer_(executor), notified_(false)
+{}
+
+boost::asio::awaitable<void> Async_waiter::wait()
+{
+    while(!notified_.load())
+    {
+        boost::system::error_code ec;
+        timer_.expires_at(boost::asio::steady_timer::time_point::max());
+        co_await timer_.async_wait(boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+    }
+}
+
+boost::asio::awaitable<bool> Async_waiter::wait(std::chrono::steady_clock::duration timeout)
+{
+    timer_.expires_after(timeout);
+    while(!notified_.load())
+    {
+        boost::system::error_code ec;
+        co_await timer_.async_wait(boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+        if(!ec) // таймер истек сам, а не отменен notify
+            co_return notified_.load();
+    }
+    co_return true;
+}
+
+void Async_waiter::notify()
+{
+    notified_.store(true);
+    // отмена таймера выполняется в потоке ожидающей корутины, к этому моменту она уже точно в async_wait
+    auto self = shared_from_this();
+    boost::asio::post(timer_.get_executor(), [self]()
+    {
+        self->timer_.cancel();
+    });
+}
+
+bool Async_waiter::is_notified() const
+{
+    return notified_.load();
+}
@@ -0,0 +1,81 @@
+#include "utils/buffer_pool.hpp"
+#include "network/tunnel.hpp"
+#include <utility>
+
+Buffer_pool::Buffer::Buffer(std::shared_ptr<Buffer_pool> pool, char* data)
+: pool_(std::move(pool)), data_(data)
+{}
+
+Buffer_pool::Buffer::Buffer(Buffer&& other) noexcept
+: pool_(std::move(other.pool_)), data_(std::exchange(other.data_, nullptr))
+{}
+
+Buffer_pool::Buffer& Buffer_pool::Buffer::operator=(Buffer&& other) noexcept
+{
+    if(this != &other)
+    {
+        release();
+        pool_ = std::move(other.pool_);
+        data_ = std::exchange(other.data_, nullptr);
+    }
+    return *this;
+}
+
+Buffer_pool::Buffer::~Buffer()
+{
+    release();
+}
+
+std::size_t Buffer_pool::Buffer::size() const
+{
+    return pool_ ? pool_->buffer_size() : 0;
+}
+
+void Buffer_pool::Buffer::release()
+{
+    if(pool_ && data_)
+        pool_->release(data_);
+    data_ = nullptr;
+    pool_.reset();
+}
+
+Buffer_pool::Buffer_pool(std::size_t buffer_size, std::size_t max_cached)
+: buffer_size_(buffer_size), max_cached_(max_cached), outstanding_(0)
+{
+    free_.reserve(max_cached_);
+}
+
+Buffer_pool::~Buffer_pool()
+{
+    for(auto i : free_)
+        delete[] i;
+}
+
+const std::shared_ptr<Buffer_pool>& Buffer_pool::local()
+{
+    thread_local auto pool = std::make_shared<Buffer_pool>(TUNNEL_BUFFER_SIZE, 64); // до 1 мб свободных буферов на поток
+    return pool;
+}
+
+Buffer_pool::Buffer Buffer_pool::acquire()
+{
+    char* data;
+    if(!free_.empty())
+    {
+        data = free_.back();
+        free_.pop_back();
+    }
+    else
+        data = new char[buffer_size_];
+    outstanding_++;
+    return Buffer(shared_from_this(), data);
+}
+
+void Buffer_pool::release(char* data)
+{
+    outstanding_--;
+    if(free_.size() < max_cached_)
+        free_.push_back(data);
+    else
+        delete[] data;
+}
@@ -0,0 +1,14 @@
+#include "utils/coarse_clock.hpp"
+#ifdef __linux__
+#include <time.h>
+#endif
+
+Coarse_clock::time_point Coarse_clock::now() noexcept
+{
+#ifdef __linux__
+    timespec ts;
+    if(::clock_gettime(CLOCK_MONOTONIC_COARSE, &ts) == 0) // значение из vDSO, без системного вызова
+        return time_point(std::chrono::duration_cast<duration>(std::chrono::seconds(ts.tv_sec) + std::chrono::nanoseconds(ts.tv_nsec)));
+#endif
+    return std::chrono::steady_clock::now();
+}
@@ -0,0 +1,25 @@
+#include "utils/deadline.hpp"
+
+Deadline::Deadline(boost::asio::ip::tcp::socket& socket, std::chrono::milliseconds timeout)
+: executor_(socket.get_executor()), timer_(executor_, static_cast<std::size_t>(timeout.count())), expired_(false)
+{
+    timer_.set_callback_func([this, &socket]()
+    {
+        expired_ = true;
+        boost::system::error_code ec;
+        socket.cancel(ec);
+    });
+    timer_.start();
+}
+
+Deadline::~Deadline()
+{
+    // запись с колеса снимает деструктор Timer'а: stop здесь нельзя, корутина может уничтожаться
+    // вместе с io_context'ом вне его потока, а stop вне потока идет через post с shared_from_this
+}
+
+void Deadline::check(boost::system::error_code& ec) const
+{
+    if(expired_ && ec == boost::asio::error::operation_aborted)
+        ec = boost::asio::error::timed_out;
+}
@@ -0,0 +1,94 @@
+#include "utils/recycling_allocator.hpp"
+#include <array>
+#include <bit>
+#include <new>
+#include <vector>
+
+namespace
+{
+    constexpr std::size_t MIN_BLOCK_SIZE = 16;
+    constexpr std::size_t MAX_BLOCK_SIZE = 4096;
+    constexpr std::size_t CLASSES_COUNT = 9; // 16, 32, ..., 4096
+    constexpr std::size_t MAX_CACHED_PER_CLASS = 1024; // сколько свободных блоков одного размера держит поток
+
+    struct Free_lists
+    {
+        std::array<std::vector<void*>, CLASSES_COUNT> lists;
+
+        ~Free_lists();
+    };
+
+    thread_local bool destroyed = false; // тривиальный thread_local доступен и после уничтожения Free_lists
+
+    Free_lists& free_lists()
+    {
+        thread_local Free_lists instance;
+        return instance;
+    }
+
+    Free_lists::~Free_lists()
+    {
+        destroyed = true;
+        for(auto& list : lists)
+            for(auto pointer : list)
+                ::operator delete(pointer);
+    }
+
+    std::size_t size_class(std::size_t size) // индекс класса размера
+    {
+        return std::bit_width(std::max(size, MIN_BLOCK_SIZE) - 1) - std::bit_width(MIN_BLOCK_SIZE - 1);
+    }
+}
+
+void* Recycling_pool::allocate(std::size_t size)
+{
+    if(size > MAX_BLOCK_SIZE || destroyed)
+        return ::operator new(size);
+    auto index = size_class(size);
+    auto& list = free_lists().lists[index];
+    if(!list.empty())
+    {
+        auto pointer = list.back();
+        list.pop_back();
+        return pointer;
+    }
+    return ::operator new(MIN_BLOCK_SIZE << index);
+}
+
+void Recycling_pool::deallocate(void* pointer, std::size_t size)
+{
+    if(size > MAX_BLOCK_SIZE || destroyed)
+    {
+        ::operator delete(pointer);
+        return;
+    }
+    auto& list = free_lists().lists[size_class(size)];
+    if(list.size() >= MAX_CACHED_PER_CLASS)
+    {
+        ::operator delete(pointer);
+        return;
+    }
+    list.push_back(pointer);
+}
+
+std::size_t Recycling_pool::cached()
+{
+    if(destroyed)
+        return 0;
+    std::size_t count = 0;
+    for(const auto& list : free_lists().lists)
+        count += list.size();
+    return count;
+}
+
+void Recycling_pool::clear()
+{
+    if(destroyed)
+        return;
+    for(auto& list : free_lists().lists)
+    {
+        for(auto pointer : list)
+            ::operator delete(pointer);
+        list.clear();
+    }
+}
@@ -0,0 +1,160 @@
+#include "utils/reload_trigger.hpp"
+#include <csignal>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <sys/inotify.h>
+
+Reload_trigger::Reload_trigger()
+: signals_(context_), inotify_(context_), debounce_timer_(context_), debounce_(0)
+{}
+
+Reload_trigger::~Reload_trigger()
+{
+    stop();
+}
+
+void Reload_trigger::start(const std::vector<std::string>& files, Handler handler, std::chrono::milliseconds debounce, bool sighup)
+{
+    stop();
+    handler_ = std::move(handler);
+    debounce_ = debounce;
+    context_.restart();
+    int fd = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if(fd < 0)
+        std::cerr << "Error: inotify is unavailable, configuration reloads only on SIGHUP: " << std::strerror(errno) << std::endl;
+    else
+    {
+        inotify_.assign(fd);
+        update_watches(files);
+        boost::asio::co_spawn(context_, read_events(), boost::asio::detached);
+    }
+    if(sighup)
+    {
+        signals_.add(SIGHUP);
+        boost::asio::co_spawn(context_, wait_signals(), boost::asio::detached);
+    }
+    thread_ = std::thread([this]()
+    {
+        try
+        {
+            context_.run();
+        }
+        catch(const std::exception& ex)
+        {
+            std::cerr << "\n!!!EXCEPTION IN RELOAD THREAD: " << ex.what() << "!!!\n";
+        }
+    });
+}
+
+void Reload_trigger::stop()
+{
+    if(!thread_.joinable())
+        return;
+    context_.stop();
+    thread_.join();
+    boost::system::error_code ec;
+    signals_.cancel(ec);
+    signals_.clear(ec);
+    inotify_.close(ec);
+    debounce_timer_.expires_at(std::chrono::steady_clock::time_point::min()); // запланированная перезагрузка не выполнится
+    directories_.clear();
+    files_.clear();
+    pending_ = false;
+}
+
+void Reload_trigger::watch(const std::vector<std::string>& files)
+{
+    boost::asio::post(context_, [this, files]()
+    {
+        update_watches(files);
+    });
+}
+
+void Reload_trigger::update_watches(const std::vector<std::string>& files)
+{
+    if(!inotify_.is_open())
+        return;
+    for(auto& [descriptor, directory] : directories_)
+        ::inotify_rm_watch(inotify_.native_handle(), descriptor);
+    directories_.clear();
+    files_.clear();
+    for(const auto& file : files)
+    {
+        auto path = std::filesystem::absolute(file).lexically_normal();
+        files_.insert(path.string());
+        auto directory = path.parent_path().string();
+        // закрытие после записи и переименование в каталог (атомарная замена файла)
+        int descriptor = ::inotify_add_watch(inotify_.native_handle(), directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+        if(descriptor < 0)
+            std::cerr << "Error: cannot watch " << directory << ": " << std::strerror(errno) << std::endl;
+        else
+            directories_[descriptor] = directory;
+    }
+}
+
+boost::asio::awaitable<void> Reload_trigger::read_events()
+{
+    alignas(inotify_event) char buffer[4096];
+    while(true)
+    {
+        boost::system::error_code ec;
+        auto size = co_await inotify_.async_read_some(boost::asio::buffer(buffer), boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+        if(ec)
+            co_return;
+        for(std::size_t offset = 0; offset + sizeof(inotify_event) <= size;)
+        {
+            auto event = reinterpret_cast<const inotify_event*>(buffer + offset);
+            offset += sizeof(inotify_event) + event->len;
+            auto directory = directories_.find(event->wd);
+            if(event->len == 0 || directory == directories_.end())
+                continue;
+            if(files_.count(directory->second + "/" + event->name))
+                schedule();
+        }
+    }
+}
+
+boost::asio::awaitable<void> Reload_trigger::wait_signals()
+{
+    while(true)
+    {
+        boost::system::error_code ec;
+        co_await signals_.async_wait(boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+        if(ec)
+            co_return;
+        schedule();
+    }
+}
+
+void Reload_trigger::schedule()
+{
+    debounce_timer_.expires_after(debounce_); // отменяет ожидание, если перезагрузка уже запланирована
+    if(pending_)
+        return;
+    pending_ = true;
+    boost::asio::co_spawn(context_, fire_after_debounce(), boost::asio::detached);
+}
+
+boost::asio::awaitable<void> Reload_trigger::fire_after_debounce()
+{
+    while(true)
+    {
+        boost::system::error_code ec;
+        co_await debounce_timer_.async_wait(boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+        if(!ec)
+            break;
+        if(debounce_timer_.expiry() <= std::chrono::steady_clock::now()) // отменили не продлением, а остановкой
+            co_return;
+    }
+    pending_ = false;
+    triggers_++;
+    try
+    {
+        handler_();
+    }
+    catch(const std::exception& ex)
+    {
+        std::cerr << "Error: configuration reload failed: " << ex.what() << std::endl;
+    }
+}
@@ -1,16 +1,49 @@
 #include "utils/timer.hpp"
 #include <chrono>
 
+namespace
+{
+    // интервал в мс -> тики колеса: с округлением вверх и еще один тик, т.к. тик активности уже мог частично пройти
+    std::uint64_t to_ticks(std::size_t interval)
+    {
+        auto tick = static_cast<std::size_t>(Timing_wheel::TICK.count());
+        return (interval + tick - 1) / tick + 1;
+    }
+}
+
 Timer::Timer(boost::asio::any_io_executor& executor, std::size_t interval)
-: timer_(executor), interval_(interval), is_running_(false)
+: Timing_wheel::Entry(to_ticks(interval)),
+executor_(static_cast<boost::asio::io_context&>(boost::asio::query(executor, boost::asio::execution::context)).get_executor()),
+wheel_(Timing_wheel::of(executor)), is_running_(false)
 {}
 
+Timer::~Timer()
+{
+    if(is_scheduled()) // после остановки io_context'а колесо уже сняло все записи
+        wheel_.cancel(*this);
+}
+
+template<typename Function>
+void Timer::run_on_wheel(Function function)
+{
+    if(executor_.running_in_this_thread())
+    {
+        function(*this);
+        return;
+    }
+    boost::asio::post(executor_, [self = shared_from_this(), function]() mutable {function(*self);});
+}
+
 void Timer::start()
 {
-    if(is_running_)
+    if(is_running_.exchange(true))
         return;
-    is_running_ = true;
-    arm();
+    touch(Timing_wheel::precise_now()); // точный старт: таймер не срабатывает раньше интервала
+    run_on_wheel([](Timer& timer)
+    {
+        if(timer.is_running_) // stop мог успеть раньше post'а
+            timer.wheel_.schedule(timer);
+    });
 }
 
 void Timer::refresh()
@@ -18,13 +51,17 @@ void Timer::refresh()
     if(!is_running_)
         start();
     else
-        arm();
+        touch(); // запись в колесе переставится, когда до нее дойдет очередь
 }
 
 void Timer::stop()
 {
     is_running_ = false;
-    timer_.cancel();
+    run_on_wheel([](Timer& timer)
+    {
+        if(!timer.is_running_) // start мог успеть раньше post'а
+            timer.wheel_.cancel(timer);
+    });
 }
 
 void Timer::set_callback_func(std::function<void()> func)
@@ -32,14 +69,11 @@ void Timer::set_callback_func(std::function<void()> func)
     callback_ = (std::move(func));
 }
 
-void Timer::arm()
+void Timer::expire()
 {
-    timer_.cancel();
-    timer_.expires_after(std::chrono::milliseconds(interval_));
-    auto self = shared_from_this();
-    timer_.async_wait([self](const boost::system::error_code& ec)
-    {
-        if(!ec && self->is_running_ && self->callback_)
-            self->callback_();
-    });
-}
\ No newline at end of file
+    if(!is_running_.exchange(false))
+        return;
+    auto self = weak_from_this().lock(); // callback может отпустить последнюю ссылку на таймер
+    if(callback_)
+        callback_();
+}
@@ -0,0 +1,193 @@
+#include "utils/timing_wheel.hpp"
+#include "utils/coarse_clock.hpp"
+#include <bit>
+
+boost::asio::execution_context::id Timing_wheel::id;
+
+namespace
+{
+    std::uint64_t to_tick(std::chrono::steady_clock::duration since_epoch)
+    {
+        return static_cast<std::uint64_t>(since_epoch / Timing_wheel::TICK);
+    }
+}
+
+std::uint64_t Timing_wheel::now() noexcept
+{
+    return to_tick(Coarse_clock::now().time_since_epoch());
+}
+
+std::uint64_t Timing_wheel::precise_now() noexcept
+{
+    return to_tick(std::chrono::steady_clock::now().time_since_epoch());
+}
+
+Timing_wheel::Timing_wheel(boost::asio::io_context& context)
+: boost::asio::execution_context::service(context), timer_(context)
+{}
+
+Timing_wheel& Timing_wheel::of(const boost::asio::any_io_executor& executor)
+{
+    auto& context = boost::asio::query(executor, boost::asio::execution::context);
+    return boost::asio::use_service<Timing_wheel>(static_cast<boost::asio::io_context&>(context));
+}
+
+void Timing_wheel::schedule(Entry& entry)
+{
+    if(entry.is_scheduled())
+        return;
+    if(size_ == 0 && !advancing_) // колесо стояло, current_ мог сильно отстать
+        current_ = precise_now();
+    insert(entry, entry.last_activity_.load(std::memory_order_relaxed) + entry.interval_);
+    size_++;
+    rearm();
+}
+
+void Timing_wheel::cancel(Entry& entry)
+{
+    if(!entry.is_scheduled())
+        return;
+    unlink(entry);
+    size_--;
+    if(size_ == 0 && armed_) // иначе пустое колесо держало бы io_context::run() до срока будильника
+    {
+        armed_ = false;
+        timer_.cancel();
+    }
+}
+
+void Timing_wheel::insert(Entry& entry, std::uint64_t expiry)
+{
+    auto delta = expiry > current_ ? expiry - current_ : 0;
+    constexpr auto max_delta = (std::uint64_t(1) << (SLOT_BITS * LEVELS)) - 1;
+    if(delta > max_delta) // дальше последнего уровня: запись переставится, когда до нее дойдет очередь
+    {
+        delta = max_delta;
+        expiry = current_ + delta;
+    }
+    std::size_t level = 0;
+    while(level + 1 < LEVELS && delta >= (std::uint64_t(1) << (SLOT_BITS * (level + 1))))
+        level++;
+    auto slot = static_cast<std::uint16_t>(level * SLOTS + ((expiry >> (SLOT_BITS * level)) & (SLOTS - 1)));
+    auto& head = slots_[slot];
+    entry.next_ = head;
+    if(head)
+        head->pprev_ = &entry.next_;
+    entry.pprev_ = &head;
+    entry.slot_ = slot;
+    head = &entry;
+    occupied_[level] |= std::uint64_t(1) << (slot % SLOTS);
+}
+
+void Timing_wheel::unlink(Entry& entry)
+{
+    *entry.pprev_ = entry.next_;
+    if(entry.next_)
+        entry.next_->pprev_ = entry.pprev_;
+    if(entry.slot_ != DETACHED && !slots_[entry.slot_])
+        occupied_[entry.slot_ / SLOTS] &= ~(std::uint64_t(1) << (entry.slot_ % SLOTS));
+    entry.next_ = nullptr;
+    entry.pprev_ = nullptr;
+}
+
+void Timing_wheel::process(std::uint64_t tick)
+{
+    current_ = tick;
+    for(std::size_t level = LEVELS; level-- > 0;)
+    {
+        if(level > 0 && (tick & ((std::uint64_t(1) << (SLOT_BITS * level)) - 1)) != 0)
+            continue; // тик не на границе слота этого уровня
+        auto slot = level * SLOTS + ((tick >> (SLOT_BITS * level)) & (SLOTS - 1));
+        if(!slots_[slot])
+            continue;
+        // список снимается целиком: callback'и могут снимать и уничтожать другие записи этого же слота
+        Entry* detached = slots_[slot];
+        slots_[slot] = nullptr;
+        occupied_[level] &= ~(std::uint64_t(1) << (slot % SLOTS));
+        detached->pprev_ = &detached;
+        for(auto* entry = detached; entry; entry = entry->next_)
+            entry->slot_ = DETACHED;
+        while(detached)
+        {
+            auto& entry = *detached;
+            unlink(entry);
+            auto expiry = entry.last_activity_.load(std::memory_order_relaxed) + entry.interval_;
+            if(expiry > tick) // была активность после постановки (или каскад с верхнего уровня)
+            {
+                insert(entry, expiry);
+                continue;
+            }
+            size_--;
+            entry.expire();
+        }
+    }
+}
+
+bool Timing_wheel::next_due(std::uint64_t& tick) const
+{
+    bool found = false;
+    for(std::size_t level = 0; level < LEVELS; level++)
+    {
+        if(!occupied_[level])
+            continue;
+        auto shift = SLOT_BITS * level;
+        auto base = (current_ >> shift) + 1; // ближайший еще не обработанный слот уровня
+        auto distance = std::countr_zero(std::rotr(occupied_[level], static_cast<int>(base & (SLOTS - 1))));
+        auto due = (base + distance) << shift;
+        if(!found || due < tick)
+            tick = due;
+        found = true;
+    }
+    return found;
+}
+
+void Timing_wheel::advance()
+{
+    auto now = precise_now();
+    std::uint64_t tick;
+    advancing_ = true;
+    while(next_due(tick) && tick <= now)
+        process(tick);
+    advancing_ = false;
+    if(now > current_)
+        current_ = now; // промежуточные тики пустые
+    rearm();
+}
+
+void Timing_wheel::rearm()
+{
+    std::uint64_t tick;
+    if(!next_due(tick))
+    {
+        if(armed_)
+        {
+            armed_ = false;
+            timer_.cancel();
+        }
+        return;
+    }
+    if(armed_ && armed_at_ <= tick) // будильник и так прозвенит не позже
+        return;
+    armed_ = true;
+    armed_at_ = tick;
+    timer_.expires_at(std::chrono::steady_clock::time_point(tick * std::chrono::duration_cast<std::chrono::steady_clock::duration>(TICK)));
+    timer_.async_wait([this](const boost::system::error_code& ec)
+    {
+        if(ec == boost::asio::error::operation_aborted) // будильник переставлен или колесо опустело
+            return;
+        armed_ = false;
+        advance();
+    });
+}
+
+void Timing_wheel::shutdown()
+{
+    for(auto& head : slots_)
+    {
+        while(head)
+            unlink(*head);
+    }
+    size_ = 0;
+    armed_ = false;
+    timer_.cancel();
+}
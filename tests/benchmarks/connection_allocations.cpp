@@ -0,0 +1,117 @@
+// кол-во malloc'ов прокси на одно соеденение в установившемся режиме (accept, запрос, ответ upstream'а, закрытие)
+// считаются только аллокации потока прокси: клиент и upstream работают в других потоках
+#include "network/server.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <string>
+#include <thread>
+
+namespace
+{
+    std::atomic<std::size_t> allocations{0}; // аллокации в потоке прокси
+
+    thread_local bool counted = false; // поток прокси
+}
+
+void* operator new(std::size_t size)
+{
+    if(counted)
+        allocations.fetch_add(1, std::memory_order_relaxed);
+    if(auto pointer = std::malloc(size ? size : 1))
+        return pointer;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* pointer) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete(void* pointer, std::size_t) noexcept
+{
+    std::free(pointer);
+}
+
+namespace
+{
+    // upstream отвечает на один запрос и закрывает соеденение
+    boost::asio::awaitable<void> serve_upstream(boost::asio::ip::tcp::acceptor& acceptor)
+    {
+        const std::string response = "HTTP/1.1 200 OK\r\nContent-Length: 2\r\nConnection: close\r\n\r\nok";
+        for(;;)
+        {
+            auto socket = co_await acceptor.async_accept(boost::asio::use_awaitable);
+            std::array<char, 1024> request;
+            boost::system::error_code ec;
+            co_await socket.async_read_some(boost::asio::buffer(request), boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+            co_await boost::asio::async_write(socket, boost::asio::buffer(response), boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+        }
+    }
+
+    // одно соеденение клиента через прокси (блокирующие сокеты в основном потоке)
+    bool request_once(boost::asio::io_context& context, unsigned short proxy_port, const std::string& request)
+    {
+        boost::asio::ip::tcp::socket client(context);
+        client.connect({boost::asio::ip::make_address("127.0.0.1"), proxy_port});
+        boost::asio::write(client, boost::asio::buffer(request));
+        std::array<char, 1024> response;
+        boost::system::error_code ec;
+        auto size = boost::asio::read(client, boost::asio::buffer(response), ec);
+        return std::string_view(response.data(), size).starts_with("HTTP/1.1 200");
+    }
+
+    void wait_sessions_closed(const Connection_gate& gate) // сессии прокси освобождаются уже после закрытия клиента
+    {
+        while(gate.active() > 0)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+int main(int argc, char** argv)
+{
+    std::size_t connections = argc > 1 ? std::stoull(argv[1]) : 1000;
+    std::size_t warmup = 100;
+
+    boost::asio::io_context upstream_context(1);
+    boost::asio::ip::tcp::acceptor upstream(upstream_context, {boost::asio::ip::make_address("127.0.0.1"), 0});
+    boost::asio::co_spawn(upstream_context, serve_upstream(upstream), boost::asio::detached);
+    std::thread upstream_thread([&]() {upstream_context.run();});
+
+    boost::asio::io_context proxy_context(1);
+    auto gate = std::make_shared<Connection_gate>(16);
+    boost::asio::ip::tcp::acceptor probe(proxy_context, {boost::asio::ip::make_address("127.0.0.1"), 0});
+    auto proxy_port = probe.local_endpoint().port();
+    probe.close();
+    auto server = std::make_shared<Server>(proxy_context, proxy_port, std::make_shared<User_traffic_manager>(), gate);
+    boost::asio::co_spawn(proxy_context, server->run(), boost::asio::detached);
+    std::thread proxy_thread([&]()
+    {
+        counted = true;
+        proxy_context.run();
+    });
+
+    boost::asio::io_context client_context(1);
+    auto target = "127.0.0.1:" + std::to_string(upstream.local_endpoint().port());
+    const std::string request = "GET http://" + target + "/ HTTP/1.1\r\nHost: " + target + "\r\nConnection: close\r\n\r\n";
+    std::size_t ok_responses = 0;
+    for(std::size_t i = 0; i < warmup; i++) // пулы и кеши прокси заполняются
+        ok_responses += request_once(client_context, proxy_port, request);
+    wait_sessions_closed(*gate);
+    auto start_allocations = allocations.load();
+    for(std::size_t i = 0; i < connections; i++)
+        ok_responses += request_once(client_context, proxy_port, request);
+    wait_sessions_closed(*gate);
+    auto per_connection = static_cast<double>(allocations.load() - start_allocations) / connections;
+
+    proxy_context.stop();
+    upstream_context.stop();
+    proxy_thread.join();
+    upstream_thread.join();
+
+    std::cout << "connections: " << connections << ", ok responses: " << ok_responses - warmup << "\n"
+    << "proxy allocations: " << per_connection << " per connection" << std::endl;
+    return ok_responses == warmup + connections ? 0 : 1;
+}
@@ -0,0 +1,98 @@
+// черный список на миллионах доменов: точный поиск в unordered_set (как было) против trie по меткам с фильтром
+// (trie еще и ловит поддомены), построение из правил против отображения скомпилированного файла
+#include "network/domain_matcher.hpp"
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+namespace
+{
+    std::size_t rss_kib() // резидентная память процесса
+    {
+        std::ifstream status("/proc/self/status");
+        std::string line;
+        while(std::getline(status, line))
+        {
+            if(line.starts_with("VmRSS:"))
+                return std::stoull(line.substr(6));
+        }
+        return 0;
+    }
+
+    std::string domain(std::uint64_t i) // похожие на реальные списки: много доменов второго уровня, часть поддоменов
+    {
+        static const char* zones[] = {"com", "net", "org", "ru", "info", "xyz", "io", "de"};
+        std::string name = "d" + std::to_string(i * 2654435761u % 100000007) + "." + zones[i % std::size(zones)];
+        if(i % 4 == 0)
+            name = "cdn" + std::to_string(i % 16) + "." + name;
+        return name;
+    }
+
+    template<typename Lookup>
+    double run(const std::vector<std::string>& hosts, Lookup lookup, std::size_t& found) // нс на один поиск
+    {
+        found = 0;
+        auto start = std::chrono::steady_clock::now();
+        for(const auto& host : hosts)
+            found += lookup(host);
+        return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / hosts.size();
+    }
+}
+
+int main(int argc, char** argv)
+{
+    std::size_t count = argc > 1 ? std::stoull(argv[1]) : 2000000;
+    std::size_t lookups = argc > 2 ? std::stoull(argv[2]) : 1000000;
+
+    std::vector<std::string> rules;
+    rules.reserve(count);
+    for(std::size_t i = 0; i < count; i++)
+        rules.push_back(domain(i));
+    std::vector<std::string> listed; // поддомены доменов из списка
+    std::vector<std::string> unlisted; // домены не из списка (обычный трафик)
+    std::mt19937_64 random(42);
+    for(std::size_t i = 0; i < lookups; i++)
+    {
+        listed.push_back("www." + rules[random() % count]);
+        unlisted.push_back(domain(count + random() % count));
+    }
+
+    auto before = rss_kib();
+    std::unordered_set<std::string> legacy(rules.begin(), rules.end());
+    auto legacy_kib = rss_kib() - before;
+    std::size_t legacy_found = 0;
+    auto legacy_ns = run(unlisted, [&](const std::string& host) {return legacy.count(host);}, legacy_found);
+    legacy.clear();
+    legacy.rehash(0);
+
+    Domain_matcher matcher;
+    auto build_start = std::chrono::steady_clock::now();
+    matcher.build(rules);
+    auto build_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - build_start).count();
+    std::size_t listed_found = 0;
+    std::size_t unlisted_found = 0;
+    auto listed_ns = run(listed, [&](const std::string& host) {return matcher.matches(host);}, listed_found);
+    auto unlisted_ns = run(unlisted, [&](const std::string& host) {return matcher.matches(host);}, unlisted_found);
+
+    const std::string file = "domain_matcher_benchmark.bin";
+    matcher.save(file);
+    Domain_matcher mapped;
+    auto load_start = std::chrono::steady_clock::now();
+    mapped.load(file);
+    auto load_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - load_start).count();
+    std::size_t mapped_found = 0;
+    auto mapped_ns = run(unlisted, [&](const std::string& host) {return mapped.matches(host);}, mapped_found);
+    std::remove(file.c_str());
+
+    std::cout << "rules: " << count << ", lookups: " << lookups << "\n"
+    << "unordered_set:       " << legacy_ns << " ns/lookup (not listed), " << legacy_kib / 1024 << " MiB\n"
+    << "label trie + filter: " << unlisted_ns << " ns/lookup (not listed, false positives: " << unlisted_found << "), "
+    << listed_ns << " ns/lookup (subdomain of listed, blocked: " << listed_found << "), "
+    << matcher.memory_bytes() / (1024 * 1024) << " MiB, " << matcher.nodes() << " nodes\n"
+    << "startup: build " << build_ms << " ms, load compiled " << load_ms << " ms (" << mapped_ns << " ns/lookup mapped)" << std::endl;
+}
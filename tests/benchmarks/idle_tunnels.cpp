@@ -0,0 +1,115 @@
+// память на простаивающие туннели: поднимается N туннелей (по 2 направления copy_transfer), ни один не передает данных,
+// на выходе - прирост RSS на туннель; режим legacy держит буфер в кадре корутины, как было раньше
+#include "network/tunnel.hpp"
+#include "utils/timer.hpp"
+#include <boost/asio.hpp>
+#include <sys/resource.h>
+#include <array>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace
+{
+    std::size_t rss_kilobytes()
+    {
+        std::ifstream status("/proc/self/status");
+        std::string line;
+        while(std::getline(status, line))
+        {
+            if(line.rfind("VmRSS:", 0) == 0)
+                return std::stoull(line.substr(6));
+        }
+        return 0;
+    }
+
+    // старая схема: буфер живет в кадре корутины все время жизни туннеля
+    boost::asio::awaitable<void> legacy_transfer(boost::asio::ip::tcp::socket& input, boost::asio::ip::tcp::socket& output,
+    Limiter_chain&, Timer&, const std::atomic_bool&, std::uint64_t&, boost::system::error_code& ec)
+    {
+        std::array<char, TUNNEL_BUFFER_SIZE> buffer;
+        for(;;)
+        {
+            auto bytes = co_await input.async_read_some(boost::asio::buffer(buffer), boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+            if(ec)
+                co_return;
+            co_await boost::asio::async_write(output, boost::asio::buffer(buffer.data(), bytes), boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+            if(ec)
+                co_return;
+        }
+    }
+
+    struct Idle_tunnel // 2 пары сокетов: клиент <-> прокси <-> сервер
+    {
+        explicit Idle_tunnel(boost::asio::io_context& context)
+        : client(context), client_side(context), upstream(context), server(context)
+        {}
+
+        boost::asio::ip::tcp::socket client, client_side, upstream, server;
+    };
+}
+
+int main(int argc, char** argv)
+{
+    std::size_t tunnels = argc > 1 ? std::stoull(argv[1]) : 100000;
+    bool legacy = argc > 2 && std::string(argv[2]) == "legacy";
+
+    rlimit limit{};
+    getrlimit(RLIMIT_NOFILE, &limit);
+    limit.rlim_cur = limit.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &limit);
+    if(limit.rlim_cur < tunnels * 4 + 64)
+    {
+        tunnels = (limit.rlim_cur - 64) / 4;
+        std::cerr << "WARNING: RLIMIT_NOFILE allows only " << tunnels << " tunnels" << std::endl;
+    }
+
+    try
+    {
+        boost::asio::io_context context(1);
+        boost::asio::any_io_executor executor = context.get_executor();
+        boost::asio::ip::tcp::acceptor acceptor(context, {boost::asio::ip::make_address("127.0.0.1"), 0});
+        acceptor.listen(4096);
+        Limiter_chain limiter{std::make_shared<Traffic_limiter>(1024 * 1024)};
+        auto timer = std::make_shared<Timer>(executor, 3600 * 1000);
+        std::atomic_bool finished = false;
+        std::uint64_t transferred = 0;
+        auto transfer = legacy ? legacy_transfer : copy_transfer;
+        std::vector<std::unique_ptr<Idle_tunnel>> idle;
+        idle.reserve(tunnels);
+
+        // сокеты создаются до замера, чтобы в приросте RSS остались только корутины и буферы
+        for(std::size_t i = 0; i < tunnels; i++)
+        {
+            auto& tunnel = *idle.emplace_back(std::make_unique<Idle_tunnel>(context));
+            tunnel.client.connect(acceptor.local_endpoint());
+            tunnel.client_side = acceptor.accept();
+            tunnel.upstream.connect(acceptor.local_endpoint());
+            tunnel.server = acceptor.accept();
+        }
+        auto before = rss_kilobytes();
+        for(auto& i : idle)
+        {
+            auto errors = std::make_shared<std::array<boost::system::error_code, 2>>();
+            boost::asio::co_spawn(context, transfer(i->client_side, i->upstream, limiter, *timer, finished, transferred, (*errors)[0]),
+            [errors](std::exception_ptr){});
+            boost::asio::co_spawn(context, transfer(i->upstream, i->client_side, limiter, *timer, finished, transferred, (*errors)[1]),
+            [errors](std::exception_ptr){});
+        }
+        context.run_for(std::chrono::seconds(1)); // все корутины доходят до ожидания данных
+        auto after = rss_kilobytes();
+
+        std::cout << "mode " << (legacy ? "legacy" : "pooled") << "\n";
+        std::cout << "tunnels " << tunnels << "\n";
+        std::cout << "rss_delta_kb " << after - before << "\n";
+        std::cout << "bytes_per_tunnel " << (after - before) * 1024.0 / tunnels << std::endl;
+        timer->stop();
+    }
+    catch(const std::exception& ex)
+    {
+        std::cerr << "Benchmark error: " << ex.what() << std::endl;
+        return 1;
+    }
+}
@@ -0,0 +1,86 @@
+// черный список адресов на сотнях тысяч префиксов: по хеш таблице на каждую длину префикса (поиск от длинных к коротким)
+// против multibit trie с корнем на 16 бит и сжатыми уровнями по 8 бит
+#include "network/ip_matcher.hpp"
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+namespace
+{
+    std::size_t rss_kib() // резидентная память процесса
+    {
+        std::ifstream status("/proc/self/status");
+        std::string line;
+        while(std::getline(status, line))
+        {
+            if(line.starts_with("VmRSS:"))
+                return std::stoull(line.substr(6));
+        }
+        return 0;
+    }
+
+    template<typename Lookup>
+    double run(const std::vector<std::uint32_t>& addresses, Lookup lookup, std::size_t& found) // нс на один поиск
+    {
+        found = 0;
+        auto start = std::chrono::steady_clock::now();
+        for(auto address : addresses)
+            found += lookup(address);
+        return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / addresses.size();
+    }
+}
+
+int main(int argc, char** argv)
+{
+    std::size_t count = argc > 1 ? std::stoull(argv[1]) : 300000;
+    std::size_t lookups = argc > 2 ? std::stoull(argv[2]) : 1000000;
+
+    // похоже на списки вроде FireHOL: в основном /24 и отдельные адреса, немного крупных сетей
+    std::mt19937 random(42);
+    std::vector<std::pair<std::uint32_t, unsigned>> prefixes;
+    std::vector<std::string> rules;
+    for(std::size_t i = 0; i < count; i++)
+    {
+        auto kind = random() % 10;
+        unsigned length = kind < 5 ? 24 : kind < 8 ? 32 : 12 + random() % 12;
+        std::uint32_t address = static_cast<std::uint32_t>(random()) & (~std::uint32_t(0) << (32 - length));
+        prefixes.emplace_back(address, length);
+        rules.push_back(boost::asio::ip::address_v4(address).to_string() + "/" + std::to_string(length));
+    }
+    std::vector<std::uint32_t> addresses;
+    for(std::size_t i = 0; i < lookups; i++)
+        addresses.push_back(static_cast<std::uint32_t>(random()));
+
+    auto before = rss_kib();
+    std::vector<std::unordered_set<std::uint32_t>> by_length(33);
+    for(auto [address, length] : prefixes)
+        by_length[length].insert(address);
+    auto hash_kib = rss_kib() - before;
+    std::size_t hash_found = 0;
+    auto hash_ns = run(addresses, [&](std::uint32_t address)
+    {
+        for(int length = 32; length >= 0; length--)
+        {
+            if(!by_length[length].empty() && by_length[length].count(length ? address & (~std::uint32_t(0) << (32 - length)) : 0))
+                return true;
+        }
+        return false;
+    }, hash_found);
+    by_length.clear();
+
+    Ip_matcher matcher;
+    auto build_start = std::chrono::steady_clock::now();
+    matcher.build(rules);
+    auto build_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - build_start).count();
+    std::size_t trie_found = 0;
+    auto trie_ns = run(addresses, [&](std::uint32_t address) {return matcher.matches(boost::asio::ip::address_v4(address));}, trie_found);
+
+    std::cout << "prefixes: " << count << ", lookups: " << lookups << "\n"
+    << "hash per length: " << hash_ns << " ns/lookup, " << hash_kib / 1024 << " MiB, blocked: " << hash_found << "\n"
+    << "multibit trie:   " << trie_ns << " ns/lookup, " << matcher.memory_bytes() / (1024 * 1024) << " MiB, blocked: " << trie_found
+    << ", build " << build_ms << " ms" << std::endl;
+}
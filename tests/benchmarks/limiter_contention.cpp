@@ -0,0 +1,99 @@
+// конкуренция за лимитер одного пользователя: N потоков берут токены кусками по 16 кб из общего лимитера,
+// на выходе - млн операций acquire в секунду для старого лимитера на мьютексе, GCRA на атомике и GCRA с пачками
+#include "network/traffic_limiter.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    // лимитер до перехода на GCRA: мьютекс и steady_clock::now() на каждый вызов
+    class Mutex_limiter
+    {
+        public:
+            explicit Mutex_limiter(uint64_t bytes_per_sec)
+            : max_tokens_(bytes_per_sec * 1.5), tokens_(max_tokens_), rate_bytes_per_sec_(bytes_per_sec),
+            last_update_(std::chrono::steady_clock::now())
+            {}
+
+            std::size_t acquire(std::size_t want)
+            {
+                std::lock_guard lock(mutex_);
+                auto now = std::chrono::steady_clock::now();
+                auto elapsed = std::chrono::duration<double>(now - last_update_).count();
+                tokens_ = std::min(max_tokens_, tokens_ + static_cast<std::size_t>(elapsed * rate_bytes_per_sec_));
+                last_update_ = now;
+                std::size_t allowed = std::min(tokens_, want);
+                tokens_ -= allowed;
+                return allowed;
+            }
+
+        private:
+            std::size_t max_tokens_;
+            std::size_t tokens_;
+            double rate_bytes_per_sec_;
+            std::chrono::steady_clock::time_point last_update_;
+            std::mutex mutex_;
+    };
+
+    constexpr std::size_t CHUNK = 16384; // кусок одной записи в туннель
+    constexpr uint64_t RATE = 1ull << 40; // скорость, которую потоки не выбирают: меряется только синхронизация
+
+    template<typename Body>
+    double run(std::size_t threads, std::chrono::milliseconds duration, Body body)
+    {
+        std::atomic<bool> stop = false;
+        std::atomic<std::size_t> operations = 0;
+        std::vector<std::thread> workers;
+        for(std::size_t i = 0; i < threads; i++)
+        {
+            workers.emplace_back([&]()
+            {
+                std::size_t local = 0;
+                while(!stop.load(std::memory_order_relaxed))
+                {
+                    body();
+                    local++;
+                }
+                operations += local;
+            });
+        }
+        std::this_thread::sleep_for(duration);
+        stop = true;
+        for(auto& worker : workers)
+            worker.join();
+        return operations.load() / std::chrono::duration<double>(duration).count() / 1e6;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    std::size_t threads = argc > 1 ? std::stoull(argv[1]) : std::max(2u, std::thread::hardware_concurrency());
+    std::chrono::milliseconds duration(argc > 2 ? std::stoull(argv[2]) : 2000);
+
+    Mutex_limiter mutex_limiter(RATE);
+    auto mutex_rate = run(threads, duration, [&] {mutex_limiter.acquire(CHUNK);});
+
+    Traffic_limiter atomic_limiter(RATE);
+    auto atomic_rate = run(threads, duration, [&] {atomic_limiter.acquire(CHUNK);});
+
+    // как Token_batch в туннеле: лимитер трогается раз на TOKEN_BATCH_SIZE байт, остальное берется из локального запаса
+    Traffic_limiter batch_limiter(RATE);
+    auto batch_rate = run(threads, duration, [&]
+    {
+        thread_local std::size_t reserved = 0;
+        if(reserved < CHUNK)
+            reserved += batch_limiter.acquire(TOKEN_BATCH_SIZE);
+        reserved -= std::min(reserved, CHUNK);
+    });
+
+    std::cout << "threads: " << threads << "\n"
+    << "mutex:        " << mutex_rate << " M acquire/s\n"
+    << "atomic GCRA:  " << atomic_rate << " M acquire/s\n"
+    << "GCRA + batch: " << batch_rate << " M acquire/s" << std::endl;
+}
@@ -0,0 +1,78 @@
+// стоимость строки лога для потока воркера: N потоков пишут строки вида "New connection: <ip>"
+// старый путь (BOOST_LOG_TRIVIAL и flush core на каждый std::endl) против кольцевых буферов с фоновой записью
+#include "logger/logger.hpp"
+#include <chrono>
+#include <ctime>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    // путь до асинхронного логгера: запись и flush файла прямо в потоке воркера
+    void legacy_line(int thread, int line)
+    {
+        thread_local std::ostringstream stream;
+        stream << "New connection: 10.0." << thread << "." << line % 256;
+        BOOST_LOG_TRIVIAL(info) << stream.str();
+        stream.str("");
+        boost::log::core::get()->flush();
+    }
+
+    double thread_cpu_ns() // время CPU текущего потока (на малом кол-ве ядер фоновый поток не попадает в замер)
+    {
+        timespec time;
+        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time);
+        return time.tv_sec * 1e9 + time.tv_nsec;
+    }
+
+    template<typename Func>
+    double run(int threads, int lines, Func&& func) // нс CPU пишущего потока на строку
+    {
+        std::vector<std::thread> workers;
+        std::vector<double> spent(threads);
+        for(int t = 0; t < threads; t++)
+        {
+            workers.emplace_back([&func, &spent, t, lines]()
+            {
+                auto start = thread_cpu_ns();
+                for(int i = 0; i < lines; i++)
+                    func(t, i);
+                spent[t] = thread_cpu_ns() - start;
+            });
+        }
+        for(auto& worker : workers)
+            worker.join();
+        double total = 0;
+        for(auto i : spent)
+            total += i;
+        return total / threads / lines;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    int threads = argc > 1 ? std::stoi(argv[1]) : 4;
+    int lines = argc > 2 ? std::stoi(argv[2]) : 200000;
+    const std::string file = "logger_benchmark.log";
+
+    Logger logger;
+    logger.init_logger(file, 1024 * 1024 * 1024); // sink общий для обоих путей
+    logger.sync();
+    auto legacy_ns = run(threads, lines, legacy_line);
+    auto async_ns = run(threads, lines, [&logger](int thread, int line)
+    {
+        logger << "New connection: 10.0." << thread << "." << line % 256 << std::endl;
+    });
+    auto before_sync = std::chrono::steady_clock::now();
+    logger.sync();
+    auto sync_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - before_sync).count();
+
+    std::cout << "threads: " << threads << ", lines per thread: " << lines << "\n"
+    << "synchronous boost log: " << legacy_ns << " ns/line\n"
+    << "ring + writer thread:  " << async_ns << " ns/line (written " << logger.written()
+    << ", dropped " << logger.dropped() << ", writer caught up in " << sync_ms << " ms)" << std::endl;
+    std::filesystem::remove(file);
+}
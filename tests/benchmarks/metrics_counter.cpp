@@ -0,0 +1,53 @@
+// счетчик в горячем пути из нескольких потоков: общий std::atomic (fetch_add, одна кеш линия на всех)
+// против шардированного счетчика Metrics_registry (обычная запись в ячейку своего потока)
+#include "metrics/metrics_registry.hpp"
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    template<typename Increment>
+    double run(std::size_t threads_count, std::size_t per_thread, Increment increment) // нс на одно увеличение в потоке
+    {
+        std::atomic<bool> go{false};
+        std::vector<std::thread> threads;
+        for(std::size_t i = 0; i < threads_count; i++)
+        {
+            threads.emplace_back([&]()
+            {
+                while(!go.load())
+                    std::this_thread::yield();
+                for(std::size_t j = 0; j < per_thread; j++)
+                    increment();
+            });
+        }
+        auto start = std::chrono::steady_clock::now();
+        go = true;
+        for(auto& thread : threads)
+            thread.join();
+        return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / per_thread;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    std::size_t threads_count = argc > 1 ? std::stoull(argv[1]) : std::max(2u, std::thread::hardware_concurrency());
+    std::size_t per_thread = argc > 2 ? std::stoull(argv[2]) : 20000000;
+
+    alignas(64) std::atomic<std::uint64_t> shared{0};
+    auto shared_ns = run(threads_count, per_thread, [&]() {shared.fetch_add(1, std::memory_order_relaxed);});
+
+    Metrics_registry registry;
+    auto counter = registry.counter("benchmark_total", "Benchmark counter");
+    auto sharded_ns = run(threads_count, per_thread, [&]() {counter.add();});
+    registry.scrape(); // шарды завершившихся потоков - в остаток
+
+    std::cout << "threads: " << threads_count << ", increments per thread: " << per_thread << "\n";
+    std::cout << "shared atomic fetch_add: " << shared_ns << " ns, total " << shared.load() << "\n";
+    std::cout << "sharded counter:         " << sharded_ns << " ns, total " << registry.value(counter) << "\n";
+    return 0;
+}
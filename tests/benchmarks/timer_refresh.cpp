@@ -0,0 +1,85 @@
+// стоимость продления таймера бездействия на каждую операцию чтения/записи (как в туннеле с мелкими пакетами)
+// N таймеров продлеваются по кругу: старый таймер (cancel + async_wait на steady_timer) против колеса таймеров
+#include "utils/timer.hpp"
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace
+{
+    // таймер до перехода на колесо: каждое продление - отмена и новый async_wait с захватом shared_from_this
+    class Legacy_timer : public std::enable_shared_from_this<Legacy_timer>
+    {
+        public:
+            Legacy_timer(boost::asio::io_context& context, std::size_t interval) : timer_(context), interval_(interval) {}
+
+            void refresh()
+            {
+                timer_.cancel();
+                timer_.expires_after(std::chrono::milliseconds(interval_));
+                timer_.async_wait([self = shared_from_this()](const boost::system::error_code& ec)
+                {
+                    if(!ec)
+                        self->expired_++;
+                });
+            }
+
+            void stop() {timer_.cancel();}
+
+        private:
+            boost::asio::steady_timer timer_;
+            std::size_t interval_;
+            std::size_t expired_ = 0;
+    };
+
+    template<typename Timers>
+    double run(boost::asio::io_context& context, Timers& timers, std::size_t operations) // нс на продление
+    {
+        double result = 0;
+        boost::asio::post(context, [&]() // продления идут из потока io_context'а, как в сессиях
+        {
+            auto start = std::chrono::steady_clock::now();
+            for(std::size_t i = 0; i < operations; i++)
+            {
+                timers[i % timers.size()]->refresh();
+                if(i % 1024 == 0)
+                    context.poll(); // отмененные ожидания завершаются, как между операциями в event loop
+            }
+            result = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / operations;
+            for(auto& timer : timers)
+                timer->stop();
+        });
+        context.run();
+        context.restart();
+        return result;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    std::size_t count = argc > 1 ? std::stoull(argv[1]) : 10000;
+    std::size_t operations = argc > 2 ? std::stoull(argv[2]) : 10000000;
+    std::size_t interval = 60000;
+
+    boost::asio::io_context context(1);
+    std::vector<std::shared_ptr<Legacy_timer>> legacy;
+    for(std::size_t i = 0; i < count; i++)
+        legacy.push_back(std::make_shared<Legacy_timer>(context, interval));
+    auto legacy_ns = run(context, legacy, operations);
+    legacy.clear();
+
+    boost::asio::any_io_executor executor = context.get_executor();
+    std::vector<std::shared_ptr<Timer>> wheel;
+    for(std::size_t i = 0; i < count; i++)
+    {
+        wheel.push_back(std::make_shared<Timer>(executor, interval));
+        wheel.back()->start();
+    }
+    auto wheel_ns = run(context, wheel, operations);
+
+    std::cout << "timers: " << count << ", refreshes: " << operations << "\n"
+    << "steady_timer re-arm: " << legacy_ns << " ns/refresh\n"
+    << "timing wheel:        " << wheel_ns << " ns/refresh" << std::endl;
+}
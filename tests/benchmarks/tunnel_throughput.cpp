@@ -0,0 +1,105 @@
+// нагрузочный тест CONNECT туннеля: клиенты через прокси заливают данные в локальный sink,
+// на выходе - пропускная способность в МБ/сек (сравнение epoll и io_uring сборок делает uring_vs_epoll.sh)
+#include <boost/asio.hpp>
+#include <array>
+#include <chrono>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace
+{
+    std::size_t received = 0; // сколько байт получил sink
+
+    boost::asio::awaitable<void> sink_session(boost::asio::ip::tcp::socket socket)
+    {
+        std::vector<char> buffer(64 * 1024);
+        boost::system::error_code ec;
+        for(;;)
+        {
+            auto bytes = co_await socket.async_read_some(boost::asio::buffer(buffer), boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+            received += bytes;
+            if(ec)
+                co_return;
+        }
+    }
+
+    boost::asio::awaitable<void> sink(boost::asio::ip::tcp::acceptor& acceptor)
+    {
+        for(;;)
+        {
+            auto socket = co_await acceptor.async_accept(boost::asio::use_awaitable);
+            boost::asio::co_spawn(acceptor.get_executor(), sink_session(std::move(socket)), boost::asio::detached);
+        }
+    }
+
+    boost::asio::awaitable<void> client(boost::asio::ip::tcp::endpoint proxy, unsigned short sink_port, std::size_t bytes)
+    {
+        boost::asio::ip::tcp::socket socket(co_await boost::asio::this_coro::executor);
+        co_await socket.async_connect(proxy, boost::asio::use_awaitable);
+        auto target = "127.0.0.1:" + std::to_string(sink_port);
+        auto request = "CONNECT " + target + " HTTP/1.1\r\nHost: " + target + "\r\n\r\n";
+        co_await boost::asio::async_write(socket, boost::asio::buffer(request), boost::asio::use_awaitable);
+        std::string response;
+        co_await boost::asio::async_read_until(socket, boost::asio::dynamic_buffer(response), "\r\n\r\n", boost::asio::use_awaitable);
+        if(response.find(" 200 ") == std::string::npos)
+            throw std::runtime_error("CONNECT failed: " + response.substr(0, response.find("\r\n")));
+
+        std::vector<char> chunk(64 * 1024, 'x');
+        while(bytes > 0)
+        {
+            auto size = std::min(bytes, chunk.size());
+            co_await boost::asio::async_write(socket, boost::asio::buffer(chunk.data(), size), boost::asio::use_awaitable);
+            bytes -= size;
+        }
+        socket.shutdown(boost::asio::ip::tcp::socket::shutdown_send);
+        std::array<char, 1> eof;
+        boost::system::error_code ec;
+        co_await socket.async_read_some(boost::asio::buffer(eof), boost::asio::redirect_error(boost::asio::use_awaitable, ec)); // ждем закрытия туннеля
+    }
+}
+
+int main(int argc, char** argv)
+{
+    if(argc < 3)
+    {
+        std::cerr << "usage: " << argv[0] << " <proxy port> <megabytes per connection> [connections]" << std::endl;
+        return 1;
+    }
+    auto proxy_port = static_cast<unsigned short>(std::stoi(argv[1]));
+    std::size_t bytes = std::stoull(argv[2]) * 1024 * 1024;
+    int connections = argc > 3 ? std::stoi(argv[3]) : 1;
+
+    try
+    {
+        boost::asio::io_context context(1);
+        boost::asio::ip::tcp::acceptor acceptor(context, {boost::asio::ip::make_address("127.0.0.1"), 0});
+        boost::asio::co_spawn(context, sink(acceptor), boost::asio::detached);
+
+        int finished = 0;
+        auto start = std::chrono::steady_clock::now();
+        for(int i = 0; i < connections; i++)
+        {
+            boost::asio::co_spawn(context, client({boost::asio::ip::make_address("127.0.0.1"), proxy_port}, acceptor.local_endpoint().port(), bytes),
+            [&](std::exception_ptr error)
+            {
+                if(error)
+                    std::rethrow_exception(error);
+                if(++finished == connections)
+                    context.stop();
+            });
+        }
+        context.run();
+        auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        auto megabytes = static_cast<double>(received) / (1024 * 1024);
+        std::cout << "transferred_mb " << megabytes << "\n";
+        std::cout << "seconds " << seconds << "\n";
+        std::cout << "throughput_mb_per_sec " << megabytes / seconds << std::endl;
+    }
+    catch(const std::exception& ex)
+    {
+        std::cerr << "Benchmark error: " << ex.what() << std::endl;
+        return 1;
+    }
+}
@@ -0,0 +1,93 @@
+#!/bin/bash
+
+# сравнение epoll (proxy) и io_uring (proxy_uring) сборок: пропускная способность туннеля и syscalls на МБ
+# сборка: cmake -DPROXY_IO_URING=ON .. && cmake --build . (из каталога build)
+
+# конфигурация
+BUILD_DIR="${BUILD_DIR:-../../build}"
+BENCHMARK_BIN="$BUILD_DIR/tunnel_benchmark"
+PROXY_PORT="${PROXY_PORT:-12399}"
+MEGABYTES="${MEGABYTES:-512}" # на одно соединение
+CONNECTIONS="${CONNECTIONS:-4}"
+WORK_DIR="$(mktemp -d)"
+PROXY_PID=""
+
+# запуск прокси из рабочего каталога с конфигом без ограничения скорости
+start_proxy()
+{
+    local proxy_bin="$1"
+    shift
+    cat > "$WORK_DIR/proxy_config.toml" <<CONFIG
+[proxy]
+port = $PROXY_PORT
+max_bandwidth_per_sec = 1099511627776
+max_connections = 1024
+worker_threads = 1
+CONFIG
+    (cd "$WORK_DIR" && exec "$@" "$(realpath "$proxy_bin")" > /dev/null) &
+    PROXY_PID=$!
+    sleep 2
+    if ! kill -0 $PROXY_PID 2>/dev/null; then
+        echo "error: $proxy_bin failed to start"
+        exit 1
+    fi
+}
+
+stop_proxy()
+{
+    if [[ -n "$PROXY_PID" ]] && kill -0 $PROXY_PID 2>/dev/null; then
+        kill -INT $PROXY_PID
+        wait $PROXY_PID 2>/dev/null || true
+    fi
+    PROXY_PID=""
+}
+
+cleanup()
+{
+    stop_proxy
+    rm -rf "$WORK_DIR"
+}
+
+trap cleanup EXIT INT TERM
+
+# прогон одного бинарника: сначала чистый замер скорости, затем подсчет syscalls под strace
+run_variant()
+{
+    local name="$1"
+    local proxy_bin="$2"
+
+    start_proxy "$proxy_bin"
+    local throughput
+    throughput=$("$BENCHMARK_BIN" "$PROXY_PORT" "$MEGABYTES" "$CONNECTIONS" | awk '/throughput_mb_per_sec/ {print $2}')
+    stop_proxy
+
+    local syscalls_per_mb="n/a"
+    if command -v strace &> /dev/null; then
+        start_proxy "$proxy_bin" strace -f -c -o "$WORK_DIR/$name.strace"
+        local transferred
+        transferred=$("$BENCHMARK_BIN" "$PROXY_PORT" "$MEGABYTES" "$CONNECTIONS" | awk '/transferred_mb/ {print $2}')
+        stop_proxy
+        local total
+        total=$(awk '$NF == "total" {print $(NF-2)}' "$WORK_DIR/$name.strace")
+        syscalls_per_mb=$(awk -v t="$total" -v mb="$transferred" 'BEGIN {printf "%.1f", t / mb}')
+    fi
+
+    printf "%-8s %12s MB/s %12s syscalls/MB\n" "$name" "$throughput" "$syscalls_per_mb"
+}
+
+main()
+{
+    for bin in "$BENCHMARK_BIN" "$BUILD_DIR/proxy" "$BUILD_DIR/proxy_uring"; do
+        if [[ ! -f "$bin" ]]; then
+            echo "error: $bin not found"
+            echo "first run: cmake -DPROXY_IO_URING=ON .. && cmake --build . (in build directory)"
+            exit 1
+        fi
+    done
+
+    echo "=== tunnel benchmark: $CONNECTIONS connections x $MEGABYTES MB ==="
+    run_variant "epoll" "$BUILD_DIR/proxy"
+    run_variant "io_uring" "$BUILD_DIR/proxy_uring"
+}
+
+main
@@ -0,0 +1,94 @@
+// таблица лимитеров пользователей под NAT-нагрузкой: N потоков принимают "соеденения" с миллионов разных ip,
+// каждый лимитер живет одно соеденение; старая таблица (строки под одним мьютексом) против шардированной по 128-битному ключу
+#include "network/user_traffic_manager.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace
+{
+    // таблица до шардирования: ключ - address().to_string(), один мьютекс, запись удаляется только при повторе ip
+    class Legacy_table
+    {
+        public:
+            std::shared_ptr<Traffic_limiter> get_or_create(const boost::asio::ip::address& address)
+            {
+                auto ip = address.to_string();
+                std::lock_guard lock(mutex_);
+                auto it = users_.find(ip);
+                if(it != users_.end())
+                {
+                    if(auto limiter = it->second.lock())
+                        return limiter;
+                    users_.erase(it);
+                }
+                auto limiter = std::make_shared<Traffic_limiter>(RATE);
+                users_[ip] = limiter;
+                return limiter;
+            }
+
+            std::size_t size()
+            {
+                std::lock_guard lock(mutex_);
+                return users_.size();
+            }
+
+        private:
+            static constexpr uint64_t RATE = 1000000;
+
+            std::unordered_map<std::string, std::weak_ptr<Traffic_limiter>> users_;
+            std::mutex mutex_;
+    };
+
+    boost::asio::ip::address client(std::uint64_t i) // половина клиентов ipv4, половина ipv6
+    {
+        if(i % 2 == 0)
+            return boost::asio::ip::address_v4(static_cast<std::uint32_t>(0x0a000000 + i / 2));
+        boost::asio::ip::address_v6::bytes_type bytes{0x20, 0x01, 0x0d, 0xb8};
+        for(std::size_t b = 0; b < 8; b++)
+            bytes[15 - b] = static_cast<unsigned char>(i >> (b * 8));
+        return boost::asio::ip::address_v6(bytes);
+    }
+
+    template<typename Body>
+    double run(std::size_t threads, std::uint64_t clients, Body body) // нс на одно соеденение
+    {
+        std::atomic<std::uint64_t> next = 0;
+        std::vector<std::thread> workers;
+        auto start = std::chrono::steady_clock::now();
+        for(std::size_t i = 0; i < threads; i++)
+        {
+            workers.emplace_back([&]()
+            {
+                for(auto n = next++; n < clients; n = next++)
+                    body(client(n));
+            });
+        }
+        for(auto& worker : workers)
+            worker.join();
+        auto elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        return elapsed * threads / clients;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    std::size_t threads = argc > 1 ? std::stoull(argv[1]) : std::max(2u, std::thread::hardware_concurrency());
+    std::uint64_t clients = argc > 2 ? std::stoull(argv[2]) : 4000000;
+
+    Legacy_table legacy;
+    auto legacy_ns = run(threads, clients, [&](const auto& address) {legacy.get_or_create(address);});
+
+    User_traffic_manager manager;
+    auto sharded_ns = run(threads, clients, [&](const auto& address) {manager.get_or_create_user(address);});
+
+    std::cout << "threads: " << threads << ", distinct clients: " << clients << "\n"
+    << "legacy string map: " << legacy_ns << " ns/connection, entries left: " << legacy.size() << "\n"
+    << "sharded ip table:  " << sharded_ns << " ns/connection, entries left: " << manager.users() << std::endl;
+}
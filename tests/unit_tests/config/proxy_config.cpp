@@ -195,4 +195,235 @@ TEST_F(ProxyConfigTest, GetSettingsReturnsConstReference)
     const auto& settings2 = config.get_settings();
     
     EXPECT_EQ(&settings1, &settings2);
-}
\ No newline at end of file
+}
+
+// тест загрузки кол-ва воркеров
+TEST_F(ProxyConfigTest, LoadWorkerThreads)
+{
+    {
+        Proxy_Config config;
+        EXPECT_EQ(config.get_settings().worker_threads, 1);
+    }
+
+    std::ofstream file("proxy_config.toml");
+    file << R"(
+[proxy]
+worker_threads = 0
+)";
+    file.close();
+
+    Proxy_Config config;
+    EXPECT_EQ(config.get_settings().worker_threads, 0);
+}
+
+TEST_F(ProxyConfigTest, LoadDnsCacheSettings)
+{
+    std::ofstream file("proxy_config.toml");
+    file << R"(
+[proxy]
+dns_cache_max_entries = 100
+dns_cache_ttl_seconds = 30
+dns_negative_ttl_seconds = -1
+)";
+    file.close();
+
+    Proxy_Config config; // отрицательный ttl - конфиг некорректный, используются значения по умолчанию
+    EXPECT_EQ(config.get_settings().dns_cache_max_entries, 4096);
+    EXPECT_EQ(config.get_settings().dns_negative_ttl_seconds, 5);
+    EXPECT_FALSE(config.get_settings().dns_native_resolver); // getaddrinfo, пока не включен явно
+}
+
+TEST_F(ProxyConfigTest, ConnectAttemptDelayRange)
+{
+    std::ofstream file("proxy_config.toml");
+    file << R"(
+[proxy]
+connect_attempt_delay_milliseconds = 5
+)";
+    file.close();
+
+    Proxy_Config config; // меньше 10 мс - конфиг некорректный
+    EXPECT_EQ(config.get_settings().connect_attempt_delay_milliseconds, 250);
+}
+
+TEST_F(ProxyConfigTest, LoadBandwidthHierarchy)
+{
+    std::ofstream file("proxy_config.toml");
+    file << R"(
+[proxy]
+global_upload_bandwidth_per_sec = 1000000
+destination_bandwidth_per_sec = 500000
+bandwidth_burst_percent = 200
+)";
+    file.close();
+
+    Proxy_Config config;
+    EXPECT_EQ(config.get_settings().global_upload_bandwidth_per_sec, 1000000);
+    EXPECT_EQ(config.get_settings().global_download_bandwidth_per_sec, 0);
+    EXPECT_EQ(config.get_settings().destination_bandwidth_per_sec, 500000);
+    EXPECT_EQ(config.get_settings().bandwidth_burst_percent, 200);
+}
+
+TEST_F(ProxyConfigTest, NegativeUserBandwidthRejected)
+{
+    std::ofstream file("proxy_config.toml");
+    file << R"(
+[proxy]
+max_bandwidth_per_sec = -1
+)";
+    file.close();
+
+    Proxy_Config config; // 0 - уровень пользователя выключен, отрицательное значение - конфиг некорректный
+    EXPECT_EQ(config.get_settings().max_bandwidth_per_sec, 1024 * 1024 * 2);
+}
+
+TEST_F(ProxyConfigTest, BandwidthBurstMustBePositive)
+{
+    std::ofstream file("proxy_config.toml");
+    file << R"(
+[proxy]
+bandwidth_burst_percent = 0
+)";
+    file.close();
+
+    Proxy_Config config; // пустое ведро - конфиг некорректный
+    EXPECT_EQ(config.get_settings().bandwidth_burst_percent, 150);
+}
+
+TEST_F(ProxyConfigTest, LoadPhaseTimeouts)
+{
+    std::ofstream file("proxy_config.toml");
+    file << R"(
+[proxy]
+header_timeout_milliseconds = 3000
+first_byte_timeout_milliseconds = 60000
+)";
+    file.close();
+
+    Proxy_Config config;
+    EXPECT_EQ(config.get_settings().header_timeout_milliseconds, 3000);
+    EXPECT_EQ(config.get_settings().dns_timeout_milliseconds, 5000);
+    EXPECT_EQ(config.get_settings().connect_timeout_milliseconds, 10000);
+    EXPECT_EQ(config.get_settings().first_byte_timeout_milliseconds, 60000);
+}
+
+TEST_F(ProxyConfigTest, HeaderTimeoutMustBePositive)
+{
+    std::ofstream file("proxy_config.toml");
+    file << R"(
+[proxy]
+header_timeout_milliseconds = 0
+)";
+    file.close();
+
+    Proxy_Config config; // без срока на заголовок молчащий клиент держит слот вечно - конфиг некорректный
+    EXPECT_EQ(config.get_settings().header_timeout_milliseconds, 10000);
+}
+
+TEST_F(ProxyConfigTest, LogBufferTooSmall)
+{
+    std::ofstream file("proxy_config.toml");
+    file << R"(
+[proxy]
+log_buffer_bytes = 100
+)";
+    file.close();
+
+    Proxy_Config config; // в буфер не поместится даже заголовок запроса - конфиг некорректный
+    EXPECT_EQ(config.get_settings().log_buffer_bytes, 1024 * 256);
+}
+
+TEST_F(ProxyConfigTest, AccessLogFileTooSmall)
+{
+    std::ofstream file("proxy_config.toml");
+    file << R"(
+[proxy]
+access_log_on = true
+access_log_file_size_bytes = 1000
+)";
+    file.close();
+
+    Proxy_Config config; // файл меньше страницы - конфиг некорректный
+    EXPECT_FALSE(config.get_settings().access_log_on);
+    EXPECT_EQ(config.get_settings().access_log_file_size_bytes, 64 * 1024 * 1024);
+}
+
+TEST_F(ProxyConfigTest, ReloadReadsChangedFile)
+{
+    std::ofstream("proxy_config.toml") << "[proxy]\ntimeout_milliseconds = 1000\nmax_bandwidth_per_sec = 500\n";
+    Proxy_Config config;
+    std::ofstream("proxy_config.toml") << "[proxy]\ntimeout_milliseconds = 2000\n";
+
+    EXPECT_TRUE(config.reload());
+    EXPECT_EQ(config.get_settings().timeout_milliseconds, 2000);
+    EXPECT_EQ(config.get_settings().max_bandwidth_per_sec, Proxy_Config::Proxy_Settings{}.max_bandwidth_per_sec); // убрано из файла
+}
+
+TEST_F(ProxyConfigTest, FailedReloadKeepsCurrentSettings)
+{
+    std::ofstream("proxy_config.toml") << "[proxy]\ntimeout_milliseconds = 1000\n";
+    Proxy_Config config;
+
+    std::ofstream("proxy_config.toml") << "[proxy\ntimeout_milliseconds = 2000\n"; // файл дописывается
+    EXPECT_FALSE(config.reload());
+    EXPECT_EQ(config.get_settings().timeout_milliseconds, 1000);
+
+    std::ofstream("proxy_config.toml") << "[proxy]\nheader_timeout_milliseconds = 0\n";
+    EXPECT_FALSE(config.reload());
+    EXPECT_EQ(config.get_settings().header_timeout_milliseconds, 10000);
+}
+
+TEST_F(ProxyConfigTest, RestartOnlyFieldsAreKept)
+{
+    Proxy_Config::Proxy_Settings running;
+    auto loaded = running;
+    loaded.port = running.port + 1;
+    loaded.worker_threads = 8;
+    loaded.retry_after_seconds = running.retry_after_seconds + 1;
+    loaded.timeout_milliseconds = running.timeout_milliseconds + 1;
+
+    auto changed = Proxy_Config::keep_restart_only(running, loaded);
+    EXPECT_EQ(changed, (std::vector<std::string>{"port", "worker_threads", "retry_after_seconds"}));
+    EXPECT_EQ(loaded.port, running.port);
+    EXPECT_EQ(loaded.worker_threads, running.worker_threads);
+    EXPECT_EQ(loaded.retry_after_seconds, running.retry_after_seconds);
+    EXPECT_EQ(loaded.timeout_milliseconds, running.timeout_milliseconds + 1); // применяется на лету
+}
+
+TEST_F(ProxyConfigTest, LoadAddressBlacklists)
+{
+    std::ofstream file("proxy_config.toml");
+    file << R"(
+[proxy]
+blacklisted_addresses_file_name = "drop.txt"
+)";
+    file.close();
+
+    Proxy_Config config;
+    EXPECT_EQ(config.get_settings().blacklisted_addresses_file_name, "drop.txt");
+    EXPECT_EQ(config.get_settings().blacklisted_clients_file_name, ""); // выключен по умолчанию
+}
+
+TEST_F(ProxyConfigTest, ReadLines)
+{
+    std::ofstream("test_cidr_list.txt") << "10.0.0.0/8\n# comment\n!10.1.0.0/16";
+    auto lines = Proxy_Config::read_lines("test_cidr_list.txt");
+    std::filesystem::remove("test_cidr_list.txt");
+    ASSERT_TRUE(lines.has_value());
+    EXPECT_EQ(*lines, (std::vector<std::string>{"10.0.0.0/8", "# comment", "!10.1.0.0/16"}));
+    EXPECT_FALSE(Proxy_Config::read_lines("no_such_list.txt").has_value());
+}
+
+TEST_F(ProxyConfigTest, LoadMetricsListener)
+{
+    std::ofstream file("proxy_config.toml");
+    file << R"(
+[proxy]
+metrics_port = 9100
+)";
+    file.close();
+
+    Proxy_Config config;
+    EXPECT_EQ(config.get_settings().metrics_port, 9100);
+    EXPECT_EQ(config.get_settings().metrics_host, "127.0.0.1"); // по умолчанию только локально
+}
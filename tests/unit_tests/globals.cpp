@@ -1,8 +1,13 @@
 #include "logger/logger.hpp"
 #include "config/proxy_config.hpp"
+#include "network/domain_matcher.hpp"
+#include "network/ip_matcher.hpp"
+#include "utils/snapshot.hpp"
 
 // определения глобальных переменных
-Proxy_Config::Proxy_Settings PROXY_CONFIG;
-std::unordered_set<std::string> BLACKLISTED_HOSTS;
+Snapshot<Proxy_Config::Proxy_Settings> PROXY_CONFIG;
+Snapshot<Domain_matcher> BLACKLISTED_HOSTS;
+Snapshot<Ip_matcher> BLACKLISTED_ADDRESSES;
+Snapshot<Ip_matcher> BLACKLISTED_CLIENTS;
 bool LOG_ON;
 Logger LOGGER;
\ No newline at end of file
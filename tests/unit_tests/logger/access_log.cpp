@@ -0,0 +1,162 @@
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "logger/access_log.hpp"
+
+namespace fs = std::filesystem;
+
+class AccessLogTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        cleanup();
+    }
+
+    void TearDown() override
+    {
+        cleanup();
+    }
+
+    void cleanup()
+    {
+        for(const auto& entry : fs::directory_iterator("."))
+        {
+            if(entry.path().filename().string().find("test_access") == 0)
+                fs::remove(entry.path());
+        }
+    }
+
+    static Access_record make_record(std::uint64_t id)
+    {
+        Access_record record;
+        record.accept_time = 1700000000000000 + id;
+        record.duration = 2500;
+        record.headers = 100;
+        record.connected = 900;
+        record.bytes_up = 300 + id;
+        record.bytes_down = 70000;
+        record.client_address = Access_record::pack_address(boost::asio::ip::make_address("192.0.2.7"));
+        record.upstream_address = Access_record::pack_address(boost::asio::ip::make_address("2001:db8::5"));
+        record.requests = 1;
+        record.status = 200;
+        record.port = 443;
+        record.tunnel = 1;
+        record.set_host("example.com");
+        return record;
+    }
+
+    std::string file_ = "test_access.bin";
+};
+
+// адреса хранятся в 16 байтах, ipv4 возвращается как ipv4
+TEST_F(AccessLogTest, AddressRoundTrip)
+{
+    auto v4 = boost::asio::ip::make_address("10.1.2.3");
+    auto v6 = boost::asio::ip::make_address("2001:db8::1");
+    EXPECT_EQ(Access_record::unpack_address(Access_record::pack_address(v4)), v4);
+    EXPECT_EQ(Access_record::unpack_address(Access_record::pack_address(v6)), v6);
+}
+
+// у длинного имени хоста сохраняется конец
+TEST_F(AccessLogTest, LongHostKeepsSuffix)
+{
+    Access_record record;
+    std::string host = "very-long-subdomain-name.another-level.cdn.example.com";
+    record.set_host(host);
+    EXPECT_EQ(record.host_name().size(), sizeof(record.host));
+    EXPECT_TRUE(host.ends_with(record.host_name()));
+}
+
+// записи из нескольких потоков попадают в файл и читаются обратно
+TEST_F(AccessLogTest, WriteAndLoad)
+{
+    Access_log log;
+    log.open(file_, 1024 * 1024);
+    ASSERT_TRUE(log.is_open());
+    std::vector<std::thread> threads;
+    for(int t = 0; t < 2; t++)
+    {
+        threads.emplace_back([&log, t]()
+        {
+            for(int i = 0; i < 50; i++)
+                log.write(make_record(t * 100 + i));
+        });
+    }
+    for(auto& thread : threads)
+        thread.join();
+    log.close();
+
+    std::vector<Access_record> records;
+    ASSERT_TRUE(Access_log::load(file_, records));
+    ASSERT_EQ(records.size(), 100);
+    EXPECT_EQ(fs::file_size(file_), sizeof(Access_log::File_header) + 100 * sizeof(Access_record)); // обрезан до записанного
+    std::uint64_t up = 0;
+    for(auto& record : records)
+        up += record.bytes_up;
+    EXPECT_EQ(up, 100 * 300 + (0 + 49) * 50 / 2 + (100 + 149) * 50 / 2);
+    EXPECT_EQ(records[0].host_name(), "example.com");
+    EXPECT_EQ(records[0].status, 200);
+}
+
+// при заполнении файл уходит в <file>.<N>, ни одна запись не теряется
+TEST_F(AccessLogTest, RotatesFullFile)
+{
+    Access_log log;
+    log.open(file_, sizeof(Access_log::File_header) + 2 * sizeof(Access_record)); // по 2 записи в файле
+    for(int i = 0; i < 5; i++)
+    {
+        log.write(make_record(i));
+        log.sync();
+    }
+    EXPECT_EQ(log.rotations(), 2);
+    log.close();
+
+    std::vector<Access_record> records;
+    ASSERT_TRUE(Access_log::load(file_ + ".1", records));
+    ASSERT_TRUE(Access_log::load(file_ + ".2", records));
+    ASSERT_TRUE(Access_log::load(file_, records));
+    ASSERT_EQ(records.size(), 5);
+    for(std::size_t i = 0; i < records.size(); i++)
+        EXPECT_EQ(records[i].accept_time, 1700000000000000 + i);
+}
+
+// файл прошлого запуска не перезаписывается
+TEST_F(AccessLogTest, ReopenKeepsPreviousFile)
+{
+    {
+        Access_log log;
+        log.open(file_, 1024 * 1024);
+        log.write(make_record(1));
+    }
+    Access_log log;
+    log.open(file_, 1024 * 1024);
+    log.close();
+    std::vector<Access_record> records;
+    ASSERT_TRUE(Access_log::load(file_ + ".1", records));
+    EXPECT_EQ(records.size(), 1);
+}
+
+TEST_F(AccessLogTest, CsvAndJson)
+{
+    auto record = make_record(0);
+    EXPECT_EQ(Access_log::to_csv(record),
+    "1700000000000000,2500,100,,900,,300,70000,192.0.2.7,2001:db8::5,1,200,example.com,443,1,completed");
+    auto json = Access_log::to_json(record);
+    EXPECT_NE(json.find("\"resolved_us\":null"), std::string::npos);
+    EXPECT_NE(json.find("\"client\":\"192.0.2.7\""), std::string::npos);
+    EXPECT_NE(json.find("\"tunnel\":true"), std::string::npos);
+    record.set_host("a\"b,c");
+    EXPECT_NE(Access_log::to_csv(record).find(",\"a\"\"b,c\","), std::string::npos);
+    EXPECT_NE(Access_log::to_json(record).find("\"host\":\"a\\\"b,c\""), std::string::npos);
+}
+
+TEST_F(AccessLogTest, RejectsForeignFile)
+{
+    std::ofstream(file_) << "not an access log at all, just some text that is long enough to fill the header";
+    std::vector<Access_record> records;
+    EXPECT_FALSE(Access_log::load(file_, records));
+}
@@ -0,0 +1,86 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <thread>
+#include <vector>
+#include "logger/log_ring.hpp"
+
+// записи читаются в порядке записи вместе с уровнем и временем
+TEST(LogRingTest, PushAndConsumeInOrder)
+{
+    Log_ring ring(1024);
+    EXPECT_TRUE(ring.empty());
+    EXPECT_TRUE(ring.try_push(0, 111, "first"));
+    EXPECT_TRUE(ring.try_push(1, 222, "second"));
+    std::vector<std::string> texts;
+    auto count = ring.consume([&](std::uint8_t level, std::int64_t time, std::string_view text)
+    {
+        texts.emplace_back(std::to_string(level) + ":" + std::to_string(time) + ":" + std::string(text));
+    });
+    EXPECT_EQ(count, 2);
+    EXPECT_EQ(texts, (std::vector<std::string>{"0:111:first", "1:222:second"}));
+    EXPECT_TRUE(ring.empty());
+}
+
+// переполненный буфер отказывает писателю, после чтения место освобождается
+TEST(LogRingTest, FullRingRejectsUntilConsumed)
+{
+    Log_ring ring(256);
+    std::string text(48, 'x'); // 64 байта вместе с заголовком
+    int pushed = 0;
+    while(ring.try_push(0, 0, text))
+        pushed++;
+    EXPECT_EQ(pushed, 4);
+    EXPECT_EQ(ring.consume([](std::uint8_t, std::int64_t, std::string_view){}), 4);
+    EXPECT_TRUE(ring.try_push(0, 0, text));
+    EXPECT_FALSE(ring.try_push(0, 0, std::string(ring.max_text() + 1, 'y'))); // длинные записи обрезает логгер
+}
+
+// запись, не помещающаяся до конца буфера, переносится в начало целиком
+TEST(LogRingTest, WrapsAroundEnd)
+{
+    Log_ring ring(256);
+    std::string text(32, 'a'); // 48 байт
+    for(int round = 0; round < 20; round++)
+    {
+        ASSERT_TRUE(ring.try_push(0, round, text));
+        ASSERT_TRUE(ring.try_push(0, round, text));
+        std::size_t seen = 0;
+        ring.consume([&](std::uint8_t, std::int64_t time, std::string_view view)
+        {
+            EXPECT_EQ(view, text);
+            EXPECT_EQ(time, round);
+            seen++;
+        });
+        ASSERT_EQ(seen, 2);
+    }
+}
+
+// один писатель и один читатель в разных потоках: ни одна запись не теряется и не повреждается
+TEST(LogRingTest, ConcurrentWriterAndReader)
+{
+    Log_ring ring(4096);
+    const int total = 200000;
+    std::thread writer([&]()
+    {
+        for(int i = 0; i < total; i++)
+        {
+            auto text = std::to_string(i);
+            while(!ring.try_push(0, i, text))
+                std::this_thread::yield();
+        }
+    });
+    int expected = 0;
+    bool corrupted = false;
+    while(expected < total)
+    {
+        ring.consume([&](std::uint8_t, std::int64_t time, std::string_view text)
+        {
+            if(time != expected || text != std::to_string(expected))
+                corrupted = true;
+            expected++;
+        });
+    }
+    writer.join();
+    EXPECT_FALSE(corrupted);
+    EXPECT_EQ(expected, total);
+}
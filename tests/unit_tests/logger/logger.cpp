@@ -3,6 +3,9 @@
 #include <fstream>
 #include <thread>
 #include <chrono>
+#include <sstream>
+#include <string>
+#include <vector>
 #include "logger/logger.hpp"
 
 namespace fs = std::filesystem;
@@ -238,4 +241,57 @@ TEST_F(LoggerTest, FileRotation)
         }
     }
     EXPECT_TRUE(rotation_occurred);
-}
\ No newline at end of file
+}
+// строки из разных потоков не перемешиваются и не теряются
+TEST_F(LoggerTest, ConcurrentThreadsKeepLinesIntact)
+{
+    Logger logger;
+    test_log_file_ = "test_log_threads.log"; // sink'и прошлых тестов пишут в test_log.log
+    logger.init_logger(test_log_file_, 10 * 1024 * 1024);
+    std::vector<std::thread> threads;
+    for(int t = 0; t < 4; t++)
+    {
+        threads.emplace_back([&logger, t]()
+        {
+            for(int i = 0; i < 500; i++)
+                logger << "thread " << t << " line " << i << " end" << std::endl;
+        });
+    }
+    for(auto& thread : threads)
+        thread.join();
+    logger.sync();
+
+    std::string content = read_log_file(test_log_file_);
+    EXPECT_EQ(logger.written() + logger.dropped(), 2000);
+    EXPECT_EQ(logger.dropped(), 0);
+    EXPECT_TRUE(log_contains(content, "thread 3 line 499 end"));
+    std::istringstream lines(content);
+    std::string line;
+    while(std::getline(lines, line))
+        EXPECT_TRUE(line.ends_with(" end")) << line;
+}
+
+// переполнение буфера потока не блокирует писателя, а считается в dropped
+TEST_F(LoggerTest, OverflowIsDroppedAndCounted)
+{
+    Logger logger;
+    logger.init_logger(test_log_file_, 10 * 1024 * 1024, 4096);
+    for(int i = 0; i < 10000; i++) // быстрее, чем фоновый поток успевает забирать
+        logger << "overflow message " << i << std::endl;
+    logger.sync();
+    EXPECT_GT(logger.dropped(), 0);
+    EXPECT_EQ(logger.written() + logger.dropped(), 10000);
+}
+
+// слишком длинная строка обрезается до размера, помещающегося в буфер
+TEST_F(LoggerTest, LongMessageIsTruncated)
+{
+    Logger logger;
+    test_log_file_ = "test_log_long.log";
+    logger.init_logger(test_log_file_, 10 * 1024 * 1024, 4096);
+    logger << std::string(10000, 'z') << std::endl;
+    logger.sync();
+    EXPECT_EQ(logger.truncated(), 1);
+    EXPECT_EQ(logger.written(), 1);
+    EXPECT_TRUE(log_contains(read_log_file(test_log_file_), std::string(512, 'z')));
+}
@@ -0,0 +1,127 @@
+#include <gtest/gtest.h>
+#include "metrics/metrics_registry.hpp"
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+TEST(MetricsRegistryTest, CounterSumsAcrossThreads)
+{
+    Metrics_registry registry;
+    auto counter = registry.counter("test_total", "Test counter");
+    std::vector<std::thread> threads;
+    for(int i = 0; i < 4; i++)
+    {
+        threads.emplace_back([counter]()
+        {
+            for(int j = 0; j < 10000; j++)
+                counter.add();
+        });
+    }
+    for(auto& thread : threads)
+        thread.join();
+    counter.add(5); // шард главного потока еще жив
+    EXPECT_EQ(registry.value(counter), 40005);
+    registry.scrape(); // шарды завершившихся потоков складываются в остаток
+    EXPECT_EQ(registry.value(counter), 40005);
+    std::thread([counter]() {counter.add(10);}).join();
+    registry.scrape();
+    EXPECT_EQ(registry.value(counter), 40015);
+}
+
+// два реестра в одном потоке не пишут в шарды друг друга
+TEST(MetricsRegistryTest, RegistriesAreIndependent)
+{
+    Metrics_registry first;
+    Metrics_registry second;
+    auto a = first.counter("a_total", "A");
+    auto b = second.counter("b_total", "B");
+    a.add(3);
+    b.add(7);
+    a.add(1);
+    EXPECT_EQ(first.value(a), 4);
+    EXPECT_EQ(second.value(b), 7);
+}
+
+TEST(MetricsRegistryTest, GaugeGoesUpAndDown)
+{
+    Metrics_registry registry;
+    auto gauge = registry.gauge("test_gauge", "Test gauge");
+    gauge.add(5);
+    std::thread([gauge]() {gauge.sub(8);}).join(); // приращения разных потоков складываются со знаком
+    EXPECT_EQ(registry.value(gauge), -3);
+    EXPECT_NE(registry.scrape().find("test_gauge -3\n"), std::string::npos);
+}
+
+TEST(MetricsRegistryTest, DefaultHandlesDoNothing)
+{
+    Metrics_registry::Counter counter;
+    Metrics_registry::Histogram histogram;
+    counter.add();
+    histogram.record(10);
+}
+
+TEST(MetricsRegistryTest, BucketBounds)
+{
+    for(std::uint64_t value : {0ull, 1ull, 3ull, 4ull, 5ull, 7ull, 8ull, 1000ull, 123456789ull, (1ull << 32) - 1})
+    {
+        auto bucket = Metrics_registry::bucket(value);
+        EXPECT_LE(value, Metrics_registry::bucket_upper(bucket)) << value;
+        if(bucket > 0)
+        {
+            EXPECT_GT(value, Metrics_registry::bucket_upper(bucket - 1)) << value;
+        }
+        if(value >= 4) // ошибка не больше 25%
+        {
+            EXPECT_LE(Metrics_registry::bucket_upper(bucket) - value, value / 4) << value;
+        }
+    }
+    EXPECT_EQ(Metrics_registry::bucket(1ull << 40), Metrics_registry::HISTOGRAM_BUCKETS - 1);
+    EXPECT_EQ(Metrics_registry::bucket_upper(Metrics_registry::HISTOGRAM_BUCKETS - 1), UINT64_MAX);
+}
+
+TEST(MetricsRegistryTest, HistogramScrapeFormat)
+{
+    Metrics_registry registry;
+    auto histogram = registry.histogram("latency_seconds", "Latency", 1e-6, "kind=\"test\"");
+    histogram.record(2); // 2 мкс
+    histogram.record(1000);
+    histogram.record(3000000);
+    EXPECT_EQ(registry.count(histogram, 3), 1);
+    EXPECT_EQ(registry.count(histogram, 1023), 2);
+    auto text = registry.scrape();
+    EXPECT_NE(text.find("# HELP latency_seconds Latency\n# TYPE latency_seconds histogram\n"), std::string::npos);
+    EXPECT_NE(text.find("latency_seconds_bucket{kind=\"test\",le=\"3e-06\"} 1\n"), std::string::npos) << text;
+    EXPECT_NE(text.find("latency_seconds_bucket{kind=\"test\",le=\"0.001023\"} 2\n"), std::string::npos) << text;
+    EXPECT_NE(text.find("latency_seconds_bucket{kind=\"test\",le=\"+Inf\"} 3\n"), std::string::npos);
+    EXPECT_NE(text.find("latency_seconds_sum{kind=\"test\"} 3.001002\n"), std::string::npos) << text;
+    EXPECT_NE(text.find("latency_seconds_count{kind=\"test\"} 3\n"), std::string::npos);
+}
+
+TEST(MetricsRegistryTest, LabelsShareFamily)
+{
+    Metrics_registry registry;
+    auto up = registry.counter("bytes_total", "Bytes", "direction=\"upload\"");
+    auto down = registry.counter("bytes_total", "Bytes", "direction=\"download\"");
+    auto seconds = registry.counter("wait_seconds_total", "Wait", "", 1e-6);
+    up.add(10);
+    down.add(20);
+    seconds.add(1500000);
+    registry.counter_callback("callback_total", "Callback", []() {return 42.0;});
+    auto text = registry.scrape();
+    EXPECT_EQ(text.find("# TYPE bytes_total counter"), text.rfind("# TYPE bytes_total counter")); // HELP/TYPE один раз
+    EXPECT_NE(text.find("bytes_total{direction=\"upload\"} 10\n"), std::string::npos);
+    EXPECT_NE(text.find("bytes_total{direction=\"download\"} 20\n"), std::string::npos);
+    EXPECT_NE(text.find("wait_seconds_total 1.5\n"), std::string::npos);
+    EXPECT_NE(text.find("callback_total 42\n"), std::string::npos);
+}
+
+TEST(MetricsRegistryTest, RegistrationErrors)
+{
+    Metrics_registry registry;
+    registry.counter("name_total", "Counter");
+    EXPECT_THROW(registry.gauge("name_total", "Gauge"), std::invalid_argument);
+    for(std::size_t i = 0; i < Metrics_registry::MAX_SLOTS / (Metrics_registry::HISTOGRAM_BUCKETS + 1); i++)
+        registry.histogram("h" + std::to_string(i), "Histogram");
+    EXPECT_THROW(registry.histogram("one_more", "Histogram"), std::length_error);
+}
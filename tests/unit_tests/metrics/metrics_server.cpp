@@ -0,0 +1,49 @@
+#include <gtest/gtest.h>
+#include "metrics/metrics_server.hpp"
+#include <boost/beast.hpp>
+
+class MetricsServerTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        counter_ = registry_.counter("test_requests_total", "Test requests");
+        counter_.add(3);
+        server_.start("127.0.0.1", 0);
+    }
+
+    boost::beast::http::response<boost::beast::http::string_body> get(const std::string& target)
+    {
+        boost::asio::io_context context;
+        boost::asio::ip::tcp::socket socket(context);
+        socket.connect({boost::asio::ip::make_address("127.0.0.1"), server_.port()});
+        boost::beast::http::request<boost::beast::http::empty_body> request(boost::beast::http::verb::get, target, 11);
+        boost::beast::http::write(socket, request);
+        boost::beast::flat_buffer buffer;
+        boost::beast::http::response<boost::beast::http::string_body> response;
+        boost::beast::http::read(socket, buffer, response);
+        return response;
+    }
+
+    Metrics_registry registry_;
+    Metrics_registry::Counter counter_;
+    Metrics_server server_{registry_};
+};
+
+TEST_F(MetricsServerTest, ServesMetrics)
+{
+    EXPECT_NE(server_.port(), 0);
+    auto response = get("/metrics");
+    EXPECT_EQ(response.result(), boost::beast::http::status::ok);
+    EXPECT_EQ(response[boost::beast::http::field::content_type], "text/plain; version=0.0.4; charset=utf-8");
+    EXPECT_NE(response.body().find("test_requests_total 3\n"), std::string::npos);
+    counter_.add();
+    EXPECT_NE(get("/metrics").body().find("test_requests_total 4\n"), std::string::npos); // каждый запрос - свежие значения
+}
+
+TEST_F(MetricsServerTest, UnknownPathIsNotFound)
+{
+    EXPECT_EQ(get("/").result(), boost::beast::http::status::not_found);
+    server_.stop();
+    server_.stop(); // повторная остановка безопасна
+}
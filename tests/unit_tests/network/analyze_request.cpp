@@ -1,6 +1,7 @@
 #include <gtest/gtest.h>
 #include <boost/beast/http.hpp>
 #include "network/analyze_request.hpp"
+#include "globals/globals.hpp"
 
 class AnalyzeRequestTest : public ::testing::Test
 {
@@ -245,4 +246,30 @@ TEST_F(AnalyzeRequestTest, HighPortNumber)
     EXPECT_TRUE(result.is_connect);
     EXPECT_EQ(result.host, "example.com");
     EXPECT_EQ(result.port, "65535");
-}
\ No newline at end of file
+}
+
+TEST_F(AnalyzeRequestTest, MissingHostHeader)
+{
+    boost::beast::http::request<boost::beast::http::string_body> req{boost::beast::http::verb::get, "/", 11};
+    
+    auto result = handler.analyze_request(req);
+    
+    EXPECT_FALSE(result.is_connect);
+    EXPECT_EQ(result.host, "");
+    EXPECT_EQ(result.port, "80");
+}
+
+// поддомены и хосты в другом регистре блокируются одним правилом
+TEST_F(AnalyzeRequestTest, BlacklistMatchesSubdomains)
+{
+    auto matcher = std::make_shared<Domain_matcher>();
+    matcher->build({"vk.com"});
+    __PROXY_GLOBALS__::BLACKLISTED_HOSTS.publish(matcher);
+    boost::beast::http::request<boost::beast::http::string_body> connect{boost::beast::http::verb::connect, "M.VK.com:443", 11};
+    boost::beast::http::request<boost::beast::http::string_body> get{boost::beast::http::verb::get, "/", 11};
+    get.set(boost::beast::http::field::host, "ok.ru");
+
+    EXPECT_TRUE(handler.analyze_request(connect).is_blacklisted);
+    EXPECT_FALSE(handler.analyze_request(get).is_blacklisted);
+    __PROXY_GLOBALS__::BLACKLISTED_HOSTS.publish(std::make_shared<Domain_matcher>());
+}
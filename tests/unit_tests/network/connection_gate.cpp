@@ -0,0 +1,143 @@
+#include <gtest/gtest.h>
+#include <boost/asio.hpp>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "network/connection_gate.hpp"
+
+class ConnectionGateTest : public ::testing::Test
+{
+protected:
+    boost::asio::io_context io_context_;
+};
+
+// слоты выдаются пока не исчерпан лимит
+TEST_F(ConnectionGateTest, TryAcquireUpToLimit)
+{
+    auto gate = std::make_shared<Connection_gate>(2);
+
+    auto first = gate->try_acquire();
+    auto second = gate->try_acquire();
+    auto third = gate->try_acquire();
+
+    EXPECT_TRUE(first.has_value());
+    EXPECT_TRUE(second.has_value());
+    EXPECT_FALSE(third.has_value());
+    EXPECT_EQ(gate->active(), 2);
+}
+
+// слот освобождается в деструкторе
+TEST_F(ConnectionGateTest, SlotReleasedOnDestruction)
+{
+    auto gate = std::make_shared<Connection_gate>(1);
+    {
+        auto slot = gate->try_acquire();
+        ASSERT_TRUE(slot.has_value());
+        EXPECT_EQ(gate->active(), 1);
+    }
+    EXPECT_EQ(gate->active(), 0);
+    EXPECT_TRUE(gate->try_acquire().has_value());
+}
+
+// перемещение слота не освобождает его дважды
+TEST_F(ConnectionGateTest, MovedSlotReleasedOnce)
+{
+    auto gate = std::make_shared<Connection_gate>(2);
+    {
+        auto slot = gate->try_acquire();
+        Connection_gate::Slot moved = std::move(*slot);
+        EXPECT_TRUE(moved);
+        EXPECT_FALSE(*slot);
+        EXPECT_EQ(gate->active(), 1);
+    }
+    EXPECT_EQ(gate->active(), 0);
+}
+
+// async_acquire ждет освобождения слота не блокируя io_context
+TEST_F(ConnectionGateTest, AsyncAcquireWaitsForRelease)
+{
+    auto gate = std::make_shared<Connection_gate>(1);
+    auto busy = gate->try_acquire();
+    bool acquired = false;
+    bool timer_fired = false;
+
+    boost::asio::co_spawn(io_context_, [&]() -> boost::asio::awaitable<void>
+    {
+        auto slot = co_await gate->async_acquire();
+        acquired = static_cast<bool>(slot);
+    }, boost::asio::detached);
+
+    // другие операции в том же потоке продолжают выполняться
+    boost::asio::steady_timer timer(io_context_, std::chrono::milliseconds(20));
+    timer.async_wait([&](const boost::system::error_code&)
+    {
+        timer_fired = true;
+        EXPECT_FALSE(acquired);
+        EXPECT_EQ(gate->waiting(), 1);
+        busy->release();
+    });
+
+    io_context_.run_for(std::chrono::milliseconds(200));
+    EXPECT_TRUE(timer_fired);
+    EXPECT_TRUE(acquired);
+    EXPECT_EQ(gate->active(), 0);
+}
+
+// ожидающие получают слоты в порядке очереди
+TEST_F(ConnectionGateTest, WaitersServedInOrder)
+{
+    auto gate = std::make_shared<Connection_gate>(1);
+    auto busy = gate->try_acquire();
+    std::vector<int> order;
+    std::vector<Connection_gate::Slot> held;
+
+    for(int i = 0; i < 3; i++)
+    {
+        boost::asio::co_spawn(io_context_, [&, i]() -> boost::asio::awaitable<void>
+        {
+            auto slot = co_await gate->async_acquire();
+            order.push_back(i);
+            held.push_back(std::move(slot));
+        }, boost::asio::detached);
+    }
+    io_context_.run_for(std::chrono::milliseconds(20));
+    EXPECT_TRUE(order.empty());
+    // пока в очереди есть ожидающие, try_acquire не должен обгонять их
+    busy->release();
+    EXPECT_FALSE(gate->try_acquire().has_value());
+    io_context_.run_for(std::chrono::milliseconds(20));
+    ASSERT_EQ(order.size(), 1);
+    held.clear();
+    io_context_.run_for(std::chrono::milliseconds(20));
+    held.clear();
+    io_context_.run_for(std::chrono::milliseconds(20));
+
+    ASSERT_EQ(order.size(), 3);
+    EXPECT_EQ(order[0], 0);
+    EXPECT_EQ(order[1], 1);
+    EXPECT_EQ(order[2], 2);
+}
+
+// освобождение слота из другого потока будит ожидающую корутину
+TEST_F(ConnectionGateTest, ReleaseFromAnotherThread)
+{
+    auto gate = std::make_shared<Connection_gate>(1);
+    auto busy = gate->try_acquire();
+    std::atomic<bool> acquired{false};
+
+    boost::asio::co_spawn(io_context_, [&]() -> boost::asio::awaitable<void>
+    {
+        auto slot = co_await gate->async_acquire();
+        acquired = true;
+    }, boost::asio::detached);
+
+    std::thread releaser([&]()
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(30));
+        busy->release();
+    });
+    io_context_.run_for(std::chrono::milliseconds(200));
+    releaser.join();
+    EXPECT_TRUE(acquired);
+}
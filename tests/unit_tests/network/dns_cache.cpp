@@ -0,0 +1,150 @@
+#include <gtest/gtest.h>
+#include <boost/asio.hpp>
+#include <thread>
+#include "network/dns_cache.hpp"
+
+class DnsCacheTest : public ::testing::Test
+{
+protected:
+    // резолвинг через кеш с ожиданием результата
+    Dns_cache::results_type resolve(const std::string& host, const std::string& port, boost::system::error_code& ec)
+    {
+        Dns_cache::results_type results;
+        boost::asio::co_spawn(io_context_, [&]() -> boost::asio::awaitable<void>
+        {
+            results = co_await cache_.async_resolve(host, port, ec);
+        }, boost::asio::detached);
+        io_context_.restart();
+        io_context_.run();
+        return results;
+    }
+
+    boost::asio::io_context io_context_;
+    Dns_cache cache_;
+};
+
+// повторный запрос отдается из кеша
+TEST_F(DnsCacheTest, SecondLookupIsHit)
+{
+    boost::system::error_code ec;
+    auto first = resolve("127.0.0.1", "80", ec);
+    ASSERT_FALSE(ec);
+    ASSERT_FALSE(first.empty());
+    auto second = resolve("127.0.0.1", "80", ec);
+    ASSERT_FALSE(ec);
+    EXPECT_EQ(second.begin()->endpoint(), first.begin()->endpoint());
+    EXPECT_EQ(cache_.misses(), 1);
+    EXPECT_EQ(cache_.hits(), 1);
+    EXPECT_EQ(cache_.size(), 1);
+}
+
+// имя хоста в ключе без учета регистра
+TEST_F(DnsCacheTest, HostKeyIsCaseInsensitive)
+{
+    boost::system::error_code ec;
+    resolve("LocalHost", "80", ec);
+    ASSERT_FALSE(ec);
+    resolve("localhost", "80", ec);
+    EXPECT_FALSE(ec);
+    EXPECT_EQ(cache_.misses(), 1);
+    EXPECT_EQ(cache_.hits(), 1);
+}
+
+// ошибка резолвинга тоже кешируется
+TEST_F(DnsCacheTest, NegativeCaching)
+{
+    boost::system::error_code ec;
+    resolve("127.0.0.1", "no-such-service-name", ec);
+    EXPECT_TRUE(ec);
+    ec.clear();
+    resolve("127.0.0.1", "no-such-service-name", ec);
+    EXPECT_TRUE(ec);
+    EXPECT_EQ(cache_.misses(), 1);
+    EXPECT_EQ(cache_.hits(), 1);
+}
+
+// устаревшая запись резолвится заново
+TEST_F(DnsCacheTest, EntryExpires)
+{
+    cache_.configure(16, std::chrono::milliseconds(20), std::chrono::milliseconds(20));
+    boost::system::error_code ec;
+    resolve("127.0.0.1", "80", ec);
+    std::this_thread::sleep_for(std::chrono::milliseconds(40));
+    resolve("127.0.0.1", "80", ec);
+    EXPECT_FALSE(ec);
+    EXPECT_EQ(cache_.misses(), 2);
+    EXPECT_EQ(cache_.hits(), 0);
+}
+
+// при переполнении вытесняется самая старая запись
+TEST_F(DnsCacheTest, LruEviction)
+{
+    cache_.configure(2, std::chrono::seconds(60), std::chrono::seconds(5));
+    boost::system::error_code ec;
+    resolve("127.0.0.1", "1", ec);
+    resolve("127.0.0.1", "2", ec);
+    resolve("127.0.0.1", "1", ec); // "1" становится самой свежей
+    resolve("127.0.0.1", "3", ec); // вытесняет "2"
+    EXPECT_EQ(cache_.size(), 2);
+    EXPECT_EQ(cache_.hits(), 1);
+    resolve("127.0.0.1", "1", ec);
+    EXPECT_EQ(cache_.hits(), 2);
+    resolve("127.0.0.1", "2", ec);
+    EXPECT_EQ(cache_.misses(), 4);
+}
+
+// одновременные запросы одного host:port ждут один резолвинг
+TEST_F(DnsCacheTest, ConcurrentLookupsAreCoalesced)
+{
+    const int count = 32;
+    int resolved = 0;
+    for(int i = 0; i < count; i++)
+    {
+        boost::asio::co_spawn(io_context_, [&]() -> boost::asio::awaitable<void>
+        {
+            boost::system::error_code ec;
+            auto results = co_await cache_.async_resolve("127.0.0.1", "8080", ec);
+            if(!ec && !results.empty())
+                resolved++;
+        }, boost::asio::detached);
+    }
+    io_context_.run();
+    EXPECT_EQ(resolved, count);
+    EXPECT_EQ(cache_.misses(), 1);
+    EXPECT_EQ(cache_.coalesced(), count - 1);
+}
+
+// со сроком getaddrinfo идет отдельной корутиной, запросы все так же объединяются и получают результат
+TEST_F(DnsCacheTest, SystemLookupWithTimeoutIsCoalesced)
+{
+    cache_.set_system_timeout(std::chrono::milliseconds(5000));
+    const int count = 8;
+    int resolved = 0;
+    for(int i = 0; i < count; i++)
+    {
+        boost::asio::co_spawn(io_context_, [&]() -> boost::asio::awaitable<void>
+        {
+            boost::system::error_code ec;
+            auto results = co_await cache_.async_resolve("127.0.0.1", "8080", ec);
+            if(!ec && !results.empty())
+                resolved++;
+        }, boost::asio::detached);
+    }
+    io_context_.run();
+    EXPECT_EQ(resolved, count);
+    EXPECT_EQ(cache_.misses(), 1);
+    EXPECT_EQ(cache_.coalesced(), count - 1);
+    EXPECT_EQ(cache_.size(), 1);
+}
+
+// с выключенным кешем каждый запрос резолвится заново
+TEST_F(DnsCacheTest, DisabledCache)
+{
+    cache_.configure(0, std::chrono::seconds(60), std::chrono::seconds(5));
+    boost::system::error_code ec;
+    resolve("127.0.0.1", "80", ec);
+    resolve("127.0.0.1", "80", ec);
+    EXPECT_FALSE(ec);
+    EXPECT_EQ(cache_.misses(), 2);
+    EXPECT_EQ(cache_.size(), 0);
+}
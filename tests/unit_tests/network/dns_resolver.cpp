@@ -0,0 +1,383 @@
+#include <gtest/gtest.h>
+#include <boost/asio.hpp>
+#include <fstream>
+#include <functional>
+#include "network/dns_resolver.hpp"
+#include "network/dns_cache.hpp"
+
+// локальный DNS сервер для тестов, отвечает по UDP и TCP на одном порту
+class Dns_stub
+{
+    public:
+        using Handler = std::function<std::vector<std::uint8_t>(const std::vector<std::uint8_t>& query, bool tcp)>;
+
+        Dns_stub(boost::asio::io_context& context, Handler handler)
+        : socket_(context), acceptor_(context), handler_(std::move(handler))
+        {
+            // свободный udp порт может быть занят по tcp - тогда берется другой
+            for(;;)
+            {
+                socket_.open(boost::asio::ip::udp::v4());
+                socket_.bind({boost::asio::ip::make_address("127.0.0.1"), 0});
+                boost::system::error_code ec;
+                acceptor_.open(boost::asio::ip::tcp::v4());
+                acceptor_.bind({boost::asio::ip::make_address("127.0.0.1"), socket_.local_endpoint().port()}, ec);
+                if(!ec)
+                    break;
+                acceptor_.close();
+                socket_.close();
+            }
+            acceptor_.listen();
+            boost::asio::co_spawn(context, serve_udp(), boost::asio::detached);
+            boost::asio::co_spawn(context, serve_tcp(), boost::asio::detached);
+        }
+
+        boost::asio::ip::udp::endpoint endpoint() const {return socket_.local_endpoint();};
+
+        int udp_queries = 0;
+        int tcp_queries = 0;
+
+    private:
+        boost::asio::awaitable<void> serve_udp()
+        {
+            std::array<std::uint8_t, 512> buffer;
+            boost::asio::ip::udp::endpoint sender;
+            for(;;)
+            {
+                boost::system::error_code ec;
+                auto size = co_await socket_.async_receive_from(boost::asio::buffer(buffer), sender,
+                boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+                if(ec)
+                    co_return;
+                udp_queries++;
+                auto reply = handler_({buffer.begin(), buffer.begin() + size}, false);
+                if(!reply.empty())
+                    co_await socket_.async_send_to(boost::asio::buffer(reply), sender, boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+            }
+        }
+
+        boost::asio::awaitable<void> serve_tcp()
+        {
+            for(;;)
+            {
+                boost::system::error_code ec;
+                auto socket = co_await acceptor_.async_accept(boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+                if(ec)
+                    co_return;
+                tcp_queries++;
+                std::array<std::uint8_t, 2> length;
+                co_await boost::asio::async_read(socket, boost::asio::buffer(length), boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+                std::vector<std::uint8_t> query((length[0] << 8) | length[1]);
+                co_await boost::asio::async_read(socket, boost::asio::buffer(query), boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+                auto reply = handler_(query, true);
+                std::vector<std::uint8_t> message{static_cast<std::uint8_t>(reply.size() >> 8), static_cast<std::uint8_t>(reply.size())};
+                message.insert(message.end(), reply.begin(), reply.end());
+                co_await boost::asio::async_write(socket, boost::asio::buffer(message), boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+            }
+        }
+
+    private:
+        boost::asio::ip::udp::socket socket_;
+        boost::asio::ip::tcp::acceptor acceptor_;
+        Handler handler_;
+};
+
+namespace
+{
+    std::uint16_t query_type(const std::vector<std::uint8_t>& query)
+    {
+        return (query[query.size() - 4] << 8) | query[query.size() - 3];
+    }
+
+    std::vector<std::uint8_t> encode_name(const std::string& name)
+    {
+        auto query = Dns_resolver::build_query(0, name, 0);
+        return {query.begin() + 12, query.end() - 4};
+    }
+
+    // запись ответа, по умолчанию владелец - имя из вопроса (указатель 0xC00C)
+    std::vector<std::uint8_t> record(std::uint16_t type, std::uint32_t ttl, const std::vector<std::uint8_t>& data,
+    const std::vector<std::uint8_t>& owner = {0xC0, 0x0C})
+    {
+        std::vector<std::uint8_t> out(owner);
+        out.insert(out.end(), {static_cast<std::uint8_t>(type >> 8), static_cast<std::uint8_t>(type), 0, 1,
+        static_cast<std::uint8_t>(ttl >> 24), static_cast<std::uint8_t>(ttl >> 16), static_cast<std::uint8_t>(ttl >> 8), static_cast<std::uint8_t>(ttl),
+        static_cast<std::uint8_t>(data.size() >> 8), static_cast<std::uint8_t>(data.size())});
+        out.insert(out.end(), data.begin(), data.end());
+        return out;
+    }
+
+    std::vector<std::uint8_t> make_reply(const std::vector<std::uint8_t>& query, int rcode,
+    const std::vector<std::vector<std::uint8_t>>& records = {}, bool truncated = false)
+    {
+        std::vector<std::uint8_t> out(query);
+        std::uint16_t flags = 0x8180 | rcode | (truncated ? 0x0200 : 0);
+        out[2] = flags >> 8;
+        out[3] = flags & 0xFF;
+        out[6] = 0;
+        out[7] = static_cast<std::uint8_t>(records.size());
+        for(const auto& i : records)
+            out.insert(out.end(), i.begin(), i.end());
+        return out;
+    }
+
+    const std::vector<std::uint8_t> IPV4 = {93, 184, 216, 34};
+    const std::vector<std::uint8_t> IPV6 = {0x20, 0x01, 0x0d, 0xb8, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1};
+}
+
+class DnsResolverTest : public ::testing::Test
+{
+protected:
+    Dns_resolver make_resolver(std::vector<boost::asio::ip::udp::endpoint> nameservers)
+    {
+        Dns_resolver::Settings settings;
+        settings.nameservers = std::move(nameservers);
+        settings.timeout = std::chrono::milliseconds(100);
+        settings.attempts = 1;
+        return Dns_resolver(settings, "nonexistent_hosts_file");
+    }
+
+    Dns_resolver::results_type resolve(Dns_resolver& resolver, const std::string& host, const std::string& port)
+    {
+        Dns_resolver::results_type results;
+        boost::asio::co_spawn(io_context_, [&]() -> boost::asio::awaitable<void>
+        {
+            results = co_await resolver.async_resolve(host, port, ttl_, ec_);
+            io_context_.stop();
+        }, boost::asio::detached);
+        io_context_.restart();
+        io_context_.run_for(std::chrono::seconds(2));
+        return results;
+    }
+
+    boost::asio::io_context io_context_;
+    std::uint32_t ttl_ = 0;
+    boost::system::error_code ec_;
+};
+
+// A и AAAA запрашиваются параллельно, TTL - минимальный из ответов
+TEST_F(DnsResolverTest, ResolvesBothFamilies)
+{
+    Dns_stub stub(io_context_, [](const std::vector<std::uint8_t>& query, bool)
+    {
+        if(query_type(query) == Dns_resolver::TYPE_A)
+            return make_reply(query, 0, {record(Dns_resolver::TYPE_A, 300, IPV4)});
+        return make_reply(query, 0, {record(Dns_resolver::TYPE_AAAA, 120, IPV6)});
+    });
+    auto resolver = make_resolver({stub.endpoint()});
+    auto results = resolve(resolver, "Example.COM", "443");
+    ASSERT_FALSE(ec_);
+    ASSERT_EQ(results.size(), 2);
+    EXPECT_EQ(results.begin()->endpoint().address().to_string(), "93.184.216.34");
+    EXPECT_EQ(results.begin()->endpoint().port(), 443);
+    EXPECT_EQ(std::next(results.begin())->endpoint().address().to_string(), "2001:db8::1");
+    EXPECT_EQ(ttl_, 120);
+    EXPECT_EQ(stub.udp_queries, 2);
+}
+
+// адреса берутся по цепочке CNAME
+TEST_F(DnsResolverTest, FollowsCname)
+{
+    Dns_stub stub(io_context_, [](const std::vector<std::uint8_t>& query, bool)
+    {
+        if(query_type(query) == Dns_resolver::TYPE_AAAA)
+            return make_reply(query, 0);
+        return make_reply(query, 0, {record(Dns_resolver::TYPE_CNAME, 60, encode_name("edge.cdn.net")),
+        record(Dns_resolver::TYPE_A, 20, {1, 2, 3, 4}, encode_name("other.net")),
+        record(Dns_resolver::TYPE_A, 30, IPV4, encode_name("edge.cdn.net"))});
+    });
+    auto resolver = make_resolver({stub.endpoint()});
+    auto results = resolve(resolver, "www.example.com", "80");
+    ASSERT_FALSE(ec_);
+    ASSERT_EQ(results.size(), 1);
+    EXPECT_EQ(results.begin()->endpoint().address().to_string(), "93.184.216.34");
+    EXPECT_EQ(ttl_, 30);
+}
+
+TEST_F(DnsResolverTest, NxDomain)
+{
+    Dns_stub stub(io_context_, [](const std::vector<std::uint8_t>& query, bool){return make_reply(query, 3);});
+    auto resolver = make_resolver({stub.endpoint()});
+    auto results = resolve(resolver, "missing.example.com", "80");
+    EXPECT_EQ(ec_, boost::asio::error::host_not_found);
+    EXPECT_TRUE(results.empty());
+}
+
+// усеченный UDP ответ повторяется по TCP
+TEST_F(DnsResolverTest, TruncatedReplyFallsBackToTcp)
+{
+    Dns_stub stub(io_context_, [](const std::vector<std::uint8_t>& query, bool tcp)
+    {
+        if(query_type(query) == Dns_resolver::TYPE_AAAA)
+            return make_reply(query, 0);
+        if(!tcp)
+            return make_reply(query, 0, {}, true);
+        return make_reply(query, 0, {record(Dns_resolver::TYPE_A, 300, IPV4)});
+    });
+    auto resolver = make_resolver({stub.endpoint()});
+    auto results = resolve(resolver, "big.example.com", "80");
+    ASSERT_FALSE(ec_);
+    ASSERT_EQ(results.size(), 1);
+    EXPECT_EQ(stub.tcp_queries, 1);
+}
+
+// nameserver, который не отвечает, пропускается по таймауту
+TEST_F(DnsResolverTest, SilentNameserverTimesOut)
+{
+    boost::asio::ip::udp::socket silent(io_context_, {boost::asio::ip::make_address("127.0.0.1"), 0});
+    Dns_stub stub(io_context_, [](const std::vector<std::uint8_t>& query, bool)
+    {
+        return make_reply(query, 0, {record(query_type(query), 300, query_type(query) == Dns_resolver::TYPE_A ? IPV4 : IPV6)});
+    });
+    auto resolver = make_resolver({silent.local_endpoint(), stub.endpoint()});
+    auto start = std::chrono::steady_clock::now();
+    auto results = resolve(resolver, "example.com", "80");
+    ASSERT_FALSE(ec_);
+    EXPECT_EQ(results.size(), 2);
+    EXPECT_GE(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(100));
+}
+
+// общий срок резолвинга обрывает попытки раньше, чем истекут таймауты всех nameserver'ов
+TEST_F(DnsResolverTest, DeadlineLimitsAllAttempts)
+{
+    boost::asio::ip::udp::socket silent(io_context_, {boost::asio::ip::make_address("127.0.0.1"), 0});
+    Dns_resolver::Settings settings;
+    settings.nameservers = {silent.local_endpoint(), silent.local_endpoint()};
+    settings.timeout = std::chrono::milliseconds(300);
+    settings.attempts = 2; // без срока - 4 попытки по 300 мс
+    settings.deadline = std::chrono::milliseconds(150);
+    Dns_resolver resolver(settings, "nonexistent_hosts_file");
+    auto start = std::chrono::steady_clock::now();
+    resolve(resolver, "example.com", "80");
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    EXPECT_EQ(ec_, boost::asio::error::timed_out);
+    EXPECT_GE(elapsed, std::chrono::milliseconds(150));
+    EXPECT_LT(elapsed, std::chrono::milliseconds(300));
+}
+
+// SERVFAIL - запрос уходит следующему nameserver'у
+TEST_F(DnsResolverTest, ServfailTriesNextNameserver)
+{
+    Dns_stub failing(io_context_, [](const std::vector<std::uint8_t>& query, bool){return make_reply(query, 2);});
+    Dns_stub stub(io_context_, [](const std::vector<std::uint8_t>& query, bool)
+    {
+        if(query_type(query) == Dns_resolver::TYPE_AAAA)
+            return make_reply(query, 0);
+        return make_reply(query, 0, {record(Dns_resolver::TYPE_A, 300, IPV4)});
+    });
+    auto resolver = make_resolver({failing.endpoint(), stub.endpoint()});
+    auto results = resolve(resolver, "example.com", "80");
+    ASSERT_FALSE(ec_);
+    EXPECT_EQ(results.size(), 1);
+    EXPECT_EQ(failing.udp_queries, 2);
+}
+
+// все nameserver'ы молчат
+TEST_F(DnsResolverTest, NoAnswerIsTryAgain)
+{
+    boost::asio::ip::udp::socket silent(io_context_, {boost::asio::ip::make_address("127.0.0.1"), 0});
+    auto resolver = make_resolver({silent.local_endpoint()});
+    resolve(resolver, "example.com", "80");
+    EXPECT_EQ(ec_, boost::asio::error::host_not_found_try_again);
+}
+
+// IP адреса и записи из hosts файла не требуют запросов
+TEST_F(DnsResolverTest, LiteralsAndHostsFile)
+{
+    {
+        std::ofstream hosts("test_hosts");
+        hosts << "# comment\n10.1.2.3  MyHost.local alias # trailing\n";
+    }
+    Dns_resolver resolver(Dns_resolver::Settings{}, "test_hosts");
+    auto results = resolve(resolver, "myhost.local", "8080");
+    ASSERT_FALSE(ec_);
+    EXPECT_EQ(results.begin()->endpoint(), boost::asio::ip::tcp::endpoint(boost::asio::ip::make_address("10.1.2.3"), 8080));
+    results = resolve(resolver, "[::1]", "443");
+    ASSERT_FALSE(ec_);
+    EXPECT_EQ(results.begin()->endpoint().address().to_string(), "::1");
+    resolve(resolver, "unknown.local", "80"); // nameserver'ов нет
+    EXPECT_EQ(ec_, boost::asio::error::host_not_found);
+    resolve(resolver, "127.0.0.1", "http");
+    EXPECT_EQ(ec_, boost::asio::error::service_not_found);
+    std::remove("test_hosts");
+}
+
+TEST_F(DnsResolverTest, LoadResolvConf)
+{
+    {
+        std::ofstream file("test_resolv.conf");
+        file << "# comment\nsearch example.com\nnameserver 10.0.0.1\nnameserver ::1 ; comment\nnameserver bad\n"
+        "nameserver 10.0.0.2\nnameserver 10.0.0.3\noptions ndots:2 timeout:1 attempts:3\n";
+    }
+    auto settings = Dns_resolver::load_resolv_conf("test_resolv.conf");
+    ASSERT_EQ(settings.nameservers.size(), 3);
+    EXPECT_EQ(settings.nameservers[0].address().to_string(), "10.0.0.1");
+    EXPECT_EQ(settings.nameservers[1].address().to_string(), "::1");
+    EXPECT_EQ(settings.nameservers[2].port(), 53);
+    EXPECT_EQ(settings.timeout, std::chrono::seconds(1));
+    EXPECT_EQ(settings.attempts, 3);
+    std::remove("test_resolv.conf");
+}
+
+TEST_F(DnsResolverTest, ParseRejectsForeignReply)
+{
+    auto query = Dns_resolver::build_query(42, "example.com", Dns_resolver::TYPE_A);
+    auto reply = make_reply(query, 0, {record(Dns_resolver::TYPE_A, 300, IPV4)});
+    Dns_resolver::Reply parsed;
+    EXPECT_FALSE(Dns_resolver::parse_reply(reply.data(), reply.size(), 43, "example.com", Dns_resolver::TYPE_A, parsed));
+    EXPECT_FALSE(Dns_resolver::parse_reply(reply.data(), reply.size(), 42, "example.org", Dns_resolver::TYPE_A, parsed));
+    EXPECT_FALSE(Dns_resolver::parse_reply(query.data(), query.size(), 42, "example.com", Dns_resolver::TYPE_A, parsed));
+    EXPECT_FALSE(Dns_resolver::parse_reply(reply.data(), 20, 42, "example.com", Dns_resolver::TYPE_A, parsed));
+    ASSERT_TRUE(Dns_resolver::parse_reply(reply.data(), reply.size(), 42, "example.com", Dns_resolver::TYPE_A, parsed));
+    EXPECT_EQ(parsed.addresses.size(), 1);
+}
+
+// кеш хранит запись не дольше ее TTL
+TEST_F(DnsResolverTest, CacheHonoursRecordTtl)
+{
+    Dns_stub stub(io_context_, [](const std::vector<std::uint8_t>& query, bool)
+    {
+        if(query_type(query) == Dns_resolver::TYPE_AAAA)
+            return make_reply(query, 0);
+        return make_reply(query, 0, {record(Dns_resolver::TYPE_A, 0, IPV4)});
+    });
+    Dns_cache cache;
+    cache.set_resolver(std::make_shared<Dns_resolver>(make_resolver({stub.endpoint()})));
+    boost::asio::co_spawn(io_context_, [&]() -> boost::asio::awaitable<void>
+    {
+        co_await cache.async_resolve("example.com", "80", ec_);
+        co_await cache.async_resolve("example.com", "80", ec_);
+        io_context_.stop();
+    }, boost::asio::detached);
+    io_context_.run_for(std::chrono::seconds(2));
+    EXPECT_FALSE(ec_);
+    EXPECT_EQ(cache.misses(), 2);
+    EXPECT_EQ(stub.udp_queries, 4);
+}
+
+// резолвинг, корутина которого уничтожена (остановка воркера), снимает pending: ожидающие не зависают
+TEST_F(DnsResolverTest, CacheReleasesWaitersWhenLookupIsDestroyed)
+{
+    boost::asio::ip::udp::socket silent(io_context_, {boost::asio::ip::make_address("127.0.0.1"), 0});
+    Dns_cache cache;
+    cache.set_resolver(std::make_shared<Dns_resolver>(make_resolver({silent.local_endpoint()})));
+    bool done = false;
+    {
+        boost::asio::io_context leader_context;
+        boost::system::error_code leader_ec;
+        boost::asio::co_spawn(leader_context, cache.async_resolve("example.com", "80", leader_ec), boost::asio::detached);
+        leader_context.run_for(std::chrono::milliseconds(20)); // запрос ушел, ответа нет
+        boost::asio::co_spawn(io_context_, [&]() -> boost::asio::awaitable<void>
+        {
+            co_await cache.async_resolve("example.com", "80", ec_);
+            done = true;
+        }, boost::asio::detached);
+        io_context_.poll();
+        EXPECT_EQ(cache.coalesced(), 1);
+    } // корутина резолвинга уничтожается вместе с io_context'ом
+    io_context_.restart();
+    io_context_.run_for(std::chrono::milliseconds(500));
+    EXPECT_TRUE(done);
+    EXPECT_EQ(ec_, boost::asio::error::operation_aborted);
+    EXPECT_EQ(cache.size(), 0);
+}
@@ -0,0 +1,169 @@
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "network/domain_matcher.hpp"
+
+class DomainMatcherTest : public ::testing::Test
+{
+protected:
+    void TearDown() override
+    {
+        std::remove(file_.c_str());
+    }
+
+    Domain_matcher matcher_;
+
+    std::string file_ = "test_blacklist.bin";
+};
+
+TEST_F(DomainMatcherTest, EmptyMatchesNothing)
+{
+    EXPECT_TRUE(matcher_.empty());
+    EXPECT_FALSE(matcher_.matches("vk.com"));
+    EXPECT_FALSE(matcher_.matches(""));
+}
+
+// правило блокирует домен и все его поддомены, но не соседние домены
+TEST_F(DomainMatcherTest, SuffixRuleCoversSubdomains)
+{
+    matcher_.build({"vk.com"});
+    EXPECT_TRUE(matcher_.matches("vk.com"));
+    EXPECT_TRUE(matcher_.matches("m.vk.com"));
+    EXPECT_TRUE(matcher_.matches("a.b.c.vk.com"));
+    EXPECT_FALSE(matcher_.matches("notvk.com"));
+    EXPECT_FALSE(matcher_.matches("vk.com.ru"));
+    EXPECT_FALSE(matcher_.matches("com"));
+}
+
+// регистр и точка в конце не влияют ни на правила, ни на хосты
+TEST_F(DomainMatcherTest, NormalizesHostsAndRules)
+{
+    matcher_.build({"  Example.COM.  ", ".vk.com"});
+    EXPECT_TRUE(matcher_.matches("example.com"));
+    EXPECT_TRUE(matcher_.matches("WWW.EXAMPLE.COM."));
+    EXPECT_TRUE(matcher_.matches("VK.com"));
+    EXPECT_TRUE(matcher_.matches("m.vk.com.."));
+    EXPECT_EQ(Domain_matcher::normalize("Mail.VK.com."), "mail.vk.com");
+}
+
+TEST_F(DomainMatcherTest, WildcardMatchesOneLabel)
+{
+    matcher_.build({"*.example.com", "ads.*.cdn.net"});
+    EXPECT_FALSE(matcher_.matches("example.com"));
+    EXPECT_TRUE(matcher_.matches("www.example.com"));
+    EXPECT_TRUE(matcher_.matches("a.www.example.com"));
+    EXPECT_TRUE(matcher_.matches("ads.eu.cdn.net"));
+    EXPECT_TRUE(matcher_.matches("x.ads.eu.cdn.net"));
+    EXPECT_FALSE(matcher_.matches("ads.cdn.net"));
+    EXPECT_FALSE(matcher_.matches("img.eu.cdn.net"));
+}
+
+// побеждает более длинное совпадение, при равной длине - исключение
+TEST_F(DomainMatcherTest, ExceptionsOverrideBlocks)
+{
+    matcher_.build({"vk.com", "!m.vk.com", "ads.m.vk.com", "@@*.ok.ru", "ok.ru", "mail.ru", "!mail.ru"});
+    EXPECT_TRUE(matcher_.matches("vk.com"));
+    EXPECT_FALSE(matcher_.matches("m.vk.com"));
+    EXPECT_FALSE(matcher_.matches("api.m.vk.com"));
+    EXPECT_TRUE(matcher_.matches("ads.m.vk.com"));
+    EXPECT_TRUE(matcher_.matches("ok.ru"));
+    EXPECT_FALSE(matcher_.matches("www.ok.ru"));
+    EXPECT_FALSE(matcher_.matches("mail.ru"));
+    EXPECT_EQ(matcher_.rules(), 6); // mail.ru и !mail.ru - одно правило
+}
+
+TEST_F(DomainMatcherTest, SkipsInvalidRules)
+{
+    auto skipped = matcher_.build({"", "# comment", "bad host.com", "a..b", "x.*y.com", "ok.com", "!", "@@", "."});
+    EXPECT_EQ(skipped, 6);
+    EXPECT_EQ(matcher_.rules(), 1);
+    EXPECT_TRUE(matcher_.matches("ok.com"));
+    EXPECT_FALSE(matcher_.matches("a..b"));
+}
+
+// повторное построение заменяет правила
+TEST_F(DomainMatcherTest, RebuildReplacesRules)
+{
+    matcher_.build({"vk.com"});
+    matcher_.build({"ok.ru"});
+    EXPECT_FALSE(matcher_.matches("vk.com"));
+    EXPECT_TRUE(matcher_.matches("ok.ru"));
+}
+
+// на большом списке ответы те же, одинаковые метки хранятся один раз
+TEST_F(DomainMatcherTest, LargeList)
+{
+    std::vector<std::string> rules;
+    for(int i = 0; i < 100000; i++)
+        rules.push_back("host" + std::to_string(i) + ".zone" + std::to_string(i % 100) + (i % 2 ? ".com" : ".net"));
+    matcher_.build(rules);
+    EXPECT_EQ(matcher_.rules(), 100000);
+    EXPECT_EQ(matcher_.nodes(), 1 + 2 + 100 + 100000); // корень, com/net, зоны (четность зоны = четности i), хосты
+    for(int i = 0; i < 100000; i += 997)
+    {
+        EXPECT_TRUE(matcher_.matches(rules[i]));
+        EXPECT_TRUE(matcher_.matches("www." + rules[i]));
+    }
+    EXPECT_FALSE(matcher_.matches("host1.zone1.net"));
+    EXPECT_FALSE(matcher_.matches("zone1.com"));
+    EXPECT_LT(matcher_.memory_bytes(), 100000 * 48); // узел, слот хеш таблицы и метка
+}
+
+// фильтр не отсекает правила из одной метки и правила со звездочкой в конце
+TEST_F(DomainMatcherTest, FilterKeepsShortAndOpenRules)
+{
+    matcher_.build({"ru", "example.com"});
+    EXPECT_TRUE(matcher_.matches("vk.ru"));
+    EXPECT_TRUE(matcher_.matches("RU"));
+    matcher_.build({"*.ru"});
+    EXPECT_TRUE(matcher_.matches("vk.ru"));
+    EXPECT_FALSE(matcher_.matches("ru"));
+    matcher_.build({"ads.*"});
+    EXPECT_TRUE(matcher_.matches("x.ads.net"));
+    EXPECT_FALSE(matcher_.matches("ads.net.x"));
+    matcher_.build({"*", "!ok.ru"});
+    EXPECT_TRUE(matcher_.matches("anything.com"));
+    EXPECT_FALSE(matcher_.matches("ok.ru"));
+}
+
+// скомпилированный файл отображается в память и отвечает так же, как построенный trie
+TEST_F(DomainMatcherTest, CompiledFileRoundTrip)
+{
+    matcher_.build({"vk.com", "!m.vk.com", "*.example.com", "ads.*.cdn.net", "ru"});
+    ASSERT_TRUE(matcher_.save(file_));
+    Domain_matcher loaded;
+    ASSERT_TRUE(loaded.load(file_));
+    EXPECT_TRUE(loaded.mapped());
+    EXPECT_EQ(loaded.rules(), matcher_.rules());
+    EXPECT_EQ(loaded.nodes(), matcher_.nodes());
+    for(auto host : {"vk.com", "a.vk.com", "m.vk.com", "example.com", "www.example.com", "ads.eu.cdn.net", "img.eu.cdn.net",
+    "mail.ru", "ok.org"})
+        EXPECT_EQ(loaded.matches(host), matcher_.matches(host)) << host;
+    loaded.build({"ok.org"}); // после построения массивы снова свои
+    EXPECT_FALSE(loaded.mapped());
+    EXPECT_TRUE(loaded.matches("ok.org"));
+    EXPECT_FALSE(loaded.matches("vk.com"));
+}
+
+// toml молча не загружается (его разбирает конфиг), поврежденный файл не заменяет текущие правила
+TEST_F(DomainMatcherTest, LoadRejectsOtherFiles)
+{
+    matcher_.build({"vk.com"});
+    {
+        std::ofstream toml(file_);
+        toml << "[blacklist]\nhosts = [\n    \"vk.com\"\n]\n";
+    }
+    EXPECT_FALSE(matcher_.load(file_));
+    EXPECT_FALSE(matcher_.load("test_blacklist_missing.bin"));
+
+    Domain_matcher compiled;
+    compiled.build({"ok.ru"});
+    ASSERT_TRUE(compiled.save(file_));
+    std::filesystem::resize_file(file_, std::filesystem::file_size(file_) - 1);
+    EXPECT_FALSE(matcher_.load(file_));
+    EXPECT_FALSE(matcher_.mapped());
+    EXPECT_TRUE(matcher_.matches("vk.com"));
+}
@@ -0,0 +1,132 @@
+#include <gtest/gtest.h>
+#include <boost/asio.hpp>
+#include <memory>
+#include "network/happy_eyeballs.hpp"
+
+class HappyEyeballsTest : public ::testing::Test
+{
+protected:
+    using endpoint = boost::asio::ip::tcp::endpoint;
+
+    static endpoint make_endpoint(const std::string& address, unsigned short port)
+    {
+        return {boost::asio::ip::make_address(address), port};
+    }
+
+    static boost::asio::ip::tcp::resolver::results_type make_results(const std::vector<endpoint>& endpoints)
+    {
+        return boost::asio::ip::tcp::resolver::results_type::create(endpoints.begin(), endpoints.end(), "host", "80");
+    }
+
+    // подключение с ожиданием результата, возвращает время подключения
+    std::chrono::milliseconds connect(boost::asio::ip::tcp::socket& socket, const std::vector<endpoint>& endpoints,
+    std::chrono::milliseconds delay, std::chrono::milliseconds timeout)
+    {
+        auto start = std::chrono::steady_clock::now();
+        boost::asio::co_spawn(io_context_, [&]() -> boost::asio::awaitable<void>
+        {
+            co_await happy_eyeballs_connect(socket, make_results(endpoints), delay, timeout, ec_);
+            io_context_.stop();
+        }, boost::asio::detached);
+        io_context_.run_for(std::chrono::seconds(3));
+        return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+    }
+
+    // адрес, подключение к которому зависает: очередь accept'а с backlog 0 уже заполнена
+    endpoint blackhole()
+    {
+        blackhole_ = std::make_unique<boost::asio::ip::tcp::acceptor>(io_context_);
+        blackhole_->open(boost::asio::ip::tcp::v4());
+        blackhole_->bind(make_endpoint("127.0.0.1", 0));
+        blackhole_->listen(0);
+        filler_ = std::make_unique<boost::asio::ip::tcp::socket>(io_context_);
+        filler_->connect(blackhole_->local_endpoint());
+        return blackhole_->local_endpoint();
+    }
+
+    boost::asio::io_context io_context_;
+    boost::system::error_code ec_;
+    std::unique_ptr<boost::asio::ip::tcp::acceptor> blackhole_;
+    std::unique_ptr<boost::asio::ip::tcp::socket> filler_;
+};
+
+// семейства чередуются, первым идет IPv6
+TEST_F(HappyEyeballsTest, OrderInterleavesFamilies)
+{
+    auto order = happy_eyeballs_order(make_results({make_endpoint("10.0.0.1", 80), make_endpoint("10.0.0.2", 80),
+    make_endpoint("10.0.0.3", 80), make_endpoint("2001:db8::1", 80)}));
+    ASSERT_EQ(order.size(), 4);
+    EXPECT_EQ(order[0].address().to_string(), "2001:db8::1");
+    EXPECT_EQ(order[1].address().to_string(), "10.0.0.1");
+    EXPECT_EQ(order[2].address().to_string(), "10.0.0.2");
+    EXPECT_EQ(order[3].address().to_string(), "10.0.0.3");
+}
+
+// зависший первый адрес стоит только задержку между попытками
+TEST_F(HappyEyeballsTest, HangingAddressIsRaced)
+{
+    boost::asio::ip::tcp::acceptor listener(io_context_, make_endpoint("127.0.0.1", 0));
+    boost::asio::ip::tcp::socket socket(io_context_);
+    auto elapsed = connect(socket, {blackhole(), listener.local_endpoint()}, std::chrono::milliseconds(50), std::chrono::seconds(2));
+    ASSERT_FALSE(ec_);
+    EXPECT_EQ(socket.remote_endpoint(), listener.local_endpoint());
+    EXPECT_GE(elapsed, std::chrono::milliseconds(50));
+    EXPECT_LT(elapsed, std::chrono::milliseconds(1000));
+}
+
+// отказ в подключении сразу запускает следующую попытку, не дожидаясь задержки
+TEST_F(HappyEyeballsTest, RefusedAddressFallsThroughImmediately)
+{
+    boost::asio::ip::tcp::acceptor listener(io_context_, make_endpoint("127.0.0.1", 0));
+    boost::asio::ip::tcp::acceptor closed(io_context_, make_endpoint("127.0.0.1", 0));
+    auto closed_endpoint = closed.local_endpoint();
+    closed.close();
+    boost::asio::ip::tcp::socket socket(io_context_);
+    auto elapsed = connect(socket, {closed_endpoint, listener.local_endpoint()}, std::chrono::milliseconds(1000), std::chrono::seconds(2));
+    ASSERT_FALSE(ec_);
+    EXPECT_EQ(socket.remote_endpoint(), listener.local_endpoint());
+    EXPECT_LT(elapsed, std::chrono::milliseconds(500));
+}
+
+TEST_F(HappyEyeballsTest, AllAddressesFail)
+{
+    boost::asio::ip::tcp::acceptor first(io_context_, make_endpoint("127.0.0.1", 0));
+    boost::asio::ip::tcp::acceptor second(io_context_, make_endpoint("127.0.0.1", 0));
+    auto endpoints = std::vector<endpoint>{first.local_endpoint(), second.local_endpoint()};
+    first.close();
+    second.close();
+    boost::asio::ip::tcp::socket socket(io_context_);
+    connect(socket, endpoints, std::chrono::milliseconds(50), std::chrono::seconds(2));
+    EXPECT_EQ(ec_, boost::asio::error::connection_refused);
+    EXPECT_FALSE(socket.is_open());
+}
+
+// общий таймаут прерывает все попытки
+TEST_F(HappyEyeballsTest, TimeoutCancelsAttempts)
+{
+    auto hanging = blackhole();
+    boost::asio::ip::tcp::socket socket(io_context_);
+    auto elapsed = connect(socket, {hanging, hanging}, std::chrono::milliseconds(20), std::chrono::milliseconds(150));
+    EXPECT_EQ(ec_, boost::asio::error::timed_out);
+    EXPECT_GE(elapsed, std::chrono::milliseconds(150));
+    EXPECT_LT(elapsed, std::chrono::milliseconds(1000));
+}
+
+// единственный адрес (голый IP или одна A запись) тоже подчиняется общему таймауту
+TEST_F(HappyEyeballsTest, TimeoutAppliesToSingleAddress)
+{
+    auto hanging = blackhole();
+    boost::asio::ip::tcp::socket socket(io_context_);
+    auto elapsed = connect(socket, {hanging}, std::chrono::milliseconds(20), std::chrono::milliseconds(150));
+    EXPECT_EQ(ec_, boost::asio::error::timed_out);
+    EXPECT_FALSE(socket.is_open());
+    EXPECT_GE(elapsed, std::chrono::milliseconds(150));
+    EXPECT_LT(elapsed, std::chrono::milliseconds(1000));
+}
+
+TEST_F(HappyEyeballsTest, EmptyResults)
+{
+    boost::asio::ip::tcp::socket socket(io_context_);
+    connect(socket, {}, std::chrono::milliseconds(50), std::chrono::seconds(1));
+    EXPECT_EQ(ec_, boost::asio::error::not_found);
+}
@@ -0,0 +1,129 @@
+#include <gtest/gtest.h>
+#include <random>
+#include <string>
+#include <vector>
+#include "network/ip_matcher.hpp"
+
+class IpMatcherTest : public ::testing::Test
+{
+protected:
+    bool matches(const std::string& address) const
+    {
+        return matcher_.matches(boost::asio::ip::make_address(address));
+    }
+
+    Ip_matcher matcher_;
+};
+
+TEST_F(IpMatcherTest, EmptyMatchesNothing)
+{
+    EXPECT_TRUE(matcher_.empty());
+    EXPECT_FALSE(matches("10.0.0.1"));
+    EXPECT_FALSE(matches("::1"));
+}
+
+TEST_F(IpMatcherTest, PrefixCoversRange)
+{
+    matcher_.build({"10.0.0.0/8", "192.168.1.0/24", "203.0.113.7", "198.51.100.0/23"});
+    EXPECT_TRUE(matches("10.0.0.0"));
+    EXPECT_TRUE(matches("10.255.255.255"));
+    EXPECT_FALSE(matches("11.0.0.0"));
+    EXPECT_TRUE(matches("192.168.1.200"));
+    EXPECT_FALSE(matches("192.168.2.1"));
+    EXPECT_TRUE(matches("203.0.113.7"));
+    EXPECT_FALSE(matches("203.0.113.8"));
+    EXPECT_TRUE(matches("198.51.101.1"));
+    EXPECT_FALSE(matches("198.51.102.1"));
+    EXPECT_EQ(matcher_.rules(), 4);
+}
+
+// самый длинный префикс побеждает, при равной длине - исключение
+TEST_F(IpMatcherTest, LongestPrefixWins)
+{
+    matcher_.build({"10.0.0.0/8", "!10.1.0.0/16", "10.1.2.0/24", "@@10.1.2.3", "172.16.0.0/12", "!172.16.0.0/12"});
+    EXPECT_TRUE(matches("10.2.0.1"));
+    EXPECT_FALSE(matches("10.1.0.1"));
+    EXPECT_TRUE(matches("10.1.2.4"));
+    EXPECT_FALSE(matches("10.1.2.3"));
+    EXPECT_FALSE(matches("172.16.5.5"));
+}
+
+// порядок правил в списке не важен
+TEST_F(IpMatcherTest, OrderIndependent)
+{
+    matcher_.build({"10.1.2.0/24", "!10.1.0.0/16", "10.0.0.0/8"});
+    EXPECT_TRUE(matches("10.1.2.4"));
+    EXPECT_FALSE(matches("10.1.3.4"));
+    EXPECT_TRUE(matches("10.9.3.4"));
+}
+
+TEST_F(IpMatcherTest, Ipv6AndMappedAddresses)
+{
+    matcher_.build({"2001:db8::/32", "!2001:db8:1::/48", "::ffff:192.0.2.0/120", "::1"});
+    EXPECT_TRUE(matches("2001:db8:ffff::1"));
+    EXPECT_FALSE(matches("2001:db8:1::1"));
+    EXPECT_FALSE(matches("2001:db9::1"));
+    EXPECT_TRUE(matches("::1"));
+    EXPECT_TRUE(matches("192.0.2.55")); // правило в виде ipv4-mapped
+    EXPECT_TRUE(matches("::ffff:192.0.2.1")); // адрес в виде ipv4-mapped
+    EXPECT_FALSE(matches("192.0.3.1"));
+}
+
+// запрет всего, кроме разрешенных подсетей (список клиентов)
+TEST_F(IpMatcherTest, DenyAllExcept)
+{
+    matcher_.build({"0.0.0.0/0", "::/0", "!127.0.0.0/8", "!::1"});
+    EXPECT_FALSE(matches("127.0.0.1"));
+    EXPECT_FALSE(matches("::1"));
+    EXPECT_TRUE(matches("8.8.8.8"));
+    EXPECT_TRUE(matches("2001:db8::1"));
+}
+
+TEST_F(IpMatcherTest, CommentsAndInvalidRules)
+{
+    auto skipped = matcher_.build({"# feed header", "", "  10.0.0.0/8 ; SBL1 ", "10.0.0.0/33", "example.com", "1.2.3.4/", "::/129",
+    "::ffff:1.2.3.4/64", "10.9.9.9/8"});
+    EXPECT_EQ(skipped, 5);
+    EXPECT_EQ(matcher_.rules(), 1); // 10.9.9.9/8 - то же правило, биты за префиксом обнуляются
+    EXPECT_TRUE(matches("10.1.1.1"));
+}
+
+// сравнение с перебором всех правил на случайных префиксах и адресах
+TEST_F(IpMatcherTest, MatchesBruteForce)
+{
+    std::mt19937 random(7);
+    struct Rule
+    {
+        std::uint32_t address;
+        unsigned length;
+        bool allow;
+    };
+    std::vector<Rule> rules;
+    std::vector<std::string> text;
+    for(int i = 0; i < 2000; i++)
+    {
+        Rule rule{static_cast<std::uint32_t>(random()) & 0x0f0fffff, 8 + static_cast<unsigned>(random() % 25), random() % 3 == 0};
+        rule.address &= rule.length ? ~std::uint32_t(0) << (32 - rule.length) : 0;
+        rules.push_back(rule);
+        text.push_back((rule.allow ? "!" : "") + boost::asio::ip::address_v4(rule.address).to_string() + "/" + std::to_string(rule.length));
+    }
+    matcher_.build(text);
+    for(int i = 0; i < 20000; i++)
+    {
+        std::uint32_t address = static_cast<std::uint32_t>(random()) & 0x0f0fffff;
+        int best_length = -1;
+        bool blocked = false;
+        for(const auto& rule : rules)
+        {
+            auto mask = ~std::uint32_t(0) << (32 - rule.length);
+            if((address & mask) != rule.address)
+                continue;
+            if(static_cast<int>(rule.length) > best_length || (static_cast<int>(rule.length) == best_length && rule.allow))
+            {
+                best_length = rule.length;
+                blocked = !rule.allow;
+            }
+        }
+        ASSERT_EQ(matcher_.matches(boost::asio::ip::address_v4(address)), blocked) << boost::asio::ip::address_v4(address);
+    }
+}
@@ -0,0 +1,360 @@
+#include <gtest/gtest.h>
+#include <boost/asio.hpp>
+#include <memory>
+#include <vector>
+#include "network/server.hpp"
+#include "globals/globals.hpp"
+
+class ServerTest : public ::testing::Test
+{
+protected:
+    // получение свободного порта, acceptor с SO_REUSEPORT держит порт до конца теста
+    unsigned short reserve_port()
+    {
+        using reuse_port_option = boost::asio::detail::socket_option::boolean<SOL_SOCKET, SO_REUSEPORT>;
+        boost::asio::ip::tcp::endpoint endpoint(boost::asio::ip::tcp::v4(), 0);
+        holder_ = std::make_unique<boost::asio::ip::tcp::acceptor>(io_context_);
+        holder_->open(endpoint.protocol());
+        holder_->set_option(reuse_port_option(true));
+        holder_->bind(endpoint);
+        return holder_->local_endpoint().port();
+    }
+
+    boost::asio::io_context io_context_;
+    std::unique_ptr<boost::asio::ip::tcp::acceptor> holder_;
+    std::shared_ptr<User_traffic_manager> manager_ = std::make_shared<User_traffic_manager>();
+    std::shared_ptr<Connection_gate> gate_ = std::make_shared<Connection_gate>(16);
+};
+
+// один сервер без SO_REUSEPORT
+TEST_F(ServerTest, Construction)
+{
+    std::shared_ptr<Server> server;
+    EXPECT_NO_THROW(server = std::make_shared<Server>(io_context_, 0, manager_, gate_));
+}
+
+// несколько воркеров на одном порту с SO_REUSEPORT
+TEST_F(ServerTest, WorkersSharePortWithReusePort)
+{
+    auto port = reserve_port();
+    std::vector<std::unique_ptr<boost::asio::io_context>> contexts;
+    std::vector<std::shared_ptr<Server>> servers;
+    for(int i = 0; i < 4; i++)
+    {
+        auto& context = *contexts.emplace_back(std::make_unique<boost::asio::io_context>(1));
+        EXPECT_NO_THROW(servers.push_back(std::make_shared<Server>(context, port, manager_, gate_, true)));
+    }
+    EXPECT_EQ(servers.size(), 4);
+}
+
+// без SO_REUSEPORT второй сервер на том же порту не запускается
+TEST_F(ServerTest, SecondServerWithoutReusePortFails)
+{
+    auto port = reserve_port();
+    EXPECT_THROW(std::make_shared<Server>(io_context_, port, manager_, gate_, false), boost::system::system_error);
+}
+
+// при перегрузке в режиме быстрого отказа клиент получает 503 с Retry-After
+TEST_F(ServerTest, FastRejectWhenOverloaded)
+{
+    auto saved = __PROXY_GLOBALS__::PROXY_CONFIG.get();
+    auto config = *saved;
+    config.reject_when_overloaded = true;
+    config.retry_after_seconds = 7;
+    __PROXY_GLOBALS__::PROXY_CONFIG.publish(config);
+    auto full_gate = std::make_shared<Connection_gate>(1);
+    auto busy_slot = full_gate->try_acquire(); // единственный слот занят
+    ASSERT_TRUE(busy_slot.has_value());
+
+    boost::asio::ip::tcp::acceptor probe(io_context_, {boost::asio::ip::tcp::v4(), 0});
+    auto port = probe.local_endpoint().port();
+    probe.close();
+    auto server = std::make_shared<Server>(io_context_, port, manager_, full_gate);
+    boost::asio::co_spawn(io_context_, server->run(), boost::asio::detached);
+
+    std::string response;
+    boost::asio::co_spawn(io_context_, [&]() -> boost::asio::awaitable<void>
+    {
+        boost::asio::ip::tcp::socket client(io_context_);
+        co_await client.async_connect({boost::asio::ip::make_address("127.0.0.1"), port}, boost::asio::use_awaitable);
+        boost::system::error_code ec;
+        co_await boost::asio::async_read(client, boost::asio::dynamic_buffer(response),
+        boost::asio::redirect_error(boost::asio::use_awaitable, ec)); // читаем до закрытия соеденения
+    }, boost::asio::detached);
+    io_context_.run_for(std::chrono::milliseconds(500));
+
+    __PROXY_GLOBALS__::PROXY_CONFIG.publish(saved);
+    EXPECT_NE(response.find("503"), std::string::npos);
+    EXPECT_NE(response.find("Retry-After: 7"), std::string::npos);
+    EXPECT_EQ(full_gate->active(), 1);
+}
+
+// клиент, не приславший заголовок за header_timeout, получает 408, слот освобождается
+TEST_F(ServerTest, SlowHeaderGetsRequestTimeout)
+{
+    auto saved = __PROXY_GLOBALS__::PROXY_CONFIG.get();
+    auto config = *saved;
+    config.header_timeout_milliseconds = 100;
+    __PROXY_GLOBALS__::PROXY_CONFIG.publish(config);
+    boost::asio::ip::tcp::acceptor probe(io_context_, {boost::asio::ip::tcp::v4(), 0});
+    auto port = probe.local_endpoint().port();
+    probe.close();
+    auto server = std::make_shared<Server>(io_context_, port, manager_, gate_);
+    boost::asio::co_spawn(io_context_, server->run(), boost::asio::detached);
+
+    std::string response;
+    boost::asio::co_spawn(io_context_, [&]() -> boost::asio::awaitable<void>
+    {
+        boost::asio::ip::tcp::socket client(io_context_);
+        co_await client.async_connect({boost::asio::ip::make_address("127.0.0.1"), port}, boost::asio::use_awaitable);
+        co_await boost::asio::async_write(client, boost::asio::buffer(std::string("GET http://example.com/ HTTP/1.1\r\n")),
+        boost::asio::use_awaitable); // заголовок не дописан
+        boost::system::error_code ec;
+        co_await boost::asio::async_read(client, boost::asio::dynamic_buffer(response),
+        boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+    }, boost::asio::detached);
+    io_context_.run_for(std::chrono::milliseconds(500));
+
+    __PROXY_GLOBALS__::PROXY_CONFIG.publish(saved);
+    EXPECT_NE(response.find("408"), std::string::npos);
+    EXPECT_EQ(gate_->active(), 0); // слоты держат только принятые соеденения
+}
+
+// upstream принял соеденение, но не ответил за first_byte_timeout - клиент получает 504
+TEST_F(ServerTest, SilentUpstreamGetsGatewayTimeout)
+{
+    auto saved = __PROXY_GLOBALS__::PROXY_CONFIG.get();
+    auto config = *saved;
+    config.first_byte_timeout_milliseconds = 100;
+    __PROXY_GLOBALS__::PROXY_CONFIG.publish(config);
+    boost::asio::ip::tcp::acceptor upstream(io_context_, {boost::asio::ip::make_address("127.0.0.1"), 0});
+    auto upstream_port = upstream.local_endpoint().port();
+    boost::asio::ip::tcp::socket upstream_peer(io_context_);
+    upstream.async_accept(upstream_peer, [](boost::system::error_code){}); // принимает и молчит
+    boost::asio::ip::tcp::acceptor probe(io_context_, {boost::asio::ip::tcp::v4(), 0});
+    auto port = probe.local_endpoint().port();
+    probe.close();
+    auto server = std::make_shared<Server>(io_context_, port, manager_, gate_);
+    boost::asio::co_spawn(io_context_, server->run(), boost::asio::detached);
+
+    std::string response;
+    boost::asio::co_spawn(io_context_, [&]() -> boost::asio::awaitable<void>
+    {
+        boost::asio::ip::tcp::socket client(io_context_);
+        co_await client.async_connect({boost::asio::ip::make_address("127.0.0.1"), port}, boost::asio::use_awaitable);
+        auto target = "127.0.0.1:" + std::to_string(upstream_port);
+        auto request = "GET http://" + target + "/ HTTP/1.1\r\nHost: " + target + "\r\n\r\n";
+        co_await boost::asio::async_write(client, boost::asio::buffer(request), boost::asio::use_awaitable);
+        boost::system::error_code ec;
+        co_await boost::asio::async_read_until(client, boost::asio::dynamic_buffer(response), "\r\n\r\n",
+        boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+    }, boost::asio::detached);
+    io_context_.run_for(std::chrono::milliseconds(500));
+
+    __PROXY_GLOBALS__::PROXY_CONFIG.publish(saved);
+    EXPECT_NE(response.find("504"), std::string::npos);
+    EXPECT_TRUE(upstream_peer.is_open());
+}
+
+// CONNECT на единственный адрес, где SYN остается без ответа: срок connect_timeout_milliseconds, а не ретраи ядра
+TEST_F(ServerTest, UnreachableSingleAddressGetsGatewayTimeout)
+{
+    auto saved = __PROXY_GLOBALS__::PROXY_CONFIG.get();
+    auto config = *saved;
+    config.connect_timeout_milliseconds = 100;
+    __PROXY_GLOBALS__::PROXY_CONFIG.publish(config);
+    // очередь accept'а с backlog 0 уже заполнена - подключение зависает, как к недоступному адресу
+    boost::asio::ip::tcp::acceptor upstream(io_context_);
+    upstream.open(boost::asio::ip::tcp::v4());
+    upstream.bind({boost::asio::ip::make_address("127.0.0.1"), 0});
+    upstream.listen(0);
+    boost::asio::ip::tcp::socket filler(io_context_);
+    filler.connect(upstream.local_endpoint());
+    auto upstream_port = upstream.local_endpoint().port();
+    boost::asio::ip::tcp::acceptor probe(io_context_, {boost::asio::ip::tcp::v4(), 0});
+    auto port = probe.local_endpoint().port();
+    probe.close();
+    auto server = std::make_shared<Server>(io_context_, port, manager_, gate_);
+    boost::asio::co_spawn(io_context_, server->run(), boost::asio::detached);
+
+    std::string response;
+    boost::asio::co_spawn(io_context_, [&]() -> boost::asio::awaitable<void>
+    {
+        boost::asio::ip::tcp::socket client(io_context_);
+        co_await client.async_connect({boost::asio::ip::make_address("127.0.0.1"), port}, boost::asio::use_awaitable);
+        auto target = "127.0.0.1:" + std::to_string(upstream_port);
+        auto request = "CONNECT " + target + " HTTP/1.1\r\nHost: " + target + "\r\n\r\n";
+        co_await boost::asio::async_write(client, boost::asio::buffer(request), boost::asio::use_awaitable);
+        boost::system::error_code ec;
+        co_await boost::asio::async_read_until(client, boost::asio::dynamic_buffer(response), "\r\n\r\n",
+        boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+    }, boost::asio::detached);
+    io_context_.run_for(std::chrono::milliseconds(600));
+
+    __PROXY_GLOBALS__::PROXY_CONFIG.publish(saved);
+    EXPECT_NE(response.find("504"), std::string::npos);
+}
+
+// сессия оставляет в access log'е запись с фазами, байтами и статусом, те же события попадают в метрики
+TEST_F(ServerTest, AccessLogRecordsSession)
+{
+    const std::string file = "test_access_session.bin";
+    auto& metrics = __PROXY_GLOBALS__::METRICS;
+    auto requests = metrics.registry.value(metrics.requests);
+    auto completed = metrics.registry.value(metrics.sessions[static_cast<std::size_t>(Access_end::completed)]);
+    auto bytes_down = metrics.registry.value(metrics.bytes_download);
+    __PROXY_GLOBALS__::ACCESS_LOG.open(file, 1024 * 1024);
+    boost::asio::ip::tcp::acceptor upstream(io_context_, {boost::asio::ip::make_address("127.0.0.1"), 0});
+    auto upstream_port = upstream.local_endpoint().port();
+    boost::asio::co_spawn(io_context_, [&]() -> boost::asio::awaitable<void>
+    {
+        auto socket = co_await upstream.async_accept(boost::asio::use_awaitable);
+        std::array<char, 1024> request;
+        co_await socket.async_read_some(boost::asio::buffer(request), boost::asio::use_awaitable);
+        const std::string response = "HTTP/1.1 200 OK\r\nContent-Length: 5\r\n\r\nhello";
+        co_await boost::asio::async_write(socket, boost::asio::buffer(response), boost::asio::use_awaitable);
+    }, boost::asio::detached);
+    boost::asio::ip::tcp::acceptor probe(io_context_, {boost::asio::ip::tcp::v4(), 0});
+    auto port = probe.local_endpoint().port();
+    probe.close();
+    auto server = std::make_shared<Server>(io_context_, port, manager_, gate_);
+    boost::asio::co_spawn(io_context_, server->run(), boost::asio::detached);
+
+    std::string request;
+    boost::asio::co_spawn(io_context_, [&]() -> boost::asio::awaitable<void>
+    {
+        boost::asio::ip::tcp::socket client(io_context_);
+        co_await client.async_connect({boost::asio::ip::make_address("127.0.0.1"), port}, boost::asio::use_awaitable);
+        auto target = "127.0.0.1:" + std::to_string(upstream_port);
+        request = "GET http://" + target + "/ HTTP/1.1\r\nHost: " + target + "\r\nConnection: close\r\n\r\n";
+        co_await boost::asio::async_write(client, boost::asio::buffer(request), boost::asio::use_awaitable);
+        std::string response;
+        boost::system::error_code ec;
+        co_await boost::asio::async_read(client, boost::asio::dynamic_buffer(response),
+        boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+    }, boost::asio::detached);
+    io_context_.run_for(std::chrono::milliseconds(500));
+    __PROXY_GLOBALS__::ACCESS_LOG.close();
+
+    std::vector<Access_record> records;
+    ASSERT_TRUE(Access_log::load(file, records));
+    std::remove(file.c_str());
+    ASSERT_EQ(records.size(), 1);
+    auto& record = records[0];
+    EXPECT_EQ(record.status, 200);
+    EXPECT_EQ(record.end, Access_end::completed);
+    EXPECT_EQ(record.requests, 1);
+    EXPECT_EQ(record.host_name(), "127.0.0.1");
+    EXPECT_EQ(record.port, upstream_port);
+    EXPECT_EQ(Access_record::unpack_address(record.client_address).to_string(), "127.0.0.1");
+    EXPECT_EQ(Access_record::unpack_address(record.upstream_address).to_string(), "127.0.0.1");
+    EXPECT_GT(record.bytes_up, 0); // запрос переписан (абсолютный url -> путь), длина другая
+    EXPECT_GT(record.bytes_down, 5);
+    EXPECT_NE(record.headers, Access_record::NONE);
+    EXPECT_LE(record.headers, record.resolved);
+    EXPECT_LE(record.resolved, record.connected);
+    EXPECT_LE(record.connected, record.first_byte);
+    EXPECT_LE(record.first_byte, record.duration);
+
+    EXPECT_EQ(metrics.registry.value(metrics.requests), requests + 1);
+    EXPECT_EQ(metrics.registry.value(metrics.sessions[static_cast<std::size_t>(Access_end::completed)]), completed + 1);
+    EXPECT_EQ(metrics.registry.value(metrics.bytes_download), bytes_down + record.bytes_down); // ответ upstream'а целиком пересылается
+}
+
+// CONNECT на адрес из черного списка не доходит до upstream'а
+TEST_F(ServerTest, BlacklistedDestinationAddress)
+{
+    auto blacklist = std::make_shared<Ip_matcher>();
+    blacklist->build({"127.0.0.0/8"});
+    __PROXY_GLOBALS__::BLACKLISTED_ADDRESSES.publish(blacklist);
+    boost::asio::ip::tcp::acceptor upstream(io_context_, {boost::asio::ip::make_address("127.0.0.1"), 0});
+    auto upstream_port = upstream.local_endpoint().port();
+    bool upstream_accepted = false;
+    boost::asio::ip::tcp::socket upstream_peer(io_context_);
+    upstream.async_accept(upstream_peer, [&](boost::system::error_code ec) {upstream_accepted = !ec;});
+    boost::asio::ip::tcp::acceptor probe(io_context_, {boost::asio::ip::tcp::v4(), 0});
+    auto port = probe.local_endpoint().port();
+    probe.close();
+    auto server = std::make_shared<Server>(io_context_, port, manager_, gate_);
+    boost::asio::co_spawn(io_context_, server->run(), boost::asio::detached);
+
+    std::string response;
+    boost::asio::co_spawn(io_context_, [&]() -> boost::asio::awaitable<void>
+    {
+        boost::asio::ip::tcp::socket client(io_context_);
+        co_await client.async_connect({boost::asio::ip::make_address("127.0.0.1"), port}, boost::asio::use_awaitable);
+        auto target = "127.0.0.1:" + std::to_string(upstream_port);
+        auto request = "CONNECT " + target + " HTTP/1.1\r\nHost: " + target + "\r\n\r\n";
+        co_await boost::asio::async_write(client, boost::asio::buffer(request), boost::asio::use_awaitable);
+        boost::system::error_code ec;
+        co_await boost::asio::async_read(client, boost::asio::dynamic_buffer(response),
+        boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+    }, boost::asio::detached);
+    io_context_.run_for(std::chrono::milliseconds(500));
+
+    __PROXY_GLOBALS__::BLACKLISTED_ADDRESSES.publish(std::make_shared<Ip_matcher>());
+    EXPECT_NE(response.find("BLACKLISTED ADDRESS"), std::string::npos);
+    EXPECT_FALSE(upstream_accepted);
+}
+
+// клиент из черного списка отключается сразу после accept, сессия не создается
+TEST_F(ServerTest, BlacklistedClientIsClosed)
+{
+    auto blacklist = std::make_shared<Ip_matcher>();
+    blacklist->build({"0.0.0.0/0", "::/0"});
+    __PROXY_GLOBALS__::BLACKLISTED_CLIENTS.publish(blacklist);
+    auto& metrics = __PROXY_GLOBALS__::METRICS;
+    auto rejected = metrics.registry.value(metrics.rejected_client);
+    boost::asio::ip::tcp::acceptor probe(io_context_, {boost::asio::ip::tcp::v4(), 0});
+    auto port = probe.local_endpoint().port();
+    probe.close();
+    auto server = std::make_shared<Server>(io_context_, port, manager_, gate_);
+    boost::asio::co_spawn(io_context_, server->run(), boost::asio::detached);
+
+    std::string response;
+    boost::system::error_code read_ec;
+    boost::asio::co_spawn(io_context_, [&]() -> boost::asio::awaitable<void>
+    {
+        boost::asio::ip::tcp::socket client(io_context_);
+        co_await client.async_connect({boost::asio::ip::make_address("127.0.0.1"), port}, boost::asio::use_awaitable);
+        auto request = std::string("GET http://example.com/ HTTP/1.1\r\nHost: example.com\r\n\r\n");
+        boost::system::error_code ec;
+        co_await boost::asio::async_write(client, boost::asio::buffer(request), boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+        co_await boost::asio::async_read(client, boost::asio::dynamic_buffer(response),
+        boost::asio::redirect_error(boost::asio::use_awaitable, read_ec));
+    }, boost::asio::detached);
+    io_context_.run_for(std::chrono::milliseconds(300));
+
+    __PROXY_GLOBALS__::BLACKLISTED_CLIENTS.publish(std::make_shared<Ip_matcher>());
+    EXPECT_TRUE(response.empty());
+    EXPECT_TRUE(read_ec == boost::asio::error::eof || read_ec == boost::asio::error::connection_reset);
+    EXPECT_EQ(gate_->active(), 0); // слоты держат только принятые соеденения
+    EXPECT_EQ(metrics.registry.value(metrics.rejected_client), rejected + 1);
+}
+
+// без быстрого отказа соеденение принимается сразу, а слот ждет уже принятое соеденение
+TEST_F(ServerTest, AcceptedConnectionWaitsForSlot)
+{
+    auto full_gate = std::make_shared<Connection_gate>(1);
+    auto busy_slot = full_gate->try_acquire(); // единственный слот занят
+    ASSERT_TRUE(busy_slot.has_value());
+    boost::asio::ip::tcp::acceptor probe(io_context_, {boost::asio::ip::tcp::v4(), 0});
+    auto port = probe.local_endpoint().port();
+    probe.close();
+    auto server = std::make_shared<Server>(io_context_, port, manager_, full_gate);
+    boost::asio::co_spawn(io_context_, server->run(), boost::asio::detached);
+    io_context_.run_for(std::chrono::milliseconds(50));
+    EXPECT_EQ(full_gate->waiting(), 0); // цикл accept'а слот не занимает
+
+    boost::asio::ip::tcp::socket client(io_context_);
+    client.connect({boost::asio::ip::make_address("127.0.0.1"), port});
+    io_context_.restart();
+    io_context_.run_for(std::chrono::milliseconds(50));
+    EXPECT_EQ(full_gate->waiting(), 1);
+
+    busy_slot.reset(); // слот уходит ожидающему соеденению
+    io_context_.restart();
+    io_context_.run_for(std::chrono::milliseconds(50));
+    EXPECT_EQ(full_gate->waiting(), 0);
+    EXPECT_EQ(full_gate->active(), 1);
+}
@@ -0,0 +1,149 @@
+#include <gtest/gtest.h>
+#include <boost/asio.hpp>
+#include <csignal>
+#include <random>
+#include "network/tunnel.hpp"
+#include "utils/timer.hpp"
+#include "utils/buffer_pool.hpp"
+
+class TunnelTest : public ::testing::Test
+{
+protected:
+    using socket_type = boost::asio::ip::tcp::socket;
+    using transfer_type = decltype(&copy_transfer);
+
+    void SetUp() override
+    {
+        std::signal(SIGPIPE, SIG_IGN);
+    }
+
+    // пара соединенных сокетов на loopback
+    std::pair<socket_type, socket_type> make_pair()
+    {
+        boost::asio::ip::tcp::acceptor acceptor(io_context_, {boost::asio::ip::make_address("127.0.0.1"), 0});
+        socket_type client(io_context_);
+        client.connect(acceptor.local_endpoint());
+        return {std::move(client), acceptor.accept()};
+    }
+
+    // данные пишутся в source, проходят через transfer (source -> input ... output -> sink) и читаются из sink
+    std::string run_transfer(transfer_type transfer, const std::string& data, Limiter_chain& limiter)
+    {
+        auto [source, input] = make_pair();
+        auto [output, sink] = make_pair();
+        boost::asio::any_io_executor executor = io_context_.get_executor();
+        auto timer = std::make_shared<Timer>(executor, 10000);
+        std::atomic_bool finished = false;
+        std::string received;
+
+        boost::asio::co_spawn(io_context_, [&]() -> boost::asio::awaitable<void>
+        {
+            co_await boost::asio::async_write(source, boost::asio::buffer(data), boost::asio::use_awaitable);
+            source.shutdown(socket_type::shutdown_send);
+        }, boost::asio::detached);
+        boost::asio::co_spawn(io_context_, [&]() -> boost::asio::awaitable<void>
+        {
+            boost::system::error_code ec;
+            co_await transfer(input, output, limiter, *timer, finished, transferred_, ec);
+            output.shutdown(socket_type::shutdown_send, ec); // как close_both в сессии
+        }, boost::asio::detached);
+        boost::asio::co_spawn(io_context_, [&]() -> boost::asio::awaitable<void>
+        {
+            boost::system::error_code ec;
+            co_await boost::asio::async_read(sink, boost::asio::dynamic_buffer(received), boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+            timer->stop();
+            io_context_.stop();
+        }, boost::asio::detached);
+        io_context_.run_for(std::chrono::seconds(10));
+        return received;
+    }
+
+    static std::string random_data(std::size_t size)
+    {
+        std::mt19937 generator(42);
+        std::string data(size, '\0');
+        for(auto& i : data)
+            i = static_cast<char>(generator());
+        return data;
+    }
+
+    boost::asio::io_context io_context_;
+    std::uint64_t transferred_ = 0; // счетчик байт последнего run_transfer
+};
+
+TEST_F(TunnelTest, CopyTransfersAllBytes)
+{
+    Limiter_chain limiter{std::make_shared<Traffic_limiter>(1024 * 1024 * 1024)};
+    auto data = random_data(2 * 1024 * 1024);
+    EXPECT_EQ(run_transfer(copy_transfer, data, limiter), data);
+    EXPECT_EQ(transferred_, data.size());
+}
+
+TEST_F(TunnelTest, SpliceTransfersAllBytes)
+{
+    Limiter_chain limiter{std::make_shared<Traffic_limiter>(1024 * 1024 * 1024)};
+    auto data = random_data(2 * 1024 * 1024);
+    EXPECT_EQ(run_transfer(splice_transfer, data, limiter), data);
+    EXPECT_EQ(transferred_, data.size());
+}
+
+// splice не обходит лимит трафика: 300000 байт в запасе, остальные 100000 идут со скоростью 200000 байт/сек
+TEST_F(TunnelTest, SpliceHonoursLimiter)
+{
+    Limiter_chain limiter{std::make_shared<Traffic_limiter>(200000)};
+    auto data = random_data(400000);
+    auto start = std::chrono::steady_clock::now();
+    EXPECT_EQ(run_transfer(splice_transfer, data, limiter), data);
+    EXPECT_GE(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(400));
+}
+
+TEST_F(TunnelTest, SpliceStopsWhenFinished)
+{
+    auto [source, input] = make_pair();
+    auto [output, sink] = make_pair();
+    Limiter_chain limiter{std::make_shared<Traffic_limiter>(1024 * 1024)};
+    boost::asio::any_io_executor executor = io_context_.get_executor();
+    auto timer = std::make_shared<Timer>(executor, 10000);
+    std::atomic_bool finished = true; // вторая сторона туннеля уже завершилась
+    bool done = false;
+    boost::asio::co_spawn(io_context_, [&]() -> boost::asio::awaitable<void>
+    {
+        boost::system::error_code ec;
+        std::uint64_t transferred = 0;
+        co_await splice_transfer(input, output, limiter, *timer, finished, transferred, ec);
+        done = true;
+        timer->stop();
+    }, boost::asio::detached);
+    io_context_.run_for(std::chrono::milliseconds(500));
+    EXPECT_TRUE(done);
+}
+
+// простаивающий туннель не держит буфер, буфер берется только на время пересылки
+TEST_F(TunnelTest, IdleTunnelHoldsNoBuffer)
+{
+    auto [source, input] = make_pair();
+    auto [output, sink] = make_pair();
+    Limiter_chain limiter{std::make_shared<Traffic_limiter>(1024 * 1024)};
+    boost::asio::any_io_executor executor = io_context_.get_executor();
+    auto timer = std::make_shared<Timer>(executor, 10000);
+    std::atomic_bool finished = false;
+    auto outstanding = Buffer_pool::local()->outstanding();
+    boost::asio::co_spawn(io_context_, [&]() -> boost::asio::awaitable<void>
+    {
+        boost::system::error_code ec;
+        std::uint64_t transferred = 0;
+        co_await copy_transfer(input, output, limiter, *timer, finished, transferred, ec);
+    }, boost::asio::detached);
+    io_context_.run_for(std::chrono::milliseconds(50));
+    EXPECT_EQ(Buffer_pool::local()->outstanding(), outstanding);
+
+    source.write_some(boost::asio::buffer(std::string("ping")));
+    std::array<char, 4> echo;
+    io_context_.run_for(std::chrono::milliseconds(50));
+    boost::asio::read(sink, boost::asio::buffer(echo));
+    EXPECT_EQ(std::string(echo.data(), echo.size()), "ping");
+    EXPECT_EQ(Buffer_pool::local()->outstanding(), outstanding);
+    timer->stop();
+    source.close(); // туннель завершается до уничтожения лимитеров (запас токенов возвращается в деструкторе)
+    io_context_.run_for(std::chrono::milliseconds(50));
+}
@@ -0,0 +1,233 @@
+#include <gtest/gtest.h>
+#include <boost/asio.hpp>
+#include <chrono>
+#include <memory>
+#include <optional>
+#include <thread>
+#include <vector>
+#include "network/upstream_pool.hpp"
+
+class UpstreamPoolTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        acceptor_.open(boost::asio::ip::tcp::v4());
+        acceptor_.bind({boost::asio::ip::make_address("127.0.0.1"), 0});
+        acceptor_.listen();
+        port_ = std::to_string(acceptor_.local_endpoint().port());
+    }
+
+    std::shared_ptr<Upstream_pool> make_pool(std::size_t max_idle, std::size_t max_per_host,
+    std::chrono::milliseconds idle_timeout = std::chrono::milliseconds(10000))
+    {
+        return std::make_shared<Upstream_pool>(io_context_.get_executor(), max_idle, max_per_host, idle_timeout);
+    }
+
+    // синхронный запуск корутины в io_context теста
+    template<typename T>
+    T run(boost::asio::awaitable<T> awaitable)
+    {
+        std::optional<T> result;
+        boost::asio::co_spawn(io_context_, std::move(awaitable), [&](std::exception_ptr, T value)
+        {
+            result = std::move(value);
+        });
+        io_context_.restart();
+        while(!result && io_context_.run_one_for(std::chrono::milliseconds(500)))
+            ;
+        EXPECT_TRUE(result.has_value());
+        return std::move(*result);
+    }
+
+    // подключение нового соеденения и прием его на стороне "сервера"
+    void connect(const std::shared_ptr<Upstream_pool::Connection>& connection)
+    {
+        connection->socket()->connect(acceptor_.local_endpoint());
+        server_sockets_.push_back(acceptor_.accept());
+    }
+
+    boost::asio::io_context io_context_;
+    boost::asio::ip::tcp::acceptor acceptor_{io_context_};
+    std::vector<boost::asio::ip::tcp::socket> server_sockets_;
+    std::string port_;
+};
+
+// новое соеденение не открыто, подключается вызывающий
+TEST_F(UpstreamPoolTest, FirstAcquireReturnsFreshConnection)
+{
+    auto pool = make_pool(8, 0);
+    auto connection = run(pool->acquire("127.0.0.1", port_));
+
+    EXPECT_FALSE(connection->is_reused());
+    EXPECT_FALSE(connection->socket()->is_open());
+    EXPECT_EQ(pool->connections_count("127.0.0.1", port_), 1);
+}
+
+// соеденение помеченное keep_alive переиспользуется
+TEST_F(UpstreamPoolTest, KeepAliveConnectionIsReused)
+{
+    auto pool = make_pool(8, 0);
+    std::shared_ptr<boost::asio::ip::tcp::socket> first_socket;
+    {
+        auto connection = run(pool->acquire("127.0.0.1", port_));
+        connect(connection);
+        first_socket = connection->socket();
+        connection->keep_alive();
+    }
+    EXPECT_EQ(pool->idle_count(), 1);
+
+    auto connection = run(pool->acquire("127.0.0.1", port_));
+    EXPECT_TRUE(connection->is_reused());
+    EXPECT_EQ(connection->socket(), first_socket);
+    EXPECT_EQ(pool->idle_count(), 0);
+}
+
+// без keep_alive соеденение закрывается
+TEST_F(UpstreamPoolTest, ConnectionWithoutKeepAliveIsClosed)
+{
+    auto pool = make_pool(8, 0);
+    std::shared_ptr<boost::asio::ip::tcp::socket> socket;
+    {
+        auto connection = run(pool->acquire("127.0.0.1", port_));
+        connect(connection);
+        socket = connection->socket();
+    }
+    EXPECT_FALSE(socket->is_open());
+    EXPECT_EQ(pool->idle_count(), 0);
+    EXPECT_EQ(pool->connections_count("127.0.0.1", port_), 0);
+}
+
+// соеденение закрытое сервером не выдается повторно
+TEST_F(UpstreamPoolTest, ClosedByServerIsNotReused)
+{
+    auto pool = make_pool(8, 0);
+    {
+        auto connection = run(pool->acquire("127.0.0.1", port_));
+        connect(connection);
+        connection->keep_alive();
+    }
+    server_sockets_.back().close();
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+    auto connection = run(pool->acquire("127.0.0.1", port_));
+    EXPECT_FALSE(connection->is_reused());
+    EXPECT_EQ(pool->connections_count("127.0.0.1", port_), 1);
+}
+
+// соеденения с истекшим idle timeout не выдаются
+TEST_F(UpstreamPoolTest, IdleTimeoutExpires)
+{
+    auto pool = make_pool(8, 0, std::chrono::milliseconds(20));
+    {
+        auto connection = run(pool->acquire("127.0.0.1", port_));
+        connect(connection);
+        connection->keep_alive();
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(40));
+
+    auto connection = run(pool->acquire("127.0.0.1", port_));
+    EXPECT_FALSE(connection->is_reused());
+}
+
+// лимит idle соеденений во всем пуле
+TEST_F(UpstreamPoolTest, MaxIdleLimit)
+{
+    auto pool = make_pool(1, 0);
+    {
+        auto first = run(pool->acquire("127.0.0.1", port_));
+        auto second = run(pool->acquire("127.0.0.1", port_));
+        connect(first);
+        connect(second);
+        first->keep_alive();
+        second->keep_alive();
+    }
+    EXPECT_EQ(pool->idle_count(), 1);
+    EXPECT_EQ(pool->connections_count("127.0.0.1", port_), 1);
+}
+
+// при лимите соеденений к хосту acquire ждет освобождения
+TEST_F(UpstreamPoolTest, PerHostLimitWaits)
+{
+    auto pool = make_pool(8, 1);
+    auto busy = run(pool->acquire("127.0.0.1", port_));
+    connect(busy);
+    busy->keep_alive();
+
+    std::shared_ptr<Upstream_pool::Connection> second;
+    boost::asio::co_spawn(io_context_, [&]() -> boost::asio::awaitable<void>
+    {
+        second = co_await pool->acquire("127.0.0.1", port_);
+    }, boost::asio::detached);
+    io_context_.restart();
+    io_context_.run_for(std::chrono::milliseconds(30));
+    EXPECT_EQ(second, nullptr);
+
+    // другие хосты не ограничены
+    auto other = run(pool->acquire("localhost", port_));
+    EXPECT_NE(other, nullptr);
+
+    busy.reset(); // соеденение вернулось в пул и сразу ушло ожидающему
+    io_context_.restart();
+    io_context_.run_for(std::chrono::milliseconds(30));
+    ASSERT_NE(second, nullptr);
+    EXPECT_TRUE(second->is_reused());
+}
+
+// сверх лимита хоста место ждется не дольше срока, затем nullptr
+TEST_F(UpstreamPoolTest, AcquirePastPerHostLimitTimesOut)
+{
+    auto pool = make_pool(8, 1);
+    auto busy = run(pool->acquire("127.0.0.1", port_));
+    connect(busy);
+
+    auto start = std::chrono::steady_clock::now();
+    auto second = run(pool->acquire("127.0.0.1", port_, std::chrono::milliseconds(50)));
+    EXPECT_EQ(second, nullptr);
+    EXPECT_GE(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(50));
+    EXPECT_EQ(pool->connections_count("127.0.0.1", port_), 1);
+
+    // ожидавший по сроку убран из очереди: освобожденное место берется сразу
+    busy.reset();
+    auto third = run(pool->acquire("127.0.0.1", port_, std::chrono::milliseconds(50)));
+    EXPECT_NE(third, nullptr);
+}
+
+// отсоединенное соеденение (туннель после 101) сразу освобождает место, сокет остается открытым
+TEST_F(UpstreamPoolTest, DetachFreesPerHostSlot)
+{
+    auto pool = make_pool(8, 1);
+    auto upgraded = run(pool->acquire("127.0.0.1", port_));
+    connect(upgraded);
+    auto socket = upgraded->socket();
+    upgraded->detach();
+    EXPECT_EQ(pool->connections_count("127.0.0.1", port_), 0);
+
+    auto next = run(pool->acquire("127.0.0.1", port_, std::chrono::milliseconds(50)));
+    EXPECT_NE(next, nullptr);
+
+    upgraded.reset(); // в пул не возвращается и не закрывается
+    EXPECT_TRUE(socket->is_open());
+    EXPECT_EQ(pool->idle_count(), 0);
+    EXPECT_EQ(pool->connections_count("127.0.0.1", port_), 1);
+}
+
+// sweeper закрывает устаревшие соеденения
+TEST_F(UpstreamPoolTest, SweeperClosesExpired)
+{
+    auto pool = make_pool(8, 0, std::chrono::milliseconds(50));
+    std::shared_ptr<boost::asio::ip::tcp::socket> socket;
+    {
+        auto connection = run(pool->acquire("127.0.0.1", port_));
+        connect(connection);
+        socket = connection->socket();
+        connection->keep_alive();
+    }
+    boost::asio::co_spawn(io_context_, pool->run_sweeper(), boost::asio::detached);
+    io_context_.restart();
+    io_context_.run_for(std::chrono::milliseconds(250));
+
+    EXPECT_FALSE(socket->is_open());
+    EXPECT_EQ(pool->idle_count(), 0);
+    EXPECT_EQ(pool->connections_count("127.0.0.1", port_), 0);
+}
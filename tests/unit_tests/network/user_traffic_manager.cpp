@@ -6,6 +6,7 @@
 #include <vector>
 #include <memory>
 #include "network/user_traffic_manager.hpp"
+#include "globals/globals.hpp"
 
 class UserTrafficManagerTest : public ::testing::Test
 {
@@ -278,4 +279,114 @@ TEST_F(UserTrafficManagerTest, LongIpStrings)
     // получаем тот же
     auto limiter2 = manager_.get_or_create_user(long_ip);
     EXPECT_EQ(limiter.get(), limiter2.get());
-}
\ No newline at end of file
+}
+
+// у отправки и загрузки отдельные ведра
+TEST_F(UserTrafficManagerTest, DirectionsHaveSeparateBudgets)
+{
+    auto upload = manager_.get_or_create_user("10.0.0.1", User_traffic_manager::Direction::upload);
+    auto download = manager_.get_or_create_user("10.0.0.1", User_traffic_manager::Direction::download);
+    EXPECT_NE(upload.get(), download.get());
+    EXPECT_EQ(download.get(), manager_.get_or_create_user("10.0.0.1").get()); // по умолчанию - загрузка
+}
+
+// по умолчанию в цепочке только пользователь, остальные уровни выключены
+TEST_F(UserTrafficManagerTest, DefaultChainHasOnlyUserLevel)
+{
+    EXPECT_EQ(manager_.global(User_traffic_manager::Direction::download), nullptr);
+    EXPECT_EQ(manager_.make_connection_limiter(), nullptr);
+    EXPECT_EQ(manager_.get_or_create_destination("example.com", User_traffic_manager::Direction::upload), nullptr);
+    auto chain = manager_.make_chain(boost::asio::ip::make_address("10.0.0.1"), "example.com", User_traffic_manager::Direction::download);
+    EXPECT_EQ(chain.size(), 1);
+}
+
+// лимит пользователя 0 - уровень выключен, а не остановлен
+TEST_F(UserTrafficManagerTest, ZeroUserRateDisablesUserLevel)
+{
+    auto saved = __PROXY_GLOBALS__::PROXY_CONFIG.get();
+    auto config = *saved;
+    config.max_bandwidth_per_sec = 0;
+    __PROXY_GLOBALS__::PROXY_CONFIG.publish(config);
+    User_traffic_manager manager;
+
+    EXPECT_EQ(manager.get_or_create_user("10.0.0.1"), nullptr);
+    EXPECT_EQ(manager.get_or_create_user("not-an-ip"), nullptr);
+    auto chain = manager.make_chain(boost::asio::ip::make_address("10.0.0.1"), "example.com", User_traffic_manager::Direction::download);
+    EXPECT_EQ(chain.size(), 0);
+    __PROXY_GLOBALS__::PROXY_CONFIG.publish(saved);
+}
+
+// все уровни включены: соеденение, хост, пользователь, весь прокси
+TEST_F(UserTrafficManagerTest, FullHierarchy)
+{
+    auto saved = __PROXY_GLOBALS__::PROXY_CONFIG.get();
+    auto config = *saved;
+    config.global_upload_bandwidth_per_sec = 10000000;
+    config.global_download_bandwidth_per_sec = 20000000;
+    config.connection_bandwidth_per_sec = 100000;
+    config.destination_bandwidth_per_sec = 500000;
+    config.max_upload_bandwidth_per_sec = 1000;
+    config.bandwidth_burst_percent = 100;
+    __PROXY_GLOBALS__::PROXY_CONFIG.publish(config);
+    User_traffic_manager manager;
+
+    auto connection = manager.make_connection_limiter();
+    ASSERT_NE(connection, nullptr);
+    auto chain = manager.make_chain(boost::asio::ip::make_address("10.0.0.1"), "example.com", User_traffic_manager::Direction::upload, connection);
+    EXPECT_EQ(chain.size(), 4);
+    // хост назначения общий для всех клиентов
+    EXPECT_EQ(manager.get_or_create_destination("example.com", User_traffic_manager::Direction::upload).get(),
+    manager.get_or_create_destination("example.com", User_traffic_manager::Direction::upload).get());
+    // отдельный лимит пользователя на отправку (ведро 100% = 1000 байт)
+    auto upload = manager.get_or_create_user("10.0.0.2", User_traffic_manager::Direction::upload);
+    EXPECT_LE(upload->acquire(100000), 1000);
+    __PROXY_GLOBALS__::PROXY_CONFIG.publish(saved);
+}
+
+// ipv4 и ipv4-mapped ipv6 - один и тот же пользователь
+TEST_F(UserTrafficManagerTest, MappedIpv6IsSameUser)
+{
+    auto v4 = manager_.get_or_create_user(boost::asio::ip::make_address("10.1.2.3"));
+    auto mapped = manager_.get_or_create_user(boost::asio::ip::make_address("::ffff:10.1.2.3"));
+    auto other = manager_.get_or_create_user(boost::asio::ip::make_address("::10.1.2.3"));
+    EXPECT_EQ(v4.get(), mapped.get());
+    EXPECT_NE(v4.get(), other.get());
+    EXPECT_EQ(v4.get(), manager_.get_or_create_user("10.1.2.3").get()); // строка разбирается в тот же ключ
+}
+
+// одноразовые клиенты не копятся: таблица чистится по мере роста
+TEST_F(UserTrafficManagerTest, ExpiredUsersAreSweptAsTableGrows)
+{
+    for(std::uint32_t i = 0; i < 100000; i++)
+        manager_.get_or_create_user(boost::asio::ip::address_v4(0x0a000000 + i)); // лимитер сразу умирает
+    EXPECT_LT(manager_.users(), 64 * 64 * 2); // не больше двух порогов чистки на шард
+}
+
+// живые записи чисткой не удаляются
+TEST_F(UserTrafficManagerTest, SweepKeepsLiveUsers)
+{
+    std::vector<std::shared_ptr<Traffic_limiter>> alive;
+    for(std::uint32_t i = 0; i < 1000; i++)
+    {
+        auto limiter = manager_.get_or_create_user(boost::asio::ip::address_v4(0x0a000000 + i));
+        if(i % 2 == 0)
+            alive.push_back(limiter);
+    }
+    manager_.sweep();
+    EXPECT_EQ(manager_.users(), alive.size());
+    for(std::uint32_t i = 0; i < 1000; i += 2)
+        EXPECT_EQ(manager_.get_or_create_user(boost::asio::ip::address_v4(0x0a000000 + i)).get(), alive[i / 2].get());
+}
+
+// запись живет, пока жив лимитер хотя бы одного направления
+TEST_F(UserTrafficManagerTest, SweepKeepsUserWithOneLiveDirection)
+{
+    auto address = boost::asio::ip::make_address("2001:db8::1");
+    auto upload = manager_.get_or_create_user(address, User_traffic_manager::Direction::upload);
+    manager_.get_or_create_user(address, User_traffic_manager::Direction::download);
+    EXPECT_EQ(manager_.sweep(), 0);
+    EXPECT_EQ(manager_.users(), 1);
+    upload.reset();
+    EXPECT_EQ(manager_.sweep(), 1);
+    EXPECT_EQ(manager_.users(), 0);
+}
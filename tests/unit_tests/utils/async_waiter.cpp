@@ -0,0 +1,69 @@
+#include <gtest/gtest.h>
+#include "utils/async_waiter.hpp"
+#include <boost/asio.hpp>
+#include <chrono>
+#include <thread>
+#include <atomic>
+
+class AsyncWaiterTest : public ::testing::Test
+{
+protected:
+    boost::asio::io_context io_context;
+};
+
+TEST_F(AsyncWaiterTest, NotifyBeforeWait)
+{
+    auto waiter = std::make_shared<Async_waiter>(io_context.get_executor());
+    bool done = false;
+
+    waiter->notify();
+    boost::asio::co_spawn(io_context, [&]() -> boost::asio::awaitable<void>
+    {
+        co_await waiter->wait();
+        done = true;
+    }, boost::asio::detached);
+
+    io_context.run_for(std::chrono::milliseconds(50));
+    EXPECT_TRUE(done);
+}
+
+TEST_F(AsyncWaiterTest, WaitsUntilNotified)
+{
+    auto waiter = std::make_shared<Async_waiter>(io_context.get_executor());
+    bool done = false;
+
+    boost::asio::co_spawn(io_context, [&]() -> boost::asio::awaitable<void>
+    {
+        co_await waiter->wait();
+        done = true;
+    }, boost::asio::detached);
+
+    io_context.run_for(std::chrono::milliseconds(50));
+    EXPECT_FALSE(done);
+    EXPECT_FALSE(waiter->is_notified());
+
+    waiter->notify();
+    io_context.run_for(std::chrono::milliseconds(50));
+    EXPECT_TRUE(done);
+}
+
+TEST_F(AsyncWaiterTest, NotifyFromAnotherThread)
+{
+    auto waiter = std::make_shared<Async_waiter>(io_context.get_executor());
+    std::atomic<bool> done{false};
+
+    boost::asio::co_spawn(io_context, [&]() -> boost::asio::awaitable<void>
+    {
+        co_await waiter->wait();
+        done = true;
+    }, boost::asio::detached);
+
+    std::thread notifier([&]()
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        waiter->notify();
+    });
+    io_context.run_for(std::chrono::milliseconds(200));
+    notifier.join();
+    EXPECT_TRUE(done);
+}
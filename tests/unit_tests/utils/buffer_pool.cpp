@@ -0,0 +1,68 @@
+#include <gtest/gtest.h>
+#include <thread>
+#include "utils/buffer_pool.hpp"
+
+TEST(BufferPoolTest, ReleasedBufferIsReused)
+{
+    auto pool = std::make_shared<Buffer_pool>(1024, 4);
+    char* first;
+    {
+        auto buffer = pool->acquire();
+        first = buffer.data();
+        EXPECT_EQ(buffer.size(), 1024);
+        EXPECT_EQ(pool->outstanding(), 1);
+    }
+    EXPECT_EQ(pool->outstanding(), 0);
+    EXPECT_EQ(pool->cached(), 1);
+    auto buffer = pool->acquire();
+    EXPECT_EQ(buffer.data(), first);
+    EXPECT_EQ(pool->cached(), 0);
+}
+
+// свободных буферов хранится не больше max_cached
+TEST(BufferPoolTest, CacheIsBounded)
+{
+    auto pool = std::make_shared<Buffer_pool>(64, 2);
+    {
+        std::vector<Buffer_pool::Buffer> buffers;
+        for(int i = 0; i < 5; i++)
+            buffers.push_back(pool->acquire());
+        EXPECT_EQ(pool->outstanding(), 5);
+    }
+    EXPECT_EQ(pool->outstanding(), 0);
+    EXPECT_EQ(pool->cached(), 2);
+}
+
+TEST(BufferPoolTest, MoveTransfersOwnership)
+{
+    auto pool = std::make_shared<Buffer_pool>(64, 2);
+    auto first = pool->acquire();
+    auto data = first.data();
+    auto second = std::move(first);
+    EXPECT_EQ(second.data(), data);
+    EXPECT_EQ(first.data(), nullptr);
+    first = pool->acquire();
+    EXPECT_EQ(pool->outstanding(), 2);
+    first = std::move(second); // старый буфер first возвращается в пул
+    EXPECT_EQ(pool->outstanding(), 1);
+    EXPECT_EQ(first.data(), data);
+}
+
+// буфер держит пул живым, даже если пул уже никому не нужен
+TEST(BufferPoolTest, BufferOutlivesPoolOwner)
+{
+    auto pool = std::make_shared<Buffer_pool>(64, 2);
+    auto buffer = pool->acquire();
+    pool.reset();
+    EXPECT_NE(buffer.data(), nullptr);
+    EXPECT_EQ(buffer.size(), 64);
+}
+
+TEST(BufferPoolTest, LocalPoolIsPerThread)
+{
+    auto main_pool = Buffer_pool::local().get();
+    Buffer_pool* other_pool = nullptr;
+    std::thread([&other_pool](){other_pool = Buffer_pool::local().get();}).join();
+    EXPECT_NE(main_pool, other_pool);
+    EXPECT_EQ(main_pool, Buffer_pool::local().get());
+}
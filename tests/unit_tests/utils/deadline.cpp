@@ -0,0 +1,70 @@
+#include <gtest/gtest.h>
+#include "utils/deadline.hpp"
+#include <boost/asio.hpp>
+#include <chrono>
+#include <string>
+
+class DeadlineTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        acceptor_.listen();
+        client_.connect(acceptor_.local_endpoint());
+        peer_ = acceptor_.accept();
+    }
+
+    boost::asio::io_context io_context_;
+    boost::asio::ip::tcp::acceptor acceptor_{io_context_, {boost::asio::ip::make_address("127.0.0.1"), 0}};
+    boost::asio::ip::tcp::socket client_{io_context_};
+    boost::asio::ip::tcp::socket peer_{io_context_};
+};
+
+// чтение из молчащего сокета прерывается сроком, сокет остается открытым
+TEST_F(DeadlineTest, ExpiredReadBecomesTimedOut)
+{
+    boost::system::error_code ec;
+    bool expired = false;
+    auto start = std::chrono::steady_clock::now();
+    boost::asio::co_spawn(io_context_, [&]() -> boost::asio::awaitable<void>
+    {
+        char byte;
+        Deadline deadline(client_, std::chrono::milliseconds(50));
+        co_await client_.async_read_some(boost::asio::buffer(&byte, 1), boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+        deadline.check(ec);
+        expired = deadline.expired();
+    }, boost::asio::detached);
+    io_context_.run_for(std::chrono::seconds(1));
+
+    EXPECT_EQ(ec, boost::asio::error::timed_out);
+    EXPECT_TRUE(expired);
+    EXPECT_GE(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(50));
+    EXPECT_TRUE(client_.is_open());
+}
+
+// операция, завершившаяся в срок, не затрагивается, а снятый срок не отменяет следующие операции
+TEST_F(DeadlineTest, CompletedInTimeIsUntouched)
+{
+    boost::system::error_code ec;
+    bool expired = true;
+    std::size_t second_read = 0;
+    boost::asio::co_spawn(io_context_, [&]() -> boost::asio::awaitable<void>
+    {
+        char byte;
+        {
+            Deadline deadline(client_, std::chrono::milliseconds(50));
+            co_await client_.async_read_some(boost::asio::buffer(&byte, 1), boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+            deadline.check(ec);
+            expired = deadline.expired();
+        }
+        second_read = co_await client_.async_read_some(boost::asio::buffer(&byte, 1), boost::asio::use_awaitable);
+    }, boost::asio::detached);
+    boost::asio::write(peer_, boost::asio::buffer(std::string("a")));
+    io_context_.run_for(std::chrono::milliseconds(150)); // срок успел бы сработать, если бы не был снят
+    boost::asio::write(peer_, boost::asio::buffer(std::string("b")));
+    io_context_.run_for(std::chrono::milliseconds(100));
+
+    EXPECT_FALSE(ec);
+    EXPECT_FALSE(expired);
+    EXPECT_EQ(second_read, 1);
+}
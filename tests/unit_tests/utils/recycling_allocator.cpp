@@ -0,0 +1,37 @@
+#include <gtest/gtest.h>
+#include <array>
+#include "utils/recycling_allocator.hpp"
+
+TEST(RecyclingAllocatorTest, FreedBlockIsReused)
+{
+    Recycling_pool::clear();
+    void* first = Recycling_pool::allocate(100);
+    Recycling_pool::deallocate(first, 100);
+    EXPECT_EQ(Recycling_pool::cached(), 1);
+    void* second = Recycling_pool::allocate(120); // тот же класс размера (128)
+    EXPECT_EQ(second, first);
+    EXPECT_EQ(Recycling_pool::cached(), 0);
+    Recycling_pool::deallocate(second, 120);
+}
+
+TEST(RecyclingAllocatorTest, LargeBlocksBypassPool)
+{
+    Recycling_pool::clear();
+    void* block = Recycling_pool::allocate(10000);
+    Recycling_pool::deallocate(block, 10000);
+    EXPECT_EQ(Recycling_pool::cached(), 0);
+}
+
+TEST(RecyclingAllocatorTest, MakeRecycledReusesMemory)
+{
+    Recycling_pool::clear();
+    make_recycled<std::array<char, 200>>(); // прогрев: блок попадает в пул
+    EXPECT_EQ(Recycling_pool::cached(), 1);
+    for(int i = 0; i < 100; i++)
+    {
+        auto object = make_recycled<std::array<char, 200>>();
+        (*object)[0] = 1;
+        EXPECT_EQ(Recycling_pool::cached(), 0); // блок взят из пула, а не у malloc'а
+    }
+    EXPECT_EQ(Recycling_pool::cached(), 1);
+}
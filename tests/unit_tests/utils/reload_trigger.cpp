@@ -0,0 +1,92 @@
+#include <gtest/gtest.h>
+#include "utils/reload_trigger.hpp"
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <fstream>
+#include <thread>
+
+class ReloadTriggerTest : public ::testing::Test
+{
+protected:
+    void TearDown() override
+    {
+        trigger_.stop();
+        std::remove(file_);
+        std::remove("reload_trigger_test.tmp");
+    }
+
+    // ждет, пока обработчик вызовется count раз (или истечет время)
+    bool wait_for(int count, std::chrono::milliseconds limit = std::chrono::milliseconds(2000))
+    {
+        auto deadline = std::chrono::steady_clock::now() + limit;
+        while(calls_ < count && std::chrono::steady_clock::now() < deadline)
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        return calls_ >= count;
+    }
+
+    const char* file_ = "reload_trigger_test.toml";
+    std::atomic<int> calls_{0};
+    Reload_trigger trigger_;
+};
+
+TEST_F(ReloadTriggerTest, FileWriteTriggersReload)
+{
+    std::ofstream(file_) << "a";
+    trigger_.start({file_}, [this]() {calls_++;}, std::chrono::milliseconds(10), false);
+    std::ofstream("other_file_in_same_directory.tmp") << "x"; // чужой файл в том же каталоге не считается
+    std::remove("other_file_in_same_directory.tmp");
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    EXPECT_EQ(calls_, 0);
+
+    std::ofstream(file_) << "b";
+    EXPECT_TRUE(wait_for(1));
+    EXPECT_EQ(trigger_.triggers(), 1);
+}
+
+// замена файла переименованием (так сохраняют редакторы и конфиг-менеджеры)
+TEST_F(ReloadTriggerTest, RenameOverFileTriggersReload)
+{
+    std::ofstream(file_) << "a";
+    trigger_.start({file_}, [this]() {calls_++;}, std::chrono::milliseconds(10), false);
+    std::ofstream("reload_trigger_test.tmp") << "b";
+    std::rename("reload_trigger_test.tmp", file_);
+    EXPECT_TRUE(wait_for(1));
+}
+
+// серия записей в пределах debounce - одна перезагрузка
+TEST_F(ReloadTriggerTest, DebounceCoalescesWrites)
+{
+    trigger_.start({file_}, [this]() {calls_++;}, std::chrono::milliseconds(100), false);
+    for(int i = 0; i < 5; i++)
+    {
+        std::ofstream(file_) << i;
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    EXPECT_TRUE(wait_for(1));
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    EXPECT_EQ(calls_, 1);
+}
+
+TEST_F(ReloadTriggerTest, SighupTriggersReload)
+{
+    trigger_.start({file_}, [this]() {calls_++;}, std::chrono::milliseconds(10));
+    std::this_thread::sleep_for(std::chrono::milliseconds(20)); // поток триггера ждет сигнал
+    std::raise(SIGHUP);
+    EXPECT_TRUE(wait_for(1));
+}
+
+// исключение в обработчике не останавливает триггер
+TEST_F(ReloadTriggerTest, HandlerExceptionKeepsWatching)
+{
+    trigger_.start({file_}, [this]()
+    {
+        if(++calls_ == 1)
+            throw std::runtime_error("broken config");
+    }, std::chrono::milliseconds(10), false);
+    std::ofstream(file_) << "a";
+    EXPECT_TRUE(wait_for(1));
+    std::ofstream(file_) << "b";
+    EXPECT_TRUE(wait_for(2));
+}
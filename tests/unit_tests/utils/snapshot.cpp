@@ -0,0 +1,87 @@
+#include <gtest/gtest.h>
+#include "utils/snapshot.hpp"
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+TEST(SnapshotTest, ReadsPublishedValue)
+{
+    Snapshot<std::string> snapshot;
+    EXPECT_EQ(*snapshot, "");
+    EXPECT_EQ(snapshot.version(), 1);
+
+    snapshot.publish(std::string("first"));
+    EXPECT_EQ(*snapshot, "first");
+    snapshot.publish(std::string("second"));
+    EXPECT_EQ(snapshot->size(), 6);
+    EXPECT_EQ(snapshot.version(), 3);
+}
+
+// значение, взятое через get(), живет после публикации нового (сессия дорабатывает со старым конфигом)
+TEST(SnapshotTest, HeldValueOutlivesPublish)
+{
+    Snapshot<std::string> snapshot(std::make_shared<const std::string>("old"));
+    auto held = snapshot.get();
+    snapshot.publish(std::string("new"));
+    EXPECT_EQ(*held, "old");
+    EXPECT_EQ(*snapshot.get(), "new");
+}
+
+// старое значение освобождается, когда его отпустил кеш потока
+TEST(SnapshotTest, OldValueIsReleased)
+{
+    Snapshot<std::string> snapshot;
+    auto first = std::make_shared<const std::string>("first");
+    std::weak_ptr<const std::string> weak = first;
+    snapshot.publish(std::move(first));
+    EXPECT_EQ(*snapshot, "first"); // значение в кеше потока
+    snapshot.publish(std::string("second"));
+    EXPECT_FALSE(weak.expired());
+    EXPECT_EQ(*snapshot, "second");
+    EXPECT_TRUE(weak.expired());
+}
+
+// у каждого снимка свой кеш в потоке
+TEST(SnapshotTest, IndependentSnapshots)
+{
+    Snapshot<int> first(std::make_shared<const int>(1));
+    Snapshot<int> second(std::make_shared<const int>(2));
+    EXPECT_EQ(*first + *second, 3);
+    second.publish(20);
+    EXPECT_EQ(*first, 1);
+    EXPECT_EQ(*second, 20);
+}
+
+// читатели в других потоках видят только целые опубликованные значения и в итоге - последнее
+TEST(SnapshotTest, ConcurrentReaders)
+{
+    struct Pair
+    {
+        int a = 0;
+        int b = 0;
+    };
+    Snapshot<Pair> snapshot;
+    std::atomic<bool> stop{false};
+    std::atomic<int> torn{0};
+    std::vector<std::thread> readers;
+    for(int i = 0; i < 4; i++)
+    {
+        readers.emplace_back([&]()
+        {
+            while(!stop)
+            {
+                if(snapshot->a != snapshot->b)
+                    torn++;
+            }
+            if(snapshot->a != 1000)
+                torn++;
+        });
+    }
+    for(int i = 1; i <= 1000; i++)
+        snapshot.publish(Pair{i, i});
+    stop = true;
+    for(auto& reader : readers)
+        reader.join();
+    EXPECT_EQ(torn, 0);
+}
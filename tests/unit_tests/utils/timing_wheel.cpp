@@ -0,0 +1,106 @@
+#include <gtest/gtest.h>
+#include "utils/timer.hpp"
+#include "utils/timing_wheel.hpp"
+#include <boost/asio.hpp>
+#include <chrono>
+#include <memory>
+#include <vector>
+
+class TimingWheelTest : public ::testing::Test
+{
+protected:
+    boost::asio::io_context io_context_;
+    boost::asio::any_io_executor executor_ = io_context_.get_executor();
+};
+
+// у одного io_context'а одно колесо
+TEST_F(TimingWheelTest, OneWheelPerContext)
+{
+    boost::asio::io_context other;
+    EXPECT_EQ(&Timing_wheel::of(executor_), &Timing_wheel::of(io_context_.get_executor()));
+    EXPECT_NE(&Timing_wheel::of(executor_), &Timing_wheel::of(other.get_executor()));
+}
+
+// срок больше первого уровня: запись спускается по уровням и срабатывает вовремя
+TEST_F(TimingWheelTest, LongIntervalCascades)
+{
+    std::chrono::steady_clock::time_point fired;
+    auto timer = std::make_shared<Timer>(executor_, 900);
+    timer->set_callback_func([&] {fired = std::chrono::steady_clock::now();});
+    auto start = std::chrono::steady_clock::now();
+    timer->start();
+    io_context_.run(); // возвращается, когда колесо опустело
+    EXPECT_GE(fired - start, std::chrono::milliseconds(900));
+    EXPECT_LT(fired - start, std::chrono::milliseconds(900) + 4 * Timing_wheel::TICK);
+    EXPECT_EQ(Timing_wheel::of(executor_).size(), 0);
+}
+
+// продление не трогает колесо, таймер срабатывает только через интервал после последней активности
+TEST_F(TimingWheelTest, RefreshDefersExpiry)
+{
+    int fired = 0;
+    auto timer = std::make_shared<Timer>(executor_, 100);
+    timer->set_callback_func([&] {fired++;});
+    timer->start();
+    for(int i = 0; i < 6; i++)
+    {
+        io_context_.run_for(std::chrono::milliseconds(40));
+        timer->refresh();
+        EXPECT_EQ(Timing_wheel::of(executor_).size(), 1);
+    }
+    EXPECT_EQ(fired, 0);
+    io_context_.run_for(std::chrono::milliseconds(200));
+    EXPECT_EQ(fired, 1);
+}
+
+// остановленные и уничтоженные таймеры снимаются с колеса, пустое колесо не держит run()
+TEST_F(TimingWheelTest, StopAndDestroyUnlink)
+{
+    int fired = 0;
+    std::vector<std::shared_ptr<Timer>> timers;
+    for(int i = 0; i < 1000; i++)
+    {
+        timers.push_back(std::make_shared<Timer>(executor_, 50 + i));
+        timers.back()->set_callback_func([&] {fired++;});
+        timers.back()->start(); // вне потока io_context'а - через post
+    }
+    io_context_.poll();
+    EXPECT_EQ(Timing_wheel::of(executor_).size(), 1000);
+    for(int i = 0; i < 1000; i += 2)
+        timers[i]->stop();
+    for(int i = 1; i < 1000; i += 4)
+        timers[i].reset();
+    io_context_.poll();
+    EXPECT_EQ(Timing_wheel::of(executor_).size(), 250);
+    io_context_.run();
+    EXPECT_EQ(fired, 250);
+}
+
+// callback может уничтожить другой таймер, который срабатывает в тот же тик
+TEST_F(TimingWheelTest, CallbackDestroysNeighbour)
+{
+    int fired = 0;
+    std::shared_ptr<Timer> first = std::make_shared<Timer>(executor_, 30);
+    std::shared_ptr<Timer> second = std::make_shared<Timer>(executor_, 30);
+    first->set_callback_func([&] {fired++; second.reset();});
+    second->set_callback_func([&] {fired++; first.reset();});
+    first->start();
+    second->start();
+    io_context_.run();
+    EXPECT_EQ(fired, 1);
+    EXPECT_EQ(Timing_wheel::of(executor_).size(), 0);
+}
+
+// сработавший таймер заново ставится через refresh
+TEST_F(TimingWheelTest, RefreshAfterExpiryRearms)
+{
+    int fired = 0;
+    auto timer = std::make_shared<Timer>(executor_, 20);
+    timer->set_callback_func([&] {fired++;});
+    timer->start();
+    io_context_.run();
+    io_context_.restart();
+    timer->refresh();
+    io_context_.run();
+    EXPECT_EQ(fired, 2);
+}
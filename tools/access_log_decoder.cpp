@@ -0,0 +1,41 @@
+// перевод бинарного access log'а прокси в CSV или JSON (по объекту на строку)
+// использование: access_log_decoder [--json] file...  (файлы после ротации можно перечислить по порядку)
+#include "logger/access_log.hpp"
+#include <iostream>
+#include <string>
+#include <vector>
+
+int main(int argc, char** argv)
+{
+    bool json = false;
+    std::vector<std::string> files;
+    for(int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if(arg == "--json")
+            json = true;
+        else
+            files.push_back(arg);
+    }
+    if(files.empty())
+    {
+        std::cerr << "usage: " << argv[0] << " [--json] file..." << std::endl;
+        return 2;
+    }
+    if(!json)
+        std::cout << Access_log::csv_header() << "\n";
+    int result = 0;
+    for(const auto& file : files)
+    {
+        std::vector<Access_record> records;
+        if(!Access_log::load(file, records))
+        {
+            std::cerr << file << ": not an access log" << std::endl;
+            result = 1;
+            continue;
+        }
+        for(const auto& record : records)
+            std::cout << (json ? Access_log::to_json(record) : Access_log::to_csv(record)) << "\n";
+    }
+    return result;
+}
@@ -0,0 +1,54 @@
+// компиляция черного списка в бинарный файл, который прокси отображает в память без разбора
+// использование: blacklist_compile <blacklisted_hosts.toml | список.txt> <blacklist.bin>
+// .toml - формат blacklist-editor.sh, любой другой файл - по правилу на строку (# - комментарий)
+// полученный файл указывается в blacklisted_hosts_file_name вместо toml
+#include "config/proxy_config.hpp"
+#include "network/domain_matcher.hpp"
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+int main(int argc, char** argv)
+{
+    if(argc != 3)
+    {
+        std::cerr << "usage: " << argv[0] << " <blacklisted_hosts.toml | list.txt> <blacklist.bin>" << std::endl;
+        return 2;
+    }
+    std::string input = argv[1];
+    std::string output = argv[2];
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::string> rules;
+    if(input.ends_with(".toml"))
+    {
+        auto hosts = Proxy_Config::read_blacklist(input);
+        if(!hosts) // ошибка уже напечатана
+            return 1;
+        rules = std::move(*hosts);
+    }
+    else
+    {
+        std::ifstream file(input);
+        if(!file)
+        {
+            std::cerr << input << ": cannot open" << std::endl;
+            return 1;
+        }
+        for(std::string line; std::getline(file, line);)
+            rules.push_back(std::move(line));
+    }
+    Domain_matcher matcher;
+    auto skipped = matcher.build(rules);
+    rules = {};
+    if(!matcher.save(output))
+    {
+        std::cerr << output << ": cannot write" << std::endl;
+        return 1;
+    }
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << output << ": " << matcher.rules() << " rules, " << matcher.nodes() << " nodes, "
+    << matcher.memory_bytes() / 1024 << " KiB, " << skipped << " invalid rules skipped, " << elapsed << " s" << std::endl;
+    return 0;
+}